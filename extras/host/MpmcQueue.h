@@ -0,0 +1,100 @@
+/**************************************************************************/
+/*!
+ * @file MpmcQueue.h
+ * @brief 固定長のロックフリーキュー（複数の書き込み・複数の読み出し）  ホスト側
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    各要素に順番を持たせる方式（D. Vyukovのbounded MPMC queue）。
+ *    push(), pop()はロックもメモリ確保もしない。満杯・空の時は待たずにfalseを返す。
+ */
+/**************************************************************************/
+
+#ifndef _MPMCQUEUE_H_
+#define _MPMCQUEUE_H_
+
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, size_t SIZE>
+class MpmcQueue {
+
+    static_assert((SIZE & (SIZE - 1)) == 0 && SIZE >= 2, "SIZE must be a power of 2");
+
+    public:
+    // methods
+    MpmcQueue(){
+        for (size_t i = 0; i < SIZE; i++){
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    };
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    /// @brief 1つ加える
+    /// @param value 値
+    /// @return True:成功   False:満杯
+    bool push(const T& value){
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        for (;;){
+            Cell& cell = cells[position & (SIZE - 1)];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (diff == 0){
+                if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                    cell.value = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0){
+                return false;
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /// @brief 1つ取り出す
+    /// @param value 取り出した値
+    /// @return True:成功   False:空
+    bool pop(T& value){
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        for (;;){
+            Cell& cell = cells[position & (SIZE - 1)];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (diff == 0){
+                if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                    value = cell.value;
+                    cell.sequence.store(position + SIZE, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0){
+                return false;
+            } else {
+                position = dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    private:
+    // consts
+
+    // 書き込み位置と読み出し位置を別のキャッシュラインに置く
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // types
+    struct Cell{
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // vars
+    Cell cells[SIZE];
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_position{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_position{0};
+};
+
+#endif //_MPMCQUEUE_H_
@@ -0,0 +1,197 @@
+#include "MultidropPoller.h"
+#include "Cobs.h"
+
+namespace {
+
+// IotGateway::E_Schemaと同じ並び  (値の長さ, fieldsのビット)
+struct Schema{
+    uint8_t size;
+    uint8_t field;
+};
+
+constexpr Schema schemas[] = {
+    { 2, TelemetryRecord::FIELD_LEVEL },
+    { 1, TelemetryRecord::FIELD_MODE },
+    { 2, TelemetryRecord::FIELD_REMAIN },
+    { 1, TelemetryRecord::FIELD_ERROR }
+};
+
+// IotGateway::RECORD_TIMESTAMP  液面の取得時刻  ホストの時刻 [ms] 48bit
+constexpr uint8_t RECORD_TIMESTAMP = 0x10;
+constexpr uint8_t TIMESTAMP_SIZE = 6;
+
+}   // namespace
+
+/// @brief constructor
+/// @param bus バス
+/// @param timeout_us 要求の送信開始から応答を待つ時間 [us]
+/// @param turnaround_us 応答を受けてから次の要求を送るまでの時間 [us]  子局のCLK周期 + 1byte以上
+MultidropPoller::MultidropPoller(Bus& bus, const uint32_t timeout_us, const uint32_t turnaround_us)
+    : bus(bus), timeout_us(timeout_us), turnaround_us(turnaround_us){
+}
+
+/// @brief POLLする子局を加える
+/// @param address アドレス  1-247
+void MultidropPoller::addNode(const uint8_t address){
+    Node node = {};
+    node.address = address;
+    node.backoff = 1;
+    node.last.source = address;
+    node.request.resize(MultidropFrame::MAX_ENCODED_LENGTH);
+    node.request.resize(MultidropFrame::encode(address, MultidropFrame::FUNCTION_POLL, nullptr, 0, node.request.data()));
+    nodes.push_back(node);
+}
+
+/// @brief 応答の値を受け取る関数を設定する
+/// @param handler 応答ごとに呼び出す
+void MultidropPoller::setHandler(Handler handler){
+    this->handler = handler;
+}
+
+/// @brief 受信・タイムアウトを確認し、バスが空いていれば次の子局に要求を送る
+/// @note ブロックしない  繰り返し呼び出す
+void MultidropPoller::service(void){
+    const uint64_t now = bus.now();
+    if (waiting){
+        receive(now);
+        if (waiting && now - sent_us >= timeout_us){
+            Node& node = nodes[current];
+            node.timeouts++;
+            node.skip_rounds = node.backoff;
+            if (node.backoff < MAX_BACKOFF){
+                node.backoff *= 2;
+            }
+            waiting = false;
+            idle_from_us = now;
+        }
+    }
+    if (!waiting && now >= idle_from_us){
+        sendNext(now);
+    }
+}
+
+/// @brief 受信データを区切りまでためて応答を処理する   (private)
+/// @param now 現在時刻 [us]
+void MultidropPoller::receive(const uint64_t now){
+    uint8_t buffer[64];
+    size_t length = 0;
+    while (waiting && (length = bus.receive(buffer, sizeof(buffer))) != 0){
+        for (size_t i = 0; i < length; i++){
+            if (buffer[i] != Cobs::DELIMITER){
+                if (rx_length < sizeof(rx_frame)){
+                    rx_frame[rx_length++] = buffer[i];
+                } else {
+                    rx_overflow = true;
+                }
+                continue;
+            }
+            if (rx_length != 0 && (rx_overflow || !handleFrame(now))){
+                error_count++;
+            }
+            rx_length = 0;
+            rx_overflow = false;
+        }
+    }
+}
+
+/// @brief 1フレームを処理する   (private)
+/// @param now 現在時刻 [us]
+/// @return True:要求中の子局の応答   False:不正なフレーム
+bool MultidropPoller::handleFrame(const uint64_t now){
+    uint8_t address = 0;
+    uint8_t function = 0;
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    if (!MultidropFrame::decode(rx_frame, rx_length, address, function, data, length)){
+        return false;
+    }
+    if (!waiting || address != nodes[current].address
+        || function != (MultidropFrame::FUNCTION_POLL | MultidropFrame::RESPONSE_FLAG) || length == 0){
+        return false;
+    }
+
+    // [シーケンス番号][ID 値]...[RECORD_TIMESTAMP 時刻]
+    Node& node = nodes[current];
+    TelemetryRecord record = node.last;
+    record.sequence = data[0];
+    record.fields = 0;
+    for (size_t index = 1; index < length;){
+        const uint8_t id = data[index++];
+        if (id == RECORD_TIMESTAMP){
+            if (index + TIMESTAMP_SIZE > length){
+                return false;
+            }
+            record.timestamp_ms = 0;
+            for (uint8_t i = 0; i < TIMESTAMP_SIZE; i++){
+                record.timestamp_ms |= static_cast<uint64_t>(data[index++]) << (8 * i);
+            }
+            record.fields |= TelemetryRecord::FIELD_TIMESTAMP;
+            continue;
+        }
+        if (id == 0 || id > sizeof(schemas) / sizeof(schemas[0]) || index + schemas[id - 1].size > length){
+            return false;
+        }
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < schemas[id - 1].size; i++){
+            value |= static_cast<uint32_t>(data[index++]) << (8 * i);
+        }
+        switch (schemas[id - 1].field){
+            case TelemetryRecord::FIELD_LEVEL :  record.level = value;  break;
+            case TelemetryRecord::FIELD_MODE :   record.mode = value;   break;
+            case TelemetryRecord::FIELD_REMAIN : record.remain = value; break;
+            default:                             record.error = value;  break;
+        }
+        record.fields |= schemas[id - 1].field;
+    }
+
+    node.last = record;
+    node.responses++;
+    node.backoff = 1;
+    node.last_response_us = now;
+    if (now - sent_us > node.max_response_us){
+        node.max_response_us = now - sent_us;
+    }
+    waiting = false;
+    idle_from_us = now + turnaround_us;
+    if (handler){
+        handler(record);
+    }
+    return true;
+}
+
+/// @brief 次の子局に要求を送る  飛ばす周回数が残っている子局は飛ばす   (private)
+/// @param now 現在時刻 [us]
+void MultidropPoller::sendNext(const uint64_t now){
+    if (nodes.empty()){
+        return;
+    }
+    // 全ての子局が飛ばす状態でも、1周分で必ず抜ける
+    for (size_t tried = 0; tried <= nodes.size(); tried++){
+        current = round_started ? current + 1 : 0;
+        if (current >= nodes.size()){
+            current = 0;
+        }
+        if (current == 0){
+            if (round_started){
+                const uint64_t elapsed = now - round_start_us;
+                round_stat.count++;
+                round_stat.total_us += elapsed;
+                round_stat.min_us = (elapsed < round_stat.min_us) ? elapsed : round_stat.min_us;
+                round_stat.max_us = (elapsed > round_stat.max_us) ? elapsed : round_stat.max_us;
+            }
+            round_started = true;
+            round_start_us = now;
+        }
+        Node& node = nodes[current];
+        if (node.skip_rounds != 0){
+            node.skip_rounds--;
+            continue;
+        }
+        rx_length = 0;
+        rx_overflow = false;
+        bus.send(node.request.data(), node.request.size());
+        sent_us = now;
+        waiting = true;
+        return;
+    }
+}
@@ -0,0 +1,128 @@
+/**************************************************************************/
+/*!
+ * @file MultidropPoller.h/cpp
+ * @brief RS-485マルチドロップの親局  子局（IotGateway）を順にPOLLする（ホスト側）
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    service()を繰り返し呼び出すと、応答を受けた時点で次の子局への要求（符号化済み）を続けて送る。
+ *    応答しない子局は連続したタイムアウトの回数に応じて何周か飛ばすので、1台の故障で全体の周期が延びない。
+ *    全ての子局を1周するのにかかった時間（fleet refresh time）を集計する。
+ *    半二重のバスでは、子局はCLKごとにしかDEをLOWにできないので、応答の後はturnaroundの間を空けて次の要求を送る。
+ *    フレームはファームウエアと同じsrc/MultidropFrame.cppを使う。
+ *
+ *    1台ずつ要求して応答を待つ（stop-and-wait）  半二重のバスで子局は非同期のCLKで応答するので、
+ *    要求中の子局を複数にはできない（extras/host/sim_multidrop.cppを参照）
+ *
+ *    ビルド例: extras/host/sim_multidrop.cpp を参照
+ */
+/**************************************************************************/
+
+#ifndef _MULTIDROPPOLLER_H_
+#define _MULTIDROPPOLLER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+#include "MultidropFrame.h"
+#include "TelemetryIngest.h"
+
+class MultidropPoller {
+
+    public:
+    // types
+
+    /*!
+     * @brief 半二重のバス  シリアルポート、またはシミュレーション
+     */
+    class Bus {
+        public:
+        virtual ~Bus(){};
+        virtual void send(const uint8_t* data, const size_t length) = 0;    // 送信が終わるまで他は送らない
+        virtual size_t receive(uint8_t* data, const size_t length) = 0;     // ブロックしない
+        virtual uint64_t now(void) = 0;                                     // [us]
+    };
+
+    /*!
+     * @brief 子局ごとの状態
+     */
+    struct Node{
+        uint8_t address;
+        uint64_t responses;
+        uint64_t timeouts;
+        uint8_t backoff;            // 連続タイムアウトで飛ばす周回数  1, 2, 4...MAX_BACKOFF
+        uint8_t skip_rounds;        // 残りの飛ばす周回数
+        uint64_t last_response_us;
+        uint64_t max_response_us;   // 要求の送信開始から応答までの最大時間
+        TelemetryRecord last;       // 最後に受けた値  sourceはアドレス
+        std::vector<uint8_t> request;   // 符号化済みのPOLL要求
+    };
+
+    /*!
+     * @brief 全ての子局を1周するのにかかった時間
+     */
+    struct RoundStat{
+        uint64_t count;
+        uint64_t total_us;
+        uint64_t min_us;
+        uint64_t max_us;
+    };
+
+    // 応答の値を受け取る関数
+    using Handler = std::function<void(const TelemetryRecord& record)>;
+
+    // consts
+
+    // 連続タイムアウト時に飛ばす周回数の上限
+    static constexpr uint8_t MAX_BACKOFF = 16;
+
+    // methods
+    MultidropPoller(Bus& bus, const uint32_t timeout_us, const uint32_t turnaround_us);
+
+    void addNode(const uint8_t address);
+    void setHandler(Handler handler);
+    void service(void);
+
+    const std::vector<Node>& getNodes(void) const {
+        return nodes;
+    };
+
+    const RoundStat& getRoundStat(void) const {
+        return round_stat;
+    };
+
+    /// @brief 受けたが不正だった（CRCエラー、宛先違い）フレームの数
+    uint64_t getErrorCount(void) const {
+        return error_count;
+    };
+
+    private:
+    // vars
+    Bus& bus;
+    const uint32_t timeout_us;
+    const uint32_t turnaround_us;
+    Handler handler;
+    std::vector<Node> nodes;
+
+    size_t current = 0;             // 要求中、または最後に要求した子局
+    bool waiting = false;
+    uint64_t sent_us = 0;           // 要求の送信開始時刻
+    uint64_t idle_from_us = 0;      // この時刻から次の要求を送れる
+    uint64_t round_start_us = 0;
+    bool round_started = false;
+    RoundStat round_stat = { 0, 0, UINT64_MAX, 0 };
+    uint64_t error_count = 0;
+
+    uint8_t rx_frame[MultidropFrame::MAX_ENCODED_LENGTH];
+    size_t rx_length = 0;
+    bool rx_overflow = false;
+
+    // methods
+    void receive(const uint64_t now);
+    bool handleFrame(const uint64_t now);
+    void sendNext(const uint64_t now);
+};
+
+#endif //_MULTIDROPPOLLER_H_
@@ -0,0 +1,189 @@
+#include "TelemetryDecoder.h"
+#include "Cobs.h"
+#include "Crc16.h"
+
+namespace {
+
+// IotGateway::E_Schemaと同じ並び  (ID, キー, 値の長さ)
+struct Schema{
+    uint8_t id;
+    const char* key;
+    uint8_t size;
+};
+
+constexpr Schema schemas[] = {
+    { 0x01, "level", 2 },
+    { 0x02, "mode", 1 },
+    { 0x03, "remain", 2 },
+    { 0x04, "error", 1 }
+};
+
+constexpr uint8_t FRAME_TYPE_RECORDS = 0x01;
+constexpr uint8_t FRAME_TYPE_BATCH = 0x02;
+constexpr uint8_t FRAME_TYPE_BATCH_EPOCH = 0x03;
+
+// IotGateway::RECORD_TIMESTAMP  値はホストの時刻 [ms] 48bit
+constexpr uint8_t RECORD_TIMESTAMP = 0x10;
+constexpr uint8_t TIMESTAMP_SIZE = 6;
+
+const Schema* findSchema(const uint8_t id){
+    for (const Schema& schema : schemas){
+        if (schema.id == id){
+            return &schema;
+        }
+    }
+    return nullptr;
+}
+
+// varintを読み、zigzagを戻す
+bool getSignedVarint(const uint8_t* data, const size_t length, size_t& index, int32_t& value){
+    uint32_t raw = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7){
+        if (index >= length){
+            return false;
+        }
+        const uint8_t byte = data[index++];
+        raw |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0){
+            value = static_cast<int32_t>(raw >> 1) ^ -static_cast<int32_t>(raw & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+}   // namespace
+
+/// @brief 受信したバイト列を渡す  フレームが揃うごとにhandlerを呼び出す
+/// @param data 受信データ
+/// @param length データ長
+void TelemetryDecoder::feed(const uint8_t* data, const size_t length){
+    for (size_t i = 0; i < length; i++){
+        if (data[i] != Cobs::DELIMITER){
+            if (frame.size() < MAX_FRAME_LENGTH){
+                frame.push_back(data[i]);
+            } else {
+                overflow = true;
+            }
+            continue;
+        }
+        if (!frame.empty()){
+            std::string json;
+            if (!overflow && decodeFrame(frame.data(), frame.size(), json)){
+                handler(json);
+            } else {
+                error_count++;
+            }
+        }
+        frame.clear();
+        overflow = false;
+    }
+}
+
+/// @brief 1フレームを復号する
+/// @param encoded COBSで符号化されたフレーム（区切りは含まない）
+/// @param length データ長
+/// @param json 変換したJSON
+/// @return True:成功   False:COBS, CRC, レコードのいずれかが不正
+bool TelemetryDecoder::decodeFrame(const uint8_t* encoded, const size_t length, std::string& json){
+    std::vector<uint8_t> decoded(length);
+    const size_t decoded_length = Cobs::decode(encoded, length, decoded.data());
+    // 種類, シーケンス番号, CRC 2byte
+    if (decoded_length < 4){
+        return false;
+    }
+    const size_t body_length = decoded_length - 2;
+    const uint16_t crc = decoded[body_length] | (decoded[body_length + 1] << 8);
+    if (Crc16::modbus(decoded.data(), body_length) != crc){
+        return false;
+    }
+    return decodeRecords(decoded.data(), body_length, json);
+}
+
+/// @brief フレームの内容をJSONに変換する
+/// @param data フレーム（CRCを除く）
+/// @param length データ長
+/// @param json 変換したJSON
+/// @return True:成功   False:不明な種類・レコード
+bool TelemetryDecoder::decodeRecords(const uint8_t* data, const size_t length, std::string& json){
+    if (data[0] == FRAME_TYPE_BATCH || data[0] == FRAME_TYPE_BATCH_EPOCH){
+        return decodeBatch(data, length, json);
+    }
+    if (data[0] != FRAME_TYPE_RECORDS){
+        return false;
+    }
+    json = "{\"seq\":" + std::to_string(data[1]);
+    size_t index = 2;
+    while (index < length){
+        if (data[index] == RECORD_TIMESTAMP){
+            index++;
+            if (index + TIMESTAMP_SIZE > length){
+                return false;
+            }
+            uint64_t timestamp = 0;
+            for (uint8_t i = 0; i < TIMESTAMP_SIZE; i++){
+                timestamp |= static_cast<uint64_t>(data[index++]) << (8 * i);
+            }
+            json += ",\"ts\":" + std::to_string(timestamp);
+            continue;
+        }
+        const Schema* schema = findSchema(data[index++]);
+        if (schema == nullptr || index + schema->size > length){
+            return false;
+        }
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < schema->size; i++){
+            value |= static_cast<uint32_t>(data[index++]) << (8 * i);
+        }
+        json += ",\"" + std::string(schema->key) + "\":" + std::to_string(value);
+    }
+    json += "}";
+    return true;
+}
+
+/// @brief バッチのフレームをJSONに変換する
+/// @param data フレーム（CRCを除く）
+/// @param length データ長
+/// @param json 変換したJSON
+/// @return True:成功   False:長さ・数が合わない
+/// @note 時刻は差分の差分、液面は差分をzigzag varintで並べてある
+///       FRAME_TYPE_BATCH_EPOCHでは最初の時刻が6byteのホストの時刻で、キーは"ts"にする
+bool TelemetryDecoder::decodeBatch(const uint8_t* data, const size_t length, std::string& json){
+    // 種類, シーケンス番号, 数, 最初の時刻 4byte（6byte）, 最初の液面 2byte
+    const bool epoch = data[0] == FRAME_TYPE_BATCH_EPOCH;
+    const uint8_t time_size = epoch ? TIMESTAMP_SIZE : 4;
+    if (length < 3u + time_size + 2 || data[2] == 0){
+        return false;
+    }
+    const uint8_t count = data[2];
+    uint64_t time = 0;
+    for (uint8_t i = 0; i < time_size; i++){
+        time |= static_cast<uint64_t>(data[3 + i]) << (8 * i);
+    }
+    size_t index = 3 + time_size;
+    int32_t level = data[index] | (data[index + 1] << 8);
+    int32_t interval = 0;
+    index += 2;
+    const char* time_key = epoch ? "{\"ts\":" : "{\"t\":";
+
+    json = "{\"seq\":" + std::to_string(data[1]) + ",\"batch\":[";
+    for (uint8_t i = 0; i < count; i++){
+        if (i != 0){
+            int32_t time_delta = 0;
+            int32_t level_delta = 0;
+            if (!getSignedVarint(data, length, index, time_delta) || !getSignedVarint(data, length, index, level_delta)){
+                return false;
+            }
+            interval += time_delta;
+            time += interval;
+            if (!epoch){
+                time &= UINT32_MAX;
+            }
+            level += level_delta;
+            json += ",";
+        }
+        json += time_key + std::to_string(time) + ",\"level\":" + std::to_string(level) + "}";
+    }
+    json += "]}";
+    return index == length;
+}
@@ -0,0 +1,68 @@
+/**************************************************************************/
+/*!
+ * @file TelemetryDecoder.h/cpp
+ * @brief IotGatewayのバイナリ形式のテレメトリをJSONに戻す（ホスト側）
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    受信したバイト列をfeed()に渡すと、0x00で区切られたフレームごとにCOBSを復号し、
+ *    CRCを確認してJSON（IotGatewayのJSON形式と同じキー）に変換する。
+ *    バッチのフレームは {"seq":n,"batch":[{"t":取得時刻[ms],"level":液面},...]} に変換する。
+ *    計測ユニットの時刻が同期済みの場合、取得時刻はホストの時刻 [ms] で、キーは"ts"になる。
+ *    COBS, CRCはファームウエアと同じsrc/Cobs.cpp, src/Crc16.cppを使う。
+ *
+ *    ビルド例:
+ *      g++ -std=c++14 -I../../src decode_telemetry.cpp TelemetryDecoder.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp
+ */
+/**************************************************************************/
+
+#ifndef _TELEMETRYDECODER_H_
+#define _TELEMETRYDECODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+class TelemetryDecoder {
+
+    public:
+    // types
+
+    // 復号したフレームを受け取る関数  JSON（大外の { } 付き）
+    using Handler = std::function<void(const std::string& json)>;
+
+    // methods
+    explicit TelemetryDecoder(Handler handler)
+        : handler(handler){
+    };
+
+    void feed(const uint8_t* data, const size_t length);
+
+    bool decodeFrame(const uint8_t* encoded, const size_t length, std::string& json);
+
+    /// @brief CRCエラーなどで捨てたフレームの数
+    uint32_t getErrorCount(void) const {
+        return error_count;
+    };
+
+    private:
+    // consts
+
+    // 受信中のフレームの最大長  これを超えたら次の区切りまで捨てる
+    static constexpr size_t MAX_FRAME_LENGTH = 512;
+
+    // vars
+    Handler handler;
+    std::vector<uint8_t> frame;
+    bool overflow = false;
+    uint32_t error_count = 0;
+
+    // methods
+    bool decodeRecords(const uint8_t* data, const size_t length, std::string& json);
+    bool decodeBatch(const uint8_t* data, const size_t length, std::string& json);
+};
+
+#endif //_TELEMETRYDECODER_H_
@@ -0,0 +1,418 @@
+#include "TelemetryIngest.h"
+#include "Cobs.h"
+#include "Crc16.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace {
+
+// IotGateway::E_Schemaと同じ並び、最後はIotGateway::RECORD_TIMESTAMP  (ID, キー, キーの長さ, 値の長さ, fieldsのビット)
+struct Schema{
+    uint8_t id;
+    const char* key;
+    uint8_t key_length;
+    uint8_t size;
+    uint8_t field;
+};
+
+constexpr Schema schemas[] = {
+    { 0x01, "level", 5, 2, TelemetryRecord::FIELD_LEVEL },
+    { 0x02, "mode", 4, 1, TelemetryRecord::FIELD_MODE },
+    { 0x03, "remain", 6, 2, TelemetryRecord::FIELD_REMAIN },
+    { 0x04, "error", 5, 1, TelemetryRecord::FIELD_ERROR },
+    { 0x10, "ts", 2, 6, TelemetryRecord::FIELD_TIMESTAMP }
+};
+
+constexpr uint8_t FRAME_TYPE_RECORDS = 0x01;
+constexpr uint8_t FRAME_TYPE_BATCH = 0x02;
+constexpr uint8_t FRAME_TYPE_BATCH_EPOCH = 0x03;
+constexpr uint8_t TIMESTAMP_SIZE = 6;
+
+// 値をレコードに書き込む
+void setField(TelemetryRecord& record, const uint8_t field, const uint64_t value){
+    switch (field){
+        case TelemetryRecord::FIELD_LEVEL :  record.level = value;  break;
+        case TelemetryRecord::FIELD_MODE :   record.mode = value;   break;
+        case TelemetryRecord::FIELD_REMAIN : record.remain = value; break;
+        case TelemetryRecord::FIELD_ERROR :  record.error = value;  break;
+        case TelemetryRecord::FIELD_TIMESTAMP : record.timestamp_ms = value; break;
+        default: return;
+    }
+    record.fields |= field;
+}
+
+const char* skipSpace(const char* p, const char* end){
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')){
+        p++;
+    }
+    return p;
+}
+
+// "で始まる文字列の終わりの次を返す  閉じていなければnullptr
+const char* skipString(const char* p, const char* end){
+    for (p++; p < end; p++){
+        if (*p == '\\'){
+            p++;
+        } else if (*p == '"'){
+            return p + 1;
+        }
+    }
+    return nullptr;
+}
+
+// 値を1つ読み飛ばす  入れ子の{ }, [ ]も読み飛ばす
+const char* skipValue(const char* p, const char* end){
+    int depth = 0;
+    while (p < end){
+        const char c = *p;
+        if (c == '"'){
+            p = skipString(p, end);
+            if (p == nullptr){
+                return nullptr;
+            }
+            if (depth == 0){
+                return p;
+            }
+            continue;
+        }
+        if (c == '{' || c == '['){
+            depth++;
+        } else if (c == '}' || c == ']'){
+            if (depth == 0){
+                return p;
+            }
+            if (--depth == 0){
+                return p + 1;
+            }
+        } else if (c == ',' && depth == 0){
+            return p;
+        }
+        p++;
+    }
+    return (depth == 0) ? p : nullptr;
+}
+
+// varintを読み、zigzagを戻す
+bool getSignedVarint(const uint8_t* data, const size_t length, size_t& index, int32_t& value){
+    uint32_t raw = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7){
+        if (index >= length){
+            return false;
+        }
+        const uint8_t byte = data[index++];
+        raw |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0){
+            value = static_cast<int32_t>(raw >> 1) ^ -static_cast<int32_t>(raw & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+}   // namespace
+
+/// @brief constructor
+/// @param queue 解析したレコードを入れるキュー
+TelemetryIngest::TelemetryIngest(RecordQueue& queue)
+    : queue(queue){
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+}
+
+/// @brief deconstructor  ソースのfdは閉じない
+TelemetryIngest::~TelemetryIngest(){
+    if (epoll_fd >= 0){
+        close(epoll_fd);
+    }
+}
+
+/// @brief 受信するソースを加える
+/// @param fd シリアルポート・ptyのfd  ノンブロッキングにする  閉じるのは呼び出し側
+/// @param source レコードに付けるID
+/// @param framing 形式
+/// @return True:成功   False:epollに登録できない
+bool TelemetryIngest::addSource(const int fd, const uint16_t source, const E_Framing framing){
+    if (epoll_fd < 0){
+        return false;
+    }
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0){
+        return false;
+    }
+    std::unique_ptr<Source> entry(new Source());
+    entry->fd = fd;
+    entry->id = source;
+    entry->framing = framing;
+    entry->used = 0;
+    entry->overflow = false;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = entry.get();
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0){
+        return false;
+    }
+    sources.push_back(std::move(entry));
+    return true;
+}
+
+/// @brief 受信できるソースを1回ずつ読む
+/// @param timeout_ms 受信を待つ時間 [ms]  -1:受信するまで待つ
+/// @return キューに入れたレコードの数
+/// @note 1回のpoll()では各ソースを1回だけread()するので、特定のソースが他を待たせない
+size_t TelemetryIngest::poll(const int timeout_ms){
+    epoll_event events[MAX_EVENTS];
+    const uint64_t start_count = record_count;
+    const int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < count; i++){
+        readSource(*static_cast<Source*>(events[i].data.ptr));
+    }
+    return record_count - start_count;
+}
+
+/// @brief stopがtrueになるまで受信し続ける
+/// @param stop 終了要求
+void TelemetryIngest::run(const std::atomic<bool>& stop){
+    while (!stop.load(std::memory_order_relaxed)){
+        poll(100);
+    }
+}
+
+/// @brief 1つの計測値のJSONフレームを解析する
+/// @param begin 行の先頭
+/// @param end 行の終わり（改行を含まない）
+/// @param record 解析したレコード  fieldsは0から設定する
+/// @return True:成功   False:JSONとして不正
+/// @note 知らないキーは読み飛ばす  数値は整数部のみ使う
+bool TelemetryIngest::parseJson(const char* begin, const char* end, TelemetryRecord& record){
+    record.fields = 0;
+    const char* p = skipSpace(begin, end);
+    if (p >= end || *p++ != '{'){
+        return false;
+    }
+    p = skipSpace(p, end);
+    if (p < end && *p == '}'){
+        return true;
+    }
+    while (p < end){
+        if (*p != '"'){
+            return false;
+        }
+        const char* key = p + 1;
+        p = skipString(p, end);
+        if (p == nullptr){
+            return false;
+        }
+        const size_t key_length = (p - 1) - key;
+        p = skipSpace(p, end);
+        if (p >= end || *p++ != ':'){
+            return false;
+        }
+        p = skipSpace(p, end);
+
+        const Schema* schema = nullptr;
+        for (const Schema& candidate : schemas){
+            if (candidate.key_length == key_length && memcmp(candidate.key, key, key_length) == 0){
+                schema = &candidate;
+                break;
+            }
+        }
+        if (schema != nullptr && p < end && *p >= '0' && *p <= '9'){
+            uint64_t value = 0;
+            while (p < end && *p >= '0' && *p <= '9'){
+                value = value * 10 + (*p++ - '0');
+            }
+            setField(record, schema->field, value);
+        }
+        p = skipValue(p, end);
+        if (p == nullptr){
+            return false;
+        }
+        p = skipSpace(p, end);
+        if (p >= end){
+            return false;
+        }
+        if (*p == '}'){
+            return true;
+        }
+        if (*p++ != ','){
+            return false;
+        }
+        p = skipSpace(p, end);
+    }
+    return false;
+}
+
+/// @brief ソースを1回read()し、揃ったフレームを解析する   (private)
+/// @param source ソース
+/// @note 受信バッファに直接読み込み、区切りごとにその場で解析する  残りは先頭に詰める
+void TelemetryIngest::readSource(Source& source){
+    const ssize_t length = read(source.fd, source.buffer + source.used, SOURCE_BUFFER_SIZE - source.used);
+    if (length <= 0){
+        if (length == 0 || (errno != EAGAIN && errno != EINTR)){
+            // 相手が閉じた  ptyの場合はEIO
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source.fd, nullptr);
+        }
+        return;
+    }
+    byte_count += length;
+
+    const uint8_t delimiter = (source.framing == E_Framing::JSON) ? '\n' : Cobs::DELIMITER;
+    uint8_t* const data = source.buffer;
+    const size_t end = source.used + length;
+    size_t frame_start = 0;
+    size_t index = source.used;
+    while (index < end){
+        uint8_t* const found = static_cast<uint8_t*>(memchr(data + index, delimiter, end - index));
+        if (found == nullptr){
+            break;
+        }
+        const size_t position = found - data;
+        if (source.overflow){
+            source.overflow = false;
+            error_count++;
+        } else if (position > frame_start){
+            parseFrame(source, data + frame_start, position - frame_start);
+        }
+        frame_start = position + 1;
+        index = position + 1;
+    }
+
+    source.used = end - frame_start;
+    if (frame_start != 0 && source.used != 0){
+        memmove(data, data + frame_start, source.used);
+    }
+    if (source.used == SOURCE_BUFFER_SIZE){
+        // 区切りが来ない  次の区切りまで捨てる
+        source.overflow = true;
+        source.used = 0;
+    }
+}
+
+/// @brief 1フレームを解析してキューに入れる   (private)
+/// @param source ソース
+/// @param begin フレームの先頭（区切りを含まない）  バイナリ形式ではその場で復号する
+/// @param length フレームの長さ
+void TelemetryIngest::parseFrame(Source& source, uint8_t* begin, const size_t length){
+    if (source.framing == E_Framing::BINARY){
+        if (!parseBinary(source, begin, length)){
+            error_count++;
+        }
+        return;
+    }
+
+    const char* const text = reinterpret_cast<const char*>(begin);
+    const char* const end = skipSpace(text, text + length);
+    if (end == text + length){
+        // 空行
+        return;
+    }
+    TelemetryRecord record = {};
+    if (!parseJson(text, text + length, record)){
+        error_count++;
+        return;
+    }
+    if (record.fields != 0){
+        record.source = source.id;
+        emit(record);
+    }
+}
+
+/// @brief バイナリ形式の1フレームを解析してキューに入れる   (private)
+/// @param source ソース
+/// @param begin COBSで符号化されたフレーム  その場で復号する（復号後は短くなるので上書きできる）
+/// @param length フレームの長さ
+/// @return True:成功   False:COBS, CRC, レコードのいずれかが不正
+bool TelemetryIngest::parseBinary(const Source& source, uint8_t* begin, const size_t length){
+    const size_t decoded_length = Cobs::decode(begin, length, begin);
+    // 種類, シーケンス番号, CRC 2byte
+    if (decoded_length < 4){
+        return false;
+    }
+    const size_t body_length = decoded_length - 2;
+    const uint16_t crc = begin[body_length] | (begin[body_length + 1] << 8);
+    if (Crc16::modbus(begin, body_length) != crc){
+        return false;
+    }
+
+    TelemetryRecord record = {};
+    record.source = source.id;
+    record.sequence = begin[1];
+
+    if (begin[0] == FRAME_TYPE_RECORDS){
+        size_t index = 2;
+        while (index < body_length){
+            const uint8_t id = begin[index++];
+            const Schema* schema = nullptr;
+            for (const Schema& candidate : schemas){
+                if (candidate.id == id){
+                    schema = &candidate;
+                    break;
+                }
+            }
+            if (schema == nullptr || index + schema->size > body_length){
+                return false;
+            }
+            uint64_t value = 0;
+            for (uint8_t i = 0; i < schema->size; i++){
+                value |= static_cast<uint64_t>(begin[index++]) << (8 * i);
+            }
+            setField(record, schema->field, value);
+        }
+        if (record.fields != 0){
+            emit(record);
+        }
+        return true;
+    }
+
+    // [種類][シーケンス番号][数][最初の時刻 uint32_t][最初の液面 uint16_t][時刻の差分の差分, 液面の差分]...
+    //  FRAME_TYPE_BATCH_EPOCHでは最初の時刻が6byteのホストの時刻
+    const bool epoch = begin[0] == FRAME_TYPE_BATCH_EPOCH;
+    const uint8_t time_size = epoch ? TIMESTAMP_SIZE : 4;
+    if ((begin[0] != FRAME_TYPE_BATCH && !epoch) || body_length < 3u + time_size + 2 || begin[2] == 0){
+        return false;
+    }
+    const uint8_t count = begin[2];
+    uint64_t time = 0;
+    for (uint8_t i = 0; i < time_size; i++){
+        time |= static_cast<uint64_t>(begin[3 + i]) << (8 * i);
+    }
+    size_t index = 3 + time_size;
+    int32_t level = begin[index] | (begin[index + 1] << 8);
+    int32_t interval = 0;
+    index += 2;
+    record.fields = TelemetryRecord::FIELD_LEVEL | (epoch ? TelemetryRecord::FIELD_TIMESTAMP : TelemetryRecord::FIELD_TIME);
+    for (uint8_t i = 0; i < count; i++){
+        if (i != 0){
+            int32_t time_delta = 0;
+            int32_t level_delta = 0;
+            if (!getSignedVarint(begin, body_length, index, time_delta) || !getSignedVarint(begin, body_length, index, level_delta)){
+                return false;
+            }
+            interval += time_delta;
+            time += interval;
+            level += level_delta;
+        }
+        if (epoch){
+            record.timestamp_ms = time;
+        } else {
+            record.time_ms = static_cast<uint32_t>(time);
+        }
+        record.level = level;
+        emit(record);
+    }
+    return index == body_length;
+}
+
+/// @brief レコードをキューに入れる   (private)
+/// @param record レコード
+void TelemetryIngest::emit(const TelemetryRecord& record){
+    if (queue.push(record)){
+        record_count++;
+    } else {
+        dropped_count++;
+    }
+}
@@ -0,0 +1,144 @@
+/**************************************************************************/
+/*!
+ * @file TelemetryIngest.h/cpp
+ * @brief 複数のIotGatewayのテレメトリを1スレッドで受信し、レコードにしてキューに入れる（ホスト側）
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    シリアルポート・ptyのfdをaddSource()で登録し、poll()またはrun()でepollを使って読む。
+ *    受信データはソースごとの固定長バッファに直接read()し、その場で解析する（コピー・メモリ確保なし）。
+ *    解析したレコードはMpmcQueueに入れるので、別のスレッドでpop()して使う。
+ *    形式はソースごとに指定する。
+ *      JSON    1行1フレーム  {"level":n,"mode":n,"remain":n,"error":n,"ts":n,...}  その他のキーは読み飛ばす
+ *      BINARY  COBSで符号化し0x00で区切ったフレーム  レコード・バッチともに読む
+ *
+ *    ビルド例:
+ *      g++ -std=c++14 -O2 -pthread -I../../src bench_ingest.cpp TelemetryIngest.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp
+ */
+/**************************************************************************/
+
+#ifndef _TELEMETRYINGEST_H_
+#define _TELEMETRYINGEST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "MpmcQueue.h"
+
+/*!
+ * @brief 1つの計測値のレコード  fieldsのビットが立っている値のみ有効
+ */
+struct TelemetryRecord{
+    // fieldsのビット
+    static constexpr uint8_t FIELD_LEVEL = 0x01;
+    static constexpr uint8_t FIELD_MODE = 0x02;
+    static constexpr uint8_t FIELD_REMAIN = 0x04;
+    static constexpr uint8_t FIELD_ERROR = 0x08;
+    static constexpr uint8_t FIELD_TIME = 0x10;    // バッチの取得時刻
+    static constexpr uint8_t FIELD_TIMESTAMP = 0x20;   // ホストの時刻での取得時刻
+
+    uint16_t source;    // addSource()で指定したID
+    uint8_t fields;
+    uint8_t sequence;   // バイナリ形式のシーケンス番号  JSON形式では0
+    uint16_t level;     // [0.1%]
+    uint16_t remain;    // [min]
+    uint8_t mode;
+    uint8_t error;
+    uint32_t time_ms;   // 計測ユニットのmillis()
+    uint64_t timestamp_ms;  // ホストの時刻 [ms]  計測ユニットの時刻が同期済みの場合
+};
+
+class TelemetryIngest {
+
+    public:
+    // consts
+
+    /// @brief ソースの形式  IotGateway::E_Framingと同じ
+    enum class E_Framing : uint8_t {
+        JSON = 0,
+        BINARY
+    };
+
+    // レコードのキューの長さ
+    static constexpr size_t QUEUE_SIZE = 1 << 16;
+
+    // types
+    using RecordQueue = MpmcQueue<TelemetryRecord, QUEUE_SIZE>;
+
+    // methods
+    explicit TelemetryIngest(RecordQueue& queue);
+    ~TelemetryIngest();
+
+    TelemetryIngest(const TelemetryIngest&) = delete;
+    TelemetryIngest& operator=(const TelemetryIngest&) = delete;
+
+    bool addSource(const int fd, const uint16_t source, const E_Framing framing);
+    size_t poll(const int timeout_ms);
+    void run(const std::atomic<bool>& stop);
+
+    /// @brief キューに入れたレコードの数
+    uint64_t getRecordCount(void) const {
+        return record_count;
+    };
+
+    /// @brief 解析できずに捨てたフレームの数
+    uint64_t getErrorCount(void) const {
+        return error_count;
+    };
+
+    /// @brief キューが満杯で捨てたレコードの数
+    uint64_t getDroppedCount(void) const {
+        return dropped_count;
+    };
+
+    /// @brief 受信したバイト数
+    uint64_t getByteCount(void) const {
+        return byte_count;
+    };
+
+    static bool parseJson(const char* begin, const char* end, TelemetryRecord& record);
+
+    private:
+    // consts
+
+    // ソースごとの受信バッファの長さ  1フレームの最大長より長いこと
+    static constexpr size_t SOURCE_BUFFER_SIZE = 2048;
+
+    // 1回のepoll_wait()で受け取るイベントの最大数
+    static constexpr int MAX_EVENTS = 64;
+
+    // types
+
+    /*!
+     * @brief 1つのソースの受信状態
+     */
+    struct Source{
+        int fd;
+        uint16_t id;
+        E_Framing framing;
+        size_t used;        // bufferに入っている未解析の長さ
+        bool overflow;      // 区切りが来ないままバッファが一杯になった  次の区切りまで捨てる
+        uint8_t buffer[SOURCE_BUFFER_SIZE];
+    };
+
+    // vars
+    RecordQueue& queue;
+    int epoll_fd = -1;
+    std::vector<std::unique_ptr<Source>> sources;
+
+    uint64_t record_count = 0;
+    uint64_t error_count = 0;
+    uint64_t dropped_count = 0;
+    uint64_t byte_count = 0;
+
+    // methods
+    void readSource(Source& source);
+    void parseFrame(Source& source, uint8_t* begin, const size_t length);
+    bool parseBinary(const Source& source, uint8_t* begin, const size_t length);
+    void emit(const TelemetryRecord& record);
+};
+
+#endif //_TELEMETRYINGEST_H_
@@ -0,0 +1,86 @@
+/**************************************************************************/
+/*!
+ * @file Adafruit_ADS1015.h
+ * @brief ホスト側シミュレーション用のAdafruit ADS1X15ライブラリ(1.x)のスタブ
+ * @par
+ *    ライブラリと同じくWireを直接使い、変換の完了はdelay()で待つ（ADS1115は8ms）。通信エラーは返さない。
+ */
+/**************************************************************************/
+
+#ifndef _HOST_ADAFRUIT_ADS1015_H_
+#define _HOST_ADAFRUIT_ADS1015_H_
+
+#include "Wire.h"
+
+#define ADS1015_ADDRESS (0x48)
+#define ADS1015_CONVERSIONDELAY (1)
+#define ADS1115_CONVERSIONDELAY (8)
+#define ADS1015_REG_POINTER_CONVERT (0x00)
+#define ADS1015_REG_POINTER_CONFIG (0x01)
+#define ADS1015_REG_CONFIG_OS_SINGLE (0x8000)
+#define ADS1015_REG_CONFIG_MUX_DIFF_0_1 (0x0000)
+#define ADS1015_REG_CONFIG_MUX_DIFF_2_3 (0x3000)
+#define ADS1015_REG_CONFIG_MODE_SINGLE (0x0100)
+#define ADS1015_REG_CONFIG_DR_1600SPS (0x0080)
+#define ADS1015_REG_CONFIG_CQUE_NONE (0x0003)
+
+typedef enum {
+    GAIN_TWOTHIRDS = 0x0000,
+    GAIN_ONE = 0x0200,
+    GAIN_TWO = 0x0400,
+    GAIN_FOUR = 0x0600,
+    GAIN_EIGHT = 0x0800,
+    GAIN_SIXTEEN = 0x0A00
+} adsGain_t;
+
+class Adafruit_ADS1015 {
+    public:
+    Adafruit_ADS1015(uint8_t i2cAddress = ADS1015_ADDRESS)
+        : m_i2cAddress(i2cAddress), m_conversionDelay(ADS1015_CONVERSIONDELAY), m_bitShift(4), m_gain(GAIN_TWOTHIRDS){}
+
+    void begin(void){ Wire.begin(); }
+    void setGain(adsGain_t gain){ m_gain = gain; }
+    adsGain_t getGain(void){ return m_gain; }
+    int16_t readADC_Differential_0_1(void){ return readDifferential(ADS1015_REG_CONFIG_MUX_DIFF_0_1); }
+    int16_t readADC_Differential_2_3(void){ return readDifferential(ADS1015_REG_CONFIG_MUX_DIFF_2_3); }
+
+    protected:
+    uint8_t m_i2cAddress;
+    uint8_t m_conversionDelay;
+    uint8_t m_bitShift;
+    adsGain_t m_gain;
+
+    private:
+    int16_t readDifferential(const uint16_t mux){
+        const uint16_t config = ADS1015_REG_CONFIG_CQUE_NONE | ADS1015_REG_CONFIG_DR_1600SPS
+            | ADS1015_REG_CONFIG_MODE_SINGLE | m_gain | mux | ADS1015_REG_CONFIG_OS_SINGLE;
+        Wire.beginTransmission(m_i2cAddress);
+        Wire.write(static_cast<uint8_t>(ADS1015_REG_POINTER_CONFIG));
+        Wire.write(static_cast<uint8_t>(config >> 8));
+        Wire.write(static_cast<uint8_t>(config & 0xFF));
+        Wire.endTransmission();
+        delay(m_conversionDelay);
+
+        Wire.beginTransmission(m_i2cAddress);
+        Wire.write(static_cast<uint8_t>(ADS1015_REG_POINTER_CONVERT));
+        Wire.endTransmission();
+        Wire.requestFrom(m_i2cAddress, static_cast<uint8_t>(2));
+        const uint16_t hi = static_cast<uint16_t>(Wire.read());
+        const uint16_t lo = static_cast<uint16_t>(Wire.read());
+        const uint16_t raw = static_cast<uint16_t>(((hi << 8) | lo) & 0xFFFF);
+        if (m_bitShift == 0){
+            return static_cast<int16_t>(raw);
+        }
+        return static_cast<int16_t>(raw) >> m_bitShift;
+    }
+};
+
+class Adafruit_ADS1115 : public Adafruit_ADS1015 {
+    public:
+    Adafruit_ADS1115(uint8_t i2cAddress = ADS1015_ADDRESS) : Adafruit_ADS1015(i2cAddress){
+        m_conversionDelay = ADS1115_CONVERSIONDELAY;
+        m_bitShift = 0;
+    }
+};
+
+#endif //_HOST_ADAFRUIT_ADS1015_H_
@@ -0,0 +1,13 @@
+/**************************************************************************/
+/*!
+ * @file Adafruit_BusIO_Register.h
+ * @brief ホスト側シミュレーション用のスタブ  src/ はインクルードするだけで使っていない
+ */
+/**************************************************************************/
+
+#ifndef _HOST_ADAFRUIT_BUSIO_REGISTER_H_
+#define _HOST_ADAFRUIT_BUSIO_REGISTER_H_
+
+#include "Adafruit_I2CDevice.h"
+
+#endif //_HOST_ADAFRUIT_BUSIO_REGISTER_H_
@@ -0,0 +1,81 @@
+/**************************************************************************/
+/*!
+ * @file Adafruit_FRAM_I2C.h
+ * @brief ホスト側シミュレーション用のAdafruit FRAM I2C / EEPROM I2Cライブラリのスタブ
+ * @par
+ *    ライブラリと同じトランザクションを出す（16bitアドレス）。
+ *    read8/write8: 1byteごとに1トランザクション
+ *    read: Wireのバッファ(32byte)ごとにアドレス書き込み + リピートスタートで読み出し
+ *    write: 30byte(32byte - アドレス2byte)ごとに書き込み、続けて書き込み完了の確認(ACKポーリング)
+ *    begin()はライブラリと同じくAdafruit_I2CDeviceをnewする。
+ */
+/**************************************************************************/
+
+#ifndef _HOST_ADAFRUIT_FRAM_I2C_H_
+#define _HOST_ADAFRUIT_FRAM_I2C_H_
+
+#include "Adafruit_I2CDevice.h"
+
+#define EEPROM_DEFAULT_ADDRESS (0x50)
+
+class Adafruit_EEPROM_I2C {
+    public:
+    Adafruit_EEPROM_I2C(void){}
+    ~Adafruit_EEPROM_I2C(){ delete i2c_dev; }
+
+    bool begin(uint8_t addr = EEPROM_DEFAULT_ADDRESS, TwoWire* theWire = &Wire){
+        if (i2c_dev){
+            delete i2c_dev;
+        }
+        i2c_dev = new Adafruit_I2CDevice(addr, theWire);
+        return i2c_dev->begin();
+    }
+    bool write8(uint16_t addr, uint8_t value){
+        return write(addr, &value, 1);
+    }
+    uint8_t read8(uint16_t addr){
+        uint8_t value = 0;
+        read(addr, &value, 1);
+        return value;
+    }
+    bool write(uint16_t addr, uint8_t* buffer, uint16_t num){
+        while (num > 0){
+            const uint8_t prefix[2] = { static_cast<uint8_t>(addr >> 8), static_cast<uint8_t>(addr & 0xFF) };
+            const uint16_t chunk = (num < i2c_dev->maxBufferSize() - 2) ? num : i2c_dev->maxBufferSize() - 2;
+            if (!i2c_dev->write(buffer, chunk, true, prefix, 2)){
+                return false;
+            }
+            // 書き込み完了の確認  FRAMはすぐにACKを返す
+            if (!i2c_dev->detected()){
+                return false;
+            }
+            addr += chunk;
+            buffer += chunk;
+            num -= chunk;
+        }
+        return true;
+    }
+    bool read(uint16_t addr, uint8_t* buffer, uint16_t num){
+        while (num > 0){
+            const uint8_t prefix[2] = { static_cast<uint8_t>(addr >> 8), static_cast<uint8_t>(addr & 0xFF) };
+            const uint16_t chunk = (num < i2c_dev->maxBufferSize()) ? num : i2c_dev->maxBufferSize();
+            if (!i2c_dev->write_then_read(prefix, 2, buffer, chunk)){
+                return false;
+            }
+            addr += chunk;
+            buffer += chunk;
+            num -= chunk;
+        }
+        return true;
+    }
+
+    protected:
+    Adafruit_I2CDevice* i2c_dev = nullptr;
+};
+
+class Adafruit_FRAM_I2C : public Adafruit_EEPROM_I2C {
+    public:
+    Adafruit_FRAM_I2C(void){}
+};
+
+#endif //_HOST_ADAFRUIT_FRAM_I2C_H_
@@ -0,0 +1,62 @@
+/**************************************************************************/
+/*!
+ * @file Adafruit_I2CDevice.h
+ * @brief ホスト側シミュレーション用のAdafruit BusIO I2CDeviceのスタブ  Wireの上で動く
+ */
+/**************************************************************************/
+
+#ifndef _HOST_ADAFRUIT_I2CDEVICE_H_
+#define _HOST_ADAFRUIT_I2CDEVICE_H_
+
+#include "Wire.h"
+
+class Adafruit_I2CDevice {
+    public:
+    Adafruit_I2CDevice(uint8_t addr, TwoWire* theWire = &Wire) : i2c_address(addr), wire(theWire){}
+
+    bool begin(bool addr_detect = true){
+        wire->begin();
+        return addr_detect ? detected() : true;
+    }
+    bool detected(void){
+        wire->beginTransmission(i2c_address);
+        return wire->endTransmission() == 0;
+    }
+    bool write(const uint8_t* buffer, size_t len, bool stop = true, const uint8_t* prefix_buffer = nullptr, size_t prefix_len = 0){
+        if (len + prefix_len > maxBufferSize()){
+            return false;
+        }
+        wire->beginTransmission(i2c_address);
+        if (prefix_len != 0 && wire->write(prefix_buffer, prefix_len) != prefix_len){
+            return false;
+        }
+        if (wire->write(buffer, len) != len){
+            return false;
+        }
+        return wire->endTransmission(stop) == 0;
+    }
+    bool read(uint8_t* buffer, size_t len, bool stop = true){
+        if (len > maxBufferSize() || wire->requestFrom(i2c_address, static_cast<uint8_t>(len), stop) != len){
+            return false;
+        }
+        for (size_t i = 0; i < len; i++){
+            buffer[i] = static_cast<uint8_t>(wire->read());
+        }
+        return true;
+    }
+    bool write_then_read(const uint8_t* write_buffer, size_t write_len, uint8_t* read_buffer, size_t read_len, bool stop = false){
+        return write(write_buffer, write_len, stop) && read(read_buffer, read_len);
+    }
+    bool setSpeed(uint32_t desiredclk){
+        wire->setClock(desiredclk);
+        return true;
+    }
+    uint8_t address(void){ return i2c_address; }
+    size_t maxBufferSize(void){ return TwoWire::BUFFER_LENGTH; }
+
+    private:
+    uint8_t i2c_address;
+    TwoWire* wire;
+};
+
+#endif //_HOST_ADAFRUIT_I2CDEVICE_H_
@@ -0,0 +1,246 @@
+/**************************************************************************/
+/*!
+ * @file Arduino.h
+ * @brief ホスト側シミュレーション用のArduino(STM32コア)のスタブ
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    src/ が使う範囲だけを持つ。時間・ピンはHostSimの仮想時間・ピンの状態に対応する。
+ *    Serial（デバッグ出力）は書き込んだバイト数だけ数えて捨てる。
+ *    StringはWStringと同じく文字列ごとにヒープのバッファを持つので、確保回数をHostSimで数えられる。
+ */
+/**************************************************************************/
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <string>
+#include "HostSim.h"
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define OUTPUT_OPEN_DRAIN 0x4
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// Nucleo-L432KC
+#define PA3 3
+#define PIN_WIRE_SDA 14
+#define PIN_WIRE_SCL 15
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// ------------------------------------------------------------------
+//  時間・ピン
+// ------------------------------------------------------------------
+inline uint32_t micros(void){ return static_cast<uint32_t>(HostSim::now()); }
+inline uint32_t millis(void){ return static_cast<uint32_t>(HostSim::now() / 1000); }
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+inline void noInterrupts(void){}
+inline void interrupts(void){}
+
+// ------------------------------------------------------------------
+//  String
+// ------------------------------------------------------------------
+class String {
+    public:
+    String(const char* text = ""){ copy(text ? text : "", text ? strlen(text) : 0); }
+    String(const std::string& text){ copy(text.c_str(), text.size()); }
+    String(const String& text){ copy(text.c_str(), text.len); }
+    String(String&& text) noexcept : buffer(text.buffer), capacity(text.capacity), len(text.len){ text.buffer = nullptr; text.capacity = 0; text.len = 0; }
+    explicit String(char c){ const char text[2] = { c, '\0' }; copy(text, 1); }
+    explicit String(int number, unsigned char base = DEC){ assign(format(static_cast<long>(number), base)); }
+    explicit String(unsigned int number, unsigned char base = DEC){ assign(format(static_cast<unsigned long>(number), base)); }
+    explicit String(long number, unsigned char base = DEC){ assign(format(number, base)); }
+    explicit String(unsigned long number, unsigned char base = DEC){ assign(format(number, base)); }
+    explicit String(float number, unsigned char digits = 2){ assign(format(static_cast<double>(number), digits)); }
+    explicit String(double number, unsigned char digits = 2){ assign(format(number, digits)); }
+    ~String(){ delete[] buffer; }
+
+    String& operator=(const String& text){ if (this != &text){ copy(text.c_str(), text.len); } return *this; }
+    String& operator=(String&& text) noexcept {
+        if (this != &text){
+            delete[] buffer;
+            buffer = text.buffer; capacity = text.capacity; len = text.len;
+            text.buffer = nullptr; text.capacity = 0; text.len = 0;
+        }
+        return *this;
+    }
+    String& operator=(const char* text){ copy(text ? text : "", text ? strlen(text) : 0); return *this; }
+
+    unsigned int length(void) const { return static_cast<unsigned int>(len); }
+    const char* c_str(void) const { return buffer ? buffer : ""; }
+    char charAt(unsigned int index) const { return (index < len) ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    String substring(unsigned int from) const { return substring(from, len); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to){ const unsigned int t = from; from = to; to = t; }
+        String out;
+        if (from < len){
+            to = (to > len) ? static_cast<unsigned int>(len) : to;
+            out.copy(buffer + from, to - from);
+        }
+        return out;
+    }
+    int indexOf(char c) const { const char* p = len ? static_cast<const char*>(memchr(buffer, c, len)) : nullptr; return p ? static_cast<int>(p - buffer) : -1; }
+    long toInt(void) const { return atol(c_str()); }
+    float toFloat(void) const { return static_cast<float>(atof(c_str())); }
+    bool concat(const String& text){ return concat(text.c_str(), text.len); }
+    bool concat(const char* text, const size_t length){
+        if (length == 0){ return true; }
+        if (length > MAX_LENGTH){ return false; }
+        // 自分自身の一部を連結する場合は確保し直した後の位置から読む
+        const bool inside = (buffer != nullptr) && text >= buffer && text < buffer + len;
+        const size_t offset = inside ? static_cast<size_t>(text - buffer) : 0;
+        if (!reserve(len + length)){ return false; }
+        memmove(buffer + len, inside ? buffer + offset : text, length);
+        len += length;
+        buffer[len] = '\0';
+        return true;
+    }
+    String& operator+=(const String& text){ concat(text); return *this; }
+    String& operator+=(const char* text){ concat(text, strlen(text)); return *this; }
+    String& operator+=(char c){ concat(&c, 1); return *this; }
+    bool operator==(const String& text) const { return len == text.len && memcmp(c_str(), text.c_str(), len) == 0; }
+    bool operator==(const char* text) const { return strcmp(c_str(), text) == 0; }
+    bool operator!=(const String& text) const { return !(*this == text); }
+    friend String operator+(const String& a, const String& b){ String out(a); out.concat(b); return out; }
+    friend String operator+(const String& a, const char* b){ String out(a); out += b; return out; }
+    friend String operator+(const char* a, const String& b){ String out(a); out.concat(b); return out; }
+
+    static std::string format(long number, unsigned char base){
+        if (number < 0 && base == DEC){
+            return "-" + format(static_cast<unsigned long>(-number), base);
+        }
+        return format(static_cast<unsigned long>(number), base);
+    }
+    static std::string format(unsigned long number, unsigned char base){
+        char buffer[sizeof(unsigned long) * 8 + 1];
+        char* p = &buffer[sizeof(buffer) - 1];
+        *p = '\0';
+        base = (base < 2) ? DEC : base;
+        do {
+            const unsigned digit = number % base;
+            *--p = static_cast<char>((digit < 10) ? '0' + digit : 'A' + digit - 10);
+            number /= base;
+        } while (number != 0);
+        return std::string(p);
+    }
+    static std::string format(double number, unsigned char digits){
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", digits, number);
+        return std::string(buffer);
+    }
+
+    private:
+    // WStringと同じく、空文字列でもバッファを確保し、足りなければ確保し直す（realloc相当）
+    bool reserve(const size_t size){
+        if (buffer != nullptr && capacity >= size){
+            return true;
+        }
+        char* next = new char[size + 1];
+        if (buffer != nullptr){
+            memcpy(next, buffer, len + 1);
+        } else {
+            next[0] = '\0';
+        }
+        delete[] buffer;
+        buffer = next;
+        capacity = size;
+        return true;
+    }
+    void copy(const char* text, const size_t length){
+        reserve(length);
+        memmove(buffer, text, length);
+        len = length;
+        buffer[len] = '\0';
+    }
+    // 数値の書式化の作業領域はWStringではスタック  std::stringは短い(SSO)のでヒープは使わない
+    void assign(const std::string& text){ copy(text.c_str(), text.size()); }
+
+    // STM32のRAMに収まらない長さは確保しない（ホストのコンパイラの範囲解析にも必要）
+    static constexpr size_t MAX_LENGTH = 0xFFFF;
+
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    size_t len = 0;
+};
+
+// ------------------------------------------------------------------
+//  Print / Stream
+// ------------------------------------------------------------------
+class Print {
+    public:
+    virtual ~Print(){}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size){
+        size_t n = 0;
+        while (size-- != 0 && write(*buffer++) != 0){
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char* text){ return (text == nullptr) ? 0 : write(reinterpret_cast<const uint8_t*>(text), strlen(text)); }
+    size_t write(const char* buffer, size_t size){ return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+
+    size_t print(const char* text){ return write(text); }
+    size_t print(const String& text){ return write(text.c_str()); }
+    size_t print(char c){ return write(static_cast<uint8_t>(c)); }
+    size_t print(unsigned char n, int base = DEC){ return print(static_cast<unsigned long>(n), base); }
+    size_t print(int n, int base = DEC){ return print(static_cast<long>(n), base); }
+    size_t print(unsigned int n, int base = DEC){ return print(static_cast<unsigned long>(n), base); }
+    size_t print(long n, int base = DEC){ return write(String::format(n, static_cast<unsigned char>(base)).c_str()); }
+    size_t print(unsigned long n, int base = DEC){ return write(String::format(n, static_cast<unsigned char>(base)).c_str()); }
+    size_t print(double n, int digits = 2){ return write(String::format(n, static_cast<unsigned char>(digits)).c_str()); }
+
+    size_t println(void){ return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value){ const size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T& value, int format){ const size_t n = print(value, format); return n + println(); }
+};
+
+class Stream : public Print {
+    public:
+    virtual int available(void){ return 0; }
+    virtual int read(void){ return -1; }
+    virtual int peek(void){ return -1; }
+    virtual void flush(void){}
+    virtual int availableForWrite(void){ return 0; }
+    using Print::write;
+};
+
+/*!
+ * @brief デバッグ出力  書き込んだバイト数を数えて捨てる
+ */
+class HostConsole : public Stream {
+    public:
+    void begin(unsigned long baud){ (void)baud; }
+    size_t write(uint8_t c) override { (void)c; written++; return 1; }
+    using Print::write;
+    operator bool(void) const { return true; }
+    uint32_t written = 0;
+};
+extern HostConsole Serial;
+
+#include "HardwareSerial.h"
+
+#endif //_HOST_ARDUINO_H_
@@ -0,0 +1,171 @@
+/**************************************************************************/
+/*!
+ * @file HardwareSerial.h
+ * @brief ホスト側シミュレーション用のHardwareSerialのスタブ  baudレートの時間で送受信する
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    送信: STM32コアと同じくTX_BUFFER_SIZEの送信バッファを持ち、1byteの時間(10bit/baud)ごとに1byteずつ送り出す。
+ *          送信中の1byteはUARTのシフトレジスタにあり、送信バッファには数えない。
+ *          バッファが一杯の時のwrite()は空くまでブロックする（仮想時間が進む）。flush()はシフトレジスタが空くまでブロックする。
+ *          availableForWrite()はその時点の送信バッファの空きを返す。送り出したバイトはtransmitted()に残る。
+ *    バッファの長さはSTM32コアと同じくSERIAL_TX_BUFFER_SIZE, SERIAL_RX_BUFFER_SIZE（デフォルト64）で変更できる。
+ *    受信: inject()で渡したバイトは1byteの時間ごとに届き、RX_BUFFER_SIZEを超えて読まれなかった分は捨てる。
+ */
+/**************************************************************************/
+
+#ifndef _HOST_HARDWARESERIAL_H_
+#define _HOST_HARDWARESERIAL_H_
+
+#include "Arduino.h"
+#include <deque>
+
+// STM32コアと同じく、ビルドオプションで変更できる
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 64
+#endif
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+
+class HardwareSerial : public Stream {
+    public:
+    // consts
+    static constexpr size_t TX_BUFFER_SIZE = SERIAL_TX_BUFFER_SIZE;
+    static constexpr size_t RX_BUFFER_SIZE = SERIAL_RX_BUFFER_SIZE;
+
+    HardwareSerial(uint32_t pin_rx, uint32_t pin_tx){ (void)pin_rx; (void)pin_tx; }
+
+    void begin(unsigned long baud, uint8_t config = 0){
+        (void)config;
+        byte_us = 10.0e6 / baud;
+    }
+    void end(void){}
+
+    int available(void) override {
+        receive();
+        return static_cast<int>(rx_buffer.size());
+    }
+    int read(void) override {
+        receive();
+        if (rx_buffer.empty()){
+            return -1;
+        }
+        const uint8_t c = rx_buffer.front();
+        rx_buffer.pop_front();
+        return c;
+    }
+    int peek(void) override {
+        receive();
+        return rx_buffer.empty() ? -1 : rx_buffer.front();
+    }
+    int availableForWrite(void) override {
+        return static_cast<int>(TX_BUFFER_SIZE - queued());
+    }
+    size_t write(uint8_t c) override {
+        // 送信バッファが一杯ならブロック  シフトレジスタの1byteを送り終えると1byte空く
+        if (queued() >= TX_BUFFER_SIZE){
+            const uint64_t free_us = static_cast<uint64_t>(ceil(tx_done_us - TX_BUFFER_SIZE * byte_us));
+            blocked_us += free_us - HostSim::now();
+            HostSim::advance(free_us - HostSim::now());
+        }
+        const double now_us = static_cast<double>(HostSim::now());
+        tx_done_us = ((tx_done_us > now_us) ? tx_done_us : now_us) + byte_us;
+        tx_log.push_back(static_cast<char>(c));
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        for (size_t i = 0; i < size; i++){
+            write(buffer[i]);
+        }
+        return size;
+    }
+    using Print::write;
+    void flush(void) override {
+        if (tx_done_us > HostSim::now()){
+            const uint64_t done_us = static_cast<uint64_t>(ceil(tx_done_us));
+            blocked_us += done_us - HostSim::now();
+            HostSim::advance(done_us - HostSim::now());
+        }
+    }
+
+    // ホスト側（シミュレーション）からの操作
+
+    /// @brief 受信するバイトを線路に載せる
+    /// @param data データ
+    /// @param len データ長
+    /// @param gap_us 前に載せたバイトの後（線路が空いていれば現在）からの空き時間 [us]
+    void inject(const uint8_t* data, const size_t len, const uint64_t gap_us = 0){
+        const double now_us = static_cast<double>(HostSim::now());
+        double t = ((rx_line_us > now_us) ? rx_line_us : now_us) + gap_us;
+        for (size_t i = 0; i < len; i++){
+            t += byte_us;
+            rx_line.push_back(Arrival{ t, data[i] });
+        }
+        rx_line_us = t;
+    }
+    void inject(const char* text, const uint64_t gap_us = 0){
+        inject(reinterpret_cast<const uint8_t*>(text), strlen(text), gap_us);
+    }
+
+    /// @brief 線路上にあってまだ届いていないバイトの数
+    size_t inFlight(void) const { return rx_line.size(); }
+
+    /// @brief 送り出したバイト（送信バッファに入った順）
+    std::string& transmitted(void){ return tx_log; }
+
+    /// @brief まだ送り終えていないバイト数  シフトレジスタの1byteを含む
+    size_t pending(void) const {
+        const double left = tx_done_us - static_cast<double>(HostSim::now());
+        if (left <= 0.0){
+            return 0;
+        }
+        return static_cast<size_t>(ceil(left / byte_us - 1e-9));
+    }
+
+    /// @brief 送信バッファに残っているバイト数  シフトレジスタの1byteを除く
+    size_t queued(void) const {
+        const size_t left = pending();
+        return (left != 0) ? left - 1 : 0;
+    }
+
+    /// @brief 1byteの時間 [us]
+    double byteTime(void) const { return byte_us; }
+
+    /// @brief write()がブロックした時間の累計 [us]
+    uint64_t blockedTime(void) const { return blocked_us; }
+
+    /// @brief 受信バッファがあふれて捨てたバイト数
+    uint32_t overruns(void) const { return overrun_count; }
+
+    private:
+    struct Arrival{
+        double at_us;
+        uint8_t data;
+    };
+
+    double byte_us = 10.0e6 / 9600;
+    double tx_done_us = 0.0;    // 送信バッファの最後のバイトを送り終わる時刻
+    uint64_t blocked_us = 0;
+    std::string tx_log;
+
+    std::deque<Arrival> rx_line;
+    double rx_line_us = 0.0;    // 線路上の最後のバイトが届く時刻
+    std::deque<uint8_t> rx_buffer;
+    uint32_t overrun_count = 0;
+
+    void receive(void){
+        const double now_us = static_cast<double>(HostSim::now());
+        while (!rx_line.empty() && rx_line.front().at_us <= now_us){
+            if (rx_buffer.size() < RX_BUFFER_SIZE){
+                rx_buffer.push_back(rx_line.front().data);
+            } else {
+                overrun_count++;
+            }
+            rx_line.pop_front();
+        }
+    }
+};
+
+#endif //_HOST_HARDWARESERIAL_H_
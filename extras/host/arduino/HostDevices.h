@@ -0,0 +1,205 @@
+/**************************************************************************/
+/*!
+ * @file HostDevices.h
+ * @brief ホスト側シミュレーション用のI2C模擬デバイス  HostSim::attachI2c()でつなぐ
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    Fram:      MB85RC256V  16bitアドレス、書き込み・読み出しともアドレスは自動で進む
+ *    Ads1115:   16bitレジスタ  コンフィグのMUXに応じて、設定した差動入力の値を変換結果にする
+ *    Mcp23008:  8bitレジスタ  ポインタは自動で進む  GPIOの読み出しは出力ラッチと入力値をIODIRで合成
+ *    GroveLcd:  LCDコントローラ(AiP31068)  制御byte(Co, RS)を解釈してDDRAMの内容とコマンド・文字数を数える
+ *    DACは書き込みを捨てる汎用のデバイス（attachI2c(address)）で足りる
+ */
+/**************************************************************************/
+
+#ifndef _HOSTDEVICES_H_
+#define _HOSTDEVICES_H_
+
+#include "HostSim.h"
+
+namespace HostSim {
+
+/*!
+ * @brief FRAM  32kB
+ */
+class Fram : public I2cTarget {
+    public:
+    static constexpr size_t SIZE = 32768;
+    uint8_t memory[SIZE] = {};
+
+    bool write(const uint8_t* data, const size_t len) override {
+        if (len < 2){
+            return true;
+        }
+        pointer = ((data[0] << 8) | data[1]) % SIZE;
+        for (size_t i = 2; i < len; i++){
+            memory[pointer] = data[i];
+            pointer = (pointer + 1) % SIZE;
+        }
+        return true;
+    };
+    void read(uint8_t* data, const size_t len) override {
+        for (size_t i = 0; i < len; i++){
+            data[i] = memory[pointer];
+            pointer = (pointer + 1) % SIZE;
+        }
+    };
+
+    private:
+    size_t pointer = 0;
+};
+
+/*!
+ * @brief ADS1115  差動入力0-1, 2-3の変換結果を設定しておく
+ */
+class Ads1115 : public I2cTarget {
+    public:
+    int16_t differential[2] = {};   // 0:AIN0-AIN1  1:AIN2-AIN3
+
+    bool write(const uint8_t* data, const size_t len) override {
+        if (len == 0){
+            return true;
+        }
+        pointer = data[0] & 0x03;
+        if (len >= 3){
+            const uint16_t value = static_cast<uint16_t>((data[1] << 8) | data[2]);
+            if (pointer == 0x01){
+                // 変換開始  MUX=000:0-1  011:2-3
+                const uint16_t mux = (value >> 12) & 0x07;
+                registers[0] = static_cast<uint16_t>(differential[(mux == 0x03) ? 1 : 0]);
+                conversions++;
+            }
+            registers[pointer] = (pointer == 0x00) ? registers[0] : value;
+        }
+        return true;
+    };
+    void read(uint8_t* data, const size_t len) override {
+        const uint16_t value = registers[pointer];
+        for (size_t i = 0; i < len; i++){
+            data[i] = (i == 0) ? static_cast<uint8_t>(value >> 8) : (i == 1) ? static_cast<uint8_t>(value & 0xFF) : 0;
+        }
+    };
+    uint32_t conversions = 0;
+
+    private:
+    uint8_t pointer = 0;
+    uint16_t registers[4] = {};
+};
+
+/*!
+ * @brief MCP23008  GPIOの入力値を設定しておく
+ */
+class Mcp23008 : public I2cTarget {
+    public:
+    uint8_t registers[11] = { 0xFF };
+    uint8_t gpio_input = 0xFF;
+
+    bool write(const uint8_t* data, const size_t len) override {
+        if (len == 0){
+            return true;
+        }
+        pointer = data[0] % sizeof(registers);
+        for (size_t i = 1; i < len; i++){
+            registers[pointer] = data[i];
+            pointer = (pointer + 1) % sizeof(registers);
+        }
+        return true;
+    };
+    void read(uint8_t* data, const size_t len) override {
+        for (size_t i = 0; i < len; i++){
+            // GPIO: 出力のピンは出力ラッチ(OLAT)、入力のピンはgpio_inputの値
+            const uint8_t gpio = (registers[0x0A] & ~registers[0x00]) | (gpio_input & registers[0x00]);
+            data[i] = (pointer == 0x09) ? gpio : registers[pointer];
+            pointer = (pointer + 1) % sizeof(registers);
+        }
+    };
+
+    private:
+    uint8_t pointer = 0;
+};
+
+/*!
+ * @brief Grove LCDのコントローラ  16x2の表示内容と、受け取ったコマンド・文字の数
+ * @note equivalentTransactions()は、同じ内容をrgb_lcd（1コマンド・1文字ごとに1トランザクション）で
+ *       書いた場合のトランザクション数
+ */
+class GroveLcd : public I2cTarget {
+    public:
+    static constexpr uint8_t COLUMNS = 16;
+    static constexpr uint8_t ROWS = 2;
+    char ddram[ROWS][COLUMNS];
+    uint32_t commands = 0;          // コマンド数
+    uint32_t characters = 0;        // DDRAMへの文字数
+    uint32_t cgram_bytes = 0;       // CGRAMへのデータ数
+
+    GroveLcd(){ memset(ddram, ' ', sizeof(ddram)); };
+
+    bool write(const uint8_t* data, const size_t len) override {
+        size_t i = 0;
+        while (i + 1 < len){
+            const uint8_t control = data[i++];
+            const bool rs = (control & 0x40) != 0;
+            if (control & 0x80){
+                // Co=1: 1byteの後に次の制御byteが続く
+                accept(rs, data[i++]);
+                continue;
+            }
+            // Co=0: 残りは全て同じ種類
+            while (i < len){
+                accept(rs, data[i++]);
+            }
+        }
+        return true;
+    };
+
+    uint32_t equivalentTransactions(void) const { return commands + characters + cgram_bytes; };
+    void clearCounts(void){ commands = 0; characters = 0; cgram_bytes = 0; };
+
+    /// @brief 表示内容の一部を取り出す
+    void text(const uint8_t x, const uint8_t y, const uint8_t width, char* out) const {
+        for (uint8_t i = 0; i < width; i++){
+            out[i] = (x + i < COLUMNS) ? ddram[y % ROWS][x + i] : ' ';
+        }
+        out[width] = '\0';
+    };
+
+    private:
+    uint8_t address = 0;
+    bool cgram = false;
+
+    void accept(const bool rs, const uint8_t value){
+        if (!rs){
+            commands++;
+            if (value & 0x80){
+                address = value & 0x7F;
+                cgram = false;
+            } else if (value & 0x40){
+                cgram = true;
+            } else if (value == 0x01){
+                memset(ddram, ' ', sizeof(ddram));
+                address = 0;
+                cgram = false;
+            } else if (value == 0x02){
+                address = 0;
+                cgram = false;
+            }
+            return;
+        }
+        if (cgram){
+            cgram_bytes++;
+            return;
+        }
+        characters++;
+        const uint8_t column = address & 0x3F;
+        if (column < COLUMNS){
+            ddram[(address & 0x40) ? 1 : 0][column] = static_cast<char>(value);
+        }
+        address = (address & 0x40) | ((column + 1) & 0x3F);
+    };
+};
+
+}   // namespace HostSim
+
+#endif //_HOSTDEVICES_H_
@@ -0,0 +1,308 @@
+#include "HostSim.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+HostConsole Serial;
+TwoWire Wire;
+
+namespace HostSim {
+
+namespace {
+
+constexpr size_t I2C_ADDRESS_COUNT = 128;
+
+uint64_t now_us = 0;
+uint64_t blocked_us = 0;
+
+int pin_level[PIN_COUNT];
+int pin_output[PIN_COUNT];
+bool pins_ready = false;
+
+// I2C
+I2cTarget generic_target;
+I2cTarget* targets[I2C_ADDRESS_COUNT] = {};
+I2cStats address_stats[I2C_ADDRESS_COUNT];
+I2cStats total_stats;
+double bus_time_carry = 0.0;    // 1us未満の端数
+
+uint8_t fault_address = 0;
+E_I2cFault fault = E_I2cFault::NONE;
+uint32_t fault_count = 0;
+uint32_t fault_param = 0;
+uint32_t stuck_clocks = 0;      // SDAが張り付いている間、解放までに必要な残りのクロック数
+
+// ヒープ
+uint32_t allocations = 0;
+bool heap_trap = false;
+const char* heap_label = "";
+
+void initPins(void){
+    if (!pins_ready){
+        for (size_t i = 0; i < PIN_COUNT; i++){
+            pin_level[i] = HIGH;
+            pin_output[i] = LOW;
+        }
+        pins_ready = true;
+    }
+}
+
+/// @brief バスを使った時間を進めて記録する
+void busTime(const uint8_t address, const uint32_t bits, const uint32_t clock_hz){
+    const double us = bits * 1.0e6 / clock_hz + bus_time_carry;
+    const uint64_t whole = static_cast<uint64_t>(us);
+    bus_time_carry = us - whole;
+    now_us += whole;
+    total_stats.busy_us += whole;
+    address_stats[address & 0x7F].busy_us += whole;
+}
+
+/// @brief 区間の始まり  トランザクションとアドレスbyteを数え、故障を取り出す
+E_I2cFault beginSegment(const uint8_t address, const size_t len, const bool repeated){
+    I2cStats& stats = address_stats[address & 0x7F];
+    if (!repeated){
+        total_stats.transactions++;
+        stats.transactions++;
+    }
+    total_stats.wire_bytes += 1 + len;
+    stats.wire_bytes += 1 + len;
+
+    if (fault == E_I2cFault::NONE || fault_count == 0 || fault_address != address){
+        return E_I2cFault::NONE;
+    }
+    fault_count--;
+    if (fault == E_I2cFault::STUCK_SDA){
+        stuck_clocks = (fault_param == 0) ? 1 : fault_param;
+    }
+    return fault;
+}
+
+void countNack(const uint8_t address){
+    total_stats.nacks++;
+    address_stats[address & 0x7F].nacks++;
+}
+
+/// @brief クロックストレッチ  Wireのタイムアウトで打ち切るまで時間を進める
+void stretch(const uint8_t address){
+    const uint64_t timeout_us = I2C_TIMEOUT_TICK * 1000ULL;
+    const uint64_t us = (fault_param < timeout_us) ? fault_param : timeout_us;
+    now_us += us;
+    total_stats.busy_us += us;
+    address_stats[address & 0x7F].busy_us += us;
+}
+
+}   // namespace
+
+uint64_t now(void){
+    return now_us;
+}
+
+void advance(const uint64_t us){
+    now_us += us;
+}
+
+uint64_t blockedTime(void){
+    return blocked_us;
+}
+
+void reset(void){
+    now_us = 0;
+    blocked_us = 0;
+    pins_ready = false;
+    initPins();
+    for (size_t i = 0; i < I2C_ADDRESS_COUNT; i++){
+        targets[i] = nullptr;
+    }
+    clearI2cStats();
+    fault = E_I2cFault::NONE;
+    fault_count = 0;
+    stuck_clocks = 0;
+}
+
+void setPin(const uint32_t pin, const int level){
+    initPins();
+    pin_level[pin % PIN_COUNT] = level;
+}
+
+int getPin(const uint32_t pin){
+    initPins();
+    return pin_output[pin % PIN_COUNT];
+}
+
+void attachI2c(const uint8_t address, I2cTarget* target){
+    targets[address & 0x7F] = (target != nullptr) ? target : &generic_target;
+}
+
+void detachI2c(const uint8_t address){
+    targets[address & 0x7F] = nullptr;
+}
+
+void injectI2cFault(const uint8_t address, const E_I2cFault new_fault, const uint32_t count, const uint32_t param){
+    fault_address = address;
+    fault = new_fault;
+    fault_count = count;
+    fault_param = param;
+}
+
+bool isSdaStuck(void){
+    return stuck_clocks != 0;
+}
+
+const I2cStats& i2cTotal(void){
+    return total_stats;
+}
+
+const I2cStats& i2cStats(const uint8_t address){
+    return address_stats[address & 0x7F];
+}
+
+void clearI2cStats(void){
+    total_stats = I2cStats();
+    for (size_t i = 0; i < I2C_ADDRESS_COUNT; i++){
+        address_stats[i] = I2cStats();
+    }
+}
+
+uint8_t i2cWrite(const uint8_t address, const uint8_t* data, const size_t len, const uint32_t clock_hz, const bool repeated, const bool stop){
+    // START + (アドレス + データ)x9bit + STOP
+    const E_I2cFault injected = beginSegment(address, len, repeated);
+    if (stuck_clocks != 0){
+        // STARTを出せない  バスエラー
+        busTime(address, 9, clock_hz);
+        return 4;
+    }
+    if (injected == E_I2cFault::STRETCH){
+        stretch(address);
+        return 4;
+    }
+    I2cTarget* target = targets[address & 0x7F];
+    if (target == nullptr || injected == E_I2cFault::NACK){
+        busTime(address, 1 + 9 + 1, clock_hz);
+        countNack(address);
+        return 2;
+    }
+    busTime(address, 1 + 9 * (1 + len) + (stop ? 1 : 0), clock_hz);
+    if (!target->write(data, len)){
+        countNack(address);
+        return 3;
+    }
+    return 0;
+}
+
+size_t i2cRead(const uint8_t address, uint8_t* data, const size_t len, const uint32_t clock_hz, const bool repeated, const bool stop){
+    const E_I2cFault injected = beginSegment(address, len, repeated);
+    if (stuck_clocks != 0){
+        busTime(address, 9, clock_hz);
+        return 0;
+    }
+    if (injected == E_I2cFault::STRETCH){
+        stretch(address);
+        return 0;
+    }
+    I2cTarget* target = targets[address & 0x7F];
+    if (target == nullptr || injected == E_I2cFault::NACK){
+        busTime(address, 1 + 9 + 1, clock_hz);
+        countNack(address);
+        return 0;
+    }
+    busTime(address, 1 + 9 * (1 + len) + (stop ? 1 : 0), clock_hz);
+    target->read(data, len);
+    if (injected == E_I2cFault::CORRUPT && len != 0){
+        data[0] = ~data[0];
+    }
+    return len;
+}
+
+uint32_t heapAllocations(void){
+    return allocations;
+}
+
+void trapHeap(const bool armed, const char* label){
+    heap_trap = armed;
+    heap_label = label;
+}
+
+}   // namespace HostSim
+
+// ------------------------------------------------------------------
+//  Arduino
+// ------------------------------------------------------------------
+
+void delay(uint32_t ms){
+    HostSim::blocked_us += static_cast<uint64_t>(ms) * 1000;
+    HostSim::now_us += static_cast<uint64_t>(ms) * 1000;
+}
+
+void delayMicroseconds(uint32_t us){
+    HostSim::blocked_us += us;
+    HostSim::now_us += us;
+}
+
+void pinMode(uint32_t pin, uint32_t mode){
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint32_t pin, uint32_t value){
+    HostSim::initPins();
+    const size_t index = pin % HostSim::PIN_COUNT;
+    // 張り付いたSDAはSCLの立ち上がりで1bitずつ進み、規定のクロック数で解放される
+    if (pin == PIN_WIRE_SCL && value == HIGH && HostSim::pin_output[index] == LOW && HostSim::stuck_clocks != 0){
+        HostSim::stuck_clocks--;
+    }
+    HostSim::pin_output[index] = static_cast<int>(value);
+}
+
+int digitalRead(uint32_t pin){
+    HostSim::initPins();
+    if (pin == PIN_WIRE_SDA && HostSim::stuck_clocks != 0){
+        return LOW;
+    }
+    return HostSim::pin_level[pin % HostSim::PIN_COUNT];
+}
+
+// ------------------------------------------------------------------
+//  Wire
+// ------------------------------------------------------------------
+
+uint8_t TwoWire::endTransmission(bool send_stop){
+    const uint8_t result = HostSim::i2cWrite(tx_address, tx_buffer, tx_length, clock_hz, open, send_stop);
+    open = (result == 0) && !send_stop;
+    tx_length = 0;
+    return result;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool send_stop){
+    const size_t length = (quantity < BUFFER_LENGTH) ? quantity : BUFFER_LENGTH;
+    rx_length = HostSim::i2cRead(address, rx_buffer, length, clock_hz, open, send_stop);
+    rx_index = 0;
+    open = (rx_length != 0) && !send_stop;
+    return static_cast<uint8_t>(rx_length);
+}
+
+// ------------------------------------------------------------------
+//  ヒープ  operator newを置き換えて数える
+// ------------------------------------------------------------------
+
+namespace {
+void* allocate(const size_t size){
+    if (HostSim::heap_trap){
+        fprintf(stderr, "heap trap: operator new(%zu) in %s\n", size, HostSim::heap_label);
+        abort();
+    }
+    HostSim::allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+}   // namespace
+
+void* operator new(size_t size){ return allocate(size); }
+void* operator new[](size_t size){ return allocate(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
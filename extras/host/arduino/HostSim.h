@@ -0,0 +1,172 @@
+/**************************************************************************/
+/*!
+ * @file HostSim.h/cpp
+ * @brief ホスト側シミュレーション用のArduino環境  仮想時間、ピン、I2Cバス、ヒープの計数
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    extras/host/arduino のスタブ（Arduino.h, Wire.h, HardwareSerial.h, 各ドライバ）と組み合わせて、
+ *    src/ のArduinoに依存するクラスをホストでビルドして動かす。
+ *    時間は仮想時間 [us] で、delay(), delayMicroseconds(), I2Cの転送, ブロックしたSerialの書き込みだけ進む。
+ *    シミュレーションは1CLKごとにadvance()で時間を進める。
+ *    I2Cはアドレスごとに模擬デバイス(I2cTarget)をつなぎ、トランザクション数・バイト数・バスの占有時間を数える。
+ *    故障注入（NACK, クロックストレッチのタイムアウト, データ化け, SDAの張り付き）はバス側で行うので、
+ *    ファームウエアの EH_I2C_FAULT_INJECTION とは独立に使える。
+ *
+ *    ビルド例: g++ -std=gnu++14 -I. -I../../src sim.cpp arduino/HostSim.cpp ../../src/...
+ *             （extras/host から。-I arduino でスタブをArduinoのヘッダとして見せる）
+ */
+/**************************************************************************/
+
+#ifndef _HOSTSIM_H_
+#define _HOSTSIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace HostSim {
+
+// consts
+constexpr size_t PIN_COUNT = 64;
+constexpr uint32_t I2C_DEFAULT_CLOCK = 100000;
+
+// ------------------------------------------------------------------
+//  仮想時間
+// ------------------------------------------------------------------
+
+/// @brief 現在の仮想時間 [us]
+uint64_t now(void);
+
+/// @brief 仮想時間を進める
+/// @param us 進める時間 [us]
+void advance(const uint64_t us);
+
+/// @brief delay(), delayMicroseconds()でブロックした時間の累計 [us]
+/// @note 起動処理などがCLKを止めた時間の評価に使う
+uint64_t blockedTime(void);
+
+/// @brief 仮想時間と計数を全て初期状態に戻す  I2Cの模擬デバイスの接続は外す
+void reset(void);
+
+// ------------------------------------------------------------------
+//  ピン
+// ------------------------------------------------------------------
+
+/// @brief digitalRead()が返す値を設定する（デフォルトはHIGH）
+void setPin(const uint32_t pin, const int level);
+
+/// @brief digitalWrite()で最後に書かれた値
+int getPin(const uint32_t pin);
+
+// ------------------------------------------------------------------
+//  I2C
+// ------------------------------------------------------------------
+
+/*!
+ * @brief I2Cの模擬デバイス  Wireのトランザクションごとに呼ばれる
+ */
+class I2cTarget {
+    public:
+    virtual ~I2cTarget(){};
+    /// @brief 書き込み（アドレスbyteの後のデータ）
+    /// @return True:ACK  False:データにNACK
+    virtual bool write(const uint8_t* data, const size_t len){ (void)data; (void)len; return true; };
+    /// @brief 読み出し
+    virtual void read(uint8_t* data, const size_t len){ memset(data, 0, len); };
+};
+
+/// @brief 注入するバスの故障
+enum class E_I2cFault : uint8_t {
+    NONE = 0,
+    NACK,       // アドレスにNACK
+    STRETCH,    // クロックストレッチが続いた後にタイムアウト（fault_usだけ、最長でWireのタイムアウトまで時間が進む）
+    CORRUPT,    // 読み出しの1byte目を反転
+    STUCK_SDA   // SDAがLOWに張り付く  SCLをstuck_clocks回クロックすると解放
+};
+
+/// @brief バスの計数
+struct I2cStats{
+    uint32_t transactions = 0;  // STARTからSTOPまで（リピートスタートは同じトランザクション）
+    uint32_t wire_bytes = 0;    // アドレスbyteを含むバイト数
+    uint32_t nacks = 0;
+    uint64_t busy_us = 0;       // バスを使っていた時間
+};
+
+/// @brief 模擬デバイスをつなぐ
+/// @param address 7bitアドレス
+/// @param target 模擬デバイス  nullptrで汎用のデバイス（書き込みは捨て、読み出しは0）
+void attachI2c(const uint8_t address, I2cTarget* target = nullptr);
+
+/// @brief 模擬デバイスを外す  以降そのアドレスはNACK
+void detachI2c(const uint8_t address);
+
+/// @brief 故障を注入する
+/// @param address 対象のアドレス  STUCK_SDAでは最初にこのアドレスにアクセスした時点で張り付く
+/// @param fault 故障の種類
+/// @param count 故障させるトランザクション数（STUCK_SDAでは張り付きを起こす回数）
+/// @param fault_us STRETCHで進める時間 [us] / STUCK_SDAで解放までに必要なSCLのクロック数
+void injectI2cFault(const uint8_t address, const E_I2cFault fault, const uint32_t count = 1, const uint32_t fault_us = 0);
+
+/// @brief SDAが張り付いているか
+bool isSdaStuck(void);
+
+/// @brief バス全体の計数
+const I2cStats& i2cTotal(void);
+
+/// @brief アドレスごとの計数
+const I2cStats& i2cStats(const uint8_t address);
+
+/// @brief 計数だけをクリアする（模擬デバイスと故障はそのまま）
+void clearI2cStats(void);
+
+/// @brief 書き込みの1区間（START/リピートスタートからSTOPもしくは次のリピートスタートまで）  Wireから呼ぶ
+/// @return 0:成功 2:アドレスにNACK 3:データにNACK 4:その他のエラー
+uint8_t i2cWrite(const uint8_t address, const uint8_t* data, const size_t len, const uint32_t clock_hz, const bool repeated, const bool stop);
+
+/// @brief 読み出しの1区間  Wireから呼ぶ
+/// @return 読み出したバイト数  NACK・エラーは0
+size_t i2cRead(const uint8_t address, uint8_t* data, const size_t len, const uint32_t clock_hz, const bool repeated, const bool stop);
+
+// ------------------------------------------------------------------
+//  ヒープ
+// ------------------------------------------------------------------
+
+/// @brief operator newの呼び出し回数（HostSim.cppで置き換えている）
+uint32_t heapAllocations(void);
+
+/// @brief operator newをトラップする  有効な間に呼ばれたらメッセージを出してabort()する
+/// @param armed True:トラップする
+/// @param label abort時に表示する区間の名前
+void trapHeap(const bool armed, const char* label = "");
+
+// ------------------------------------------------------------------
+//  処理時間の計測（ベンチマーク用  仮想時間ではない）
+// ------------------------------------------------------------------
+
+/// @brief stamp()の単位  表示用
+#if defined(__x86_64__) || defined(__i386__)
+constexpr const char* STAMP_UNIT = "TSC cycles";
+#else
+constexpr const char* STAMP_UNIT = "ns";
+#endif
+
+/// @brief 時刻  TSCが使えればサイクル数、使えなければsteady_clockの[ns]
+/// @note ホストでの値なので、STM32での絶対値ではなく比で見る
+inline uint64_t stamp(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+}   // namespace HostSim
+
+#endif //_HOSTSIM_H_
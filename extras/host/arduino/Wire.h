@@ -0,0 +1,79 @@
+/**************************************************************************/
+/*!
+ * @file Wire.h
+ * @brief ホスト側シミュレーション用のWire(TwoWire)のスタブ
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    トランザクションはHostSimのI2Cバスに渡し、バスクロックに応じて仮想時間を進める。
+ *    endTransmission()の戻り値はArduinoと同じ  0:成功 2:アドレスにNACK 3:データにNACK 4:その他のエラー
+ *    クロックストレッチが続く転送は、I2C_TIMEOUT_TICKで打ち切ってエラー(4)にする
+ */
+/**************************************************************************/
+
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+#include "Arduino.h"
+
+// 1回の転送のタイムアウト [ms]  STM32コア（utility/twi.h）と同じ名前
+//  コアのデフォルトは100ms  ファームウエアと同じくbuild_opt.hで設定した値（EH_I2C_TIMEOUT_MS）にしておく
+#ifndef I2C_TIMEOUT_TICK
+#define I2C_TIMEOUT_TICK 4
+#endif
+
+class TwoWire : public Stream {
+    public:
+    // consts
+    static constexpr size_t BUFFER_LENGTH = 32;
+
+    void begin(void){ clock_hz = HostSim::I2C_DEFAULT_CLOCK; }
+    void end(void){}
+    void setClock(uint32_t frequency){ clock_hz = frequency; }
+    uint32_t getClock(void) const { return clock_hz; }
+
+    void beginTransmission(uint8_t address){
+        tx_address = address;
+        tx_length = 0;
+    }
+    void beginTransmission(int address){ beginTransmission(static_cast<uint8_t>(address)); }
+
+    size_t write(uint8_t data) override {
+        if (tx_length >= BUFFER_LENGTH){
+            return 0;
+        }
+        tx_buffer[tx_length++] = data;
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t quantity) override {
+        size_t n = 0;
+        while (n < quantity && write(data[n]) != 0){
+            n++;
+        }
+        return n;
+    }
+    using Print::write;
+
+    uint8_t endTransmission(bool send_stop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool send_stop = true);
+    uint8_t requestFrom(int address, int quantity){ return requestFrom(static_cast<uint8_t>(address), static_cast<uint8_t>(quantity), true); }
+
+    int available(void) override { return static_cast<int>(rx_length - rx_index); }
+    int read(void) override { return (rx_index < rx_length) ? rx_buffer[rx_index++] : -1; }
+    int peek(void) override { return (rx_index < rx_length) ? rx_buffer[rx_index] : -1; }
+
+    private:
+    uint32_t clock_hz = HostSim::I2C_DEFAULT_CLOCK;
+    uint8_t tx_address = 0;
+    uint8_t tx_buffer[BUFFER_LENGTH] = {};
+    size_t tx_length = 0;
+    uint8_t rx_buffer[BUFFER_LENGTH] = {};
+    size_t rx_length = 0;
+    size_t rx_index = 0;
+    bool open = false;          // STOPを出していない（リピートスタートで続く）
+};
+
+extern TwoWire Wire;
+
+#endif //_HOST_WIRE_H_
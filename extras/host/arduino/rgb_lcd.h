@@ -0,0 +1,101 @@
+/**************************************************************************/
+/*!
+ * @file rgb_lcd.h
+ * @brief ホスト側シミュレーション用のGrove LCD RGB Backlightライブラリのスタブ
+ * @par
+ *    ライブラリと同じく、コマンド・文字は1byteごとに1トランザクション（制御byte + 1byte）。
+ *    begin()の待ち時間（合計約57ms）もdelayMicroseconds()で再現する。
+ */
+/**************************************************************************/
+
+#ifndef _HOST_RGB_LCD_H_
+#define _HOST_RGB_LCD_H_
+
+#include "Wire.h"
+
+#define LCD_ADDRESS (0x7c >> 1)
+#define RGB_ADDRESS (0xc4 >> 1)
+
+#define LCD_CLEARDISPLAY 0x01
+#define LCD_RETURNHOME 0x02
+#define LCD_ENTRYMODESET 0x04
+#define LCD_DISPLAYCONTROL 0x08
+#define LCD_FUNCTIONSET 0x20
+#define LCD_SETCGRAMADDR 0x40
+#define LCD_SETDDRAMADDR 0x80
+#define LCD_ENTRYLEFT 0x02
+#define LCD_DISPLAYON 0x04
+#define LCD_2LINE 0x08
+
+class rgb_lcd : public Print {
+    public:
+    rgb_lcd(){}
+
+    void begin(uint8_t cols, uint8_t lines, uint8_t dotsize = 0){
+        (void)cols;
+        (void)dotsize;
+        Wire.begin();
+        const uint8_t function = (lines > 1) ? LCD_2LINE : 0;
+        delayMicroseconds(50000);
+        command(LCD_FUNCTIONSET | function);
+        delayMicroseconds(4500);
+        command(LCD_FUNCTIONSET | function);
+        delayMicroseconds(150);
+        command(LCD_FUNCTIONSET | function);
+        command(LCD_FUNCTIONSET | function);
+        command(LCD_DISPLAYCONTROL | LCD_DISPLAYON);
+        clear();
+        command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+        // バックライト
+        setReg(0x00, 0);
+        setReg(0x08, 0xFF);
+        setReg(0x01, 0x20);
+        setRGB(255, 255, 255);
+    }
+    void clear(void){
+        command(LCD_CLEARDISPLAY);
+        delayMicroseconds(2000);
+    }
+    void home(void){
+        command(LCD_RETURNHOME);
+        delayMicroseconds(2000);
+    }
+    void setCursor(uint8_t col, uint8_t row){
+        command((row == 0) ? (col | 0x80) : (col | 0xC0));
+    }
+    void createChar(uint8_t location, uint8_t charmap[]){
+        command(LCD_SETCGRAMADDR | ((location & 0x7) << 3));
+        for (uint8_t i = 0; i < 8; i++){
+            write(charmap[i]);
+        }
+    }
+    void setRGB(uint8_t r, uint8_t g, uint8_t b){
+        setReg(0x04, r);
+        setReg(0x03, g);
+        setReg(0x02, b);
+    }
+    void command(uint8_t value){
+        send(0x80, value);
+    }
+    size_t write(uint8_t value) override {
+        send(0x40, value);
+        return 1;
+    }
+    using Print::write;
+
+    private:
+    void send(uint8_t control, uint8_t value){
+        Wire.beginTransmission(LCD_ADDRESS);
+        Wire.write(control);
+        Wire.write(value);
+        Wire.endTransmission();
+    }
+    void setReg(uint8_t reg, uint8_t value){
+        Wire.beginTransmission(RGB_ADDRESS);
+        Wire.write(reg);
+        Wire.write(value);
+        Wire.endTransmission();
+    }
+};
+
+#endif //_HOST_RGB_LCD_H_
@@ -0,0 +1,173 @@
+/**************************************************************************/
+/*!
+ * @file bench_batch_throughput.cpp
+ * @brief 連続計測の液面をUARTで送れる速さ [readings/s] を、1液面1フレームとバッチ（差分varint）で比べる
+ * @par
+ *    IotGateway::addReading()に毎CLK（100readings/s）液面を渡し、HardwareSerialの模擬UARTで送る。
+ *    送ったバイト列はTelemetryDecoderでJSONに戻し、届いた液面を数える。
+ *      JSON:          1液面1フレーム  {"level":n}
+ *      BINARY:        1液面1フレーム  COBS+CRC
+ *      BATCH:         バッチ32個  最大遅延は初期値（DEFAULT_BATCH_MAX_LATENCY）
+ *      BATCH size-only: バッチ32個  最大遅延0（数だけで送る）
+ *    1. 115200baudで、1液面あたりのUARTのバイト数と、それから求めた9600baudで送れる液面の数
+ *    2. 9600baudで10秒  届いた液面の数（送信待ちのLEVELのフレームは最新の1つにまとめられる）
+ *       バッチは全ての液面が順に届くこと、最大遅延0では全てのフレームが32個で送られること
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src bench_batch_throughput.cpp TelemetryDecoder.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "IotGateway.h"
+#include "TelemetryDecoder.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// 動かす時間 [CLK]  10秒
+constexpr uint32_t TICKS = 1000;
+
+constexpr uint32_t FAST_BAUD = 115200;
+constexpr uint32_t SLOW_BAUD = 9600;
+
+constexpr uint8_t BATCH_SIZE = IotGateway::MAX_BATCH_SIZE;
+
+/*!
+ * @brief 送り方
+ */
+enum class E_Method : uint8_t {
+    JSON = 0,
+    BINARY,
+    BATCH,
+    BATCH_SIZE_ONLY
+};
+
+const char* const METHOD_NAMES[] = { "JSON", "BINARY", "BATCH", "BATCH size-only" };
+
+/// @brief 1回の結果
+struct Result{
+    uint64_t wire_bytes;
+    uint32_t offered;
+    std::vector<uint16_t> delivered;    // 届いた液面  順に
+    uint32_t frames;
+    uint32_t short_frames;              // バッチの数に満たないフレーム
+    uint32_t crc_errors;
+};
+
+/// @brief i番目の液面  50%付近で±0.2%ゆらぐ
+uint16_t levelAt(const uint32_t i){
+    return static_cast<uint16_t>(500 + (i * 7) % 5 - 2);
+}
+
+/// @brief JSONの文字列から "level":n を順に取り出す
+/// @return フレーム中の液面の数
+uint32_t collectLevels(const std::string& json, std::vector<uint16_t>& levels){
+    static const std::string key = "\"level\":";
+    uint32_t count = 0;
+    for (size_t pos = json.find(key); pos != std::string::npos; pos = json.find(key, pos + 1)){
+        levels.push_back(static_cast<uint16_t>(std::stoul(json.substr(pos + key.size()))));
+        count++;
+    }
+    return count;
+}
+
+Result run(const E_Method method, const uint32_t baud){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(baud);
+    gateway.setFraming(method == E_Method::JSON ? IotGateway::E_Framing::JSON : IotGateway::E_Framing::BINARY);
+    if (method == E_Method::BATCH){
+        gateway.setBatching(BATCH_SIZE, IotGateway::DEFAULT_BATCH_MAX_LATENCY);
+    } else if (method == E_Method::BATCH_SIZE_ONLY){
+        gateway.setBatching(BATCH_SIZE, 0);
+    }
+
+    Result result = { 0, TICKS, {}, 0, 0, 0 };
+    TelemetryDecoder decoder([&result, method](const std::string& json){
+        const uint32_t count = collectLevels(json, result.delivered);
+        result.frames++;
+        result.short_frames += (method >= E_Method::BATCH && count < BATCH_SIZE) ? 1 : 0;
+    });
+    for (uint32_t tick = 0; tick < TICKS; tick++){
+        gateway.addReading(levelAt(tick));
+        gateway.clk_in();
+        HostSim::advance(CLK_US);
+    }
+    // 残りを送り切る  バッチは数に満たなくても送る
+    gateway.setBatching(1, 0);
+    while (gateway.getTxQueueDepth() != 0){
+        gateway.pollTx();
+        HostSim::advance(1000);
+    }
+    HostSim::advance(CLK_US);
+
+    const std::string& sent = gateway.transmitted();
+    result.wire_bytes = sent.size();
+    if (method == E_Method::JSON){
+        for (size_t begin = 0, end = sent.find('\n'); end != std::string::npos; begin = end + 1, end = sent.find('\n', begin)){
+            collectLevels(sent.substr(begin, end - begin), result.delivered);
+            result.frames++;
+        }
+    } else {
+        decoder.feed(reinterpret_cast<const uint8_t*>(sent.data()), sent.size());
+        result.crc_errors = decoder.getErrorCount();
+    }
+    return result;
+}
+
+/// @brief 届いた液面が、送った順の液面と一致するか（全て届いた場合）
+bool inOrder(const Result& r){
+    if (r.delivered.size() != r.offered){
+        return false;
+    }
+    for (uint32_t i = 0; i < r.offered; i++){
+        if (r.delivered[i] != levelAt(i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+}   // namespace
+
+int main(void){
+    int failures = 0;
+
+    printf("1. wire bytes per reading at %ubaud (%u readings, 1 per tick)\n", FAST_BAUD, TICKS);
+    double capacity[4] = {};
+    for (uint8_t m = 0; m < 4; m++){
+        const Result r = run(static_cast<E_Method>(m), FAST_BAUD);
+        const double per_reading = static_cast<double>(r.wire_bytes) / r.delivered.size();
+        capacity[m] = SLOW_BAUD / 10.0 / per_reading;
+        const bool ok = inOrder(r) && r.crc_errors == 0;
+        printf("   %-16s %6.2f bytes/reading  -> %5.0f readings/s at %ubaud (x%.1f)  %s\n",
+               METHOD_NAMES[m], per_reading, capacity[m], SLOW_BAUD, capacity[m] / capacity[0], ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    }
+
+    printf("2. %u readings/s offered at %ubaud for %.0fs\n", static_cast<uint32_t>(1000000 / CLK_US), SLOW_BAUD, TICKS * CLK_US / 1e6);
+    for (uint8_t m = 0; m < 4; m++){
+        const E_Method method = static_cast<E_Method>(m);
+        const Result r = run(method, SLOW_BAUD);
+        bool ok = r.crc_errors == 0;
+        if (method == E_Method::BATCH){
+            ok = ok && inOrder(r);
+        } else if (method == E_Method::BATCH_SIZE_ONLY){
+            // 最後に送り切った1フレーム以外は全て32個
+            ok = ok && inOrder(r) && r.short_frames <= 1;
+        }
+        printf("   %-16s delivered %4zu/%u readings in %4u frames (%u short)  %s\n",
+               METHOD_NAMES[m], r.delivered.size(), r.offered, r.frames, r.short_frames, ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
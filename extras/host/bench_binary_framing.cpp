@@ -0,0 +1,200 @@
+/**************************************************************************/
+/*!
+ * @file bench_binary_framing.cpp
+ * @brief テレメトリ1フレームの長さと組み立て時間を、バイナリ形式（COBS+CRC）とJSON形式（addPayload()）で比べる
+ * @par
+ *    同じ値（液面, モード, タイマ残り時間, エラーフラグ）をIotGatewayで送信リングバッファに入れる。
+ *      JSON:    addPayload()でキーごとにノードを加え、sendPayload()で { } CR LF を付けて入れる
+ *      BINARY:  addRecord()でレコードを加え、sendPayload()でCRC-16を付けてCOBSで符号化し、0x00を付けて入れる
+ *    1. バイナリ形式のフレームをTelemetryDecoderでJSONに戻し、JSON形式と同じ値になること
+ *    2. 1フレームの長さ（区切りを含む、UARTに出るバイト数）
+ *    3. 1フレームの組み立て時間（addPayload()/addRecord()からsendPayload()まで）と、
+ *       そのうちCRC-16とCOBSの符号化だけの時間  CRC-16はテーブルを持たない1bitずつの計算（src/Crc16.cpp）なので、
+ *       バイナリ形式の組み立て時間の大半を占める
+ *    サイクル数はHostSim::stamp()（x86ではTSC、それ以外はsteady_clockの時間 [ns]）。ホストでの値なので比で見る。
+ *    1フレームごとに送信リングバッファをUARTに送り出す（時間には含めない）。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src bench_binary_framing.cpp TelemetryDecoder.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <Arduino.h>
+#include "IotGateway.h"
+#include "Cobs.h"
+#include "Crc16.h"
+#include "TelemetryDecoder.h"
+
+namespace {
+
+// 繰り返し回数
+constexpr uint32_t FRAMES = 100000;
+
+// 値の確認をするフレーム数
+constexpr uint32_t CHECK_FRAMES = 10000;
+
+constexpr uint32_t BAUD = 115200;
+
+/// @brief 1フレームの値
+struct Frame{
+    uint16_t level;
+    uint16_t mode;
+    uint16_t remain;
+    uint16_t error;
+};
+
+Frame makeFrame(const uint32_t i){
+    return Frame{ static_cast<uint16_t>(i % 1001), static_cast<uint16_t>(i % 3),
+                  static_cast<uint16_t>(i % 60), static_cast<uint16_t>((i & 0xFF) == 0 ? 1 : 0) };
+}
+
+/// @brief 1フレームを送信リングバッファに入れる
+void build(IotGateway& gateway, const Frame& f){
+    if (gateway.getFraming() == IotGateway::E_Framing::JSON){
+        gateway.addPayload("level", static_cast<int32_t>(f.level));
+        gateway.addPayload("mode", static_cast<int32_t>(f.mode));
+        gateway.addPayload("remain", static_cast<int32_t>(f.remain));
+        gateway.addPayload("error", static_cast<int32_t>(f.error));
+    } else {
+        gateway.addRecord(IotGateway::E_Schema::LEVEL, f.level);
+        gateway.addRecord(IotGateway::E_Schema::MODE, f.mode);
+        gateway.addRecord(IotGateway::E_Schema::REMAIN, f.remain);
+        gateway.addRecord(IotGateway::E_Schema::ERROR_FLAGS, f.error);
+    }
+    gateway.sendPayload();
+}
+
+/// @brief 送信リングバッファが空になるまでUARTに送り出す
+void flush(IotGateway& gateway){
+    while (gateway.getTxQueueDepth() != 0){
+        gateway.pollTx();
+        HostSim::advance(1000);
+    }
+}
+
+/// @brief 計測の結果
+struct Result{
+    double cycles;          // 1フレームの組み立て時間
+    double wire_bytes;      // 1フレームのUARTに出るバイト数
+};
+
+Result run(IotGateway& gateway, const IotGateway::E_Framing framing){
+    gateway.setFraming(framing);
+    uint64_t cycles = 0;
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < FRAMES; i++){
+        const Frame f = makeFrame(i);
+        const size_t free_before = gateway.getTxFree();
+        const uint64_t begin = HostSim::stamp();
+        build(gateway, f);
+        cycles += HostSim::stamp() - begin;
+        bytes += free_before - gateway.getTxFree();
+        flush(gateway);
+        gateway.transmitted().clear();
+    }
+    return Result{ static_cast<double>(cycles) / FRAMES, static_cast<double>(bytes) / FRAMES };
+}
+
+/// @brief CRC-16とCOBSの符号化だけの時間（sendFrame()と同じ手順）
+double runEncodeOnly(void){
+    uint8_t frame[32];
+    uint8_t encoded[Cobs::maxEncodedLength(sizeof(frame)) + 1];
+    volatile size_t sink = 0;
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < FRAMES; i++){
+        const Frame f = makeFrame(i);
+        // [種類][シーケンス番号][ID 値]x4
+        const uint8_t body[] = { IotGateway::FRAME_TYPE_RECORDS, static_cast<uint8_t>(i),
+            0x01, static_cast<uint8_t>(f.level), static_cast<uint8_t>(f.level >> 8),
+            0x02, static_cast<uint8_t>(f.mode),
+            0x03, static_cast<uint8_t>(f.remain), static_cast<uint8_t>(f.remain >> 8),
+            0x04, static_cast<uint8_t>(f.error) };
+        memcpy(frame, body, sizeof(body));
+        const uint64_t begin = HostSim::stamp();
+        size_t length = sizeof(body);
+        const uint16_t crc = Crc16::modbus(frame, length);
+        frame[length++] = crc & 0xFF;
+        frame[length++] = crc >> 8;
+        size_t encoded_length = Cobs::encode(frame, length, encoded);
+        encoded[encoded_length++] = Cobs::DELIMITER;
+        cycles += HostSim::stamp() - begin;
+        sink = sink + encoded_length;
+    }
+    return static_cast<double>(cycles) / FRAMES;
+}
+
+/// @brief 時刻の取得だけの時間（計測の誤差の目安）
+double runOverhead(void){
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < FRAMES; i++){
+        const uint64_t begin = HostSim::stamp();
+        cycles += HostSim::stamp() - begin;
+    }
+    return static_cast<double>(cycles) / FRAMES;
+}
+
+/// @brief JSON形式のフレームの文字列（CR LFを除く）に、TelemetryDecoderの"seq"を除いた出力が一致するか
+int runRoundTrip(IotGateway& gateway){
+    std::string decoded;
+    TelemetryDecoder decoder([&decoded](const std::string& json){
+        // {"seq":n, を { にする
+        const size_t comma = json.find(',');
+        decoded = "{" + json.substr(comma + 1);
+    });
+    uint32_t mismatches = 0;
+    std::string json_frame;
+    for (uint32_t i = 0; i < CHECK_FRAMES; i++){
+        const Frame f = makeFrame(i * 7919);
+        gateway.setFraming(IotGateway::E_Framing::JSON);
+        build(gateway, f);
+        flush(gateway);
+        json_frame = gateway.transmitted().substr(0, gateway.transmitted().size() - 2);
+        gateway.transmitted().clear();
+
+        gateway.setFraming(IotGateway::E_Framing::BINARY);
+        build(gateway, f);
+        flush(gateway);
+        decoded.clear();
+        decoder.feed(reinterpret_cast<const uint8_t*>(gateway.transmitted().data()), gateway.transmitted().size());
+        gateway.transmitted().clear();
+        mismatches += (decoded == json_frame) ? 0 : 1;
+    }
+    printf("1. binary frame decoded by TelemetryDecoder vs JSON frame (%u frames): %u mismatches, %u CRC errors"
+           "  e.g. %s  %s\n", CHECK_FRAMES, mismatches, decoder.getErrorCount(), json_frame.c_str(),
+           (mismatches == 0 && decoder.getErrorCount() == 0) ? "PASS" : "FAIL");
+    return (mismatches == 0 && decoder.getErrorCount() == 0) ? 0 : 1;
+}
+
+}   // namespace
+
+int main(void){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(BAUD);
+
+    int failures = runRoundTrip(gateway);
+
+    const Result json = run(gateway, IotGateway::E_Framing::JSON);
+    const Result binary = run(gateway, IotGateway::E_Framing::BINARY);
+    const double encode_only = runEncodeOnly();
+    const double overhead = runOverhead();
+
+    const char* unit = HostSim::STAMP_UNIT;
+    printf("2./3. level, mode, remain, error x%u (timer overhead %.0f %s included)\n", FRAMES, overhead, unit);
+    printf("   JSON (addPayload):      %5.1f bytes/frame  %6.0f %s/frame  %5.0f frames/s at %ubaud\n",
+           json.wire_bytes, json.cycles, unit, BAUD / 10.0 / json.wire_bytes, BAUD);
+    printf("   BINARY (COBS+CRC-16):   %5.1f bytes/frame  %6.0f %s/frame  %5.0f frames/s at %ubaud\n",
+           binary.wire_bytes, binary.cycles, unit, BAUD / 10.0 / binary.wire_bytes, BAUD);
+    printf("     of which CRC+COBS:                       %6.0f %s/frame\n", encode_only, unit);
+    printf("   binary/JSON: size %.2f  time %.2f\n", binary.wire_bytes / json.wire_bytes, binary.cycles / json.cycles);
+
+    const bool ok = binary.wire_bytes < json.wire_bytes;
+    printf("%s\n", (failures == 0 && ok) ? "PASS" : "FAIL");
+    return (failures == 0 && ok) ? 0 : 1;
+}
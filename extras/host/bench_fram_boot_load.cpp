@@ -0,0 +1,194 @@
+/**************************************************************************/
+/*!
+ * @file bench_fram_boot_load.cpp
+ * @brief 起動時のFRAMからのパラメタの読み込みのI2Cトランザクション数とバイト数を、1byteごとの読み出しとブロック読み出しで比べる
+ * @par
+ *    extras/host/arduino の模擬FRAM（MB85RC256V）にParameterStorage::store()でパラメタと製造番号を書き込み、
+ *    BootSequencer::loadParameters()と同じパラメタと製造番号を読む。
+ *      per-byte:  以前のParameterStorage  パラメタごとに応答の確認をして、read8()で1byteずつ読む
+ *                 製造番号は終端まで1byteずつ読む
+ *      block:     ParameterStorage  パラメタごとに応答の確認をして、read()で1回のトランザクションで読む
+ *                 製造番号は最大長（SER_NUM_MAX_LENGTH）を読む
+ *    1. 両方で読んだ値が、書き込んだ値と一致すること
+ *    2. FRAM(0x50)へのトランザクション数とバイト数（アドレスbyteを含む）
+ *       応答の確認（アドレスのみのトランザクション）は両方でパラメタごとに1回なので、データの転送と分けて出す
+ *       バスの時間は1byteを9bitとして100kHz, 400kHzで求めたもの（ドライバの処理時間は含まない）
+ *    参考: 書き込みはライブラリ（スタブも同じ）がチャンクごとに書き込み完了の確認(ACKポーリング)を出すので、
+ *          書き込みの数にだけ含まれる  起動時の読み込みには関係しない
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src bench_fram_boot_load.cpp arduino/HostSim.cpp \
+ *          ../../src/ParameterStorage.cpp ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostDevices.h"
+#include "ParameterStorage.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+using Category = ParameterStorage::E_ParameterCategories;
+
+// 製造番号  終端を含めて13byte
+const char SERIAL_NUMBER[] = "EH900-260001";
+
+HostSim::Fram fram;
+
+/// @brief 起動時に読むもの  BootSequencer::loadParameters()と製造番号
+struct Loaded{
+    uint8_t sensor_length;
+    uint8_t timer_period;
+    ParameterStorage::UnitAddress unit_address;
+    ParameterStorage::ScalingParameter scaling;
+    bool calibrated;
+    ParameterStorage::CalData cal_data;
+    char serial_number[ParameterStorage::SER_NUM_MAX_LENGTH];
+};
+
+// 読むパラメタの数（製造番号を含む）  応答の確認もパラメタごとに1回
+constexpr uint32_t READS = 7;
+
+/*!
+ * @brief 以前のParameterStorageの読み出し  パラメタを1byteごとにread8()で読む
+ */
+class LegacyStorage : public Adafruit_FRAM_I2C {
+    public:
+    template <typename T>
+    bool read(const Category parameter_name, T& parameter){
+        const uint16_t idx = static_cast<uint16_t>(parameter_name);
+        uint8_t* ptr = (uint8_t *) &parameter;
+        I2cClock.select(I2C_ADDR::FRAM);
+        if (!I2cRecovery.check(I2C_ADDR::FRAM)){
+            return false;
+        }
+        for (size_t i = 0; i < sizeof(parameter); i++){
+            ptr[i] = read8(idx + i);
+        }
+        I2cRecovery.filterRead(I2C_ADDR::FRAM, ptr, sizeof(parameter));
+        return true;
+    };
+
+    bool read(const Category parameter_name, char* parameter){
+        const uint16_t idx = static_cast<uint16_t>(parameter_name);
+        I2cClock.select(I2C_ADDR::FRAM);
+        if (!I2cRecovery.check(I2C_ADDR::FRAM)){
+            return false;
+        }
+        size_t i = 0;
+        for (i = 0; i < ParameterStorage::SER_NUM_MAX_LENGTH; i++){
+            parameter[i] = read8(idx + i);
+            if (parameter[i] == '\0'){
+                break;
+            }
+        }
+        return i != 0 && i != ParameterStorage::SER_NUM_MAX_LENGTH;
+    };
+};
+
+/// @brief 起動時と同じ順に読む
+template <typename Storage>
+bool load(Storage& storage, Loaded& loaded){
+    bool ack = storage.read(Category::SENSOR_LENGTH, loaded.sensor_length);
+    ack = storage.read(Category::TIMER_PERIOD, loaded.timer_period) && ack;
+    ack = storage.read(Category::UNIT_ADDRESS, loaded.unit_address) && ack;
+    ack = storage.read(Category::SCALING, loaded.scaling) && ack;
+    ack = storage.read(Category::CAL_FLAG, loaded.calibrated) && ack;
+    ack = storage.read(Category::CAL_DATA, loaded.cal_data) && ack;
+    ack = storage.read(Category::SERIAL_NUMBER, loaded.serial_number) && ack;
+    return ack;
+}
+
+void attachDevices(void){
+    HostSim::reset();
+    HostSim::attachI2c(I2C_ADDR::FRAM, &fram);
+    Wire.begin();
+    I2cClock.begin(&Wire);
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+    I2cClock.setActive(I2C_ADDR::FRAM, true);
+}
+
+/// @brief 1回の結果
+struct Result{
+    bool ack;
+    bool matched;
+    uint32_t transactions;      // 応答の確認を除く
+    uint32_t wire_bytes;        // 応答の確認を除く
+};
+
+template <typename Storage>
+Result run(const Loaded& expected){
+    attachDevices();
+    Storage storage;
+    storage.begin(I2C_ADDR::FRAM);
+    HostSim::clearI2cStats();
+
+    Loaded loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    const bool ack = load(storage, loaded);
+    const HostSim::I2cStats& stats = HostSim::i2cStats(I2C_ADDR::FRAM);
+    return Result{ ack, memcmp(&loaded, &expected, sizeof(loaded)) == 0,
+                   stats.transactions - READS, stats.wire_bytes - READS };
+}
+
+void printResult(const char* name, const Result& r){
+    printf("   %-10s %3u transactions  %4u bytes  (+%u probes)  bus %5.1fms at 100kHz  %4.1fms at 400kHz  values %s\n",
+           name, r.transactions, r.wire_bytes, READS, r.wire_bytes * 9 / 100.0, r.wire_bytes * 9 / 400.0,
+           (r.ack && r.matched) ? "match" : "MISMATCH");
+}
+
+}   // namespace
+
+int main(void){
+    Loaded expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.sensor_length = 48;
+    expected.timer_period = 30;
+    expected.unit_address = ParameterStorage::UnitAddress::make(17);
+    expected.scaling = ParameterStorage::ScalingParameter{ 1000, 0 };
+    expected.calibrated = true;
+    expected.cal_data = ParameterStorage::CalData{ -12, 7, 1.0012f, 0.9987f, 3, 750 };
+    strncpy(expected.serial_number, SERIAL_NUMBER, sizeof(expected.serial_number));
+
+    // 書き込み  値は以降の読み出しで使う
+    memset(fram.memory, 0, sizeof(fram.memory));
+    attachDevices();
+    ParameterStorage storage;
+    storage.begin(I2C_ADDR::FRAM);
+    HostSim::clearI2cStats();
+    bool stored = storage.store(Category::SENSOR_LENGTH, expected.sensor_length);
+    stored = storage.store(Category::TIMER_PERIOD, expected.timer_period) && stored;
+    stored = storage.store(Category::UNIT_ADDRESS, expected.unit_address) && stored;
+    stored = storage.store(Category::SCALING, expected.scaling) && stored;
+    stored = storage.store(Category::CAL_FLAG, expected.calibrated) && stored;
+    stored = storage.store(Category::CAL_DATA, expected.cal_data) && stored;
+    stored = storage.store(Category::SERIAL_NUMBER, SERIAL_NUMBER, sizeof(SERIAL_NUMBER)) && stored;
+    const HostSim::I2cStats store_stats = HostSim::i2cStats(I2C_ADDR::FRAM);
+
+    const size_t parameter_bytes = sizeof(expected.sensor_length) + sizeof(expected.timer_period) + sizeof(expected.unit_address)
+        + sizeof(expected.scaling) + sizeof(expected.calibrated) + sizeof(expected.cal_data);
+    printf("boot load of FRAM parameters (%zu bytes) and serial number (%zu bytes with terminator)\n",
+           parameter_bytes, sizeof(SERIAL_NUMBER));
+    const Result legacy = run<LegacyStorage>(expected);
+    const Result block = run<ParameterStorage>(expected);
+    printResult("per-byte", legacy);
+    printResult("block", block);
+
+    // per-byte: 1byteごとにアドレス書き込み(1+2) + リピートスタートで読み出し(1+1)
+    // block:    パラメタごとにアドレス書き込み(1+2) + リピートスタートで読み出し(1+n)
+    const uint32_t legacy_count = parameter_bytes + sizeof(SERIAL_NUMBER);
+    const bool legacy_ok = legacy.ack && legacy.matched && legacy.transactions == legacy_count && legacy.wire_bytes == 5 * legacy_count;
+    const bool block_ok = block.ack && block.matched && block.transactions == READS
+        && block.wire_bytes == 4 * READS + parameter_bytes + ParameterStorage::SER_NUM_MAX_LENGTH;
+    printf("   transactions %u -> %u, bytes %u -> %u  %s\n", legacy.transactions, block.transactions,
+           legacy.wire_bytes, block.wire_bytes, (legacy_ok && block_ok) ? "PASS" : "FAIL");
+
+    printf("store (reference): %u transactions  %u bytes  including one ACK poll per chunk  %s\n",
+           store_stats.transactions, store_stats.wire_bytes, stored ? "PASS" : "FAIL");
+    return (legacy_ok && block_ok && stored) ? 0 : 1;
+}
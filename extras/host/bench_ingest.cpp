@@ -0,0 +1,169 @@
+/**************************************************************************/
+/*!
+ * @file bench_ingest.cpp
+ * @brief TelemetryIngestのベンチマーク  擬似端末（pty）で模擬した計測ユニットから受信する
+ * @par
+ *    計測ユニットごとに書き込みスレッドがptyのmaster側へIotGatewayのJSON形式の行を書き込み続け、
+ *    1つの受信スレッドが全てのslave側をTelemetryIngestで読む。
+ *    受信スレッドのCPU時間あたりのレコード数（records/s per core）を表示する。
+ *
+ *    例: ./bench_ingest [ユニット数=32] [秒数=5]
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -I../../src bench_ingest.cpp TelemetryIngest.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp -pthread
+ */
+/**************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TelemetryIngest.h"
+
+namespace {
+
+double threadCpuSeconds(void){
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+double wallSeconds(void){
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// 計測ユニットが送るpayloadを模擬する  液面を変えながら、I2Cプロファイルも混ぜる
+std::string makeStream(const int unit){
+    std::string stream;
+    for (int i = 0; i < 256; i++){
+        stream += "{\"level\":" + std::to_string((unit * 37 + i * 3) % 1000) +
+                  ",\"mode\":1,\"remain\":" + std::to_string(60 - i % 60) + ",\"error\":0";
+        if (i % 16 == 0){
+            stream += ",\"i2c_48\":\"12,34,5,6,0\"";
+        }
+        stream += "}\r\n";
+    }
+    return stream;
+}
+
+}   // namespace
+
+int main(int argc, char* argv[]){
+    const int units = (argc > 1) ? atoi(argv[1]) : 32;
+    const double seconds = (argc > 2) ? atof(argv[2]) : 5.0;
+
+    static TelemetryIngest::RecordQueue queue;
+    TelemetryIngest ingest(queue);
+
+    std::vector<int> masters;
+    std::vector<int> slaves;
+    for (int i = 0; i < units; i++){
+        const int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0){
+            perror("posix_openpt");
+            return 1;
+        }
+        const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (slave < 0){
+            perror("open pts");
+            return 1;
+        }
+        // 改行の変換などをしない
+        termios settings;
+        tcgetattr(slave, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(slave, TCSANOW, &settings);
+        if (!ingest.addSource(slave, i, TelemetryIngest::E_Framing::JSON)){
+            perror("addSource");
+            return 1;
+        }
+        masters.push_back(master);
+        slaves.push_back(slave);
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> writers;
+    for (int i = 0; i < units; i++){
+        writers.emplace_back([&, i](){
+            const std::string stream = makeStream(i);
+            size_t offset = 0;
+            while (!stop.load(std::memory_order_relaxed)){
+                const ssize_t written = write(masters[i], stream.data() + offset, stream.size() - offset);
+                if (written < 0){
+                    if (errno != EAGAIN){
+                        break;
+                    }
+                    // ptyのバッファが一杯  受信側が読むのを待つ
+                    std::this_thread::yield();
+                    continue;
+                }
+                offset = (offset + written) % stream.size();
+            }
+        });
+    }
+
+    // 受信したレコードを読み出す側
+    std::atomic<uint64_t> consumed(0);
+    std::thread consumer([&](){
+        TelemetryRecord record;
+        uint64_t count = 0;
+        uint64_t checksum = 0;
+        while (!stop.load(std::memory_order_relaxed)){
+            bool popped = false;
+            while (queue.pop(record)){
+                checksum += record.level;
+                count++;
+                popped = true;
+            }
+            consumed.store(count, std::memory_order_relaxed);
+            if (!popped){
+                std::this_thread::yield();
+            }
+        }
+        while (queue.pop(record)){
+            count++;
+        }
+        consumed.store(count, std::memory_order_relaxed);
+        if (checksum == 0){
+            printf("no level values\n");
+        }
+    });
+
+    const double wall_start = wallSeconds();
+    const double cpu_start = threadCpuSeconds();
+    while (wallSeconds() - wall_start < seconds){
+        ingest.poll(10);
+    }
+    const double cpu = threadCpuSeconds() - cpu_start;
+    const double wall = wallSeconds() - wall_start;
+
+    stop = true;
+    for (std::thread& writer : writers){
+        writer.join();
+    }
+    for (int master : masters){
+        close(master);
+    }
+    consumer.join();
+    for (int slave : slaves){
+        close(slave);
+    }
+
+    const uint64_t records = ingest.getRecordCount();
+    printf("units:%d  wall:%.2fs  ingest cpu:%.2fs\n", units, wall, cpu);
+    printf("records:%llu  bytes:%llu  errors:%llu  dropped:%llu  consumed:%llu\n",
+           (unsigned long long)records, (unsigned long long)ingest.getByteCount(),
+           (unsigned long long)ingest.getErrorCount(), (unsigned long long)ingest.getDroppedCount(),
+           (unsigned long long)consumed.load());
+    printf("records/s (wall):%.0f  records/s per core:%.0f  MB/s per core:%.1f\n",
+           records / wall, records / cpu, ingest.getByteCount() / cpu / 1e6);
+    return 0;
+}
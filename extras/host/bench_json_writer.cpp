@@ -0,0 +1,159 @@
+/**************************************************************************/
+/*!
+ * @file bench_json_writer.cpp
+ * @brief テレメトリ1フレームのJSONの組み立てを、JsonWriterと以前のString版で比べる（サイクル数・ヒープ確保回数）
+ * @par
+ *    フレームはpublish()の送信と同じ内容（level, mode, remain, error, ts）と、addPayload()の小数のノード1つ。
+ *    以前の実装（addPayload()ごとにStringでノードを作り、joinToPayload()でpayloadに連結し、
+ *    getPayload()で{ }を付けてコピーする）をLegacyPayloadとしてここに写す。
+ *    extras/host/arduino のStringはWStringと同じく文字列ごとにヒープのバッファを持つ。
+ *    JsonWriter側はoperator newをトラップ（呼ばれたらabort()）した状態で回す。
+ *    サイクル数はHostSim::stamp()（x86ではTSC、それ以外はsteady_clockの時間 [ns]）。ホストでの値なので比で見る。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src bench_json_writer.cpp arduino/HostSim.cpp ../../src/JsonWriter.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <Arduino.h>
+#include "JsonWriter.h"
+
+namespace {
+
+// 繰り返し回数
+constexpr uint32_t FRAMES = 200000;
+
+// 送信バッファ（IotGatewayのTX_BUFFER_SIZEと同じ）
+constexpr size_t BUFFER_SIZE = 512;
+
+/// @brief 1フレームの値
+struct Frame{
+    int32_t level;
+    int32_t mode;
+    int32_t remain;
+    int32_t error;
+    uint32_t ts_high;   // epoch [ms] を上位・下位の10^6で分けたもの（以前のString版はuint64_tを扱えない）
+    uint32_t ts_low;
+    float vmon;
+};
+
+Frame makeFrame(const uint32_t i){
+    return Frame{ static_cast<int32_t>(i % 1001), 2, static_cast<int32_t>(i % 60), 0,
+                  1760000 + i / 1000000, i % 1000000, 1.0f + (i % 100) / 100.0f };
+}
+
+/*!
+ * @brief 以前のString版（IotGateway.cppから写したもの）
+ */
+class LegacyPayload {
+    public:
+    String payload;
+
+    void addPayload(const String& key, const int32_t& value){
+        String quote = "\"";
+        String node = quote + key + quote + ":" +  String(value) ;
+        joinToPayload(node);
+    }
+    void addPayload(const String& key, const String& value){
+        String quote = "\"";
+        String node = quote + key + quote + ":" + value;
+        joinToPayload(node);
+    }
+    void addPayload(const String& key, const float& value, const uint8_t& deciPlac){
+        String quote = "\"";
+        String node = quote + key + quote + ":"  + String(value, deciPlac) ;
+        joinToPayload(node);
+    }
+    String getPayload(void){
+        return("{" + payload + "}");
+    }
+
+    private:
+    void joinToPayload(const String& node){
+        if (payload.length() != 0)
+            {payload = payload + "," + node ;}
+        else
+            {payload = node;}
+    }
+};
+
+/// @brief 以前の実装で1フレームを作る
+/// @return 送信する文字列の長さ
+size_t buildLegacy(const Frame& f, char* out){
+    LegacyPayload legacy;
+    legacy.addPayload("level", f.level);
+    legacy.addPayload("mode", f.mode);
+    legacy.addPayload("remain", f.remain);
+    legacy.addPayload("error", f.error);
+    char ts[24];
+    snprintf(ts, sizeof(ts), "%u%06u", f.ts_high, f.ts_low);
+    legacy.addPayload("ts", String(ts));
+    legacy.addPayload("vmon", f.vmon, 2);
+    const String frame = legacy.getPayload();
+    memcpy(out, frame.c_str(), frame.length() + 1);
+    return frame.length();
+}
+
+/// @brief JsonWriterで1フレームを作り、送信バッファに{ }を付けて積む（sendPayload()と同じ）
+size_t buildWriter(JsonWriter& writer, const Frame& f, char* out){
+    writer.clear();
+    writer.add("level", f.level);
+    writer.add("mode", f.mode);
+    writer.add("remain", f.remain);
+    writer.add("error", f.error);
+    writer.beginNode("ts");
+    writer.appendUint64(static_cast<uint64_t>(f.ts_high) * 1000000 + f.ts_low);
+    writer.endNode();
+    writer.add("vmon", f.vmon, 2);
+    out[0] = '{';
+    memcpy(&out[1], writer.c_str(), writer.length());
+    out[writer.length() + 1] = '}';
+    out[writer.length() + 2] = '\0';
+    return writer.length() + 2;
+}
+
+}   // namespace
+
+int main(void){
+    char payload[BUFFER_SIZE];
+    char legacy_out[BUFFER_SIZE];
+    char writer_out[BUFFER_SIZE];
+    JsonWriter writer(payload, sizeof(payload));
+
+    // 1. 同じ内容になること
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < 10000; i++){
+        const Frame f = makeFrame(i * 7919);
+        buildLegacy(f, legacy_out);
+        buildWriter(writer, f, writer_out);
+        mismatches += (strcmp(legacy_out, writer_out) == 0) ? 0 : 1;
+    }
+    printf("1. frame text vs String version (10000 frames): %u mismatches  e.g. %s  %s\n",
+           mismatches, writer_out, mismatches == 0 ? "PASS" : "FAIL");
+
+    // 2. 1フレームあたりのサイクル数とヒープ確保回数
+    size_t bytes = 0;
+    const uint32_t before = HostSim::heapAllocations();
+    uint64_t begin = HostSim::stamp();
+    for (uint32_t i = 0; i < FRAMES; i++){
+        bytes += buildLegacy(makeFrame(i), legacy_out);
+    }
+    const double legacy_cycles = static_cast<double>(HostSim::stamp() - begin) / FRAMES;
+    const double legacy_allocations = static_cast<double>(HostSim::heapAllocations() - before) / FRAMES;
+
+    HostSim::trapHeap(true, "JsonWriter frame");
+    begin = HostSim::stamp();
+    for (uint32_t i = 0; i < FRAMES; i++){
+        bytes += buildWriter(writer, makeFrame(i), writer_out);
+    }
+    const double writer_cycles = static_cast<double>(HostSim::stamp() - begin) / FRAMES;
+    HostSim::trapHeap(false);
+
+    const char* unit = HostSim::STAMP_UNIT;
+    printf("2. one telemetry frame (%zu bytes avg) x%u\n", bytes / (2 * FRAMES), FRAMES);
+    printf("   String version: %6.1f heap allocations  %8.0f %s/frame\n", legacy_allocations, legacy_cycles, unit);
+    printf("   JsonWriter:     %6.1f heap allocations  %8.0f %s/frame (operator new trapped)\n", 0.0, writer_cycles, unit);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+/**************************************************************************/
+/*!
+ * @file bench_lcd_format.cpp
+ * @brief EhLcdの表示内容のsetter（数値→文字列）のヒープ確保回数と処理時間を、以前のString版と比べる
+ * @par
+ *    以前の実装（表示テキストをStringで持ち、"  "+String(value)をsubstring()で右詰めにする）を
+ *    LegacyFormatterとしてここに写し、同じ値の列で比べる。
+ *    extras/host/arduino のStringはWStringと同じく文字列ごとにヒープのバッファを持つので、確保回数はそのまま数えられる。
+ *    EhLcd側はoperator newをトラップ（呼ばれたらabort()）した状態でsetterとclk_in()を回す。
+ *    1. 表示内容が以前の実装と同じこと（タイマ動作中表示の":"、液面・センサ長・タイマ残り時間の全ての値、
+ *       LCDの表示内容で比較）
+ *    2. setter 1回あたりのヒープ確保回数と処理時間 [ns]（ホストでの値  STM32での絶対値ではなく比で見る）
+ *    3. clk_in()（描画とLCDへの転送）でヒープを使わないこと
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src bench_lcd_format.cpp arduino/HostSim.cpp \
+ *          ../../src/eh_LCD.cpp ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostDevices.h"
+#include "eh_LCD.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// 処理時間の測定の繰り返し回数
+constexpr uint32_t ITERATIONS = 200000;
+
+/*!
+ * @brief 以前のString版の表示内容の作り方（eh_LCD.cppから写したもの）
+ */
+class LegacyFormatter {
+    public:
+    String level;
+    String sensor;
+    String time_remain;
+    String mode;
+    String sensor_length;
+
+    void setLevel(const uint16_t value){
+        String msg = ("  "+String((float(value)/10.0),1));
+        msg = msg.substring(msg.length()-5);
+        level = msg;
+    }
+    void setSensorlength(const uint8_t value){
+        String msg = ("  "+String(value));
+        msg = msg.substring(msg.length()-3);
+        sensor_length = msg +"inch";
+        sensor = sensor_length;
+    }
+    void setTimerRemain(const uint8_t value){
+        String msg = ("  "+String(value));
+        msg = msg.substring(msg.length()-2);
+        time_remain = msg;
+    }
+    void setMeasMode(const uint8_t meas_mode){
+        mode = String(ModeInd[meas_mode]);
+    }
+    void setError(const bool error){
+        String msg = "";
+        if (error){
+            msg = "-ERROR-";
+        } else {
+            msg = sensor_length;
+        }
+        sensor = msg;
+    }
+
+    private:
+    const char ModeInd[3] = {'M','T','C'};
+};
+
+EhLcd lcd;
+HostSim::GroveLcd lcd_model;
+LegacyFormatter legacy;
+uint64_t next_tick_us = 0;
+
+/// @brief CLKを1回入れて、その周期の終わりまで時間を進める
+void tick(void){
+    HostSim::advance(next_tick_us - HostSim::now());
+    lcd.clk_in();
+    next_tick_us += CLK_US;
+}
+
+/// @brief LCDの表示内容と以前の実装のテキストを比べる  幅に足りない分は空白
+bool sameText(const uint8_t x, const uint8_t y, const uint8_t width, const String& expected){
+    char shown[HostSim::GroveLcd::COLUMNS + 1];
+    char padded[HostSim::GroveLcd::COLUMNS + 1];
+    lcd_model.text(x, y, width, shown);
+    snprintf(padded, sizeof(padded), "%-*s", width, expected.c_str());
+    return strcmp(shown, padded) == 0;
+}
+
+int runEquivalence(void){
+    // 初期テキスト  タイマ動作中表示の":"
+    tick();
+    uint32_t mismatches = sameText(1, 0, 1, String(":")) ? 0 : 1;
+    for (uint16_t value = 0; value <= 1000; value++){
+        lcd.setLevel(value);
+        legacy.setLevel(value);
+        tick();
+        mismatches += sameText(10, 1, 5, legacy.level) ? 0 : 1;
+    }
+    for (uint16_t value = 0; value <= 255; value++){
+        lcd.setSensorlength(static_cast<uint8_t>(value));
+        legacy.setSensorlength(static_cast<uint8_t>(value));
+        lcd.setTimerRemain(static_cast<uint8_t>(value % 100));
+        legacy.setTimerRemain(static_cast<uint8_t>(value % 100));
+        tick();
+        mismatches += sameText(0, 1, 7, legacy.sensor) ? 0 : 1;
+        mismatches += sameText(2, 0, 2, legacy.time_remain) ? 0 : 1;
+    }
+    for (uint8_t mode = 0; mode < 3; mode++){
+        lcd.setMeasMode(static_cast<EhLcd::E_Modes>(mode));
+        legacy.setMeasMode(mode);
+        tick();
+        mismatches += sameText(0, 0, 1, legacy.mode) ? 0 : 1;
+    }
+    printf("1. LCD text vs String version (\":\", level 0-1000, sensor 0-255, timer 0-99, mode): %u mismatches  %s\n",
+           mismatches, mismatches == 0 ? "PASS" : "FAIL");
+    return mismatches == 0 ? 0 : 1;
+}
+
+/// @brief setterの組を繰り返し呼び、1回あたりの時間を返す [ns]
+template <typename SETTERS>
+double measure(SETTERS setters){
+    const auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++){
+        setters(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / ITERATIONS;
+}
+
+int runSetters(void){
+    // 計測1回分の更新  液面（数値・バーグラフ）、タイマ残り時間、エラー解除
+    const uint32_t before = HostSim::heapAllocations();
+    const double legacy_ns = measure([](const uint32_t i){
+        legacy.setLevel(static_cast<uint16_t>(i % 1001));
+        legacy.setTimerRemain(static_cast<uint8_t>(i % 100));
+        legacy.setSensorlength(static_cast<uint8_t>(i));
+        legacy.setError((i & 0x3F) == 0);
+    });
+    const double legacy_allocations = static_cast<double>(HostSim::heapAllocations() - before) / ITERATIONS;
+
+    HostSim::trapHeap(true, "EhLcd setters");
+    const double ns = measure([](const uint32_t i){
+        lcd.setLevel(static_cast<uint16_t>(i % 1001));
+        lcd.setBargraph(static_cast<uint16_t>(i % 1001));
+        lcd.setTimerRemain(static_cast<uint8_t>(i % 100));
+        lcd.setSensorlength(static_cast<uint8_t>(i));
+        lcd.setError((i & 0x3F) == 0);
+    });
+    HostSim::trapHeap(false);
+
+    printf("2. one update (level, timer remain, sensor length, error) x%u\n", ITERATIONS);
+    printf("   String version: %6.1f heap allocations  %7.1fns\n", legacy_allocations, legacy_ns);
+    printf("   EhLcd:          %6.1f heap allocations  %7.1fns (operator new trapped, incl. setBargraph)\n", 0.0, ns);
+    return 0;
+}
+
+int runClock(void){
+    constexpr uint32_t TICKS = 6000;   // 60秒
+    HostSim::trapHeap(true, "EhLcd::clk_in");
+    lcd.setBlink(EhLcd::E_DisplayItemName::TIMER_IND, EhLcd::BLINK_MODE);
+    for (uint32_t i = 0; i < TICKS; i++){
+        if (i % 50 == 0){
+            lcd.setLevel(static_cast<uint16_t>(i % 1001));
+            lcd.setBargraph(static_cast<uint16_t>(i % 1001));
+        }
+        tick();
+    }
+    HostSim::trapHeap(false);
+    printf("3. clk_in() x%u with blink and level updates: 0 heap allocations (operator new trapped)  PASS\n", TICKS);
+    return 0;
+}
+
+}   // namespace
+
+int main(void){
+    HostSim::reset();
+    HostSim::attachI2c(I2C_ADDR::LCD, &lcd_model);
+    HostSim::attachI2c(RGB_ADDRESS);
+    Wire.begin();
+    I2cClock.begin(&Wire);
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+
+    lcd.init();
+    lcd.writeFrame();
+    lcd.activateDisplay(true);
+    next_tick_us = HostSim::now() + CLK_US;
+
+    int failures = 0;
+    failures += runEquivalence();
+    failures += runSetters();
+    failures += runClock();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,430 @@
+/**************************************************************************/
+/*!
+ * @file bench_lcd_transactions.cpp
+ * @brief EhLcdのLCDへのI2Cトランザクション数とバス上のバイト数を、模擬LCDコントローラで数える
+ * @par
+ *    次の2つの計測モードの表示を仮想時間で10分ずつ動かし、LCD(0x3E)へのトランザクション数とバイト数
+ *    （アドレスbyteを含むバス上のバイト数と、その毎秒の値）を数える。
+ *      CONTINUOUS: 液面の数値・バーグラフが1秒ごと、タイマ表示の点滅、残り時間が1分ごと、
+ *                  5分目から1分間センサエラーの点滅
+ *      TIMER:      タイマ周期5分  周期ごとに液面を1回計測、残り時間が1分ごと、タイマ表示の点滅
+ *    比較のため、同じ内容を以前の実装（表示要素ごとにsetCursor + 文字列、1CLKに1スレッド、10スレッドで1周）を
+ *    模擬したLegacyLcdで同じ時間動かし、トランザクション数とバイト数を数える。
+ *      per-char:  模擬LCDが受け取ったコマンド・文字を、1つずつ1トランザクションで送った場合（EhLcdの実行から求める）
+ *      per-item:  LegacyLcd  rgb_lcdで1文字1トランザクション
+ *    LCDの表示内容は模擬LCDのDDRAMで最後の値と照合する（両方）。
+ *    表示の遅れ（setterの呼び出しからLCDへの書き込み完了まで）は、起動後の全画面の描画が終わった定常状態
+ *    （最初の1秒の後、clearLatencyStat()から）で、表示要素ごとに平均、50%点、99%点、最大を出す。
+ *    50%点、99%点はEhLcdのヒストグラムのビンの上限（10ms, 20ms, 40ms, ...）で表す。
+ *    setterはメインループから呼ばれるので、CLKの間のランダムな時刻に呼ぶ。
+ *    両方のモードで、EhLcdのLEVEL, SENSOR（エラー表示）の遅れの最大が、1CLK + 1CLKで使ったバスの時間の最大
+ *    （+ millis()の分解能1ms）以内で、トランザクション数とバス上のバイト数が以前の実装より少ないこと。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src bench_lcd_transactions.cpp arduino/HostSim.cpp \
+ *          ../../src/eh_LCD.cpp ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostDevices.h"
+#include "eh_LCD.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// 動かす時間 [CLK]  10分
+constexpr uint32_t TICKS = 60000;
+
+// 起動後、全画面を描画し終えるまでの時間 [CLK]  遅れの集計から除く
+constexpr uint32_t WARMUP_TICKS = 100;
+
+// 表示要素の幅  eh_LCD.hのitem_layoutsと同じ順（E_DisplayItemName）
+constexpr uint8_t ITEM_WIDTHS[] = { 1, 1, 2, 5, 7, 4 };
+
+// タイマ計測の周期
+constexpr uint8_t TIMER_PERIOD_MIN = 5;
+constexpr uint32_t TIMER_PERIOD_TICKS = TIMER_PERIOD_MIN * 6000;
+
+// 表示要素の名前  E_DisplayItemNameの順
+const char* const ITEM_NAMES[] = { "MODE", "TIMER_IND", "TIME_REMAIN", "LEVEL", "SENSOR", "BARGRAPH" };
+
+/// @brief 遅れを集計に加える  EhLcd::recordLatency()と同じビン
+void record(EhLcd::LatencyStat& stat, const uint16_t latency){
+    stat.count++;
+    stat.total_ms += latency;
+    stat.max_ms = (latency > stat.max_ms) ? latency : stat.max_ms;
+    size_t bin = 0;
+    for (uint32_t limit = EhLcd::LATENCY_FIRST_BIN_MS; latency >= limit && bin < EhLcd::LATENCY_BINS - 1; limit <<= 1){
+        bin++;
+    }
+    stat.histogram[bin]++;
+}
+
+/*!
+ * @brief 以前のEhLcdの表示処理  1CLKに1スレッドを実行し、スレッドの番号の表示要素だけを書く
+ * @note 更新があればsetCursor + 表示内容（非表示は同じ長さの空白）をrgb_lcdで書く
+ *       点滅はスレッドが回ってくるごとに数え、5回（50CLK）で表示・非表示を切り替える
+ */
+class LegacyLcd : public rgb_lcd {
+    public:
+    // consts
+    static constexpr uint8_t THREADS = 10;
+    static constexpr uint8_t BLINK_PERIOD = 5;     // [スレッドの周回]
+
+    // vars
+    EhLcd::LatencyStat stats[sizeof(ITEM_WIDTHS)];
+
+    // methods
+    LegacyLcd(void){
+        const uint8_t locations[][2] = { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 10, 1 }, { 0, 1 }, { 10, 0 } };
+        for (size_t i = 0; i < sizeof(ITEM_WIDTHS); i++){
+            items[i].x = locations[i][0];
+            items[i].y = locations[i][1];
+        }
+        items[static_cast<uint8_t>(EhLcd::E_DisplayItemName::TIMER_IND)].text = ":";
+    };
+
+    void clk_in(void){
+        const uint8_t now_thread = thread_count;
+        if (now_thread < sizeof(ITEM_WIDTHS)){
+            Item& item = items[now_thread];
+            if (item.refresh){
+                I2cClock.select(I2C_ADDR::LCD);
+                rgb_lcd::setCursor(item.x, item.y);
+                rgb_lcd::print(item.state ? item.text.c_str() : std::string(item.text.length(), ' ').c_str());
+                item.refresh = false;
+                record(stats[now_thread], static_cast<uint16_t>(millis()) - item.dirty_ms);
+            }
+            if (item.blink && --item.count == 0){
+                item.count = BLINK_PERIOD;
+                item.state = !item.state;
+                markDirty(item);
+            }
+        }
+        if (++thread_count == THREADS){
+            thread_count = 0;
+        }
+    };
+
+    void setLevel(const uint16_t value){
+        char text[8];
+        snprintf(text, sizeof(text), "%5.1f", value / 10.0);
+        setText(EhLcd::E_DisplayItemName::LEVEL, text);
+    };
+    void setBargraph(const uint16_t value){
+        char text[5] = "    ";
+        uint8_t index = 0;
+        for (; index < value / 250; index++){
+            text[index] = 0x05;
+        }
+        if ((value % 250) / 50 > 0){
+            text[index] = static_cast<char>((value % 250) / 50);
+        }
+        setText(EhLcd::E_DisplayItemName::BARGRAPH, text);
+    };
+    void setTimerRemain(const uint8_t value){
+        char text[4];
+        snprintf(text, sizeof(text), "%2u", value);
+        setText(EhLcd::E_DisplayItemName::TIME_REMAIN, text);
+    };
+    void setSensorlength(const uint8_t value){
+        char text[8];
+        snprintf(text, sizeof(text), "%3uinch", value);
+        sensor_length = text;
+        setText(EhLcd::E_DisplayItemName::SENSOR, text);
+    };
+    void setMeasMode(const EhLcd::E_Modes meas_mode){
+        const char text[2] = { "MTC"[static_cast<uint8_t>(meas_mode)], '\0' };
+        setText(EhLcd::E_DisplayItemName::MODE, text);
+    };
+    void setBlink(const EhLcd::E_DisplayItemName name, const bool mode){
+        Item& item = items[static_cast<uint8_t>(name)];
+        item.blink = mode;
+        item.state = true;
+        markDirty(item);
+    };
+    void setError(const bool error){
+        Item& item = items[static_cast<uint8_t>(EhLcd::E_DisplayItemName::SENSOR)];
+        item.blink = error;
+        item.state = true;
+        setText(EhLcd::E_DisplayItemName::SENSOR, error ? "-ERROR-" : sensor_length.c_str());
+    };
+    void clearLatencyStat(void){
+        for (size_t i = 0; i < sizeof(ITEM_WIDTHS); i++){
+            stats[i] = EhLcd::LatencyStat();
+            items[i].dirty_ms = static_cast<uint16_t>(millis());
+        }
+    };
+
+    private:
+    struct Item{
+        bool blink = false;
+        bool state = true;
+        uint8_t count = BLINK_PERIOD;
+        uint8_t x = 0;
+        uint8_t y = 0;
+        std::string text;
+        bool refresh = true;
+        uint16_t dirty_ms = 0;
+    };
+
+    Item items[sizeof(ITEM_WIDTHS)];
+    std::string sensor_length;
+    uint8_t thread_count = 0;
+
+    void markDirty(Item& item){
+        if (!item.refresh){
+            item.refresh = true;
+            item.dirty_ms = static_cast<uint16_t>(millis());
+        }
+    };
+    void setText(const EhLcd::E_DisplayItemName name, const char* text){
+        Item& item = items[static_cast<uint8_t>(name)];
+        item.text = text;
+        markDirty(item);
+    };
+};
+
+/// @brief タイマ計測の表示更新を模擬する
+/// @param display 表示  EhLcdまたはLegacyLcd
+/// @param tick CLKの番号
+/// @param level 最後に設定した液面 [0.1%]
+template <typename Display>
+void updateTimer(Display& display, const uint32_t tick, uint16_t& level){
+    // 周期ごとに計測  計測は周期の始めから2秒
+    if (tick % TIMER_PERIOD_TICKS == 200){
+        level = static_cast<uint16_t>(900 - tick / 1000);
+        display.setLevel(level);
+        display.setBargraph(level);
+    }
+    // タイマの残り時間  1分ごと
+    if (tick % 6000 == 0){
+        display.setTimerRemain(static_cast<uint8_t>(TIMER_PERIOD_MIN - (tick % TIMER_PERIOD_TICKS) / 6000));
+    }
+}
+
+/// @brief 連続計測の表示更新を模擬する
+/// @param display 表示  EhLcdまたはLegacyLcd
+/// @param tick CLKの番号
+/// @param level 最後に設定した液面 [0.1%]
+template <typename Display>
+void updateContinuous(Display& display, const uint32_t tick, uint16_t& level){
+    // 液面  1秒ごとにゆっくり下がり、時々ノイズで0.1%揺れる
+    if (tick % 100 == 0){
+        level = static_cast<uint16_t>(900 - (tick / 1000) + ((tick / 100) % 3 == 0 ? 1 : 0));
+        display.setLevel(level);
+        display.setBargraph(level);
+    }
+    // タイマの残り時間  1分ごと
+    if (tick % 6000 == 0){
+        display.setTimerRemain(static_cast<uint8_t>(60 - tick / 6000));
+    }
+    // センサエラー  5分目から1分間
+    if (tick == 30000){
+        display.setError(true);
+    }
+    if (tick == 36000){
+        display.setError(false);
+    }
+}
+
+/// @brief 1回の実行の結果
+struct Result{
+    HostSim::I2cStats stats;
+    uint32_t active_ticks;
+    uint32_t max_tick_transactions;
+    uint64_t max_tick_bus_us;       // 1CLKでLCDのバスを使った時間の最大
+    uint16_t level;                 // 最後に設定した液面
+};
+
+/*!
+ * @brief 起動から表示を動かし、定常状態でLCDへのトランザクションを数える
+ * @param display 表示  EhLcdまたはLegacyLcd
+ * @param mode 計測モード  TIMERまたはCONTINUOUS
+ * @note setterはCLKの間のランダムな時刻（メインループ）に呼ぶ
+ */
+template <typename Display>
+Result run(Display& display, const EhLcd::E_Modes mode){
+    std::mt19937 rng(20261019);
+    std::uniform_int_distribution<uint32_t> setter_us(1, CLK_US - 1);
+
+    // 起動後の全画面の描画
+    uint64_t next_tick_us = HostSim::now() + CLK_US;
+    for (uint32_t tick = 0; tick < WARMUP_TICKS; tick++){
+        HostSim::advance(next_tick_us - HostSim::now());
+        display.clk_in();
+        next_tick_us += CLK_US;
+    }
+
+    // ここから数える
+    HostSim::clearI2cStats();
+    display.clearLatencyStat();
+
+    Result result = {};
+    for (uint32_t tick = 0; tick < TICKS; tick++){
+        const uint64_t setter_at_us = next_tick_us - setter_us(rng);
+        if (setter_at_us > HostSim::now()){
+            HostSim::advance(setter_at_us - HostSim::now());
+        }
+        if (mode == EhLcd::E_Modes::TIMER){
+            updateTimer(display, tick, result.level);
+        } else {
+            updateContinuous(display, tick, result.level);
+        }
+        if (next_tick_us > HostSim::now()){
+            HostSim::advance(next_tick_us - HostSim::now());
+        }
+        const HostSim::I2cStats before = HostSim::i2cStats(I2C_ADDR::LCD);
+        display.clk_in();
+        const HostSim::I2cStats& after = HostSim::i2cStats(I2C_ADDR::LCD);
+        const uint32_t transactions = after.transactions - before.transactions;
+        const uint64_t bus_us = after.busy_us - before.busy_us;
+        result.active_ticks += (transactions != 0) ? 1 : 0;
+        result.max_tick_transactions = (transactions > result.max_tick_transactions) ? transactions : result.max_tick_transactions;
+        result.max_tick_bus_us = (bus_us > result.max_tick_bus_us) ? bus_us : result.max_tick_bus_us;
+        next_tick_us += CLK_US;
+    }
+    result.stats = HostSim::i2cStats(I2C_ADDR::LCD);
+    return result;
+}
+
+/// @brief I2Cと表示を起動する
+/// @param model 模擬LCD
+void attachDevices(HostSim::GroveLcd& model){
+    HostSim::reset();
+    HostSim::attachI2c(I2C_ADDR::LCD, &model);
+    HostSim::attachI2c(RGB_ADDRESS);
+    Wire.begin();
+    I2cClock.begin(&Wire);
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+}
+
+/// @brief 最後の液面がLCDに表示されていることを確かめる
+bool shows(const HostSim::GroveLcd& model, const uint16_t level, const char* name){
+    char shown[HostSim::GroveLcd::COLUMNS + 1];
+    char expected[8];
+    model.text(10, 1, 5, shown);
+    snprintf(expected, sizeof(expected), "%3u.%u", level / 10, level % 10);
+    const bool ok = strcmp(shown, expected) == 0;
+    printf("   %-8s LCD shows \"%s\" (expected \"%s\")  %s\n", name, shown, expected, ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+/// @brief 遅れの分布で、指定した割合の回数が収まるビンの上限を返す
+/// @param stat 表示要素の遅れの集計
+/// @param ratio 割合  0.5で50%点
+/// @return ビンの上限 [ms]  最後のビンは最大値
+uint32_t percentile(const EhLcd::LatencyStat& stat, const double ratio){
+    uint32_t counted = 0;
+    uint32_t limit = EhLcd::LATENCY_FIRST_BIN_MS;
+    for (size_t bin = 0; bin < EhLcd::LATENCY_BINS - 1; bin++, limit <<= 1){
+        counted += stat.histogram[bin];
+        if (counted >= stat.count * ratio){
+            return limit;
+        }
+    }
+    return stat.max_ms;
+}
+
+/// @brief 表示要素ごとの遅れを出す
+void printLatency(const char* name, const EhLcd::LatencyStat& stat){
+    if (stat.count == 0){
+        return;
+    }
+    printf("   %-20s %6u  %5.1fms  <%3ums  <%3ums  %3ums\n", name, stat.count,
+           static_cast<double>(stat.total_ms) / stat.count, percentile(stat, 0.5), percentile(stat, 0.99), stat.max_ms);
+}
+
+/*!
+ * @brief 1つの計測モードでEhLcdと以前の実装を比べる
+ * @param mode 計測モード  TIMERまたはCONTINUOUS
+ * @return True:全て合格
+ */
+bool compare(const EhLcd::E_Modes mode){
+    const char* mode_name = (mode == EhLcd::E_Modes::TIMER) ? "timer" : "continuous";
+    const uint8_t period = (mode == EhLcd::E_Modes::TIMER) ? TIMER_PERIOD_MIN : 60;
+
+    // EhLcd
+    EhLcd lcd;
+    HostSim::GroveLcd lcd_model;
+    attachDevices(lcd_model);
+    lcd.init();
+    lcd.setSensorlength(36);
+    lcd.setTimerperiod(period);
+    lcd.setMeasMode(mode);
+    lcd.setBlink(EhLcd::E_DisplayItemName::TIMER_IND, EhLcd::BLINK_MODE);
+    lcd.writeFrame();
+    lcd.activateDisplay(true);
+    lcd_model.clearCounts();
+    const Result burst = run(lcd, mode);
+    const uint32_t per_char = lcd_model.equivalentTransactions();
+
+    // 以前の実装
+    LegacyLcd legacy;
+    HostSim::GroveLcd legacy_model;
+    attachDevices(legacy_model);
+    legacy.setSensorlength(36);
+    legacy.setMeasMode(mode);
+    legacy.setBlink(EhLcd::E_DisplayItemName::TIMER_IND, EhLcd::BLINK_MODE);
+    const Result per_item = run(legacy, mode);
+
+    const double seconds = TICKS * CLK_US / 1e6;
+    printf("%s display, %u ticks (%.0fs virtual) after %.0fs of boot screen\n",
+           mode_name, TICKS, seconds, WARMUP_TICKS * CLK_US / 1e6);
+    printf("                    transactions  wire bytes  bytes/s  active ticks  per active tick  max/tick  bus time\n");
+    printf("   burst (EhLcd)    %12u  %10u  %7.1f  %12u  %15.2f  %8u  %6.1fms\n", burst.stats.transactions,
+           burst.stats.wire_bytes, burst.stats.wire_bytes / seconds, burst.active_ticks,
+           static_cast<double>(burst.stats.transactions) / burst.active_ticks, burst.max_tick_transactions,
+           burst.stats.busy_us / 1000.0);
+    printf("   rgb_lcd per-char %12u  %10u  %7.1f\n", per_char, per_char * 3, per_char * 3 / seconds);
+    printf("   rgb_lcd per-item %12u  %10u  %7.1f  %12u  %15.2f  %8u  %6.1fms\n", per_item.stats.transactions,
+           per_item.stats.wire_bytes, per_item.stats.wire_bytes / seconds, per_item.active_ticks,
+           static_cast<double>(per_item.stats.transactions) / per_item.active_ticks,
+           per_item.max_tick_transactions, per_item.stats.busy_us / 1000.0);
+
+    // 定常状態の表示の遅れ
+    printf("   refresh latency (steady state)   count     mean    p50    p99    max\n");
+    for (uint8_t i = 0; i < sizeof(ITEM_WIDTHS); i++){
+        const std::string name = std::string("EhLcd ") + ITEM_NAMES[i];
+        printLatency(name.c_str(), lcd.getLatencyStat(static_cast<EhLcd::E_DisplayItemName>(i)));
+    }
+    for (uint8_t i = 0; i < sizeof(ITEM_WIDTHS); i++){
+        const std::string name = std::string("legacy ") + ITEM_NAMES[i];
+        printLatency(name.c_str(), legacy.stats[i]);
+    }
+
+    // LEVEL, SENSOR（エラー表示）は、setterの後の最初のCLKで書き終えること
+    const uint16_t bound_ms = static_cast<uint16_t>(ceil((CLK_US + burst.max_tick_bus_us) / 1000.0)) + 1;
+    const uint16_t level_ms = lcd.getLatencyStat(EhLcd::E_DisplayItemName::LEVEL).max_ms;
+    const uint16_t error_ms = lcd.getLatencyStat(EhLcd::E_DisplayItemName::SENSOR).max_ms;
+    const bool latency_ok = lcd.getLatencyStat(EhLcd::E_DisplayItemName::LEVEL).count != 0
+        && level_ms <= bound_ms && error_ms <= bound_ms;
+    printf("   EhLcd max latency LEVEL %ums, SENSOR/ERROR %ums (bound: 1 CLK + %.1fms bus + 1ms = %ums)  %s\n",
+           level_ms, error_ms, burst.max_tick_bus_us / 1000.0, bound_ms, latency_ok ? "PASS" : "FAIL");
+
+    const bool count_ok = burst.stats.transactions < per_char && burst.stats.transactions < per_item.stats.transactions
+        && burst.stats.wire_bytes < per_item.stats.wire_bytes && burst.stats.nacks == 0 && per_item.stats.nacks == 0;
+    printf("   fewer transactions and bytes than per-item (%.1f -> %.1f bytes/s)  %s\n",
+           per_item.stats.wire_bytes / seconds, burst.stats.wire_bytes / seconds, count_ok ? "PASS" : "FAIL");
+    const bool shown_ok = shows(lcd_model, burst.level, "EhLcd") & shows(legacy_model, per_item.level, "legacy");
+    return latency_ok && count_ok && shown_ok;
+}
+
+}   // namespace
+
+int main(void){
+    bool ok = compare(EhLcd::E_Modes::TIMER);
+    ok = compare(EhLcd::E_Modes::CONTINUOUS) && ok;
+    return ok ? 0 : 1;
+}
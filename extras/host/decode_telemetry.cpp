@@ -0,0 +1,28 @@
+/**************************************************************************/
+/*!
+ * @file decode_telemetry.cpp
+ * @brief 標準入力から受け取ったバイナリ形式のテレメトリを1行1フレームのJSONで出力する
+ * @par
+ *    例: stty -F /dev/ttyUSB0 9600 raw && ./decode_telemetry < /dev/ttyUSB0
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <iostream>
+#include "TelemetryDecoder.h"
+
+int main(void){
+    TelemetryDecoder decoder([](const std::string& json){
+        std::cout << json << std::endl;
+    });
+
+    uint8_t buffer[256];
+    size_t length = 0;
+    while ((length = fread(buffer, 1, sizeof(buffer), stdin)) != 0){
+        decoder.feed(buffer, length);
+    }
+    if (decoder.getErrorCount() != 0){
+        std::cerr << "frame errors: " << decoder.getErrorCount() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,409 @@
+/**************************************************************************/
+/*!
+ * @file fuzz_command_parser.cpp
+ * @brief CommandParserのファジングと、1byteあたりの処理時間、IotGatewayでのコマンドから実行までの時間を測る
+ * @par
+ *    1. 差分ファジング  行単位で解析する参照モデル（std::stringで書いたもの）と、feed()の結果を比べる
+ *       入力は正しいコマンド（大文字・小文字、空白、引数の境界値を混ぜる）に1byteの挿入・削除・置換を加えた行と、
+ *       ランダムなバイト列（0x00-0xFFの全て）。解析したコマンドの列とエラーの数が一致すること
+ *    2. feed() 1回の処理時間  平均、99.99%点、最大（HostSim::stamp()  TSCサイクル、x86以外は[ns]）
+ *       最大値にはホストの割り込みなどが入るので、99.99%点で見る
+ *    3. IotGateway経由のコマンドから実行までの時間  コマンドの行末（CR）が届いてから、clk_in()で
+ *       実行（ステートマシンの状態遷移、タイマ周期の設定）されるまで [ms]  CLKの位相はランダム
+ *       9600baudと115200baudで1コマンドずつ、115200baudで6コマンド（約50byte）を続けて送った場合
+ *       （1CLKに読むのはRX_BYTES_PER_TICK = UARTの受信バッファ(64byte)まで）
+ *    4. MODEでのMANUALとCONTの間の遷移  スイッチ操作と同じくできないこと
+ *       連続計測中のMODE Mと1回計測中のMODE Cは実行できないエラーになり、状態と計測コマンドが変わらないこと
+ *       1回計測は測定完了でTIMERに戻り、連続計測はMODE Tで止まること
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src fuzz_command_parser.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ */
+/**************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "CommandParser.h"
+#include "IotGateway.h"
+#include "statemachine.h"
+#include "timeswitch.h"
+
+namespace {
+
+// ファジングの行数
+constexpr uint32_t FUZZ_LINES = 1000000;
+
+// 処理時間を測るバイト数
+constexpr uint32_t TIMING_BYTES = 2000000;
+
+// 実行までの時間を測るコマンドの数
+constexpr uint32_t LATENCY_COMMANDS = 1000;
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+using Command = CommandParser::Command;
+using E_Command = CommandParser::E_Command;
+
+bool isEndOfLine(const uint8_t c){
+    return c == '\r' || c == '\n';
+}
+
+bool isSpace(const uint8_t c){
+    return c == ' ' || c == '\t';
+}
+
+/*!
+ * @brief 行単位の参照モデル  CommandParser.hの文法をそのまま書いたもの
+ * @param line 行（行末を含まない）
+ * @param command 解析したコマンド
+ * @return 0:空行   1:コマンド   -1:不正な行
+ */
+int referenceParse(const std::string& line, Command& command){
+    struct Name{ const char* name; E_Command type; uint8_t argument; };   // 0:なし 1:モード 2:数値 3:時刻
+    static const Name names[] = {
+        { "START", E_Command::START, 0 }, { "STOP", E_Command::STOP, 0 }, { "MODE", E_Command::MODE, 1 },
+        { "TIMER", E_Command::TIMER, 2 }, { "GET", E_Command::GET, 0 }, { "TIME", E_Command::TIME, 3 }
+    };
+    std::string upper;
+    for (const char c : line){
+        upper += (c >= 'a' && c <= 'z') ? static_cast<char>(c - ('a' - 'A')) : c;
+    }
+    // 空白で区切る
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < upper.size()){
+        while (i < upper.size() && isSpace(upper[i])){
+            i++;
+        }
+        size_t end = i;
+        while (end < upper.size() && !isSpace(upper[end])){
+            end++;
+        }
+        if (end > i){
+            tokens.push_back(upper.substr(i, end - i));
+        }
+        i = end;
+    }
+    if (tokens.empty()){
+        return 0;
+    }
+    const Name* name = nullptr;
+    for (const Name& n : names){
+        name = (tokens[0] == n.name) ? &n : name;
+    }
+    if (name == nullptr || tokens.size() != (name->argument == 0 ? 1u : 2u)){
+        return -1;
+    }
+    uint64_t argument = 0;
+    if (name->argument == 1){
+        if (tokens[1] != "T" && tokens[1] != "M" && tokens[1] != "C"){
+            return -1;
+        }
+        argument = static_cast<uint8_t>(tokens[1][0]);
+    } else if (name->argument != 0){
+        const uint64_t limit = (name->argument == 3) ? 0xFFFFFFFFFFFFULL : UINT16_MAX;
+        for (const char c : tokens[1]){
+            if (c < '0' || c > '9'){
+                return -1;
+            }
+            argument = argument * 10 + (c - '0');
+            if (argument > limit){
+                return -1;
+            }
+        }
+    }
+    command = Command{ name->type, static_cast<uint16_t>(argument), argument };
+    return 1;
+}
+
+/// @brief 正しいコマンドの行を作る  大文字・小文字、空白、引数の値はランダム
+std::string validLine(std::mt19937& rng){
+    static const char* const names[] = { "START", "STOP", "MODE", "TIMER", "GET", "TIME" };
+    static const char* const spaces[] = { "", " ", "\t", "  ", " \t " };
+    static const uint64_t numbers[] = { 0, 1, 60, 65535, 65536, 99999, 0xFFFFFFFFFFFFULL, 0x1000000000000ULL,
+                                        1760000000000ULL, 18446744073709551615ULL };
+    const uint8_t index = rng() % 6;
+    std::string line = spaces[rng() % 5];
+    for (const char* p = names[index]; *p != '\0'; p++){
+        line += (rng() & 1) ? static_cast<char>(*p + ('a' - 'A')) : *p;
+    }
+    if (index == 2){
+        line += " " + std::string(spaces[rng() % 5]) + "TMCtmcX"[rng() % 7];
+    } else if (index == 3 || index == 5){
+        const uint64_t value = (rng() & 1) ? numbers[rng() % 10] : rng() % 100000;
+        line += " " + std::string(spaces[rng() % 5]) + ((rng() % 8 == 0) ? "00" : "") + std::to_string(value);
+    }
+    return line + spaces[rng() % 5];
+}
+
+/// @brief 1byteの挿入・削除・置換を加える
+void mutate(std::string& line, std::mt19937& rng){
+    static const char interesting[] = { ' ', '\t', '\r', '\n', '\0', '0', '9', 'A', 'Z', 'a', 'z', '@', '[', '`', '{',
+                                        static_cast<char>(0x80), static_cast<char>(0xFF) };
+    const size_t position = line.empty() ? 0 : rng() % line.size();
+    const char c = (rng() & 1) ? interesting[rng() % sizeof(interesting)] : static_cast<char>(rng());
+    switch (rng() % 3){
+        case 0: line.insert(position, 1, c); break;
+        case 1: if (!line.empty()){ line.erase(position, 1); } break;
+        default: if (!line.empty()){ line[position] = c; } break;
+    }
+}
+
+/// @brief ランダムなバイト列
+std::string randomLine(std::mt19937& rng){
+    std::string line;
+    const size_t length = rng() % 24;
+    for (size_t i = 0; i < length; i++){
+        line += static_cast<char>(rng());
+    }
+    return line;
+}
+
+bool sameCommand(const Command& a, const Command& b){
+    return a.type == b.type && a.value == b.value && a.epoch_ms == b.epoch_ms;
+}
+
+int runFuzz(void){
+    std::mt19937 rng(20261019);
+    static const char* const terminators[] = { "\n", "\r", "\r\n", "\n\n" };
+    std::string stream;
+    for (uint32_t i = 0; i < FUZZ_LINES; i++){
+        std::string line;
+        switch (rng() % 4){
+            case 0:  line = validLine(rng); break;
+            case 1:
+            case 2:  line = validLine(rng); mutate(line, rng); if (rng() & 1){ mutate(line, rng); } break;
+            default: line = randomLine(rng); break;
+        }
+        stream += line + terminators[rng() % 4];
+    }
+
+    // 参照モデル  行末で区切る
+    std::vector<Command> expected;
+    uint32_t expected_errors = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < stream.size(); i++){
+        if (!isEndOfLine(static_cast<uint8_t>(stream[i]))){
+            continue;
+        }
+        Command command = { E_Command::NONE, 0, 0 };
+        const int result = referenceParse(stream.substr(begin, i - begin), command);
+        if (result > 0){
+            expected.push_back(command);
+        }
+        expected_errors += (result < 0) ? 1 : 0;
+        begin = i + 1;
+    }
+
+    CommandParser parser;
+    size_t matched = 0;
+    uint32_t mismatches = 0;
+    for (const char c : stream){
+        if (!parser.feed(static_cast<uint8_t>(c))){
+            continue;
+        }
+        if (matched >= expected.size() || !sameCommand(parser.getCommand(), expected[matched])){
+            if (mismatches++ < 5){
+                printf("   mismatch at command %zu\n", matched);
+            }
+        }
+        matched++;
+    }
+    const bool ok = mismatches == 0 && matched == expected.size() && parser.getErrorCount() == expected_errors
+        && !parser.isReceiving();
+    printf("1. differential fuzz: %u lines, %zu bytes -> %zu commands (expected %zu), %u errors (expected %u), "
+           "%u mismatches  %s\n", FUZZ_LINES, stream.size(), matched, expected.size(),
+           parser.getErrorCount(), expected_errors, mismatches, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int runTiming(void){
+    std::mt19937 rng(1);
+    std::string stream;
+    while (stream.size() < TIMING_BYTES){
+        std::string line = validLine(rng);
+        if (rng() & 1){
+            mutate(line, rng);
+        }
+        stream += line + "\n";
+    }
+    std::vector<uint32_t> cycles(stream.size());
+    CommandParser parser;
+    volatile uint32_t commands = 0;
+    const uint64_t total_begin = HostSim::stamp();
+    for (size_t i = 0; i < stream.size(); i++){
+        const uint64_t begin = HostSim::stamp();
+        commands = commands + (parser.feed(static_cast<uint8_t>(stream[i])) ? 1 : 0);
+        cycles[i] = static_cast<uint32_t>(HostSim::stamp() - begin);
+    }
+    const double mean = static_cast<double>(HostSim::stamp() - total_begin) / stream.size();
+    std::sort(cycles.begin(), cycles.end());
+    const char* unit = HostSim::STAMP_UNIT;
+    printf("2. feed() per byte over %zu bytes: mean %.1f  p99.99 %u  max %u %s (timer included in p99.99/max)  PASS\n",
+           stream.size(), mean, cycles[cycles.size() * 9999 / 10000], cycles.back(), unit);
+    return 0;
+}
+
+/// @brief 実行までの時間の結果 [us]
+struct Latency{
+    uint64_t max_us;
+    double mean_us;
+    uint32_t executed;
+    uint32_t sent;
+};
+
+/*!
+ * @brief コマンドをIotGatewayに送り、実行されるまでの時間を測る
+ * @param baud ボーレート
+ * @param burst 続けて送るコマンドの数
+ */
+Latency runLatency(const uint32_t baud, const uint8_t burst){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    Statemachine statemachine;
+    TimeSwitch timer;
+    gateway.begin(baud);
+    gateway.setCommandTarget(&statemachine, &timer);
+
+    std::mt19937 rng(baud + burst);
+    // MANUALとCONTの間は遷移できないので、MODE Mのあとは1回計測を止めてから次のMODE Cへ
+    static const char* const commands[] = { "MODE C\r\n", "MODE T\r\n", "TIMER 30\r\n", "MODE M\r\n", "STOP\r\n" };
+    constexpr size_t COMMANDS = sizeof(commands) / sizeof(commands[0]);
+    Latency latency = { 0, 0, 0, 0 };
+    uint64_t total_us = 0;
+    uint64_t next_tick_us = CLK_US;
+    for (uint32_t n = 0; n < LATENCY_COMMANDS; n += burst){
+        // CLKの位相をランダムにする
+        HostSim::advance(rng() % CLK_US);
+        // 前のコマンドは全て届いているので、線路は今から使う
+        std::vector<uint64_t> done_us;
+        size_t bytes = 0;
+        for (uint8_t b = 0; b < burst; b++){
+            gateway.inject(commands[(n + b) % COMMANDS]);
+            // 行末のCRが届く時刻  コマンドはCRで揃う（続くLFは空行）
+            bytes += strlen(commands[(n + b) % COMMANDS]);
+            done_us.push_back(HostSim::now() + static_cast<uint64_t>(ceil((bytes - 1) * gateway.byteTime())));
+        }
+        latency.sent += burst;
+        size_t executed = 0;
+        const uint32_t before = gateway.getCommandCount();
+        while (executed < done_us.size()){
+            HostSim::advance(next_tick_us > HostSim::now() ? next_tick_us - HostSim::now() : 0);
+            gateway.clk_in();
+            next_tick_us += CLK_US;
+            // このCLKで実行されたコマンド
+            const uint32_t count = gateway.getCommandCount() - before;
+            for (; executed < count && executed < done_us.size(); executed++){
+                const uint64_t us = HostSim::now() - done_us[executed];
+                latency.max_us = (us > latency.max_us) ? us : latency.max_us;
+                total_us += us;
+                latency.executed++;
+            }
+            if (HostSim::now() > done_us.back() + 1000000){
+                break;
+            }
+        }
+    }
+    latency.mean_us = static_cast<double>(total_us) / latency.executed;
+    return latency;
+}
+
+int runLatencies(void){
+    struct Case{ uint32_t baud; uint8_t burst; };
+    static const Case cases[] = { { 9600, 1 }, { 115200, 1 }, { 115200, 6 } };
+    int failures = 0;
+    printf("3. command to action through IotGateway::clk_in() (CR received -> executed)\n");
+    for (const Case& c : cases){
+        const Latency l = runLatency(c.baud, c.burst);
+        // 1CLKで受信バッファを全て読むので、続けて送った場合も1CLK以内
+        const uint64_t limit_us = CLK_US;
+        const bool ok = l.executed == l.sent && l.max_us <= limit_us;
+        printf("   %6ubaud x%u: executed %u/%u  mean %.2fms  max %.2fms (limit %.0fms)  %s\n", c.baud, c.burst,
+               l.executed, l.sent, l.mean_us / 1000.0, l.max_us / 1000.0, limit_us / 1000.0, ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    }
+    return failures;
+}
+
+/// @brief コマンドを送り、実行またはエラーになるまでclk_in()を回す
+void sendCommand(IotGateway& gateway, const char* command){
+    const uint32_t before = gateway.getCommandCount() + gateway.getCommandErrorCount();
+    gateway.inject(command);
+    while (gateway.getCommandCount() + gateway.getCommandErrorCount() == before){
+        HostSim::advance(CLK_US);
+        gateway.clk_in();
+    }
+}
+
+int runModeTransitions(void){
+    using E_Status = Statemachine::E_Status;
+    using E_MeasCommand = Statemachine::E_MeasCommand;
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    Statemachine statemachine;
+    TimeSwitch timer;
+    gateway.begin(115200);
+    gateway.setCommandTarget(&statemachine, &timer);
+    int failures = 0;
+    printf("4. MODE between MANUAL and CONT (not reachable by the switch either)\n");
+
+    /// @brief 1つの手順  送ったあとの状態、計測コマンド、エラーになったか
+    auto check = [&](const char* name, const E_Status status, const E_MeasCommand command, const bool rejected,
+                     const bool updated){
+        const uint32_t errors = gateway.getCommandErrorCount();
+        sendCommand(gateway, name);
+        const bool was_rejected = gateway.getCommandErrorCount() != errors;
+        const bool was_updated = statemachine.hasStatusUpdated();
+        const bool ok = statemachine.getStatus() == status && was_rejected == rejected && was_updated == updated
+            && (!updated || statemachine.getMeasCommand() == command);
+        std::string line(name);
+        line.resize(line.size() - 2);
+        printf("   %-8s -> %c%s%s  %s\n", line.c_str(), statemachine.getStatusChar(), was_rejected ? " rejected" : "",
+               was_updated ? (statemachine.getMeasCommand() == E_MeasCommand::START ? " START" : " STOP") : "",
+               ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    };
+
+    // 連続計測中のMODE Mは実行しない  計測を止めるのはMODE T
+    check("MODE C\r\n", E_Status::CONT, E_MeasCommand::START, false, true);
+    check("MODE M\r\n", E_Status::CONT, E_MeasCommand::IDLE, true, false);
+    check("MODE T\r\n", E_Status::TIMER, E_MeasCommand::STOP, false, true);
+    // 1回計測中のMODE Cは実行しない  1回計測は測定完了でTIMERに戻る
+    check("MODE M\r\n", E_Status::MANUAL, E_MeasCommand::START, false, true);
+    check("MODE C\r\n", E_Status::MANUAL, E_MeasCommand::IDLE, true, false);
+    const bool completed = statemachine.setTransitSignal(Statemachine::E_Transit::MEASCPL)
+        && statemachine.getStatus() == E_Status::TIMER && statemachine.getMeasCommand() == E_MeasCommand::STOP;
+    printf("   MEASCPL  -> %c%s  %s\n", statemachine.getStatusChar(), completed ? " STOP" : "", completed ? "PASS" : "FAIL");
+    failures += completed ? 0 : 1;
+    statemachine.hasStatusUpdated();
+    // STARTの1回計測中も同じ
+    check("START\r\n", E_Status::MANUAL, E_MeasCommand::START, false, true);
+    check("MODE C\r\n", E_Status::MANUAL, E_MeasCommand::IDLE, true, false);
+    // ステートマシンを直接呼んでも遷移しない
+    const bool direct = !statemachine.requestStatus(E_Status::CONT) && statemachine.getStatus() == E_Status::MANUAL
+        && statemachine.getMeasCommand() == E_MeasCommand::IDLE;
+    printf("   requestStatus(CONT) from MANUAL -> %c  %s\n", statemachine.getStatusChar(), direct ? "PASS" : "FAIL");
+    failures += direct ? 0 : 1;
+    return failures;
+}
+
+}   // namespace
+
+int main(void){
+    int failures = 0;
+    failures += runFuzz();
+    failures += runTiming();
+    failures += runLatencies();
+    failures += runModeTransitions();
+    return failures == 0 ? 0 : 1;
+}
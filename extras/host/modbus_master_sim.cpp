@@ -0,0 +1,350 @@
+/**************************************************************************/
+/*!
+ * @file modbus_master_sim.cpp
+ * @brief IotGatewayのModbus RTUスレーブを、ローカルのModbusマスタのシミュレーションで確認する
+ * @par
+ *    extras/host/arduino のスタブで、setModbus()したIotGatewayをそのまま動かす。時間は仮想時間 [us]。
+ *    マスタは要求をHardwareSerialのinject()で線路に載せ（baudに応じて1byteずつ届く）、
+ *    10ms周期でIotGateway::clk_in()を呼び出す。応答はUARTに出たバイト列(transmitted())、
+ *    DEはdigitalWrite()されたピンの値で見る。
+ *      正常な読み出し  publish()の値がレジスタ0-3に、setModbusRegister(), setModbusFloat()の値がそれ以降に入ること
+ *      例外応答、宛先違い・ブロードキャスト・CRCエラーには応答しないこと
+ *      CLKをまたぐ要求、スナップショットの一貫性（同じCLKのpublish()と、2ワードの値）
+ *      共有バスで他のスレーブとのやり取りに間を空けずに続く要求
+ *      DE  応答を送る間だけHIGHで、応答しない要求ではHIGHにならないこと
+ *          最後のbyteを送り終えてからreleaseBus()でLOWにするまでの時間が1CLK以内であること
+ *      スケッチのpayload, addReading()はRS-485では送らず、UARTに出るのは応答（enqueue(ALARM)）だけであること
+ *    要求の最後のbyteが届いてから応答をUARTに書き込むまでの時間を集計する。最後に乱数のフレームを流す。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src modbus_master_sim.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ *    例: ./a.out [baud=9600]
+ *    115200baudでは1CLKに約115byte届くので、他のスレーブの長い応答が続くとUARTの受信バッファ(64byte)があふれる
+ *    その場合は -DSERIAL_RX_BUFFER_SIZE=128 を付けてビルドする（IotGateway::RX_BYTES_PER_TICKを参照）
+ */
+/**************************************************************************/
+
+#include <stdlib.h>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <Arduino.h>
+#include "IotGateway.h"
+#include "ModbusSlave.h"
+#include "Crc16.h"
+
+namespace {
+
+// スレーブのCLK周期 [us]
+constexpr uint64_t CLK_PERIOD_US = 10000;
+
+constexpr uint8_t SLAVE_ADDRESS = 17;
+
+// 同じバスの他のスレーブ
+constexpr uint8_t OTHER_ADDRESS = 18;
+
+// RS-485トランシーバのDEピン
+constexpr uint32_t DE_PIN = 7;
+
+/*!
+ * @brief Modbusマスタと、setModbus()したIotGateway
+ */
+class Master {
+    public:
+    explicit Master(IotGateway& gateway)
+        : gateway(gateway){
+    };
+
+    uint64_t max_latency_us = 0;
+    uint64_t total_latency_us = 0;
+    uint64_t responses = 0;
+    uint64_t response_bytes = 0;
+    uint64_t max_de_hold_us = 0;    // 最後のbyteを送り終えてからDEをLOWにするまで
+    uint32_t de_errors = 0;         // 応答しないのにDEがHIGH、もしくは送信中にDEがLOW
+
+    /// @brief 要求を送り、応答を送り終えてDEがLOWになるか、一定時間が過ぎるまでCLKを進める
+    /// @param request 要求（CRC込み）
+    /// @param response 応答
+    /// @param on_tick CLKごとにclk_in()の前に呼び出す（スケッチの処理）
+    /// @return True:応答があった
+    template <typename F>
+    bool transact(const std::vector<uint8_t>& request, std::vector<uint8_t>& response, F on_tick){
+        // 前のCLKから位相だけ後に要求を送り始める
+        HostSim::advance(phase_us);
+        const size_t sent_before = gateway.transmitted().size();
+        const uint64_t last_byte_us = HostSim::now() + static_cast<uint64_t>(ceil(request.size() * gateway.byteTime()));
+        gateway.inject(request.data(), request.size());
+        response.clear();
+        uint64_t written_us = 0;
+        while (true){
+            HostSim::advance(next_tick_us > HostSim::now() ? next_tick_us - HostSim::now() : 0);
+            next_tick_us += CLK_PERIOD_US;
+            on_tick(gateway);
+            const uint64_t tick_us = HostSim::now();
+            gateway.clk_in();
+            const size_t sent = gateway.transmitted().size();
+            const bool de = HostSim::getPin(DE_PIN) == HIGH;
+            if (written_us == 0 && sent != sent_before){
+                written_us = tick_us;
+                // 書き込んだCLKでは送信中
+                de_errors += de ? 0 : 1;
+            }
+            if (written_us == 0){
+                // 応答を書き込むまでDEはLOW
+                de_errors += de ? 1 : 0;
+                if (HostSim::now() > last_byte_us + 3 * CLK_PERIOD_US){
+                    return false;
+                }
+                continue;
+            }
+            if (de){
+                continue;
+            }
+            // 送り終えてDEをLOWにした  応答はCLKでまとめて書き込むので、送り終わるのは書き込みから長さ分の後
+            response.assign(gateway.transmitted().begin() + sent_before, gateway.transmitted().end());
+            const uint64_t done_us = written_us + static_cast<uint64_t>(ceil(response.size() * gateway.byteTime()));
+            const uint64_t hold_us = (HostSim::now() > done_us) ? HostSim::now() - done_us : 0;
+            max_de_hold_us = (hold_us > max_de_hold_us) ? hold_us : max_de_hold_us;
+            const uint64_t latency = written_us - last_byte_us;
+            max_latency_us = (latency > max_latency_us) ? latency : max_latency_us;
+            total_latency_us += latency;
+            responses++;
+            response_bytes += response.size();
+            return true;
+        }
+    };
+
+    bool transact(const std::vector<uint8_t>& request, std::vector<uint8_t>& response){
+        return transact(request, response, [](IotGateway&){});
+    };
+
+    /// @brief 要求を送り始めるCLKの位相を変える（要求がCLKをまたぐ位置を変える）
+    void setPhase(const uint64_t phase){
+        phase_us = phase % CLK_PERIOD_US;
+    };
+
+    private:
+    IotGateway& gateway;
+    uint64_t next_tick_us = CLK_PERIOD_US;
+    uint64_t phase_us = 0;
+};
+
+std::vector<uint8_t> withCrc(std::vector<uint8_t> frame){
+    const uint16_t crc = Crc16::modbus(frame.data(), frame.size());
+    frame.push_back(crc & 0xFF);
+    frame.push_back(crc >> 8);
+    return frame;
+}
+
+std::vector<uint8_t> readRequest(const uint8_t address, const uint8_t function, const uint16_t start, const uint16_t quantity){
+    return withCrc({ address, function, static_cast<uint8_t>(start >> 8), static_cast<uint8_t>(start & 0xFF),
+                     static_cast<uint8_t>(quantity >> 8), static_cast<uint8_t>(quantity & 0xFF) });
+}
+
+/// @brief 他のスレーブの読み出しの応答
+std::vector<uint8_t> otherResponse(const uint16_t quantity, const uint32_t seed){
+    std::vector<uint8_t> frame = { OTHER_ADDRESS, 0x03, static_cast<uint8_t>(2 * quantity) };
+    for (uint16_t i = 0; i < 2 * quantity; i++){
+        frame.push_back(static_cast<uint8_t>(seed * 31 + i * 7));
+    }
+    return withCrc(frame);
+}
+
+bool validCrc(const std::vector<uint8_t>& frame){
+    return frame.size() >= 4
+        && Crc16::modbus(frame.data(), frame.size() - 2) == (frame[frame.size() - 2] | (frame[frame.size() - 1] << 8));
+}
+
+int failures = 0;
+
+void check(const char* name, const bool result){
+    printf("%-52s %s\n", name, result ? "PASS" : "FAIL");
+    failures += result ? 0 : 1;
+}
+
+bool isException(const std::vector<uint8_t>& response, const uint8_t function, const uint8_t code){
+    return response.size() == 5 && validCrc(response) && response[0] == SLAVE_ADDRESS
+        && response[1] == (function | ModbusSlave::EXCEPTION_FLAG) && response[2] == code;
+}
+
+uint16_t registerAt(const std::vector<uint8_t>& response, const size_t index){
+    return (response[3 + 2 * index] << 8) | response[4 + 2 * index];
+}
+
+}   // namespace
+
+int main(int argc, char* argv[]){
+    const uint32_t baud = (argc > 1) ? atoi(argv[1]) : 9600;
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(baud);
+    if (!gateway.setModbus(SLAVE_ADDRESS, DE_PIN)){
+        printf("setModbus failed\n");
+        return 1;
+    }
+    Master master(gateway);
+    std::vector<uint8_t> response;
+    using E_Schema = IotGateway::E_Schema;
+
+    // レジスタ0-3はpublish()の値  それ以降はsetModbusRegister()
+    gateway.publish(E_Schema::LEVEL, 613);
+    gateway.publish(E_Schema::MODE, 2);
+    gateway.publish(E_Schema::REMAIN, 45);
+    gateway.publish(E_Schema::ERROR_FLAGS, 0x0004);
+    for (uint16_t i = 4; i < ModbusSlave::REGISTER_COUNT; i++){
+        gateway.setModbusRegister(static_cast<ModbusSlave::E_Register>(i), 1000 + i);
+    }
+    gateway.setModbusFloat(ModbusSlave::E_Register::ADC_GAIN_ERROR_01, 1.0f);
+
+    // 正常な読み出し
+    bool ok = master.transact(readRequest(SLAVE_ADDRESS, 0x03, 0, ModbusSlave::REGISTER_COUNT), response)
+        && validCrc(response) && response.size() == 5 + 2 * ModbusSlave::REGISTER_COUNT
+        && response[2] == 2 * ModbusSlave::REGISTER_COUNT
+        && registerAt(response, 0) == 613 && registerAt(response, 1) == 2 && registerAt(response, 2) == 45
+        && registerAt(response, 3) == 0x0004 && registerAt(response, 4) == 1004 && registerAt(response, 11) == 1011
+        && registerAt(response, 12) == 0x3F80 && registerAt(response, 13) == 0x0000;
+    check("0x03 read all registers (publish() -> registers 0-3)", ok);
+
+    ok = master.transact(readRequest(SLAVE_ADDRESS, 0x04, 4, 2), response)
+        && validCrc(response) && response.size() == 9 && registerAt(response, 0) == 1004 && registerAt(response, 1) == 1005;
+    check("0x04 read sensor length, timer period", ok);
+
+    // 次のCLKのpublish()の値を返す
+    ok = master.transact(readRequest(SLAVE_ADDRESS, 0x04, 0, 1), response, [](IotGateway& g){
+        g.publish(E_Schema::LEVEL, 700);
+    }) && validCrc(response) && registerAt(response, 0) == 700;
+    check("publish() between requests", ok);
+
+    // 例外応答
+    ok = master.transact(withCrc({ SLAVE_ADDRESS, 0x06, 0x00, 0x01, 0x00, 0x05 }), response)
+        && isException(response, 0x06, ModbusSlave::EXCEPTION_ILLEGAL_FUNCTION);
+    check("0x06 write -> illegal function", ok);
+
+    ok = master.transact(readRequest(SLAVE_ADDRESS, 0x03, ModbusSlave::REGISTER_COUNT - 1, 2), response)
+        && isException(response, 0x03, ModbusSlave::EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    check("read past the last register -> illegal address", ok);
+
+    ok = master.transact(readRequest(SLAVE_ADDRESS, 0x03, 0xFFFF, 1), response)
+        && isException(response, 0x03, ModbusSlave::EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    check("start address 0xFFFF -> illegal address", ok);
+
+    ok = master.transact(readRequest(SLAVE_ADDRESS, 0x04, 0, 0), response)
+        && isException(response, 0x04, ModbusSlave::EXCEPTION_ILLEGAL_DATA_VALUE);
+    check("quantity 0 -> illegal value", ok);
+
+    ok = master.transact(readRequest(SLAVE_ADDRESS, 0x04, 0, 126), response)
+        && isException(response, 0x04, ModbusSlave::EXCEPTION_ILLEGAL_DATA_VALUE);
+    check("quantity 126 -> illegal value", ok);
+
+    // 応答しないもの
+    check("other slave address -> no response", !master.transact(readRequest(SLAVE_ADDRESS + 1, 0x03, 0, 1), response));
+    check("broadcast -> no response", !master.transact(readRequest(0, 0x03, 0, 1), response));
+    std::vector<uint8_t> corrupted = readRequest(SLAVE_ADDRESS, 0x03, 0, 1);
+    corrupted[3] ^= 0x01;
+    const uint32_t frame_errors = gateway.getModbus().getFrameErrorCount();
+    check("CRC error -> no response, counted",
+          !master.transact(corrupted, response) && gateway.getModbus().getFrameErrorCount() == frame_errors + 1);
+
+    // 要求がCLKをまたぐ位置を変えても応答する
+    ok = true;
+    for (uint64_t phase = 0; phase < CLK_PERIOD_US; phase += 700){
+        master.setPhase(phase);
+        ok = ok && master.transact(readRequest(SLAVE_ADDRESS, 0x03, 4, 3), response) && validCrc(response)
+            && registerAt(response, 0) == 1004;
+    }
+    check("request split across ticks at every phase", ok);
+
+    // 共有バス  他のスレーブへの要求、その応答、自分への要求が間を空けずに（3.5文字時間未満で）続く
+    //  1CLKの受信の途切れを待つと1つのフレームに繋がってしまう
+    ok = true;
+    for (uint16_t quantity = 1; quantity <= 40 && ok; quantity++){
+        master.setPhase(quantity * 613);
+        std::vector<uint8_t> bus = readRequest(OTHER_ADDRESS, 0x03, 0, quantity);
+        const std::vector<uint8_t> other = otherResponse(quantity, quantity);
+        const std::vector<uint8_t> mine = readRequest(SLAVE_ADDRESS, 0x04, 4, 3);
+        bus.insert(bus.end(), other.begin(), other.end());
+        bus.insert(bus.end(), mine.begin(), mine.end());
+        ok = master.transact(bus, response) && validCrc(response) && response.size() == 11
+            && registerAt(response, 0) == 1004 && registerAt(response, 2) == 1006;
+    }
+    check("shared bus: back-to-back after another slave", ok);
+
+    // 他のスレーブへの要求の直後に自分への要求（応答のないブロードキャストの後など）
+    ok = true;
+    for (uint64_t phase = 0; phase < CLK_PERIOD_US && ok; phase += 900){
+        master.setPhase(phase);
+        std::vector<uint8_t> bus = readRequest(OTHER_ADDRESS, 0x04, 0, 4);
+        const std::vector<uint8_t> mine = readRequest(SLAVE_ADDRESS, 0x03, 4, 1);
+        bus.insert(bus.end(), mine.begin(), mine.end());
+        ok = master.transact(bus, response) && validCrc(response) && response.size() == 7 && registerAt(response, 0) == 1004;
+    }
+    check("shared bus: back-to-back requests", ok);
+
+    // スナップショット  CLKごとに値を書き換えても、同じCLKの値の組み合わせが崩れない
+    //  2ワードのfloatの上位・下位と、publish()した液面・残り時間
+    uint32_t tick = 0;
+    ok = true;
+    for (int i = 0; i < 200 && ok; i++){
+        master.setPhase(i * 137);
+        ok = master.transact(readRequest(SLAVE_ADDRESS, 0x03, 14, 2), response, [&tick](IotGateway& g){
+            const uint16_t value = ++tick;
+            g.setModbusRegister(ModbusSlave::E_Register::ADC_GAIN_ERROR_23, value);
+            g.setModbusRegister(static_cast<ModbusSlave::E_Register>(static_cast<uint16_t>(ModbusSlave::E_Register::ADC_GAIN_ERROR_23) + 1), value);
+        }) && registerAt(response, 0) == registerAt(response, 1);
+        ok = ok && master.transact(readRequest(SLAVE_ADDRESS, 0x04, 0, 3), response, [&tick](IotGateway& g){
+            const uint16_t value = ++tick % 1000;
+            g.publish(E_Schema::LEVEL, value);
+            g.publish(E_Schema::REMAIN, value);
+        }) && registerAt(response, 0) == registerAt(response, 2);
+    }
+    check("two-word value and publish() values are never torn", ok);
+
+    // スケッチがpayload, addReading()を出しても、RS-485では送らない  UARTに出るのは応答だけ
+    ok = true;
+    for (int i = 0; i < 50 && ok; i++){
+        master.setPhase(i * 211);
+        ok = master.transact(readRequest(SLAVE_ADDRESS, 0x04, 0, 1), response, [i](IotGateway& g){
+            g.addPayload("temp", static_cast<int32_t>(i));
+            g.sendPayload();
+            g.addReading(static_cast<uint16_t>(i));
+        }) && validCrc(response) && response.size() == 7;
+    }
+    const uint64_t unsolicited = gateway.transmitted().size() - master.response_bytes;
+    check("sketch payloads are not sent on RS-485", ok && unsolicited == 0);
+
+    const uint64_t responses = master.responses;
+    printf("read latency (last request byte -> response written) avg:%.2fms max:%.2fms over %llu responses\n",
+           master.total_latency_us / 1000.0 / responses, master.max_latency_us / 1000.0, (unsigned long long)responses);
+    check("every response within 2 ticks", master.max_latency_us <= 2 * CLK_PERIOD_US);
+    printf("DE held after the last response byte: max %.2fms\n", master.max_de_hold_us / 1000.0);
+    check("DE only while responding, released within 1 tick",
+          master.de_errors == 0 && master.max_de_hold_us <= CLK_PERIOD_US);
+
+    // 乱数のフレーム  落ちないこと、不正な応答を返さないこと
+    std::mt19937 rng(5);
+    ok = true;
+    for (int i = 0; i < 20000 && ok; i++){
+        std::vector<uint8_t> frame(1 + rng() % 300);
+        for (uint8_t& byte : frame){
+            byte = rng();
+        }
+        if (rng() % 2){
+            frame[0] = SLAVE_ADDRESS;
+        }
+        if (master.transact(frame, response)){
+            ok = validCrc(response) && response[0] == SLAVE_ADDRESS;
+        }
+    }
+    check("random frames", ok && master.de_errors == 0);
+
+    check("no UART receive overrun", gateway.overruns() == 0);
+
+    const ModbusSlave& slave = gateway.getModbus();
+    printf("requests:%u exceptions:%u frame errors:%u resyncs:%u  rx overruns:%u\n", slave.getRequestCount(),
+           slave.getExceptionCount(), slave.getFrameErrorCount(), slave.getResyncCount(), gateway.overruns());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+/**************************************************************************/
+/*!
+ * @file sim_boot.cpp
+ * @brief 起動処理(BootSequencer)の、起動から最初の計測結果までの時間と、CLKを止める時間を測る
+ * @par
+ *    extras/host/arduino のスタブでBootSequencer, EhLcd, Measurement, ParameterStorageをそのまま動かす。時間は仮想時間。
+ *    起動が終わったら連続計測を始め、最初の計測結果が得られるまでCLKを入れる。
+ *    1. FRAMにパラメタあり  読み込んだセンサ長・タイマ周期・ユニットアドレスが使われること
+ *       以前のファームウェアが0x4Cに残した1byte（反転の確認なし）はユニットアドレスに使わないこと
+ *    2. 未書き込みのFRAM（全て0）  センサ長・タイマ周期・スケーリングは初期値のまま（0で割らない）、ユニットアドレスは0
+ *    3. FRAMなし  ERROR_FRAMで起動を終える
+ *    4. 比較: 以前のブロックする起動（EhLcd::init(), showSplash(), Measurement::init()を順に呼ぶ）
+ *    CLK 1回の最長の所要時間は、rgb_lcd::begin()の中の待ち（ライブラリ）を含む。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src sim_boot.cpp arduino/HostSim.cpp \
+ *          ../../src/BootSequencer.cpp ../../src/eh_LCD.cpp ../../src/measurement.cpp ../../src/DAC80501.cpp \
+ *          ../../src/MCP4725.cpp ../../src/MCP23008.cpp \
+ *          ../../src/ParameterStorage.cpp ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostDevices.h"
+#include "BootSequencer.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// 呼び出し側（スケッチ）で設定するパラメタの初期値
+constexpr uint8_t DEFAULT_SENSOR_LENGTH = 36;
+constexpr uint16_t DEFAULT_TIMER_PERIOD = 60;
+
+HostSim::Ads1115 adc;
+HostSim::Mcp23008 pio;
+HostSim::Fram fram;
+HostSim::GroveLcd lcd_model;
+
+/// @brief 起動の結果
+struct BootResult{
+    uint16_t error_code;
+    bool failed;
+    uint32_t boot_ms;           // 起動開始からスプラッシュを消すまで
+    uint32_t first_result_ms;   // 起動開始から最初の計測結果まで
+    uint64_t max_tick_us;       // CLK 1回の最長の所要時間
+    uint64_t blocked_us;        // 起動中にdelay()でブロックした時間の合計（計測の待ちは含まない）
+    uint8_t sensor_length;
+    uint16_t timer_period;
+    uint16_t level;
+    uint8_t unit_address;
+};
+
+void attachDevices(const bool with_fram){
+    HostSim::reset();
+    HostSim::attachI2c(I2C_ADDR::ADC, &adc);
+    HostSim::attachI2c(I2C_ADDR::PIO, &pio);
+    HostSim::attachI2c(I2C_ADDR::CURRENT_ADJ);
+    HostSim::attachI2c(I2C_ADDR::V_MON);
+    HostSim::attachI2c(I2C_ADDR::LCD, &lcd_model);
+    HostSim::attachI2c(RGB_ADDRESS);
+    if (with_fram){
+        HostSim::attachI2c(I2C_ADDR::FRAM, &fram);
+    }
+    Wire.begin();
+    I2cClock.begin(&Wire);
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+    // 液面約50%になる読み値
+    adc.differential[0] = 10158;
+    adc.differential[1] = 24000;
+}
+
+void setDefaults(Measurement::MesasUintParameters& parameters){
+    parameters.sensor_length = DEFAULT_SENSOR_LENGTH;
+    parameters.timer_period = DEFAULT_TIMER_PERIOD;
+    parameters.adc_err_comp_diff_0_1 = 1.0;
+    parameters.adc_err_comp_diff_2_3 = 1.0;
+    parameters.adc_OFS_comp_diff_0_1 = 0;
+    parameters.adc_OFS_comp_diff_2_3 = 0;
+    parameters.current_set_default = 750;
+    parameters.vmon_da_offset = 0;
+}
+
+/// @brief 連続計測を始め、最初の計測結果が得られるまで動かす
+/// @param next_tick_us 次のCLKの時刻
+/// @param max_tick_us CLK 1回の最長の所要時間（更新する）
+void runToFirstResult(Measurement& measurement, uint64_t& next_tick_us, uint64_t& max_tick_us){
+    measurement.setMode(Measurement::E_Modes::CONTINUOUS);
+    measurement.setCommand(Measurement::E_Command::START);
+    while (measurement.getFirstResultTime() == 0 && HostSim::now() < 10000000){
+        if (measurement.shouldMeasure()){
+            measurement.executeMeasurement();
+        } else {
+            HostSim::advance(next_tick_us - HostSim::now());
+        }
+        while (HostSim::now() >= next_tick_us){
+            const uint64_t begin_us = HostSim::now();
+            measurement.clk_in();
+            max_tick_us = (HostSim::now() - begin_us > max_tick_us) ? HostSim::now() - begin_us : max_tick_us;
+            next_tick_us += CLK_US;
+        }
+    }
+}
+
+BootResult runBoot(const bool with_fram){
+    attachDevices(with_fram);
+    Measurement::MesasUintParameters parameters;
+    setDefaults(parameters);
+    EhLcd lcd;
+    Measurement measurement(&parameters);
+    ParameterStorage storage;
+    BootSequencer boot(&lcd, &measurement, &storage, &parameters, "EH-900 host sim");
+
+    BootResult result = {};
+    uint64_t next_tick_us = HostSim::now() + CLK_US;
+    while (!boot.isDone()){
+        HostSim::advance(next_tick_us - HostSim::now());
+        const uint64_t begin_us = HostSim::now();
+        boot.clk_in();
+        const uint64_t tick_us = HostSim::now() - begin_us;
+        result.max_tick_us = (tick_us > result.max_tick_us) ? tick_us : result.max_tick_us;
+        next_tick_us += CLK_US;
+    }
+    result.error_code = boot.getErrorCode();
+    result.failed = (boot.getStep() == BootSequencer::E_Step::FAILED);
+    result.boot_ms = boot.getBootTime();
+    result.blocked_us = HostSim::blockedTime();
+    if (!result.failed){
+        runToFirstResult(measurement, next_tick_us, result.max_tick_us);
+        result.first_result_ms = boot.getTimeToFirstMeasurement();
+    }
+    result.sensor_length = parameters.sensor_length;
+    result.timer_period = parameters.timer_period;
+    result.level = measurement.getResult();
+    result.unit_address = boot.getUnitAddress();
+    return result;
+}
+
+/// @brief 以前のブロックする起動  起動開始から最初の計測結果までの時間 [ms]
+BootResult runBlockingBoot(void){
+    attachDevices(true);
+    Measurement::MesasUintParameters parameters;
+    setDefaults(parameters);
+    EhLcd lcd;
+    Measurement measurement(&parameters);
+
+    BootResult result = {};
+    const uint64_t start_us = HostSim::now();
+    lcd.init();
+    lcd.showSplash("EH-900 host sim");
+    result.error_code = measurement.init();
+    result.boot_ms = static_cast<uint32_t>((HostSim::now() - start_us) / 1000);
+    result.blocked_us = HostSim::blockedTime();
+    // 起動の間はCLKが止まっている
+    result.max_tick_us = HostSim::now() - start_us;
+    uint64_t next_tick_us = HostSim::now() + CLK_US;
+    runToFirstResult(measurement, next_tick_us, result.max_tick_us);
+    result.first_result_ms = static_cast<uint32_t>(measurement.getFirstResultTime() - start_us / 1000);
+    result.sensor_length = parameters.sensor_length;
+    result.timer_period = parameters.timer_period;
+    result.level = measurement.getResult();
+    return result;
+}
+
+void printResult(const char* name, const BootResult& r, const bool ok){
+    printf("   %-24s error:0x%02X boot:%5ums first result:%5ums  longest tick:%6.1fms blocked:%7.1fms"
+           "  sensor:%uinch timer:%umin level:%u unit:%u  %s\n",
+           name, r.error_code, r.boot_ms, r.first_result_ms, r.max_tick_us / 1000.0, r.blocked_us / 1000.0,
+           r.sensor_length, r.timer_period, r.level, r.unit_address, ok ? "PASS" : "FAIL");
+}
+
+}   // namespace
+
+int main(void){
+    int failures = 0;
+    printf("boot to first measurement (virtual time, minimum splash %u ticks)\n", BootSequencer::DEFAULT_MIN_SPLASH_TIME);
+
+    // 1. パラメタあり  センサ長48inch、タイマ周期30分、ユニットアドレス17
+    const uint16_t unit_address_at = static_cast<uint16_t>(ParameterStorage::E_ParameterCategories::UNIT_ADDRESS);
+    const ParameterStorage::UnitAddress unit_address = ParameterStorage::UnitAddress::make(17);
+    memset(fram.memory, 0, sizeof(fram.memory));
+    fram.memory[static_cast<uint16_t>(ParameterStorage::E_ParameterCategories::SENSOR_LENGTH)] = 48;
+    fram.memory[static_cast<uint16_t>(ParameterStorage::E_ParameterCategories::TIMER_PERIOD)] = 30;
+    memcpy(&fram.memory[unit_address_at], &unit_address, sizeof(unit_address));
+    fram.memory[static_cast<uint16_t>(ParameterStorage::E_ParameterCategories::SCALING)] = 0xE8;      // scale_100 = 1000
+    fram.memory[static_cast<uint16_t>(ParameterStorage::E_ParameterCategories::SCALING) + 1] = 0x03;
+    const BootResult programmed = runBoot(true);
+    const bool programmed_ok = !programmed.failed && programmed.error_code == 0 && programmed.first_result_ms != 0
+        && programmed.sensor_length == 48 && programmed.timer_period == 30 && programmed.unit_address == 17;
+    printResult("1. programmed FRAM", programmed, programmed_ok);
+    failures += programmed_ok ? 0 : 1;
+
+    // 1. 以前のファームウェアの値  0x4Cに1byteだけ残っている
+    fram.memory[unit_address_at] = 17;
+    fram.memory[unit_address_at + 1] = 0;
+    const BootResult stale = runBoot(true);
+    const bool stale_ok = !stale.failed && stale.error_code == 0 && stale.sensor_length == 48 && stale.unit_address == 0;
+    printResult("1. stale unit address", stale, stale_ok);
+    failures += stale_ok ? 0 : 1;
+
+    // 2. 未書き込みのFRAM
+    memset(fram.memory, 0, sizeof(fram.memory));
+    const BootResult blank = runBoot(true);
+    const bool blank_ok = !blank.failed && blank.first_result_ms != 0
+        && blank.sensor_length == DEFAULT_SENSOR_LENGTH && blank.timer_period == DEFAULT_TIMER_PERIOD && blank.level != 0
+        && blank.unit_address == 0;
+    printResult("2. blank FRAM", blank, blank_ok);
+    failures += blank_ok ? 0 : 1;
+
+    // 3. FRAMなし
+    const BootResult missing = runBoot(false);
+    const bool missing_ok = missing.failed && (missing.error_code & BootSequencer::ERROR_FRAM) != 0
+        && missing.sensor_length == DEFAULT_SENSOR_LENGTH;
+    printResult("3. no FRAM", missing, missing_ok);
+    failures += missing_ok ? 0 : 1;
+
+    // 4. 以前のブロックする起動
+    const BootResult blocking = runBlockingBoot();
+    printResult("4. blocking (reference)", blocking, blocking.first_result_ms != 0);
+    printf("   time to first measurement: %ums -> %ums  longest CLK stall during boot: %.1fms -> %.1fms\n",
+           blocking.first_result_ms, blank.first_result_ms, blocking.max_tick_us / 1000.0, blank.max_tick_us / 1000.0);
+
+    return failures == 0 ? 0 : 1;
+}
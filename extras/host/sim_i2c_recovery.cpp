@@ -0,0 +1,259 @@
+/**************************************************************************/
+/*!
+ * @file sim_i2c_recovery.cpp
+ * @brief I2cBusRecoveryのリトライ・バス復旧を、バス側の故障注入で確認し、所要時間を測る
+ * @par
+ *    extras/host/arduino のスタブで計測ユニット(Measurement)をそのまま動かす。時間は仮想時間。
+ *    故障はファームウエアの故障注入(EH_I2C_FAULT_INJECTION)ではなく、模擬バス(HostSim)で起こすので、
+ *    isBusStuck(), recoverBus()も実際のピン操作で動く。
+ *
+ *    1. execute()1回の所要時間（CLKを止める時間）  故障の種類ごと
+ *       上限は固定の I2cBusRecovery::STALL_LIMIT_US（予算 + バス復旧 + 転送1回のタイムアウト）
+ *       予算はリトライを始める前にだけ確認するので、予算の直前に始めた試行はタイムアウトまで続く
+ *       クロックストレッチはWireのタイムアウト（I2C_TIMEOUT_TICK）で打ち切られる
+ *       ADS1115の変換1回（execute()の外、リトライなし）  変換待ち(8ms) + 転送3回で、
+ *       全ての転送がタイムアウトした場合も ADS1115_SAMPLE_LIMIT_US 以内であること
+ *    2. 計測中にADCが応答しない  device_errorだけが立ち、sensor_errorは立たないこと
+ *    3. ADCが3秒間応答しない（連続計測）  応答が戻ってから計測結果が得られるまでの時間
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src sim_i2c_recovery.cpp arduino/HostSim.cpp \
+ *          ../../src/measurement.cpp ../../src/DAC80501.cpp ../../src/MCP4725.cpp ../../src/MCP23008.cpp \
+ *          ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_ADS1015.h>
+#include "HostDevices.h"
+#include "measurement.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// ADS1115の変換1回の最長 [us]  変換待ち + 転送3回（コンフィグ書き込み、ポインタ書き込み、読み出し）のタイムアウト
+constexpr uint64_t ADS1115_SAMPLE_LIMIT_US = ADS1115_CONVERSIONDELAY * 1000ULL + 3 * I2cBusRecovery::TRANSFER_TIMEOUT_US;
+
+HostSim::Ads1115 adc;
+HostSim::Mcp23008 pio;
+
+Measurement::MesasUintParameters parameters;
+uint64_t next_tick_us = 0;
+
+/// @brief 計測ユニットの模擬デバイスをつなぐ
+void attachDevices(void){
+    HostSim::attachI2c(I2C_ADDR::ADC, &adc);
+    HostSim::attachI2c(I2C_ADDR::PIO, &pio);
+    HostSim::attachI2c(I2C_ADDR::CURRENT_ADJ);
+    HostSim::attachI2c(I2C_ADDR::V_MON);
+    HostSim::attachI2c(I2C_ADDR::LCD);
+}
+
+/// @brief 仮想時間に追いつくまでCLKを入れる  計測(executeMeasurement)中もCLKの割り込みは入る
+void catchUp(Measurement& measurement){
+    while (HostSim::now() >= next_tick_us){
+        measurement.clk_in();
+        next_tick_us += CLK_US;
+    }
+}
+
+/// @brief メインループ1回分  計測要求があれば計測し、なければ次のCLKまで進める
+void loopOnce(Measurement& measurement){
+    if (measurement.shouldMeasure()){
+        measurement.executeMeasurement();
+    } else {
+        HostSim::advance(next_tick_us - HostSim::now());
+    }
+    catchUp(measurement);
+}
+
+/*!
+ * @brief 故障ごとのexecute()の所要時間
+ */
+struct FaultCase{
+    const char* name;
+    HostSim::E_I2cFault fault;
+    uint32_t count;
+    uint32_t param;         // STRETCH:時間[us]  STUCK_SDA:解放までのクロック数
+    bool expect_success;
+};
+
+int runStallCases(void){
+    const FaultCase cases[] = {
+        { "none",                      HostSim::E_I2cFault::NONE,      0,    0, true  },
+        { "NACK x1",                   HostSim::E_I2cFault::NACK,      1,    0, true  },
+        { "NACK x3 (all attempts)",    HostSim::E_I2cFault::NACK,      3,    0, false },
+        { "stretch 1ms x1",            HostSim::E_I2cFault::STRETCH,   1, 1000, true  },
+        { "stretch 1.8ms x3",          HostSim::E_I2cFault::STRETCH,   3, 1800, false },
+        { "stretch 2.9ms x3",          HostSim::E_I2cFault::STRETCH,   3, 2900, false },
+        { "stretch 25ms x1",           HostSim::E_I2cFault::STRETCH,   1, 25000, false },
+        { "SDA stuck, 9 clocks",       HostSim::E_I2cFault::STUCK_SDA, 1,    9, true  },
+        { "SDA stuck, 2 clocks",       HostSim::E_I2cFault::STUCK_SDA, 1,    2, true  },
+    };
+
+    // 故障のない試行1回の時間（アドレスのみのトランザクション）
+    const uint64_t start_us = HostSim::now();
+    I2cRecovery.check(I2C_ADDR::ADC);
+    const uint64_t attempt_us = HostSim::now() - start_us;
+
+    printf("1. execute() stall per fault  (check(ADC) at 100kHz, one clean attempt %lluus, STALL_BUDGET_US %u,"
+           " transfer timeout %uus)\n", static_cast<unsigned long long>(attempt_us), I2cBusRecovery::STALL_BUDGET_US,
+           I2cBusRecovery::TRANSFER_TIMEOUT_US);
+    int failures = 0;
+    for (const FaultCase& c : cases){
+        HostSim::injectI2cFault(I2C_ADDR::ADC, c.fault, c.count, c.param);
+        const uint32_t recoveries = I2cRecovery.getRecoveryCount();
+        const uint64_t begin_us = HostSim::now();
+        const bool result = I2cRecovery.check(I2C_ADDR::ADC);
+        const uint64_t stall_us = HostSim::now() - begin_us;
+
+        const bool ok = (result == c.expect_success) && (stall_us <= I2cBusRecovery::STALL_LIMIT_US) && !HostSim::isSdaStuck();
+        printf("   %-26s result:%-5s stall:%6lluus  bus recoveries:%u (last %uus)  limit:%6uus  %s\n",
+               c.name, result ? "ok" : "fail", static_cast<unsigned long long>(stall_us),
+               I2cRecovery.getRecoveryCount() - recoveries, I2cRecovery.getLastRecoveryTime(),
+               I2cBusRecovery::STALL_LIMIT_US, ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+
+        // 健全性を戻す
+        HostSim::injectI2cFault(I2C_ADDR::ADC, HostSim::E_I2cFault::NONE, 0);
+        HostSim::advance(I2cBusRecovery::FAILED_RETRY_INTERVAL_MS * 1000ULL);
+        I2cRecovery.check(I2C_ADDR::ADC);
+    }
+
+    // ADS1115の変換1回  ドライバ（ライブラリ）は通信エラーを返さずリトライもしない
+    Adafruit_ADS1115 ads(I2C_ADDR::ADC);
+    uint64_t begin_us = HostSim::now();
+    ads.readADC_Differential_0_1();
+    const uint64_t clean_us = HostSim::now() - begin_us;
+    HostSim::injectI2cFault(I2C_ADDR::ADC, HostSim::E_I2cFault::STRETCH, 3, 25000);
+    begin_us = HostSim::now();
+    ads.readADC_Differential_0_1();
+    const uint64_t stretched_us = HostSim::now() - begin_us;
+    HostSim::injectI2cFault(I2C_ADDR::ADC, HostSim::E_I2cFault::NONE, 0);
+    const bool ok = clean_us <= ADS1115_SAMPLE_LIMIT_US && stretched_us <= ADS1115_SAMPLE_LIMIT_US;
+    printf("   ADS1115 sample (outside execute()): clean %6lluus  all 3 transfers stretched 25ms %6lluus"
+           "  limit:%6lluus  %s\n", static_cast<unsigned long long>(clean_us), static_cast<unsigned long long>(stretched_us),
+           static_cast<unsigned long long>(ADS1115_SAMPLE_LIMIT_US), ok ? "PASS" : "FAIL");
+    failures += ok ? 0 : 1;
+    return failures;
+}
+
+int runDeviceErrorCase(Measurement& measurement){
+    printf("2. ADC does not respond during a measurement\n");
+    measurement.setMode(Measurement::E_Modes::CONTINUOUS);
+    measurement.setCommand(Measurement::E_Command::START);
+    catchUp(measurement);
+
+    HostSim::detachI2c(I2C_ADDR::ADC);
+    const uint64_t begin_us = HostSim::now();
+    measurement.executeMeasurement();
+    const uint64_t elapsed_us = HostSim::now() - begin_us;
+    const bool sensor_error = measurement.isSensorError();
+    const bool device_error = measurement.isDeviceError();
+    const bool failed = measurement.haveFailedMesasurement();
+    HostSim::attachI2c(I2C_ADDR::ADC, &adc);
+    catchUp(measurement);
+
+    const bool ok = device_error && !sensor_error && failed;
+    printf("   device_error:%d sensor_error:%d failed:%d  aborted after %.1fms  %s\n",
+           device_error, sensor_error, failed, elapsed_us / 1000.0, ok ? "PASS" : "FAIL");
+    HostSim::advance(I2cBusRecovery::FAILED_RETRY_INTERVAL_MS * 1000ULL);
+    catchUp(measurement);
+    return ok ? 0 : 1;
+}
+
+int runOutageCase(Measurement& measurement){
+    constexpr uint64_t OUTAGE_US = 3000000;
+    printf("3. ADC outage %.1fs in continuous mode (restart after each failure)\n", OUTAGE_US / 1e6);
+    measurement.setMode(Measurement::E_Modes::CONTINUOUS);
+    measurement.setCommand(Measurement::E_Command::START);
+    catchUp(measurement);
+
+    // 1回は正常に計測しておく
+    const uint64_t setup_us = HostSim::now();
+    while (measurement.getResultTime() <= setup_us / 1000){
+        loopOnce(measurement);
+    }
+
+    HostSim::detachI2c(I2C_ADDR::ADC);
+    const uint64_t outage_begin_us = HostSim::now();
+    uint32_t failed_count = 0;
+    uint32_t device_errors = 0;
+    uint32_t sensor_errors = 0;
+    uint64_t max_loop_us = 0;
+    uint64_t restored_us = 0;
+    while (true){
+        if (restored_us == 0 && HostSim::now() - outage_begin_us >= OUTAGE_US){
+            HostSim::attachI2c(I2C_ADDR::ADC, &adc);
+            restored_us = HostSim::now();
+        }
+        const uint64_t loop_begin_us = HostSim::now();
+        const bool measured = measurement.shouldMeasure();
+        loopOnce(measurement);
+        if (measured && restored_us == 0){
+            max_loop_us = (HostSim::now() - loop_begin_us > max_loop_us) ? HostSim::now() - loop_begin_us : max_loop_us;
+        }
+        device_errors += measurement.isDeviceError() ? 1 : 0;
+        sensor_errors += measurement.isSensorError() ? 1 : 0;
+        if (measurement.haveFailedMesasurement()){
+            failed_count++;
+            // 状態遷移(statemachine)の代わりに計測を再開する
+            measurement.setCommand(Measurement::E_Command::START);
+            catchUp(measurement);
+        }
+        if (restored_us != 0 && measurement.getResultTime() >= restored_us / 1000){
+            break;
+        }
+    }
+    const double latency_ms = (measurement.getResultTime() - restored_us / 1000.0);
+    const double bound_ms = I2cBusRecovery::FAILED_RETRY_INTERVAL_MS + CONT_MEAS_INTERVAL * 10.0 + 300.0;
+    const bool ok = (latency_ms <= bound_ms) && (sensor_errors == 0) && (device_errors == failed_count);
+    printf("   failed measurements:%u device_error:%u sensor_error:%u  longest failed measurement:%.1fms\n",
+           failed_count, device_errors, sensor_errors, max_loop_us / 1000.0);
+    printf("   ADC health after outage:%u  result %.0fms after ADC came back  bound:%.0fms  %s\n",
+           static_cast<unsigned>(I2cRecovery.getHealth(I2C_ADDR::ADC)), latency_ms, bound_ms, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+}   // namespace
+
+int main(void){
+    HostSim::reset();
+    attachDevices();
+    Wire.begin();
+    I2cClock.begin(&Wire);
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+
+    // センサ長36inch、液面約50%になる読み値
+    parameters.sensor_length = 36;
+    parameters.timer_period = 0;
+    parameters.adc_err_comp_diff_0_1 = 1.0;
+    parameters.adc_err_comp_diff_2_3 = 1.0;
+    parameters.adc_OFS_comp_diff_0_1 = 0;
+    parameters.adc_OFS_comp_diff_2_3 = 0;
+    parameters.current_set_default = 750;
+    parameters.vmon_da_offset = 0;
+    adc.differential[0] = 10158;    // センサ両端の電圧
+    adc.differential[1] = 24000;    // 電流 75mA
+
+    Measurement measurement(&parameters);
+    const uint16_t init_error = measurement.init();
+    next_tick_us = HostSim::now() + CLK_US;
+    if (init_error != 0){
+        printf("init error:%u\n", init_error);
+        return 1;
+    }
+
+    int failures = 0;
+    failures += runStallCases();
+    failures += runDeviceErrorCase(measurement);
+    failures += runOutageCase(measurement);
+    printf("max execute() stall over the run: %uus\n", I2cRecovery.getMaxStallTime());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/**************************************************************************/
+/*!
+ * @file sim_measurement_cycle.cpp
+ * @brief 1回計測の1サイクルの時間とI2Cバスの時間を、100kHz固定とI2cBusClockで比べる
+ * @par
+ *    extras/host/arduino のスタブでMeasurement, EhLcdをそのまま動かす。時間は仮想時間。
+ *    1回計測（MANUAL）をSTARTから終了（haveFinishedMeasurement()）まで動かし、結果をLCDに表示し終えるまでを1サイクルとする。
+ *    メインループと同じく、shouldMeasure()ならexecuteMeasurement()を呼び、CLKごとにMeasurementとEhLcdのclk_in()を呼ぶ。
+ *      100kHz:      I2cClock.begin()を呼ばない  バスはArduinoの初期値（100kHz）のまま
+ *      I2cBusClock: I2cClock.begin()の後  計測用ICは共通の最高クロック、LCDだけ100kHz
+ *    サイクルの時間、I2Cバスを使った時間（デバイスごと）、トランザクション数、クロックの切り替え回数、
+ *    1回のexecuteMeasurement()の最長の時間を出す。
+ *    1. 両方で同じ計測値が得られ、LCDに表示されること
+ *    2. I2cBusClockの方が計測用ICのバスの時間が短く、LCDのバスの時間は同じ（100kHz）であること
+ *    I2cClockはグローバルで、begin()を取り消せないので、100kHzを先に動かす。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src sim_measurement_cycle.cpp arduino/HostSim.cpp \
+ *          ../../src/eh_LCD.cpp ../../src/measurement.cpp ../../src/DAC80501.cpp ../../src/MCP4725.cpp \
+ *          ../../src/MCP23008.cpp ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostDevices.h"
+#include "eh_LCD.h"
+#include "measurement.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// サイクルの上限 [us]  これを超えたら打ち切る
+constexpr uint64_t CYCLE_LIMIT_US = 60000000;
+
+// センサ長 [inch]
+constexpr uint8_t SENSOR_LENGTH = 36;
+
+HostSim::Ads1115 adc;
+HostSim::Mcp23008 pio;
+HostSim::GroveLcd lcd_model;
+
+// バスの時間を出すデバイス
+struct Device{
+    uint16_t address;
+    const char* name;
+};
+const Device DEVICES[] = {
+    { I2C_ADDR::ADC, "ADS1115" },
+    { I2C_ADDR::PIO, "MCP23008" },
+    { I2C_ADDR::CURRENT_ADJ, "MCP4725" },
+    { I2C_ADDR::V_MON, "DAC80501" },
+    { I2C_ADDR::LCD, "LCD" }
+};
+constexpr size_t DEVICE_COUNT = sizeof(DEVICES) / sizeof(DEVICES[0]);
+
+/// @brief 1サイクルの結果
+struct CycleResult{
+    bool finished;
+    uint16_t level;
+    bool shown;                 // 計測値がLCDに表示された
+    uint64_t cycle_us;          // STARTからLCDに表示し終えるまで
+    uint64_t max_execute_us;    // 1回のexecuteMeasurement()の最長
+    uint32_t executions;        // executeMeasurement()の回数
+    uint32_t switches;          // クロックの切り替え回数
+    HostSim::I2cStats total;
+    HostSim::I2cStats devices[DEVICE_COUNT];
+};
+
+void attachDevices(void){
+    HostSim::reset();
+    HostSim::attachI2c(I2C_ADDR::ADC, &adc);
+    HostSim::attachI2c(I2C_ADDR::PIO, &pio);
+    HostSim::attachI2c(I2C_ADDR::CURRENT_ADJ);
+    HostSim::attachI2c(I2C_ADDR::V_MON);
+    HostSim::attachI2c(I2C_ADDR::LCD, &lcd_model);
+    HostSim::attachI2c(RGB_ADDRESS);
+    Wire.begin();
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+    // 液面約50%になる読み値
+    adc.differential[0] = 10158;
+    adc.differential[1] = 24000;
+}
+
+void setDefaults(Measurement::MesasUintParameters& parameters){
+    parameters.sensor_length = SENSOR_LENGTH;
+    parameters.timer_period = 60;
+    parameters.adc_err_comp_diff_0_1 = 1.0;
+    parameters.adc_err_comp_diff_2_3 = 1.0;
+    parameters.adc_OFS_comp_diff_0_1 = 0;
+    parameters.adc_OFS_comp_diff_2_3 = 0;
+    parameters.current_set_default = 750;
+    parameters.vmon_da_offset = 0;
+}
+
+/// @brief 液面の表示（LCDの2行目）が計測値と一致するか
+bool shows(const uint16_t level){
+    char shown[HostSim::GroveLcd::COLUMNS + 1];
+    char expected[8];
+    lcd_model.text(10, 1, 5, shown);
+    snprintf(expected, sizeof(expected), "%3u.%u", level / 10, level % 10);
+    return strcmp(shown, expected) == 0;
+}
+
+/*!
+ * @brief 1回計測の1サイクルを動かす
+ * @param managed True:I2cClock.begin()を呼ぶ  False:100kHzのまま
+ */
+CycleResult runCycle(const bool managed){
+    attachDevices();
+    if (managed){
+        I2cClock.begin(&Wire);
+    }
+    Measurement::MesasUintParameters parameters;
+    setDefaults(parameters);
+    Measurement measurement(&parameters);
+    EhLcd lcd;
+    measurement.init();
+    lcd.init();
+    lcd.setSensorlength(SENSOR_LENGTH);
+    lcd.setTimerperiod(parameters.timer_period);
+    lcd.setMeasMode(EhLcd::E_Modes::MANUAL);
+    lcd.writeFrame();
+    lcd.activateDisplay(true);
+
+    // 起動時の表示を送り終えてから数える
+    uint64_t next_tick_us = HostSim::now() + CLK_US;
+    for (uint32_t tick = 0; tick < 100; tick++){
+        HostSim::advance(next_tick_us - HostSim::now());
+        lcd.clk_in();
+        next_tick_us += CLK_US;
+    }
+    HostSim::clearI2cStats();
+    const uint32_t switches = I2cClock.getSwitchCount();
+
+    CycleResult result = {};
+    const uint64_t start_us = HostSim::now();
+    measurement.setMode(Measurement::E_Modes::MANUAL);
+    measurement.setCommand(Measurement::E_Command::START);
+    while (!result.shown && HostSim::now() - start_us < CYCLE_LIMIT_US){
+        if (measurement.shouldMeasure()){
+            const uint64_t begin_us = HostSim::now();
+            measurement.executeMeasurement();
+            const uint64_t us = HostSim::now() - begin_us;
+            result.max_execute_us = (us > result.max_execute_us) ? us : result.max_execute_us;
+            result.executions++;
+        } else if (next_tick_us > HostSim::now()){
+            HostSim::advance(next_tick_us - HostSim::now());
+        }
+        while (HostSim::now() >= next_tick_us){
+            measurement.clk_in();
+            lcd.setVacateI2Cbus(measurement.shouldVacateI2Cbus());
+            lcd.clk_in();
+            next_tick_us += CLK_US;
+            if (measurement.haveFinishedMeasurement()){
+                result.finished = true;
+                result.level = measurement.getResult();
+                lcd.setLevel(result.level);
+                lcd.setBargraph(result.level);
+            }
+            if (result.finished && shows(result.level)){
+                result.shown = true;
+                result.cycle_us = HostSim::now() - start_us;
+                break;
+            }
+        }
+    }
+    result.switches = I2cClock.getSwitchCount() - switches;
+    result.total = HostSim::i2cTotal();
+    for (size_t i = 0; i < DEVICE_COUNT; i++){
+        result.devices[i] = HostSim::i2cStats(DEVICES[i].address);
+    }
+    return result;
+}
+
+void printResult(const char* name, const CycleResult& r){
+    printf("   %-12s cycle %7.1fms  level %4u  bus %6.2fms in %4u transactions  longest executeMeasurement() %5.2fms"
+           " (%u calls)  clock switches %u\n",
+           name, r.cycle_us / 1000.0, r.level, r.total.busy_us / 1000.0, r.total.transactions, r.max_execute_us / 1000.0,
+           r.executions, r.switches);
+    printf("   %-12s", "");
+    for (size_t i = 0; i < DEVICE_COUNT; i++){
+        printf("  %s %.2fms", DEVICES[i].name, r.devices[i].busy_us / 1000.0);
+    }
+    printf("\n");
+}
+
+}   // namespace
+
+int main(void){
+    printf("single measurement cycle (MANUAL, sensor %uinch): START to the result shown on the LCD, virtual time\n",
+           SENSOR_LENGTH);
+    const CycleResult fixed = runCycle(false);
+    const CycleResult managed = runCycle(true);
+    printResult("100kHz", fixed);
+    printResult("I2cBusClock", managed);
+
+    // 1. 同じ計測値が得られ、表示されること
+    const bool result_ok = fixed.shown && managed.shown && fixed.level == managed.level && fixed.level != 0;
+    printf("1. same result shown on the LCD  %s\n", result_ok ? "PASS" : "FAIL");
+
+    // 2. 計測用ICのバスの時間が短く、LCDは100kHzのまま
+    uint64_t fixed_meas_us = 0;
+    uint64_t managed_meas_us = 0;
+    for (size_t i = 0; i < DEVICE_COUNT; i++){
+        if (DEVICES[i].address != I2C_ADDR::LCD){
+            fixed_meas_us += fixed.devices[i].busy_us;
+            managed_meas_us += managed.devices[i].busy_us;
+        }
+    }
+    const HostSim::I2cStats& fixed_lcd = fixed.devices[DEVICE_COUNT - 1];
+    const HostSim::I2cStats& managed_lcd = managed.devices[DEVICE_COUNT - 1];
+    const bool bus_ok = managed_meas_us < fixed_meas_us
+        && managed_lcd.busy_us * fixed_lcd.wire_bytes == fixed_lcd.busy_us * managed_lcd.wire_bytes;
+    printf("2. measurement ICs bus time %.2fms -> %.2fms, LCD %.2fms -> %.2fms, cycle %.1fms -> %.1fms  %s\n",
+           fixed_meas_us / 1000.0, managed_meas_us / 1000.0, fixed_lcd.busy_us / 1000.0, managed_lcd.busy_us / 1000.0,
+           fixed.cycle_us / 1000.0, managed.cycle_us / 1000.0, bus_ok ? "PASS" : "FAIL");
+    return (result_ok && bus_ok) ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+/**************************************************************************/
+/*!
+ * @file sim_multidrop.cpp
+ * @brief 半二重RS-485バスのシミュレーションでMultidropPollerとIotGatewayの子局を動かし、全子局の更新周期を測る
+ * @par
+ *    extras/host/arduino のスタブで、setMultidrop()したIotGatewayを子局の数だけそのまま動かす。時間は仮想時間 [us]。
+ *    子局はそれぞれの位相の10ms周期でpublish()とclk_in()を行う（receiveMultidrop(), handleRequest(), releaseBus()）。
+ *    バスに出たバイトは、親局と全ての子局のUART（inject()）に届く。DEはdigitalWrite()されたピンの値で見て、
+ *    DEがHIGHの子局がいる間に他が送信すると衝突として数え、そのフレームは壊れる。
+ *      1. 応答しない子局を除き、タイムアウト・衝突・フレームエラーがないこと
+ *      2. 応答の液面が、その子局が応答を送ったCLKでpublish()した値と一致すること
+ *    turnaround 0（応答を受けたら直ちに次の要求）は比較のためのもの。応答した子局のDEは次のCLKまでHIGHなので衝突する
+ *
+ *    MultidropPollerは1台ずつ要求して応答を待つ（stop-and-wait）。先に複数の子局へ要求を送っておくことはできない
+ *      - 1対の半二重のバスで、同時に送れるのは1台だけ
+ *      - 子局はそれぞれのCLK（位相は揃っていない）で応答を送り始めるので、要求中の子局が2台あると応答が重なる
+ *      - 応答した子局は、送り終えた後の最初のCLKまでDEをHIGHにしているので、その間は次の要求も送れない
+ *    子局が時刻を揃えてスロットで応答するには、子局のファームウエアの変更が必要になる
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src sim_multidrop.cpp MultidropPoller.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ *    例: ./a.out [子局数=32] [baud=9600] [応答しない子局数=2] [秒数=60]
+ */
+/**************************************************************************/
+
+#include <stdlib.h>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+#include <Arduino.h>
+#include "IotGateway.h"
+#include "MultidropPoller.h"
+
+namespace {
+
+// 子局のCLK周期 [us]
+constexpr uint64_t CLK_PERIOD_US = 10000;
+
+// 子局のDEピン  最初の子局から順に使う（I2CのSDA, SCLのピンを避ける）
+constexpr uint32_t FIRST_DE_PIN = 16;
+
+// シミュレーションできる子局の数  ピンの数まで
+constexpr int MAX_UNITS = static_cast<int>(HostSim::PIN_COUNT - FIRST_DE_PIN);
+
+/*!
+ * @brief 半二重バスと子局（IotGateway）
+ */
+class SimBus : public MultidropPoller::Bus {
+    public:
+    struct SimNode{
+        std::unique_ptr<IotGateway> gateway;
+        uint8_t address;
+        uint32_t de_pin;
+        bool alive;
+        uint64_t next_tick_us;
+        uint16_t level;
+        uint64_t line_us;               // UARTが送り出した最後のbyteが線路に出終わる時刻
+        std::deque<uint16_t> sent_levels;   // 壊れずに送った応答の液面  親局が受けた順に照合する
+    };
+
+    SimBus(const int units, const int dead, const uint32_t baud, std::mt19937& rng)
+        : byte_us(10.0e6 / baud){
+        for (int i = 0; i < units; i++){
+            SimNode node;
+            node.gateway.reset(new IotGateway(0, 1));
+            node.address = i + 1;
+            node.de_pin = FIRST_DE_PIN + i;
+            node.alive = i < units - dead;
+            node.next_tick_us = HostSim::now() + rng() % CLK_PERIOD_US;
+            node.level = rng() % 1000;
+            node.line_us = 0;
+            node.gateway->begin(baud);
+            node.gateway->setMultidrop(node.address, node.de_pin);
+            sim_nodes.push_back(std::move(node));
+        }
+    };
+
+    void send(const uint8_t* data, const size_t length) override {
+        const uint64_t now = HostSim::now();
+        const uint64_t end = now + static_cast<uint64_t>(ceil(length * byte_us));
+        master_until_us = end;
+        // 子局のDEがHIGHの間に送ると、そのフレームは壊れる
+        bool collided = false;
+        for (const SimNode& node : sim_nodes){
+            collided = collided || HostSim::getPin(node.de_pin) == HIGH;
+        }
+        collisions += collided ? 1 : 0;
+        std::vector<uint8_t> frame(data, data + length);
+        if (collided){
+            frame[0] ^= 0x55;
+        }
+        for (SimNode& node : sim_nodes){
+            node.gateway->inject(frame.data(), frame.size());
+        }
+    };
+
+    size_t receive(uint8_t* data, const size_t length) override {
+        size_t count = 0;
+        while (count < length && !rx.empty() && rx.front().first <= HostSim::now()){
+            data[count++] = rx.front().second;
+            rx.pop_front();
+        }
+        return count;
+    };
+
+    uint64_t now(void) override {
+        return HostSim::now();
+    };
+
+    /// @brief 仮想時間を進め、その間の子局のCLKを時刻順に処理する
+    void advance(const uint64_t step_us){
+        const uint64_t target = HostSim::now() + step_us;
+        while (true){
+            SimNode* next = nullptr;
+            for (SimNode& node : sim_nodes){
+                if (node.next_tick_us <= target && (next == nullptr || node.next_tick_us < next->next_tick_us)){
+                    next = &node;
+                }
+            }
+            if (next == nullptr){
+                break;
+            }
+            if (next->next_tick_us > HostSim::now()){
+                HostSim::advance(next->next_tick_us - HostSim::now());
+            }
+            next->next_tick_us += CLK_PERIOD_US;
+            tick(*next);
+        }
+        if (target > HostSim::now()){
+            HostSim::advance(target - HostSim::now());
+        }
+    };
+
+    /// @brief 親局が受けた応答の液面を照合する
+    void verify(const TelemetryRecord& record){
+        SimNode& node = sim_nodes[record.source - 1];
+        if (node.sent_levels.empty() || node.sent_levels.front() != record.level){
+            level_mismatches++;
+        }
+        while (!node.sent_levels.empty() && node.sent_levels.front() != record.level){
+            node.sent_levels.pop_front();
+        }
+        if (!node.sent_levels.empty()){
+            node.sent_levels.pop_front();
+        }
+    };
+
+    /// @brief 子局が捨てた受信フレームの数
+    uint64_t nodeRxErrors(void) const {
+        uint64_t errors = 0;
+        for (const SimNode& node : sim_nodes){
+            errors += node.gateway->getRxErrorCount();
+        }
+        return errors;
+    };
+
+    bool isAlive(const uint8_t address) const {
+        return sim_nodes[address - 1].alive;
+    };
+
+    uint64_t collisions = 0;
+    uint64_t level_mismatches = 0;
+
+    private:
+    const double byte_us;
+    uint64_t master_until_us = 0;
+    std::vector<SimNode> sim_nodes;
+    std::deque<std::pair<uint64_t, uint8_t>> rx;    // (届く時刻, データ)  親局が受ける
+
+    // 子局のCLK  値を更新してclk_in()を呼び、UARTに出たバイトをバスに載せる
+    void tick(SimNode& node){
+        if (!node.alive){
+            return;
+        }
+        node.level = (node.level + 1) % 1000;
+        IotGateway& gateway = *node.gateway;
+        gateway.publish(IotGateway::E_Schema::LEVEL, node.level);
+        gateway.publish(IotGateway::E_Schema::MODE, 0);
+        const size_t before = gateway.transmitted().size();
+        const uint64_t start_us = HostSim::now();
+        gateway.clk_in();
+        const size_t after = gateway.transmitted().size();
+        if (after == before){
+            return;
+        }
+
+        // clk_in()の初めに書き込んだバイトは、1byteの時間ごとに線路に出る
+        const std::vector<uint8_t> frame(gateway.transmitted().begin() + before, gateway.transmitted().end());
+        const uint64_t line_from_us = (node.line_us > start_us) ? node.line_us : start_us;
+        node.line_us = line_from_us + static_cast<uint64_t>(ceil(frame.size() * byte_us));
+        bool collided = master_until_us > line_from_us;
+        for (const SimNode& other : sim_nodes){
+            collided = collided || (&other != &node && HostSim::getPin(other.de_pin) == HIGH);
+        }
+        collisions += collided ? 1 : 0;
+        if (!collided){
+            node.sent_levels.push_back(node.level);
+        }
+        for (size_t i = 0; i < frame.size(); i++){
+            // 衝突したフレームは壊れて届く
+            const uint8_t value = (collided && i == 1) ? frame[i] ^ 0x55 : frame[i];
+            rx.emplace_back(line_from_us + static_cast<uint64_t>(ceil((i + 1) * byte_us)), value);
+        }
+        // 他の子局も応答を受ける（RESPONSE_FLAG付きなので読み捨てる）
+        for (SimNode& other : sim_nodes){
+            if (&other != &node){
+                other.gateway->inject(frame.data(), frame.size());
+            }
+        }
+    };
+};
+
+}   // namespace
+
+int main(int argc, char* argv[]){
+    const int units = (argc > 1) ? atoi(argv[1]) : 32;
+    const uint32_t baud = (argc > 2) ? atoi(argv[2]) : 9600;
+    const int dead = (argc > 3) ? atoi(argv[3]) : 2;
+    const double seconds = (argc > 4) ? atof(argv[4]) : 60.0;
+    if (units < 1 || units > MAX_UNITS || dead < 0 || dead > units){
+        printf("units: 1-%d\n", MAX_UNITS);
+        return 1;
+    }
+
+    const uint64_t byte_us = 10000000ULL / baud;
+    // 要求 + 子局のCLK待ち + 応答（最大長） + 余裕
+    const uint32_t timeout_us = (MultidropFrame::MAX_ENCODED_LENGTH * 2) * byte_us + 2 * CLK_PERIOD_US;
+    const uint32_t turnarounds[] = { static_cast<uint32_t>(CLK_PERIOD_US + 2 * byte_us), 0 };
+
+    printf("units:%d  baud:%u  not responding:%d  simulated:%.0fs  timeout:%uus\n", units, baud, dead, seconds, timeout_us);
+    int failures = 0;
+    for (const uint32_t turnaround_us : turnarounds){
+        HostSim::reset();
+        std::mt19937 rng(1);
+        SimBus bus(units, dead, baud, rng);
+        MultidropPoller poller(bus, timeout_us, turnaround_us);
+        poller.setHandler([&bus](const TelemetryRecord& record){ bus.verify(record); });
+        for (int i = 0; i < units; i++){
+            poller.addNode(i + 1);
+        }
+        const uint64_t end_us = HostSim::now() + static_cast<uint64_t>(seconds * 1e6);
+        while (bus.now() < end_us){
+            poller.service();
+            bus.advance(50);
+        }
+
+        uint64_t responses = 0;
+        uint64_t timeouts = 0;
+        uint64_t alive_timeouts = 0;
+        uint64_t max_response_us = 0;
+        for (const MultidropPoller::Node& node : poller.getNodes()){
+            responses += node.responses;
+            timeouts += node.timeouts;
+            alive_timeouts += bus.isAlive(node.address) ? node.timeouts : 0;
+            max_response_us = (node.max_response_us > max_response_us) ? node.max_response_us : max_response_us;
+        }
+        const MultidropPoller::RoundStat& stat = poller.getRoundStat();
+        printf("turnaround:%6uus  fleet refresh[ms] avg:%.1f min:%.1f max:%.1f  responses:%llu timeouts:%llu "
+               "collisions:%llu frame errors:%llu (nodes:%llu)  max response:%.1fms\n",
+               turnaround_us, stat.count ? stat.total_us / 1000.0 / stat.count : 0.0,
+               stat.count ? stat.min_us / 1000.0 : 0.0, stat.max_us / 1000.0,
+               (unsigned long long)responses, (unsigned long long)timeouts, (unsigned long long)bus.collisions,
+               (unsigned long long)poller.getErrorCount(), (unsigned long long)bus.nodeRxErrors(),
+               max_response_us / 1000.0);
+        if (turnaround_us == 0){
+            printf("   (turnaround 0 is for comparison: the last responder holds DE until its next tick)\n");
+            continue;
+        }
+        const bool clean = alive_timeouts == 0 && bus.collisions == 0 && poller.getErrorCount() == 0
+            && bus.nodeRxErrors() == 0 && responses != 0;
+        printf("   1. no timeouts from responding units, no collisions, no frame errors  %s\n", clean ? "PASS" : "FAIL");
+        printf("   2. level in each response matches the value published at that tick (mismatches:%llu)  %s\n",
+               (unsigned long long)bus.level_mismatches, bus.level_mismatches == 0 ? "PASS" : "FAIL");
+        failures += clean ? 0 : 1;
+        failures += (bus.level_mismatches == 0) ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/**************************************************************************/
+/*!
+ * @file sim_publish_timer.cpp
+ * @brief タイマモードで24時間動かし、IotGatewayのpublish()によるテレメトリのUARTの送信量 [byte/h] を測る
+ * @par
+ *    仮想時間で24時間、毎CLK clk_in()を入れる。タイマ周期は60分で、周期の始めに1回計測する。
+ *    液面は1時間に0.3%ずつ下がり、計測ごとに±0.1%ばらつく。12時間目から10分間センサエラーにする。
+ *    比べる送り方
+ *      fixed 1s:      以前のスケッチ  1秒ごとにaddPayload()で4つの値を入れる（変化がなくても送る）
+ *      publish JSON:  毎CLK publish()で最新の値を渡し、送信条件（デッドバンド、ハートビート、即時）に任せる
+ *      publish BINARY: 同じ送り方をバイナリ形式で
+ *    1. publish()の送信量が固定周期より少ないこと
+ *    2. センサエラーの発生・解除が、そのCLKのうちに送信されること
+ *    3. 計測した液面がそのCLKのうちに送信されること（デッドバンドを超えて変化した場合）
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src sim_publish_timer.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <string>
+#include <Arduino.h>
+#include "IotGateway.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// 1時間・1分のCLK数
+constexpr uint32_t TICKS_PER_HOUR = 360000;
+constexpr uint32_t TICKS_PER_MINUTE = 6000;
+
+// 動かす時間 [h]
+constexpr uint32_t HOURS = 24;
+
+// タイマ周期 [min]
+constexpr uint16_t TIMER_PERIOD = 60;
+
+// タイマモード（Measurement::E_Modes::TIMER）
+constexpr uint16_t MODE_TIMER = 1;
+
+// 以前のスケッチの送信周期 [CLK Cycle]
+constexpr uint32_t FIXED_PERIOD = 100;
+
+// センサエラーの期間 [CLK]
+constexpr uint32_t ERROR_BEGIN = 12 * TICKS_PER_HOUR + 30 * TICKS_PER_MINUTE;
+constexpr uint32_t ERROR_END = ERROR_BEGIN + 10 * TICKS_PER_MINUTE;
+
+constexpr uint32_t BAUD = 115200;
+
+/*!
+ * @brief 送り方
+ */
+enum class E_Method : uint8_t {
+    FIXED = 0,
+    PUBLISH_JSON,
+    PUBLISH_BINARY
+};
+
+/// @brief 1回の結果
+struct Result{
+    double bytes_per_hour;
+    bool error_on_time;     // センサエラーの発生・解除がそのCLKに送られた
+    uint32_t late_levels;   // 計測した液面（デッドバンドを超えた変化）がそのCLKに送られなかった数
+};
+
+/// @brief tickの時点の値
+struct Values{
+    uint16_t level;     // [0.1%]
+    uint16_t remain;    // [min]
+    uint16_t error;
+};
+
+/// @brief 計測した液面  周期の始めに計測する
+uint16_t measuredLevel(const uint32_t period_index){
+    // 90.0%から1時間に0.3%下がる  ±0.1%のばらつき
+    const int32_t noise = static_cast<int32_t>((period_index * 7) % 3) - 1;
+    return static_cast<uint16_t>(900 - 3 * period_index * TIMER_PERIOD / 60 + noise);
+}
+
+Values valuesAt(const uint32_t tick){
+    const uint32_t period_ticks = TIMER_PERIOD * TICKS_PER_MINUTE;
+    const uint32_t period_index = tick / period_ticks;
+    const uint32_t elapsed_min = (tick % period_ticks) / TICKS_PER_MINUTE;
+    return Values{ measuredLevel(period_index), static_cast<uint16_t>(TIMER_PERIOD - elapsed_min),
+                   static_cast<uint16_t>((tick >= ERROR_BEGIN && tick < ERROR_END) ? 1 : 0) };
+}
+
+/// @brief このCLKに送ったフレームにキーと値の組が含まれるか
+/// @note バイナリ形式はCOBSで符号化されているので、フレームが送られたことだけを見る
+bool sentInTick(const std::string& sent, const E_Method method, const char* json_node){
+    if (method != E_Method::PUBLISH_BINARY){
+        return sent.find(json_node) != std::string::npos;
+    }
+    return !sent.empty();
+}
+
+Result run(const E_Method method){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(BAUD);
+    gateway.setFraming(method == E_Method::PUBLISH_BINARY ? IotGateway::E_Framing::BINARY : IotGateway::E_Framing::JSON);
+
+    Result result = { 0, true, 0 };
+    uint64_t bytes = 0;
+    uint16_t last_sent_level = 0xFFFF;
+    const uint32_t ticks = HOURS * TICKS_PER_HOUR;
+    for (uint32_t tick = 0; tick < ticks; tick++){
+        const Values v = valuesAt(tick);
+        if (method == E_Method::FIXED){
+            if (tick % FIXED_PERIOD == 0){
+                gateway.addPayload("level", static_cast<int32_t>(v.level));
+                gateway.addPayload("mode", static_cast<int32_t>(MODE_TIMER));
+                gateway.addPayload("remain", static_cast<int32_t>(v.remain));
+                gateway.addPayload("error", static_cast<int32_t>(v.error));
+            }
+        } else {
+            gateway.publish(IotGateway::E_Schema::LEVEL, v.level);
+            gateway.publish(IotGateway::E_Schema::MODE, MODE_TIMER);
+            gateway.publish(IotGateway::E_Schema::REMAIN, v.remain);
+            gateway.publish(IotGateway::E_Schema::ERROR_FLAGS, v.error);
+        }
+        gateway.clk_in();
+        HostSim::advance(CLK_US);
+
+        const std::string& sent = gateway.transmitted();
+        if (method != E_Method::FIXED){
+            if (tick == ERROR_BEGIN || tick == ERROR_END){
+                const char* node = (tick == ERROR_BEGIN) ? "\"error\":1" : "\"error\":0";
+                result.error_on_time = result.error_on_time && sentInTick(sent, method, node);
+            }
+            const uint16_t change = (v.level > last_sent_level) ? v.level - last_sent_level : last_sent_level - v.level;
+            if (last_sent_level == 0xFFFF || change > 5){
+                char node[24];
+                snprintf(node, sizeof(node), "\"level\":%u", v.level);
+                result.late_levels += sentInTick(sent, method, node) ? 0 : 1;
+                last_sent_level = v.level;
+            } else if (sentInTick(sent, method, "\"level\":")){
+                // ハートビートで送った値
+                last_sent_level = v.level;
+            }
+        }
+        bytes += sent.size();
+        gateway.transmitted().clear();
+    }
+    // 送信リングバッファに残った分
+    while (gateway.getTxQueueDepth() != 0){
+        gateway.pollTx();
+        HostSim::advance(1000);
+    }
+    bytes += gateway.transmitted().size();
+    result.bytes_per_hour = static_cast<double>(bytes) / HOURS;
+    return result;
+}
+
+}   // namespace
+
+int main(void){
+    printf("TIMER mode, period %umin, %uh virtual, level -0.3%%/h, sensor error for 10min at 12:30\n", TIMER_PERIOD, HOURS);
+    const Result fixed = run(E_Method::FIXED);
+    const Result json = run(E_Method::PUBLISH_JSON);
+    const Result binary = run(E_Method::PUBLISH_BINARY);
+
+    printf("                     bytes/hour   vs fixed  error on time  late levels\n");
+    printf("   fixed 1s          %10.0f   %7.3f\n", fixed.bytes_per_hour, 1.0);
+    printf("   publish JSON      %10.0f   %7.3f  %13s  %11u\n", json.bytes_per_hour, json.bytes_per_hour / fixed.bytes_per_hour,
+           json.error_on_time ? "yes" : "NO", json.late_levels);
+    printf("   publish BINARY    %10.0f   %7.3f  %13s  %11u\n", binary.bytes_per_hour, binary.bytes_per_hour / fixed.bytes_per_hour,
+           binary.error_on_time ? "yes" : "NO", binary.late_levels);
+
+    const bool ok = json.bytes_per_hour < fixed.bytes_per_hour && binary.bytes_per_hour < json.bytes_per_hour
+        && json.error_on_time && binary.error_on_time && json.late_levels == 0 && binary.late_levels == 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/**************************************************************************/
+/*!
+ * @file sim_timesync.cpp
+ * @brief TIMEコマンドによる時刻の同期とタイムスタンプの誤差を確認する
+ * @par
+ *    時間は仮想時間 [us]。ホストの時刻を真の時刻とし、計測ユニットのmillis()は水晶の誤差（ドリフト）だけずれる。
+ *    ホストは一定間隔で "TIME <epoch ms>" を送り（送信前にOSの遅れ、1byteごとにbaudの時間）、
+ *    計測ユニットはIotGateway::clk_in()と同じく10ms周期で受信データを読み、CommandParser, TimeSyncで処理する。
+ *    計測はCLKごとに行い、取得時刻のmillis()をTimeSyncでホストの時刻に変換して、真の時刻との差を集計する。
+ *    ドリフトが求まるまで（最初の同期からTimeSync::MIN_DRIFT_INTERVAL_MS + 同期間隔）と、その後に分けて示す。
+ *
+ *    ビルド例:
+ *      g++ -std=c++14 -O2 -I../../src sim_timesync.cpp ../../src/TimeSync.cpp ../../src/CommandParser.cpp
+ *    例: ./sim_timesync [baud=9600]
+ */
+/**************************************************************************/
+
+#include <stdlib.h>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "TimeSync.h"
+#include "CommandParser.h"
+
+namespace {
+
+// 計測ユニットのCLK周期 [ms]  millis()で数える
+constexpr uint32_t CLK_PERIOD_MS = 10;
+
+// 1CLKに読む受信データの最大数  IotGateway::RX_BYTES_PER_TICK（SERIAL_RX_BUFFER_SIZE）
+constexpr size_t RX_BYTES_PER_TICK = 64;
+
+// IotGateway::RX_STAMP_CORRECTION_MS
+constexpr uint32_t RX_STAMP_CORRECTION_MS = 5;
+
+// ホストの時刻の起点 [ms]
+constexpr uint64_t EPOCH_ORIGIN_MS = 1790000000000ULL;
+
+/*!
+ * @brief シナリオ
+ */
+struct Scenario{
+    const char* name;
+    double drift_ppm;           // 計測ユニットの水晶の誤差  正:millis()が進む
+    double wander_ppm;          // 温度によるドリフトの変化（振幅、6時間周期）
+    uint32_t sync_period_s;     // TIMEを送る間隔
+    double host_jitter_ms;      // 書き込みから送信開始までのOSの遅れ（0からこの値まで一様）
+    int64_t host_step_ms;       // 12時間後にホストの時刻をこれだけ飛ばす
+};
+
+/*!
+ * @brief 結果
+ */
+struct Result{
+    double max_error_locked = 0.0;      // ドリフトが求まった後の誤差の最大値 [ms]
+    double max_error_settling = 0.0;    // ドリフトが求まるまで
+    double sum_error_locked = 0.0;
+    uint64_t count_locked = 0;
+    uint32_t syncs = 0;
+    int32_t drift_ppb = 0;
+};
+
+Result run(const Scenario& scenario, const uint32_t baud, std::mt19937& rng){
+    const double byte_us = 10e6 / baud;
+    const double duration_us = 24.0 * 3600e6;
+    const double step_at_us = duration_us / 2;
+    const double settle_us = (TimeSync::MIN_DRIFT_INTERVAL_MS + scenario.sync_period_s * 1000.0) * 1000.0;
+    std::uniform_real_distribution<double> jitter(0.0, scenario.host_jitter_ms * 1000.0);
+
+    TimeSync sync;
+    CommandParser parser;
+    Result result;
+
+    // millis()の起点はホストの時刻の起点とずれる
+    uint32_t millis = 123456;
+    double true_us = 0.0;
+
+    // 送信中のTIMEの行  1文字目の送信開始時刻
+    std::string line;
+    double line_start_us = 0.0;
+    size_t line_read = 0;
+    double next_sync_us = 0.0;
+    uint32_t command_start_ms = 0;
+    double first_sync_us = -1.0;
+
+    while (true_us < duration_us){
+        // CLKはmillis()でCLK_PERIOD_MSごと  真の時間はドリフトの分だけ伸び縮みする
+        const double ppm = scenario.drift_ppm
+            + scenario.wander_ppm * std::sin(2.0 * M_PI * true_us / (6.0 * 3600e6));
+        true_us += CLK_PERIOD_MS * 1000.0 / (1.0 + ppm * 1e-6);
+        millis += CLK_PERIOD_MS;
+        const int64_t host_offset_ms = (true_us >= step_at_us) ? scenario.host_step_ms : 0;
+
+        if (true_us >= next_sync_us && line_read >= line.size()){
+            // ホストは書き込む直前の時刻を送る
+            const double send_us = next_sync_us;
+            const int64_t host_offset = (send_us >= step_at_us) ? scenario.host_step_ms : 0;
+            const uint64_t epoch_ms = EPOCH_ORIGIN_MS + static_cast<uint64_t>(send_us / 1000) + host_offset;
+            line = "TIME " + std::to_string(epoch_ms) + "\r\n";
+            line_start_us = send_us + jitter(rng);
+            line_read = 0;
+            next_sync_us += scenario.sync_period_s * 1e6;
+        }
+
+        // clk_in()  受信
+        for (size_t n = 0; n < RX_BYTES_PER_TICK && line_read < line.size()
+             && line_start_us + (line_read + 1) * byte_us <= true_us; n++){
+            if (!parser.isReceiving()){
+                command_start_ms = millis;
+            }
+            if (parser.feed(static_cast<uint8_t>(line[line_read++]))
+                && parser.getCommand().type == CommandParser::E_Command::TIME){
+                sync.sync(parser.getCommand().epoch_ms, command_start_ms - RX_STAMP_CORRECTION_MS);
+                first_sync_us = (first_sync_us < 0) ? true_us : first_sync_us;
+            }
+        }
+
+        // 計測  取得時刻はこのCLKのmillis()
+        uint64_t timestamp = 0;
+        if (!sync.toEpoch(millis, timestamp)){
+            continue;
+        }
+        // ホストの時刻が飛んでから次の同期までは除く
+        if (scenario.host_step_ms != 0 && true_us >= step_at_us
+            && true_us < step_at_us + scenario.sync_period_s * 1e6 + 100000){
+            continue;
+        }
+        const double truth = EPOCH_ORIGIN_MS + true_us / 1000.0 + host_offset_ms;
+        const double error = std::fabs(static_cast<double>(timestamp) - truth);
+        if (true_us - first_sync_us < settle_us){
+            result.max_error_settling = std::fmax(result.max_error_settling, error);
+        } else {
+            result.max_error_locked = std::fmax(result.max_error_locked, error);
+            result.sum_error_locked += error;
+            result.count_locked++;
+        }
+    }
+    result.syncs = sync.getSyncCount();
+    result.drift_ppb = sync.getDrift();
+    return result;
+}
+
+}   // namespace
+
+int main(int argc, char* argv[]){
+    const uint32_t baud = (argc > 1) ? atoi(argv[1]) : 9600;
+    std::mt19937 rng(7);
+
+    // ドリフトが求まった後の誤差の上限 [ms]
+    //  受信時刻の量子化（CLK周期の半分、補正後）+ 1byteの時間 + OSの遅れ + millis()の切り捨て
+    const double bound_ms = CLK_PERIOD_MS / 2.0 + 10000.0 / baud + 2.0 + 1.0;
+
+    const Scenario scenarios[] = {
+        { "crystal +20ppm, sync 60s",         20.0,   0.0,   60, 2.0, 0 },
+        { "crystal -50ppm, sync 600s",       -50.0,   0.0,  600, 2.0, 0 },
+        { "crystal +100ppm, sync 3600s",     100.0,   0.0, 3600, 2.0, 0 },
+        { "-30ppm +/-5ppm wander, sync 600s", -30.0,  5.0,  600, 2.0, 0 },
+        { "+20ppm, host step +2s, sync 600s",  20.0,  0.0,  600, 2.0, 2000 },
+    };
+
+    printf("baud:%u  CLK:%ums  simulated:24h  bound:%.2fms + wander x sync period (after drift lock)\n", baud, CLK_PERIOD_MS, bound_ms);
+    int failures = 0;
+    for (const Scenario& scenario : scenarios){
+        const Result result = run(scenario, baud, rng);
+        // ドリフトの変化は次の同期まで追従しない
+        const double scenario_bound_ms = bound_ms + scenario.wander_ppm * scenario.sync_period_s * 1e-3;
+        const bool ok = result.max_error_locked <= scenario_bound_ms;
+        printf("%-36s syncs:%5u drift:%9.3fppm  error[ms] settling max:%7.2f  locked max:%5.2f avg:%5.2f bound:%5.2f  %s\n",
+               scenario.name, result.syncs, result.drift_ppb / 1000.0, result.max_error_settling,
+               result.max_error_locked, result.sum_error_locked / result.count_locked, scenario_bound_ms, ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
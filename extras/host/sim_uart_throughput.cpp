@@ -0,0 +1,245 @@
+/**************************************************************************/
+/*!
+ * @file sim_uart_throughput.cpp
+ * @brief IotGatewayの送信リングバッファからUARTへの送り出しの速度を、baudレートを模擬したUARTで測る
+ * @par
+ *    extras/host/arduino のHardwareSerialは、SERIAL_TX_BUFFER_SIZEの送信バッファを1byteの時間(10bit/baud)ごとに送り出す。
+ *    115200baudで、100byteのフレーム（BATCH  まとめずに順に送る）を毎CLK送信リングバッファに入れる（10kB/s）。
+ *    1. clk_in()だけで送る  1CLKに送れるのはUARTの送信バッファの空き（64byte）まで → 6.4kB/sで頭打ち、フレームを捨てる
+ *    2. メインループから1msごとにpollTx()も呼ぶ  線路の速度(11.5kB/s)まで送れる
+ *    -DSERIAL_TX_BUFFER_SIZE=128 でビルドすると、clk_in()だけでも115200baudに足りることを確認できる。
+ *    3. 1回のclk_in(), pollTx()にかかった時間の最大値（UARTのwrite(), flush()でブロックした時間を含む）
+ *       9600baudと115200baudで、CLKの予算(10ms)以内であること  1対1ではブロックしないこと
+ *    4. RS-485（マルチドロップ、Modbus）  応答を送り終える前後にclk_in()を呼び、releaseBus()のflush()が
+ *       シフトレジスタの最後の1byteを待つ場合を含める  1回のclk_in()の最大値が1byteの時間以内（と予算以内）で、
+ *       送り終えてからDEをLOWにするまでが1CLK以内であること
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src sim_uart_throughput.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ */
+/**************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <Arduino.h>
+#include "IotGateway.h"
+#include "MultidropFrame.h"
+#include "Crc16.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// メインループからpollTx()を呼ぶ周期 [us]
+constexpr uint64_t POLL_US = 1000;
+
+constexpr uint32_t BAUD = 115200;
+
+// 1CLKの処理の予算 [us]
+constexpr uint64_t TICK_BUDGET_US = CLK_US;
+
+// RS-485のユニットアドレスとDEピン
+constexpr uint8_t UNIT_ADDRESS = 5;
+constexpr uint32_t DE_PIN = 7;
+
+
+// 1フレームの長さと、動かす時間
+constexpr size_t FRAME_LENGTH = 100;
+constexpr uint32_t TICKS = 1000;    // 10秒
+constexpr uint32_t BUS_TICKS = 2000;    // RS-485  20秒（200回の要求）
+
+struct Result{
+    double delivered_bytes_per_s;
+    uint32_t dropped;
+    uint32_t frames;
+    uint64_t max_clk_us;        // 1回のclk_in()の最大 [us]
+    uint64_t max_poll_us;       // 1回のpollTx()の最大 [us]
+    uint64_t blocked_us;        // UARTでブロックした時間の累計 [us]
+};
+
+/// @brief 1回の呼び出しにかかった時間を測り、最大値を更新する
+template <typename F>
+void timed(uint64_t& max_us, F call){
+    const uint64_t start_us = HostSim::now();
+    call();
+    const uint64_t us = HostSim::now() - start_us;
+    max_us = (us > max_us) ? us : max_us;
+}
+
+Result run(const uint32_t baud, const bool poll){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(baud);
+
+    uint8_t frame[FRAME_LENGTH];
+    memset(frame, 'x', sizeof(frame));
+    frame[FRAME_LENGTH - 1] = '\n';
+
+    Result result = {};
+    for (uint32_t tick = 0; tick < TICKS; tick++){
+        gateway.enqueue(frame, sizeof(frame), IotGateway::E_Priority::BATCH);
+        timed(result.max_clk_us, [&gateway](){ gateway.clk_in(); });
+        for (uint64_t t = POLL_US; t < CLK_US; t += POLL_US){
+            HostSim::advance(POLL_US);
+            if (poll){
+                timed(result.max_poll_us, [&gateway](){ gateway.pollTx(); });
+            }
+        }
+        HostSim::advance(POLL_US);
+    }
+    const double seconds = HostSim::now() / 1e6;
+    result.delivered_bytes_per_s = gateway.transmitted().size() / seconds;
+    result.dropped = gateway.getTxDroppedCount(IotGateway::E_Priority::BATCH);
+    result.frames = TICKS;
+    result.blocked_us = gateway.blockedTime();
+    return result;
+}
+
+/// @brief RS-485の結果
+struct BusResult{
+    uint32_t requests;
+    uint32_t responses;         // DEをLOWにして終えた応答
+    uint32_t flushed;           // releaseBus()がflush()で待った応答
+    uint64_t max_clk_us;        // 1回のclk_in()の最大 [us]
+    uint64_t max_hold_us;       // 応答を送り終えてからDEをLOWにするまでの最大 [us]
+    uint64_t blocked_us;        // flush()で待った時間の累計 [us]
+};
+
+/*!
+ * @brief RS-485で要求に応答させ、clk_in()の時間を測る
+ * @param baud ボーレート
+ * @param modbus True:Modbus  False:マルチドロップ
+ * @note 要求は100msごと（9600baudでも最長の応答が次の要求までに終わる）  Modbusは読むレジスタ数を変える
+ *       応答はclk_in()で書き込むので、CLKが一定だと送り終える時刻とCLKの位相は応答の長さで決まり、
+ *       releaseBus()が最後の1byteの送信中に呼ばれる場合がほとんど起きない（115200baudでは起きない）。
+ *       loop()から呼ぶ時の遅れとして、応答を送り終える時刻を含むCLKだけを、その時刻の前後1byteの範囲でずらす。
+ */
+BusResult runBus(const uint32_t baud, const bool modbus){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(baud);
+    if (modbus){
+        gateway.setModbus(UNIT_ADDRESS, DE_PIN);
+    } else {
+        gateway.setMultidrop(UNIT_ADDRESS, DE_PIN);
+    }
+    for (uint16_t i = 0; i < ModbusSlave::REGISTER_COUNT; i++){
+        gateway.setModbusRegister(static_cast<ModbusSlave::E_Register>(i), 1000 + i);
+    }
+    gateway.publish(IotGateway::E_Schema::LEVEL, 815);
+    gateway.publish(IotGateway::E_Schema::MODE, 0);
+    gateway.publish(IotGateway::E_Schema::REMAIN, 30);
+    gateway.publish(IotGateway::E_Schema::ERROR_FLAGS, 0);
+
+    std::mt19937 rng(20261019);
+    std::uniform_real_distribution<double> phase(-1.0, 1.0);
+    BusResult result = {};
+    bool de = false;
+    bool shift = false;         // 送り終える時刻に合わせるCLKがまだ来ていない
+    double done_us = 0.0;       // 応答を送り終える時刻
+    uint64_t tick_us = 0;
+    for (uint32_t tick = 0; tick < BUS_TICKS; tick++){
+        if (tick % 10 == 0){
+            // 要求  Modbusはレジスタの読み出し、マルチドロップはPOLL
+            uint8_t request[MultidropFrame::MAX_ENCODED_LENGTH];
+            size_t request_length = 0;
+            if (modbus){
+                const uint8_t count = 1 + result.requests % ModbusSlave::REGISTER_COUNT;
+                const uint8_t read[] = { UNIT_ADDRESS, 0x03, 0x00, 0x00, 0x00, count };
+                memcpy(request, read, sizeof(read));
+                const uint16_t crc = Crc16::modbus(read, sizeof(read));
+                request[sizeof(read)] = crc & 0xFF;
+                request[sizeof(read) + 1] = crc >> 8;
+                request_length = sizeof(read) + 2;
+            } else {
+                request_length = MultidropFrame::encode(UNIT_ADDRESS, MultidropFrame::FUNCTION_POLL, nullptr, 0, request);
+            }
+            gateway.inject(request, request_length);
+            result.requests++;
+        }
+        HostSim::advance(tick_us - HostSim::now());
+        timed(result.max_clk_us, [&gateway](){ gateway.clk_in(); });
+        const bool now_de = HostSim::getPin(DE_PIN) == HIGH;
+        if (de && !now_de){
+            const uint64_t hold_us = HostSim::now() - static_cast<uint64_t>(ceil(done_us));
+            result.max_hold_us = (hold_us > result.max_hold_us) ? hold_us : result.max_hold_us;
+            result.flushed += (tick_us < done_us) ? 1 : 0;
+            result.responses++;
+        }
+        // 次のCLK  応答を送り終える時刻を含むCLKは、その時刻の前後1byteにずらす
+        uint64_t next_us = tick_us + CLK_US;
+        if (!de && now_de){
+            done_us = HostSim::now() + gateway.pending() * gateway.byteTime();
+            shift = true;
+        }
+        if (shift && now_de && next_us + gateway.byteTime() > done_us){
+            const double shifted_us = done_us + phase(rng) * gateway.byteTime();
+            next_us = (shifted_us > HostSim::now()) ? static_cast<uint64_t>(shifted_us) : HostSim::now();
+            shift = false;
+        }
+        de = now_de;
+        // clk_in()でブロックした分は、次のCLKの前に終わる
+        tick_us = (next_us > HostSim::now()) ? next_us : HostSim::now();
+    }
+    result.blocked_us = gateway.blockedTime();
+    return result;
+}
+
+}   // namespace
+
+int main(void){
+    const double wire_bytes_per_s = BAUD / 10.0;
+    const double offered = FRAME_LENGTH * 1e6 / CLK_US;
+    printf("%ubaud (line %.0fB/s), UART TX buffer %zuB, offered %.0fB/s (%zuB frame every tick) for %.0fs\n",
+           BAUD, wire_bytes_per_s, HardwareSerial::TX_BUFFER_SIZE, offered, FRAME_LENGTH, TICKS * CLK_US / 1e6);
+
+    const Result tick_only = run(BAUD, false);
+    const Result polled = run(BAUD, true);
+
+    // clk_in()だけの上限  1CLKにUARTの送信バッファとシフトレジスタの分
+    const double tick_cap = (HardwareSerial::TX_BUFFER_SIZE + 1) * 1e6 / CLK_US;
+    const double expected_tick_only = (tick_cap < offered) ? tick_cap : offered;
+    printf("   1. clk_in() only:           delivered %6.0fB/s  dropped %4u/%u frames  (cap %.0fB/s)\n",
+           tick_only.delivered_bytes_per_s, tick_only.dropped, tick_only.frames, tick_cap);
+    printf("   2. clk_in() + pollTx()/1ms: delivered %6.0fB/s  dropped %4u/%u frames\n",
+           polled.delivered_bytes_per_s, polled.dropped, polled.frames);
+
+    bool ok = (tick_only.delivered_bytes_per_s <= expected_tick_only * 1.02)
+        && (polled.dropped == 0) && (polled.delivered_bytes_per_s >= offered * 0.98);
+    printf("   %s\n", ok ? "PASS" : "FAIL");
+    int failures = ok ? 0 : 1;
+
+    // 1回の呼び出しの時間  送信リングバッファが溢れるほど入れても、送るのはUARTの送信バッファの空きまで
+    printf("3. worst call time (point to point, %zuB frame every tick), budget %.0fms\n", FRAME_LENGTH, TICK_BUDGET_US / 1000.0);
+    const uint32_t bauds[] = { 9600, BAUD };
+    for (const uint32_t baud : bauds){
+        const Result r = (baud == BAUD) ? polled : run(baud, true);
+        ok = r.max_clk_us <= TICK_BUDGET_US && r.max_poll_us <= TICK_BUDGET_US && r.blocked_us == 0;
+        printf("   %6ubaud: max clk_in() %.3fms  max pollTx() %.3fms  UART blocked %.3fms  %s\n", baud,
+               r.max_clk_us / 1000.0, r.max_poll_us / 1000.0, r.blocked_us / 1000.0, ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    }
+
+    // RS-485  releaseBus()のflush()はシフトレジスタの1byteだけ待つ
+    printf("4. RS-485: worst clk_in() including releaseBus() flush(), a request every 10 ticks\n");
+    for (const uint32_t baud : bauds){
+        const uint64_t byte_us = static_cast<uint64_t>(ceil(10.0e6 / baud));
+        for (uint8_t modbus = 0; modbus < 2; modbus++){
+            const BusResult r = runBus(baud, modbus != 0);
+            ok = r.responses == r.requests && r.flushed != 0 && r.blocked_us != 0
+                && r.max_clk_us <= byte_us && r.max_clk_us <= TICK_BUDGET_US && r.max_hold_us <= CLK_US;
+            printf("   %6ubaud %-9s responses %u/%u (flushed %u)  max clk_in() %.3fms (1 byte %.3fms)  "
+                   "flush() total %.1fms  max DE hold %.1fms  %s\n",
+                   baud, modbus ? "modbus" : "multidrop", r.responses, r.requests, r.flushed, r.max_clk_us / 1000.0,
+                   byte_us / 1000.0, r.blocked_us / 1000.0, r.max_hold_us / 1000.0, ok ? "PASS" : "FAIL");
+            failures += ok ? 0 : 1;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,470 @@
+/**************************************************************************/
+/*!
+ * @file stress_tx_queue.cpp
+ * @brief IotGatewayの送信リングバッファ（優先度、LEVELのまとめ、捨て方）を参照モデルと比べるストレステスト
+ * @par
+ *    1. 200000回のランダムな操作（enqueue()を長さ・優先度・値の組を変えて、pollTx()を時間を進めて）を行い、
+ *       毎回、送信待ちのフレーム数・空き・優先度ごとの捨てた数・まとめた数を参照モデル（std::deque）と比べる
+ *       UARTに出たバイト列は、参照モデルが送るフレームの内容と一致し、フレームが途中で切れないこと
+ *       入りきらずに捨てた場合は、送信待ちのフレームが何も変わらないこと（まとめる前に入るかを確かめる）
+ *    2. スケッチのpayload  ALARMを指定したエラーのJSONは、後から来るpublish()の周期的な値にまとめられずに届くこと
+ *       優先度を指定しない一定周期のpayloadは、同じキーの組のものだけが最新の1つにまとめられること
+ *    以下は参照モデルを使わず、UARTに出たJSONだけで確かめる
+ *    3. publish()の一部の値だけのフレーム  9600baudで publish(LEVEL,600), clk_in, publish(REMAIN,99), clk_in のあと、
+ *       液面600も届くこと  ランダムにpublish()した値の最後のものが、全ての種類で最後に届いていること
+ *    4. ALARMを捨てない保証  UARTが混んでいても（LEVEL, BATCH, DEBUGで埋まっていても）、UARTの速さ以内の
+ *       ALARMは全て順に届くこと  保証の限界: 送信待ちのALARMだけでリングバッファを超える分は捨てられ、数えられること
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src stress_tx_queue.cpp arduino/HostSim.cpp \
+ *          ../../src/IotGateway.cpp ../../src/JsonWriter.cpp ../../src/CommandParser.cpp ../../src/MultidropFrame.cpp \
+ *          ../../src/ModbusSlave.cpp ../../src/TimeSync.cpp ../../src/Cobs.cpp ../../src/Crc16.cpp ../../src/I2cProfiler.cpp \
+ *          ../../src/statemachine.cpp ../../src/timeswitch.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "IotGateway.h"
+
+namespace {
+
+using E_Priority = IotGateway::E_Priority;
+
+// ランダムな操作の回数
+constexpr uint32_t OPERATIONS = 200000;
+
+// IotGateway::TX_RING_SIZE, TX_FRAME_QUEUE_SIZE
+constexpr size_t RING_SIZE = 1024;
+constexpr size_t FRAME_QUEUE_SIZE = 32;
+
+// フレームの先頭  [MARK][番号 4byte][優先度][番号から作る埋め草...]
+constexpr uint8_t MARK = 0xA5;
+constexpr size_t HEADER_SIZE = 6;
+
+/// @brief 番号と長さからフレームの内容を作る
+std::string makeFrame(const uint32_t id, const size_t length, const E_Priority priority){
+    std::string frame(length, '\0');
+    for (size_t i = 0; i < length; i++){
+        frame[i] = static_cast<char>((id * 31 + i * 7) & 0xFF);
+    }
+    if (length >= HEADER_SIZE){
+        frame[0] = static_cast<char>(MARK);
+        for (uint8_t i = 0; i < 4; i++){
+            frame[1 + i] = static_cast<char>((id >> (8 * i)) & 0xFF);
+        }
+        frame[5] = static_cast<char>(priority);
+    }
+    return frame;
+}
+
+/*!
+ * @brief 送信リングバッファの参照モデル  IotGateway::enqueue()のコメントの仕様をそのまま書いたもの
+ */
+class ReferenceQueue {
+    public:
+    struct Frame{
+        uint32_t id;
+        E_Priority priority;
+        std::string data;
+        uint32_t fields;
+    };
+
+    std::deque<Frame> frames;
+    size_t front_sent = 0;
+    uint32_t dropped[IotGateway::PRIORITY_COUNT] = {};
+    uint32_t coalesced = 0;
+
+    size_t used(void) const {
+        size_t total = 0;
+        for (const Frame& f : frames){
+            total += f.data.size();
+        }
+        return total - front_sent;
+    }
+    size_t free(void) const {
+        return RING_SIZE - used();
+    }
+
+    /// @brief 外せるフレームか  送信中のフレームは外せない
+    bool removable(const size_t index) const {
+        return index != 0 || front_sent == 0;
+    }
+
+    /// @brief まとめられるか  どちらもLEVELで、値の組が分かっていて同じ
+    static bool sameFields(const Frame& frame, const Frame& pending){
+        return frame.priority == E_Priority::LEVEL && pending.priority == E_Priority::LEVEL
+            && frame.fields != IotGateway::FIELDS_UNKNOWN && pending.fields == frame.fields;
+    }
+
+    /// @return True:入れた
+    bool enqueue(const Frame& frame){
+        const uint8_t level = static_cast<uint8_t>(frame.priority);
+        const size_t length = frame.data.size();
+        if (length > RING_SIZE){
+            dropped[level]++;
+            return false;
+        }
+        // LEVELは送信待ちの値の組が同じLEVELを、どの優先度も自分より低いものを外せる
+        size_t reclaimable = free();
+        bool has_victim = false;
+        for (size_t i = 0; i < frames.size(); i++){
+            const bool lower = frames[i].priority > frame.priority;
+            const bool same_level = sameFields(frame, frames[i]);
+            if (removable(i) && (lower || same_level)){
+                reclaimable += frames[i].data.size();
+                has_victim = true;
+            }
+        }
+        if (length > reclaimable || (frames.size() >= FRAME_QUEUE_SIZE && !has_victim)){
+            dropped[level]++;
+            return false;
+        }
+        if (frame.priority == E_Priority::LEVEL){
+            for (size_t i = frames.size(); i-- > 0;){
+                if (removable(i) && sameFields(frame, frames[i])){
+                    frames.erase(frames.begin() + i);
+                    coalesced++;
+                }
+            }
+        }
+        // 優先度の最も低いものの中で一番古いものから捨てる
+        while (length > free() || frames.size() >= FRAME_QUEUE_SIZE){
+            bool evicted = false;
+            for (uint8_t p = IotGateway::PRIORITY_COUNT - 1; p > level && !evicted; p--){
+                for (size_t i = 0; i < frames.size(); i++){
+                    if (removable(i) && static_cast<uint8_t>(frames[i].priority) == p){
+                        frames.erase(frames.begin() + i);
+                        dropped[p]++;
+                        evicted = true;
+                        break;
+                    }
+                }
+            }
+            if (!evicted){
+                return false;   // 来ないはず（入るかは先に確かめている）
+            }
+        }
+        frames.push_back(frame);
+        return true;
+    }
+
+    /// @brief UARTに出たバイトを先頭から取り除く
+    /// @return 出るはずのバイト列
+    std::string consume(size_t count){
+        std::string out;
+        while (count > 0 && !frames.empty()){
+            const size_t left = frames.front().data.size() - front_sent;
+            const size_t n = (count < left) ? count : left;
+            out += frames.front().data.substr(front_sent, n);
+            front_sent += n;
+            count -= n;
+            if (front_sent == frames.front().data.size()){
+                frames.pop_front();
+                front_sent = 0;
+            }
+        }
+        return out;
+    }
+};
+
+/// @brief IotGatewayと参照モデルの状態を比べる
+bool sameState(IotGateway& gateway, const ReferenceQueue& model){
+    bool same = gateway.getTxQueueDepth() == model.frames.size() && gateway.getTxFree() == model.free()
+        && gateway.getTxCoalescedCount() == model.coalesced;
+    for (uint8_t p = 0; p < IotGateway::PRIORITY_COUNT; p++){
+        same = same && gateway.getTxDroppedCount(static_cast<E_Priority>(p)) == model.dropped[p];
+    }
+    return same;
+}
+
+int runStress(void){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(115200);
+    ReferenceQueue model;
+    std::mt19937 rng(45);
+
+    uint32_t mismatches = 0;
+    uint32_t stream_errors = 0;
+    uint32_t rejected = 0;
+    uint32_t rejected_changed = 0;
+    uint32_t enqueued = 0;
+    uint64_t wire_bytes = 0;
+    uint32_t next_id = 0;
+    for (uint32_t op = 0; op < OPERATIONS; op++){
+        if (rng() % 100 < 60){
+            // 優先度  ALARM 10%, LEVEL 40%, BATCH 30%, DEBUG 20%
+            const uint32_t r = rng() % 10;
+            const E_Priority priority = (r < 1) ? E_Priority::ALARM : (r < 5) ? E_Priority::LEVEL
+                                      : (r < 8) ? E_Priority::BATCH : E_Priority::DEBUG;
+            // 長さ  たいていは短く、時々リングバッファに近い・超える長さ
+            const uint32_t s = rng() % 100;
+            const size_t length = (s < 80) ? HEADER_SIZE + rng() % 120 : (s < 97) ? HEADER_SIZE + rng() % 600
+                                : 900 + rng() % 200;
+            // 値の組  LEVELは4通り（不明、液面、残り時間、液面とタイムスタンプ）
+            const uint32_t field_sets[] = { IotGateway::FIELDS_UNKNOWN, 0x01, 0x04, 0x01 | IotGateway::FIELD_TIMESTAMP };
+            const uint32_t fields = (priority == E_Priority::LEVEL) ? field_sets[rng() % 4] : IotGateway::FIELDS_UNKNOWN;
+            const ReferenceQueue::Frame frame = { next_id, priority, makeFrame(next_id, length, priority), fields };
+            next_id++;
+            const size_t depth = gateway.getTxQueueDepth();
+            const size_t free = gateway.getTxFree();
+            const uint32_t coalesced = gateway.getTxCoalescedCount();
+            const bool accepted = model.enqueue(frame);
+            gateway.enqueue(reinterpret_cast<const uint8_t*>(frame.data.data()), frame.data.size(), priority, fields);
+            if (!accepted){
+                rejected++;
+                rejected_changed += (gateway.getTxQueueDepth() != depth || gateway.getTxFree() != free
+                                     || gateway.getTxCoalescedCount() != coalesced) ? 1 : 0;
+            }
+            enqueued += accepted ? 1 : 0;
+        } else {
+            // 0-5ms進めてからUARTに送り出す
+            HostSim::advance(rng() % 5000);
+            gateway.pollTx();
+            std::string& sent = gateway.transmitted();
+            const std::string expected = model.consume(sent.size());
+            stream_errors += (sent == expected) ? 0 : 1;
+            wire_bytes += sent.size();
+            sent.clear();
+        }
+        if (!sameState(gateway, model)){
+            if (mismatches++ < 5){
+                printf("   mismatch at op %u: depth %zu/%zu free %zu/%zu coalesced %u/%u\n", op,
+                       gateway.getTxQueueDepth(), model.frames.size(), gateway.getTxFree(), model.free(),
+                       gateway.getTxCoalescedCount(), model.coalesced);
+            }
+        }
+    }
+    const bool ok = mismatches == 0 && stream_errors == 0 && rejected_changed == 0;
+    printf("1. %u random ops (%u frames offered, %u admitted, %u rejected), %llu bytes on the wire\n",
+           OPERATIONS, next_id, enqueued, rejected, static_cast<unsigned long long>(wire_bytes));
+    printf("   dropped ALARM:%u LEVEL:%u BATCH:%u DEBUG:%u  coalesced:%u\n",
+           gateway.getTxDroppedCount(E_Priority::ALARM), gateway.getTxDroppedCount(E_Priority::LEVEL),
+           gateway.getTxDroppedCount(E_Priority::BATCH), gateway.getTxDroppedCount(E_Priority::DEBUG),
+           gateway.getTxCoalescedCount());
+    printf("   state mismatches:%u  wire stream mismatches:%u  rejected frames that changed the queue:%u  %s\n",
+           mismatches, stream_errors, rejected_changed, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/// @brief 送信リングバッファが空になるまでUARTに送り出す
+void flush(IotGateway& gateway){
+    while (gateway.getTxQueueDepth() != 0){
+        HostSim::advance(1000);
+        gateway.pollTx();
+    }
+}
+
+/// @brief UARTに出たJSONのフレームから、キーの値を順に取り出す
+std::vector<int32_t> valuesOf(const std::string& sent, const char* key){
+    const std::string node = std::string("\"") + key + "\":";
+    std::vector<int32_t> values;
+    for (size_t pos = sent.find(node); pos != std::string::npos; pos = sent.find(node, pos + 1)){
+        values.push_back(std::stol(sent.substr(pos + node.size())));
+    }
+    return values;
+}
+
+int runSketchPayload(void){
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(9600);
+
+    // 長いバッチのフレームを送っている間（9600baudで約0.3秒）に、スケッチのエラーのJSONと、publish()の周期的な値が続く
+    const std::string batch = makeFrame(0, 300, E_Priority::BATCH);
+    gateway.enqueue(reinterpret_cast<const uint8_t*>(batch.data()), batch.size(), E_Priority::BATCH);
+    gateway.publish(IotGateway::E_Schema::LEVEL, 500);
+    gateway.clk_in();
+    gateway.setPayloadPriority(E_Priority::ALARM);
+    gateway.addPayload("error", 1);
+    gateway.addPayload("msg", "sensor open");
+    gateway.sendPayload();
+    // 優先度を指定しない一定周期のスケッチの値  同じキーの組なので最新の1つになる
+    for (uint16_t i = 0; i < 5; i++){
+        HostSim::advance(10000);
+        gateway.publish(IotGateway::E_Schema::LEVEL, 500 + 10 * (i + 1));
+        gateway.addPayload("temp", 20 + i);
+        gateway.addPayload("hum", 40 + i);
+        gateway.sendPayload();
+        gateway.clk_in();
+    }
+    // 別のキーの組のスケッチの値はまとめない
+    gateway.addPayload("door", 1);
+    gateway.sendPayload();
+    // 混ぜた場合  publish()の値と同じフレームに入ったスケッチの値は、publish()だけのフレームにまとめない
+    gateway.addPayload("error", 2);
+    gateway.publish(IotGateway::E_Schema::LEVEL, 600);
+    gateway.clk_in();
+    gateway.publish(IotGateway::E_Schema::LEVEL, 620);
+    HostSim::advance(10000);
+    gateway.clk_in();
+    flush(gateway);
+    const std::string& sent = gateway.transmitted();
+    const bool alarm = sent.find("{\"error\":1,\"msg\":\"sensor open\"}") != std::string::npos;
+    const std::vector<int32_t> temps = valuesOf(sent, "temp");
+    const bool periodic = temps.size() == 1 && temps[0] == 24;
+    const bool other_keys = sent.find("\"door\":1") != std::string::npos;
+    const bool mixed = sent.find("\"error\":2") != std::string::npos;
+    const bool latest = sent.find("\"level\":620") != std::string::npos;
+    const bool ok = alarm && periodic && other_keys && mixed && latest && gateway.getTxCoalescedCount() != 0;
+    printf("2. sketch payloads behind publish() traffic: ALARM JSON %s, periodic untagged %zu of 5 sent (latest %s),"
+           " other keys %s, mixed frame %s, latest level %s, %u LEVEL frames coalesced  %s\n",
+           alarm ? "sent" : "LOST", temps.size(), periodic ? "yes" : "NO", other_keys ? "sent" : "LOST",
+           mixed ? "sent" : "LOST", latest ? "sent" : "LOST", gateway.getTxCoalescedCount(), ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int runPartialUpdates(void){
+    int failures = 0;
+
+    // publish()は変化した値だけを送る  液面だけのフレームを、残り時間だけのフレームで捨ててはいけない
+    //  送信中のバッチがある場合とない場合
+    for (uint8_t with_batch = 0; with_batch < 2; with_batch++){
+        HostSim::reset();
+        IotGateway gateway(0, 1);
+        gateway.begin(9600);
+        if (with_batch){
+            const std::string batch = makeFrame(0, 300, E_Priority::BATCH);
+            gateway.enqueue(reinterpret_cast<const uint8_t*>(batch.data()), batch.size(), E_Priority::BATCH);
+        }
+        gateway.publish(IotGateway::E_Schema::LEVEL, 600);
+        gateway.clk_in();
+        gateway.publish(IotGateway::E_Schema::REMAIN, 99);
+        gateway.clk_in();
+        flush(gateway);
+        const std::string& sent = gateway.transmitted();
+        const bool ok = sent.find("\"level\":600") != std::string::npos && sent.find("\"remain\":99") != std::string::npos;
+        printf("%s publish(LEVEL,600), clk_in, publish(REMAIN,99), clk_in at 9600baud%s: level %s, remain %s,"
+               " coalesced:%u  %s\n", with_batch ? "  " : "3.", with_batch ? " behind a batch" : "",
+               sent.find("\"level\":600") != std::string::npos ? "sent" : "LOST",
+               sent.find("\"remain\":99") != std::string::npos ? "sent" : "LOST", gateway.getTxCoalescedCount(),
+               ok ? "PASS" : "FAIL");
+        failures += ok ? 0 : 1;
+    }
+
+    // ランダムなpublish()  全て変化で送る（デッドバンド0、ハートビートなし）ので、最後に送った値が最後に届く
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(9600);
+    const IotGateway::E_Schema schemas[] = { IotGateway::E_Schema::LEVEL, IotGateway::E_Schema::MODE,
+                                             IotGateway::E_Schema::REMAIN, IotGateway::E_Schema::ERROR_FLAGS };
+    const char* const keys[] = { "level", "mode", "remain", "error" };
+    for (uint8_t i = 0; i < 4; i++){
+        gateway.setPublishPolicy(schemas[i], 0, 0, i == 1 || i == 3);
+    }
+    std::mt19937 rng(42);
+    uint16_t last[4] = {};
+    bool published[4] = {};
+    for (uint32_t tick = 0; tick < 100000; tick++){
+        // 液面・残り時間は時々、モード・エラーはまれに変わる  時々まとめて変わる（UARTが混む）
+        const bool burst = (tick % 1000) < 50;
+        for (uint8_t i = 0; i < 4; i++){
+            const uint32_t percent = (i == 1 || i == 3) ? 1 : (burst ? 60 : 5);
+            if (rng() % 1000 < percent * 10){
+                last[i] = static_cast<uint16_t>(rng() % ((i == 1 || i == 3) ? 4 : 1000));
+                published[i] = true;
+                gateway.publish(schemas[i], last[i]);
+            }
+        }
+        gateway.clk_in();
+        HostSim::advance(10000);
+    }
+    flush(gateway);
+    const std::string& sent = gateway.transmitted();
+    bool ok = gateway.getTxDroppedCount() == 0 && gateway.getTxCoalescedCount() != 0;
+    uint32_t lost = 0;
+    for (uint8_t i = 0; i < 4; i++){
+        const std::vector<int32_t> values = valuesOf(sent, keys[i]);
+        const bool delivered = !published[i] || (!values.empty() && values.back() == last[i]);
+        lost += delivered ? 0 : 1;
+    }
+    ok = ok && lost == 0;
+    printf("   random publish() for 100000 ticks at 9600baud: coalesced:%u dropped:%u,"
+           " fields whose last value was not the last on the wire: %u  %s\n",
+           gateway.getTxCoalescedCount(), gateway.getTxDroppedCount(), lost, ok ? "PASS" : "FAIL");
+    failures += ok ? 0 : 1;
+    return failures;
+}
+
+int runAlarmGuarantee(void){
+    int failures = 0;
+
+    // UARTの速さを超える周期的な値・バッチ・デバッグの中で、0.5秒ごとのアラーム
+    HostSim::reset();
+    IotGateway gateway(0, 1);
+    gateway.begin(9600);
+    const std::string batch = makeFrame(0, 200, E_Priority::BATCH);
+    const std::string debug = makeFrame(0, 100, E_Priority::DEBUG);
+    constexpr uint32_t ALARMS = 60;
+    for (uint32_t tick = 0; tick < ALARMS * 50; tick++){
+        gateway.addPayload("temp", static_cast<int32_t>(tick % 300));
+        gateway.addPayload("hum", static_cast<int32_t>(tick % 100));
+        gateway.sendPayload();
+        gateway.publish(IotGateway::E_Schema::LEVEL, static_cast<uint16_t>(tick % 1000));
+        if (tick % 10 == 0){
+            gateway.enqueue(reinterpret_cast<const uint8_t*>(batch.data()), batch.size(), E_Priority::BATCH);
+        }
+        if (tick % 5 == 0){
+            gateway.enqueue(reinterpret_cast<const uint8_t*>(debug.data()), debug.size(), E_Priority::DEBUG);
+        }
+        if (tick % 50 == 0){
+            gateway.setPayloadPriority(E_Priority::ALARM);
+            gateway.addPayload("alarm", static_cast<int32_t>(tick / 50));
+            gateway.sendPayload();
+        }
+        gateway.clk_in();
+        HostSim::advance(10000);
+    }
+    flush(gateway);
+    std::vector<int32_t> alarms = valuesOf(gateway.transmitted(), "alarm");
+    bool in_order = alarms.size() == ALARMS;
+    for (uint32_t i = 0; i < alarms.size() && in_order; i++){
+        in_order = alarms[i] == static_cast<int32_t>(i);
+    }
+    const uint32_t lower_dropped = gateway.getTxDroppedCount(E_Priority::LEVEL) + gateway.getTxDroppedCount(E_Priority::BATCH)
+        + gateway.getTxDroppedCount(E_Priority::DEBUG);
+    bool ok = in_order && gateway.getTxDroppedCount(E_Priority::ALARM) == 0 && lower_dropped != 0;
+    printf("4. %u ALARM frames at 2/s under backpressure (LEVEL/BATCH/DEBUG dropped:%u coalesced:%u):"
+           " %zu delivered in order, ALARM dropped:%u  %s\n", ALARMS, lower_dropped, gateway.getTxCoalescedCount(),
+           alarms.size(), gateway.getTxDroppedCount(E_Priority::ALARM), ok ? "PASS" : "FAIL");
+    failures += ok ? 0 : 1;
+
+    // 限界  送り出す前に送信待ちのフレーム数を超えるALARMを入れると、超えた分が捨てられる
+    HostSim::reset();
+    IotGateway burst(0, 1);
+    burst.begin(9600);
+    constexpr uint32_t BURST = 100;
+    for (uint32_t i = 0; i < BURST; i++){
+        burst.setPayloadPriority(E_Priority::ALARM);
+        burst.addPayload("alarm", static_cast<int32_t>(i));
+        burst.sendPayload();
+    }
+    const uint32_t dropped = burst.getTxDroppedCount(E_Priority::ALARM);
+    flush(burst);
+    alarms = valuesOf(burst.transmitted(), "alarm");
+    in_order = alarms.size() == FRAME_QUEUE_SIZE;
+    for (uint32_t i = 0; i < alarms.size() && in_order; i++){
+        in_order = alarms[i] == static_cast<int32_t>(i);
+    }
+    ok = in_order && dropped == BURST - FRAME_QUEUE_SIZE;
+    printf("   limit: burst of %u ALARM frames without draining: first %zu delivered in order, %u dropped and counted  %s\n",
+           BURST, alarms.size(), dropped, ok ? "PASS" : "FAIL");
+    failures += ok ? 0 : 1;
+    return failures;
+}
+
+}   // namespace
+
+int main(void){
+    int failures = 0;
+    failures += runStress();
+    failures += runSketchPayload();
+    failures += runPartialUpdates();
+    failures += runAlarmGuarantee();
+    return failures == 0 ? 0 : 1;
+}
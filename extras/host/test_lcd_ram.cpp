@@ -0,0 +1,116 @@
+/**************************************************************************/
+/*!
+ * @file test_lcd_ram.cpp
+ * @brief EhLcdの表示要素が使うRAMを、以前の構成（ItemProperty）と比べる
+ * @par
+ *    以前の構成は表示要素6つとフレーム4つの計10要素をItemPropertyで持ち、バーグラフのCGデータ（40byte）もRAMに置いていた。
+ *      String版:   元の構成  テキストをStringで持つ  Stringは要素ごとにヒープのバッファも持つ
+ *      char[]版:   テキストをchar[TEXT_LENGTH + 1]にし、表示の遅れの計測用にdirty_tickを足したもの
+ *      ItemState:  現在の構成  表示要素6つだけ  位置と幅、フレーム、CGデータはフラッシュに置く
+ *    sizeofはホストとSTM32（32bit ARM）で違うことがあるので、両方を出す。
+ *    STM32duinoのString（WString）は char* buffer, unsigned int capacity, unsigned int len の12byteで、
+ *    ARM版はこれをポインタも32bitの構造体で置き換えて求める。ItemStateとchar[]版はポインタを含まないので同じ値になる。
+ *    1. ItemStateが12byte、表示要素の状態が72byteであること（EhLcdの値）
+ *    2. String版の1要素が24byte（ARM）であること
+ *    3. 現在の構成のRAMが、以前のどちらの構成よりも小さいこと
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src test_lcd_ram.cpp arduino/HostSim.cpp \
+ *          ../../src/eh_LCD.cpp ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <Arduino.h>
+#include "eh_LCD.h"
+
+namespace {
+
+// 以前の構成の要素数  表示要素6つ + フレーム4つ
+constexpr size_t LEGACY_ITEM_COUNT = 10;
+
+// 以前の構成でRAMに置いていたバーグラフのCGデータ  5文字 x 8行
+constexpr size_t LEGACY_GLYPH_BYTES = 5 * 8;
+
+// 表示要素のテキストの最大文字数（EhLcd::TEXT_LENGTHと同じ）
+constexpr size_t TEXT_LENGTH = 8;
+
+/// @brief 32bit ARMでのString（WString）のメンバ  ポインタも32bit
+struct ArmString{
+    uint32_t buffer;
+    uint32_t capacity;
+    uint32_t len;
+};
+
+/// @brief 元の構成の表示要素（eh_LCD.hから写したもの）  Textはテキストの型
+template <typename Text>
+struct LegacyItemProperty{
+    bool mode = false;          // True: Blink False: Normal
+    bool state = true;          // True: 表示   False: 非表示
+    uint8_t count = 1;          // Blink時のカウンタ
+    uint8_t x_location = 0;     // 表示位置X
+    uint8_t y_location = 0;     // 表示位置y
+    Text text;                  // 表示内容
+    bool refresh = true;        // 当該項目の表示内容をリフレッシュするかどうか
+};
+
+/// @brief テキストをchar[]にした後の表示要素（eh_LCD.hから写したもの）
+struct CharItemProperty{
+    bool mode = false;
+    bool state = true;
+    uint8_t count = 1;
+    uint8_t x_location = 0;
+    uint8_t y_location = 0;
+    char text[TEXT_LENGTH + 1] = "";
+    bool refresh = true;
+    uint16_t dirty_tick = 0;    // refreshが設定されたCLKカウント
+};
+
+void printLayout(const char* name, const size_t host_item, const size_t arm_item, const size_t count,
+                 const size_t glyphs, const uint32_t heap_buffers){
+    printf("   %-10s %2zu byte/item (host %2zu)  x %2zu items + %2zu byte glyphs = %3zu byte RAM",
+           name, arm_item, host_item, count, glyphs, arm_item * count + glyphs);
+    if (heap_buffers != 0){
+        printf("  + %u heap buffers", heap_buffers);
+    }
+    printf("\n");
+}
+
+}   // namespace
+
+int main(void){
+    // String版  要素ごとのヒープのバッファの数を数える
+    const uint32_t allocations = HostSim::heapAllocations();
+    LegacyItemProperty<String>* legacy = new LegacyItemProperty<String>[LEGACY_ITEM_COUNT];
+    const uint32_t heap_buffers = HostSim::heapAllocations() - allocations - 1;
+    delete[] legacy;
+
+    EhLcd lcd;
+    const size_t item_state = lcd.getItemStateSize();
+    const size_t item_ram = lcd.getItemRamSize();
+
+    const size_t string_arm = sizeof(LegacyItemProperty<ArmString>);
+    const size_t string_ram = string_arm * LEGACY_ITEM_COUNT + LEGACY_GLYPH_BYTES;
+    const size_t char_ram = sizeof(CharItemProperty) * LEGACY_ITEM_COUNT + LEGACY_GLYPH_BYTES;
+
+    printf("EhLcd per-item RAM, 32-bit ARM (host sizeof in parentheses)\n");
+    printLayout("String", sizeof(LegacyItemProperty<String>), string_arm, LEGACY_ITEM_COUNT, LEGACY_GLYPH_BYTES,
+                heap_buffers);
+    printLayout("char[]", sizeof(CharItemProperty), sizeof(CharItemProperty), LEGACY_ITEM_COUNT, LEGACY_GLYPH_BYTES, 0);
+    printLayout("ItemState", item_state, item_state, item_ram / item_state, 0, 0);
+
+    // 1. 現在の構成
+    const bool state_ok = item_state == 12 && item_ram == 72;
+    printf("1. ItemState %zu byte, display_items %zu byte  %s\n", item_state, item_ram, state_ok ? "PASS" : "FAIL");
+
+    // 2. String版はARMで24byte  5byte + 詰め物3byte + String 12byte + bool + 詰め物3byte
+    const bool string_ok = string_arm == 24 && heap_buffers == LEGACY_ITEM_COUNT;
+    printf("2. String ItemProperty %zu byte on ARM, %u heap buffers  %s\n", string_arm, heap_buffers,
+           string_ok ? "PASS" : "FAIL");
+
+    // 3. 現在の構成が小さいこと
+    const bool ram_ok = item_ram < char_ram && item_ram < string_ram;
+    printf("3. RAM %zu byte (String) / %zu byte (char[]) -> %zu byte  %s\n", string_ram, char_ram, item_ram,
+           ram_ok ? "PASS" : "FAIL");
+    return (state_ok && string_ok && ram_ok) ? 0 : 1;
+}
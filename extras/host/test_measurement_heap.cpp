@@ -0,0 +1,111 @@
+/**************************************************************************/
+/*!
+ * @file test_measurement_heap.cpp
+ * @brief 計測ユニット(Measurement)がヒープを使わないことをoperator newのトラップで確認する
+ * @par
+ *    計測用ICのドライバ（ADS1115, MCP4725, MCP23008, DAC80501）は全てMeasurementの中の領域に構築され、
+ *    I2Cデバイスもドライバの中に持つ。Measurementを構築した後、最初のinit()から
+ *    （再初期化、デバイスがない場合の再初期化、計測、停止まで）operator newをトラップする（呼ばれたらabort()）。
+ *
+ *    ビルド例（extras/host で）:
+ *      g++ -std=gnu++14 -O2 -Iarduino -I../../src test_measurement_heap.cpp arduino/HostSim.cpp \
+ *          ../../src/measurement.cpp ../../src/DAC80501.cpp ../../src/MCP4725.cpp ../../src/MCP23008.cpp \
+ *          ../../src/I2cBusRecovery.cpp ../../src/I2cBusClock.cpp ../../src/I2cProfiler.cpp
+ */
+/**************************************************************************/
+
+#include <cstdio>
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostDevices.h"
+#include "measurement.h"
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+namespace {
+
+// CLK周期 [us]
+constexpr uint64_t CLK_US = 10000;
+
+// 再初期化の回数
+constexpr int REINIT_COUNT = 5;
+
+HostSim::Ads1115 adc;
+HostSim::Mcp23008 pio;
+
+}   // namespace
+
+int main(void){
+    HostSim::reset();
+    HostSim::attachI2c(I2C_ADDR::ADC, &adc);
+    HostSim::attachI2c(I2C_ADDR::PIO, &pio);
+    HostSim::attachI2c(I2C_ADDR::CURRENT_ADJ);
+    HostSim::attachI2c(I2C_ADDR::V_MON);
+    Wire.begin();
+    I2cClock.begin(&Wire);
+    I2cRecovery.begin(&Wire, PIN_WIRE_SDA, PIN_WIRE_SCL);
+
+    Measurement::MesasUintParameters parameters;
+    parameters.sensor_length = 36;
+    parameters.timer_period = 0;
+    parameters.adc_err_comp_diff_0_1 = 1.0;
+    parameters.adc_err_comp_diff_2_3 = 1.0;
+    parameters.adc_OFS_comp_diff_0_1 = 0;
+    parameters.adc_OFS_comp_diff_2_3 = 0;
+    parameters.current_set_default = 750;
+    parameters.vmon_da_offset = 0;
+    adc.differential[0] = 10158;
+    adc.differential[1] = 24000;
+
+    Measurement measurement(&parameters);
+
+    // ここから先はヒープを使わないこと  最初の初期化（ドライバのbegin()）を含む
+    const uint32_t before = HostSim::heapAllocations();
+    HostSim::trapHeap(true, "init / measurement");
+    const uint16_t first_error = measurement.init();
+    printf("first init():  error:%u\n", first_error);
+    uint16_t reinit_error = 0;
+    for (int i = 0; i < REINIT_COUNT; i++){
+        reinit_error |= measurement.init();
+    }
+
+    // 再初期化でデバイスが見つからない場合も検出できること（PIOを外す）
+    HostSim::detachI2c(I2C_ADDR::PIO);
+    const uint16_t missing_error = measurement.init();
+    HostSim::attachI2c(I2C_ADDR::PIO, &pio);
+    reinit_error |= measurement.init();
+
+    // 連続計測を数回
+    measurement.setMode(Measurement::E_Modes::CONTINUOUS);
+    measurement.setCommand(Measurement::E_Command::START);
+    uint64_t next_tick_us = HostSim::now() + CLK_US;
+    uint32_t results = 0;
+    uint32_t last_result_ms = measurement.getResultTime();
+    while (results < 5){
+        if (measurement.shouldMeasure()){
+            measurement.executeMeasurement();
+        } else {
+            HostSim::advance(next_tick_us - HostSim::now());
+        }
+        while (HostSim::now() >= next_tick_us){
+            measurement.clk_in();
+            next_tick_us += CLK_US;
+        }
+        if (measurement.getResultTime() != last_result_ms){
+            last_result_ms = measurement.getResultTime();
+            results++;
+        }
+    }
+    measurement.setCommand(Measurement::E_Command::STOP);
+    HostSim::trapHeap(false);
+
+    printf("re-init x%d:   error:%u  PIO missing on re-init: error:%u  measurements:%u level:%u\n",
+           REINIT_COUNT + 1, reinit_error, missing_error, results, measurement.getResult());
+    const uint32_t allocations = HostSim::heapAllocations() - before;
+    printf("heap allocations from the first init(): %u (operator new trapped)\n", allocations);
+
+    const bool ok = (first_error == 0) && (allocations == 0)
+        && (reinit_error == 0) && (missing_error == 4) && (results == 5);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
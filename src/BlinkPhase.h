@@ -0,0 +1,46 @@
+/**************************************************************************/
+/*!
+ * @file BlinkPhase.h
+ * @brief 点滅の位相  全ての点滅表示（LCDの表示要素, LED）で共通の位相を使う
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    位相はmillis()から求めたCLKカウントで決まるので、呼び出し側にカウンタは不要。
+ *    同じ周期の点滅は常に同期する。
+ */
+/**************************************************************************/
+
+#ifndef _BLINKPHASE_H_
+#define _BLINKPHASE_H_
+
+#include <Arduino.h>
+
+class BlinkPhase {
+
+    public:
+    // consts
+
+    // CLKの周期 [ms]
+    static constexpr uint32_t CLK_PERIOD_MS = 10;
+
+    // methods
+
+    /// @brief 現在のCLKカウントを返す
+    /// @return millis()をCLK周期で割った値
+    static uint32_t getTick(void){
+        return millis() / CLK_PERIOD_MS;
+    };
+
+    /// @brief 点滅の位相を返す
+    /// @param half_period 点灯（消灯）の時間 [CLK Cycle]  0の場合は常に点灯
+    /// @return True:点灯  False:消灯
+    static bool isOn(const uint16_t half_period){
+        if (half_period == 0){
+            return true;
+        }
+        return ((getTick() / half_period) & 1) == 0;
+    };
+};
+
+#endif //_BLINKPHASE_H_
@@ -0,0 +1,187 @@
+#include "BootSequencer.h"
+
+/// @brief CLKに同期した処理: 起動処理を1ステップ進める
+/// @note 10ms周期で呼び出す。isDone()がtrueになったら呼び出す必要はない
+void BootSequencer::clk_in(void){
+    switch (step){
+        case E_Step::LCD_INIT :
+            // BEGINとCGRAMの間は1CLK空くので、LCDの初期化を待てる
+            if (lcd_step == EhLcd::E_InitStep::BEGIN){
+                start_ms = millis();
+            }
+            lcd->initStep(lcd_step);
+            lcd_step = static_cast<EhLcd::E_InitStep>(static_cast<uint8_t>(lcd_step) + 1);
+            if (lcd_step == EhLcd::E_InitStep::DONE){
+                step = E_Step::SPLASH_CLEAR;
+            }
+            break;
+
+        case E_Step::SPLASH_CLEAR :
+            lcd->clearDisplay();
+            step = E_Step::SPLASH;
+            break;
+
+        case E_Step::SPLASH :
+            // クリアから1CLK以上経過している
+            lcd->writeSplash(message);
+            step = E_Step::FRAM;
+            break;
+
+        case E_Step::FRAM :
+            I2cClock.setActive(I2C_ADDR::FRAM, true);
+            I2cClock.select(I2C_ADDR::FRAM);
+            if (storage->begin(I2C_ADDR::FRAM)){
+                step = E_Step::LOAD_PARAMETERS;
+            } else {
+                // 読み込めないので、パラメタは呼び出し側で設定した初期値のまま
+                if(DEBUG){Serial.println("error on FRAM.  ");}
+                error_code = error_code | ERROR_FRAM;
+                step = E_Step::MEASUREMENT;
+            }
+            break;
+
+        case E_Step::LOAD_PARAMETERS :
+            loadParameters();
+            step = E_Step::MEASUREMENT;
+            break;
+
+        case E_Step::MEASUREMENT :
+            // V_MON_RESETとV_MON_CONFIGUREの間は1CLK空くので、DAC80501の再起動を待てる
+            error_code = (error_code & ERROR_FRAM) | measurement->initStep(measurement_step);
+            measurement_step = static_cast<Measurement::E_InitStep>(static_cast<uint8_t>(measurement_step) + 1);
+            if (measurement_step == Measurement::E_InitStep::DONE){
+                step = E_Step::WAIT_SPLASH;
+            }
+            break;
+
+        case E_Step::WAIT_SPLASH :
+            if (splash_time >= min_splash_time){
+                step = E_Step::SPLASH_END;
+            }
+            break;
+
+        case E_Step::SPLASH_END :
+            ready_ms = millis();
+            if (error_code != 0){
+                lcd->showHardwareError(error_code);
+                step = E_Step::FAILED;
+            } else {
+                lcd->clearDisplay();
+                step = E_Step::DONE;
+            }
+            if(DEBUG){
+                Serial.print("Boot time[ms]:"); Serial.print(ready_ms - start_ms);
+                Serial.print(" error:"); Serial.println(error_code, HEX);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (step > E_Step::SPLASH && step <= E_Step::WAIT_SPLASH){
+        splash_time++;
+    }
+    return;
+}
+
+/// @brief スプラッシュの最短表示時間を設定する
+/// @param ticks 最短表示時間 [CLK Cycle]
+void BootSequencer::setMinSplashTime(const uint16_t ticks){
+    min_splash_time = ticks;
+}
+
+/// @brief 起動処理が終わったか
+/// @return True:終了（エラーの場合も含む）    False:起動処理中
+/// @note 終了した時点でLCDはクリア済み（1CLK後からアクセス可能）
+bool BootSequencer::isDone(void){
+    return (step == E_Step::DONE || step == E_Step::FAILED);
+}
+
+/// @brief 起動処理のステップを返す
+/// @return 現在のステップ
+BootSequencer::E_Step BootSequencer::getStep(void){
+    return step;
+}
+
+/// @brief 起動時のエラーコードを返す
+/// @return bit0-3:Measurement::init()と同じ  bit4:FRAM
+uint16_t BootSequencer::getErrorCode(void){
+    return error_code;
+}
+
+/// @brief 起動開始からスプラッシュを消すまでの時間を返す
+/// @return 起動時間 [ms]  起動処理中は0
+uint32_t BootSequencer::getBootTime(void){
+    return isDone() ? ready_ms - start_ms : 0;
+}
+
+/// @brief 起動開始から最初の計測結果が得られるまでの時間を返す
+/// @return 時間 [ms]  まだ計測結果が無い場合は0
+uint32_t BootSequencer::getTimeToFirstMeasurement(void){
+    const uint32_t first_result_ms = measurement->getFirstResultTime();
+    return (first_result_ms != 0) ? first_result_ms - start_ms : 0;
+}
+
+/// @brief FRAMからパラメタを読み込む
+/// @note 読めなかった値は呼び出し側で設定した初期値のまま  校正値は校正済みの場合のみ読み込む
+void BootSequencer::loadParameters(void){
+    bool ack = true;
+
+    // センサ長・タイマ周期は読めた場合のみ  0（未書き込みのFRAM）は初期値のまま（センサ長は計算の除数になる）
+    uint8_t sensor_length = 0;
+    if (storage->read(ParameterStorage::E_ParameterCategories::SENSOR_LENGTH, sensor_length)){
+        if (sensor_length != 0){
+            parameter->sensor_length = sensor_length;
+        }
+    } else {
+        ack = false;
+    }
+    uint8_t timer_period = 0;
+    if (storage->read(ParameterStorage::E_ParameterCategories::TIMER_PERIOD, timer_period)){
+        if (timer_period != 0){
+            parameter->timer_period = timer_period;
+        }
+    } else {
+        ack = false;
+    }
+    // ユニットアドレスは読めて、書き込まれた値（反転の確認が一致）の場合のみ  それ以外は0（マルチドロップを使わない）のまま
+    ParameterStorage::UnitAddress address;
+    if (storage->read(ParameterStorage::E_ParameterCategories::UNIT_ADDRESS, address)){
+        if (address.isValid()){
+            unit_address = address.address;
+        }
+    } else {
+        ack = false;
+    }
+
+    ParameterStorage::ScalingParameter scaling;
+    if (storage->read(ParameterStorage::E_ParameterCategories::SCALING, scaling)){
+        // 未書き込み（0:0）など、100%と0%が同じか逆の値はスケーリングの除数が0以下になるので使わない
+        if (scaling.hi_side_scale > scaling.low_side_scale){
+            parameter->scale_100 = scaling.hi_side_scale;
+            parameter->scale_0 = scaling.low_side_scale;
+        }
+    } else {
+        ack = false;
+    }
+
+    bool calibrated = false;
+    ack = storage->read(ParameterStorage::E_ParameterCategories::CAL_FLAG, calibrated) && ack;
+    ParameterStorage::CalData cal_data;
+    if (calibrated && storage->read(ParameterStorage::E_ParameterCategories::CAL_DATA, cal_data)){
+        parameter->adc_OFS_comp_diff_0_1 = cal_data.adc_offset_01;
+        parameter->adc_OFS_comp_diff_2_3 = cal_data.adc_offset_23;
+        parameter->adc_err_comp_diff_0_1 = cal_data.adc_gain_error_01;
+        parameter->adc_err_comp_diff_2_3 = cal_data.adc_gain_error_23;
+        parameter->vmon_da_offset = cal_data.vmon_da_offset;
+        parameter->current_set_default = cal_data.current_adj;
+    } else if (calibrated){
+        ack = false;
+    }
+
+    if (!ack){
+        error_code = error_code | ERROR_FRAM;
+    }
+    return;
+}
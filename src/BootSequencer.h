@@ -0,0 +1,123 @@
+/**************************************************************************/
+/*!
+ * @file BootSequencer.h/cpp
+ * @brief 起動処理  スプラッシュ表示中にデバイスの初期化とパラメタの読み込みを進める
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    clk_in()を10ms周期で呼び出すと、1CLKにつき1ステップずつ起動処理を進める。
+ *    デバイスの再起動待ち（LCDの初期化・クリア、DAC80501リセット）はdelay()ではなくCLKの間隔で待つ。
+ *    ただしrgb_lcd::begin()の中の電源投入後の待ち（約57ms）はライブラリのままブロックする。
+ *    スプラッシュは最短表示時間が過ぎ、ハードウエアの準備ができた時点で終了する。
+ *    FRAMのbegin()もここで行うので、スケッチ側では呼び出さないこと。
+ */
+/**************************************************************************/
+
+#ifndef _BOOTSEQUENCER_H_
+#define _BOOTSEQUENCER_H_
+
+#include <Arduino.h>
+#include "eh_LCD.h"
+#include "measurement.h"
+#include "ParameterStorage.h"
+#include "BlinkPhase.h"
+
+class BootSequencer {
+
+    public:
+    // consts
+
+    /// @brief 起動処理のステップ  この順に進む
+    enum class E_Step : uint8_t {
+        LCD_INIT = 0,       // LCDの初期化（EhLcd::E_InitStepを1CLKに1つ）
+        SPLASH_CLEAR,       // LCDクリア
+        SPLASH,             // スプラッシュ表示
+        FRAM,               // FRAMの検出
+        LOAD_PARAMETERS,    // FRAMからパラメタを読み込む
+        MEASUREMENT,        // 計測ユニットの初期化（Measurement::E_InitStepを1CLKに1つ）
+        WAIT_SPLASH,        // スプラッシュの最短表示時間を待つ
+        SPLASH_END,         // スプラッシュを消去  エラーがあればエラー表示
+        DONE,               // 起動完了
+        FAILED              // ハードウエアエラー
+    };
+
+    // エラーコード  bit0-3はMeasurement::init()と同じ
+    static constexpr uint16_t ERROR_FRAM = 0x10;
+
+    // スプラッシュの最短表示時間（デフォルト）
+    static constexpr uint16_t DEFAULT_MIN_SPLASH_TIME = 100;   // [CLK Cycle]
+
+    // methods
+    /*!
+    * @brief constructor
+    * @param lcd LCD
+    * @param measurement 計測ユニット
+    * @param storage パラメタを保存しているFRAM
+    * @param parameter 読み込んだパラメタの保存先  measurementに渡したもの
+    * @param message スプラッシュに表示するメッセージ  16文字まで
+    */
+    BootSequencer(EhLcd* lcd, Measurement* measurement, ParameterStorage* storage,
+                  Measurement::MesasUintParameters* parameter, const char* message)
+        : lcd(lcd), measurement(measurement), storage(storage), parameter(parameter), message(message){
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~BootSequencer(){
+    };
+
+    void clk_in(void);
+    void setMinSplashTime(const uint16_t ticks);
+
+    bool isDone(void);
+    E_Step getStep(void);
+    uint16_t getErrorCode(void);
+    uint32_t getBootTime(void);
+    uint32_t getTimeToFirstMeasurement(void);
+
+    /// @brief FRAMから読み込んだユニットアドレス
+    /// @return IotGateway::setMultidrop()に渡すアドレス  FRAMが読めない・書き込まれていない場合は0（マルチドロップを使わない）
+    uint8_t getUnitAddress(void){
+        return unit_address;
+    };
+
+    private:
+    // consts
+
+    // debug flag
+    static constexpr bool DEBUG = false;
+
+    //  デバイスの再起動待ちを1CLKの間隔で済ませるための条件
+    static_assert(BlinkPhase::CLK_PERIOD_MS >= EhLcd::CLEAR_TIME_MS, "CLK period is shorter than LCD clear time");
+    static_assert(BlinkPhase::CLK_PERIOD_MS >= EhLcd::BEGIN_TIME_MS, "CLK period is shorter than LCD begin time");
+    static_assert(BlinkPhase::CLK_PERIOD_MS >= DAC80501::RESET_TIME_MS, "CLK period is shorter than DAC80501 reset time");
+
+    // instances
+    EhLcd* const lcd;
+    Measurement* const measurement;
+    ParameterStorage* const storage;
+    Measurement::MesasUintParameters* const parameter;
+    const char* const message;
+
+    // vars
+    E_Step step = E_Step::LCD_INIT;
+    EhLcd::E_InitStep lcd_step = EhLcd::E_InitStep::BEGIN;
+    Measurement::E_InitStep measurement_step = Measurement::E_InitStep::PARAMETERS;
+
+    uint16_t min_splash_time = DEFAULT_MIN_SPLASH_TIME;
+    uint16_t splash_time = 0;   // スプラッシュを表示してからのCLKカウント
+    uint16_t error_code = 0;
+    uint8_t unit_address = 0;
+
+    // 起動開始・完了の時刻 [ms]
+    uint32_t start_ms = 0;
+    uint32_t ready_ms = 0;
+
+    // methods
+    void loadParameters(void);
+};
+
+#endif //_BOOTSEQUENCER_H_
@@ -0,0 +1,58 @@
+#include "Cobs.h"
+
+/// @brief COBSで符号化する
+/// @param source 符号化するデータ
+/// @param length データ長
+/// @param destination 書き込み先  maxEncodedLength(length)以上の長さがあること
+/// @return 符号化後の長さ（区切りは含まない）
+size_t Cobs::encode(const uint8_t* source, const size_t length, uint8_t* destination){
+    size_t code_index = 0;  // 次の0x00までの距離を書き込む位置
+    size_t write_index = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++){
+        if (source[i] == 0){
+            destination[code_index] = code;
+            code_index = write_index++;
+            code = 1;
+        } else {
+            destination[write_index++] = source[i];
+            if (++code == 0xFF){
+                destination[code_index] = code;
+                code_index = write_index++;
+                code = 1;
+            }
+        }
+    }
+    destination[code_index] = code;
+    return write_index;
+}
+
+/// @brief COBSを復号する
+/// @param source 符号化されたデータ（区切りは含まない）
+/// @param length データ長
+/// @param destination 書き込み先  length以上の長さがあること
+/// @return 復号後の長さ  0:不正なデータ
+size_t Cobs::decode(const uint8_t* source, const size_t length, uint8_t* destination){
+    size_t read_index = 0;
+    size_t write_index = 0;
+
+    while (read_index < length){
+        const uint8_t code = source[read_index];
+        if (code == 0 || read_index + code > length){
+            return 0;
+        }
+        read_index++;
+        for (uint8_t i = 1; i < code; i++){
+            if (read_index >= length || source[read_index] == 0){
+                return 0;
+            }
+            destination[write_index++] = source[read_index++];
+        }
+        // 最大長のブロックの後と、データの最後には0x00を補わない
+        if (code != 0xFF && read_index < length){
+            destination[write_index++] = 0;
+        }
+    }
+    return write_index;
+}
@@ -0,0 +1,41 @@
+/**************************************************************************/
+/*!
+ * @file Cobs.h/cpp
+ * @brief COBS (Consistent Overhead Byte Stuffing) の符号化・復号
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    符号化したデータは0x00を含まないので、0x00をフレームの区切りに使える。
+ *    増加は254byteごとに1byte。Arduinoに依存しないので、ホスト側でもそのまま使える。
+ */
+/**************************************************************************/
+
+#ifndef _COBS_H_
+#define _COBS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Cobs {
+
+    public:
+    // consts
+
+    // フレームの区切り
+    static constexpr uint8_t DELIMITER = 0x00;
+
+    // methods
+
+    /// @brief 符号化後の最大長
+    /// @param length 符号化前の長さ
+    /// @return 符号化後の最大長（区切りは含まない）
+    static constexpr size_t maxEncodedLength(const size_t length){
+        return length + length / 254 + 1;
+    };
+
+    static size_t encode(const uint8_t* source, const size_t length, uint8_t* destination);
+    static size_t decode(const uint8_t* source, const size_t length, uint8_t* destination);
+};
+
+#endif //_COBS_H_
@@ -0,0 +1,168 @@
+#include "CommandParser.h"
+
+constexpr CommandParser::CommandName CommandParser::command_names[];
+
+namespace {
+
+bool isEndOfLine(const uint8_t c){
+    return c == '\r' || c == '\n';
+}
+
+bool isSpace(const uint8_t c){
+    return c == ' ' || c == '\t';
+}
+
+}   // namespace
+
+/// @brief 受信した1byteを渡す
+/// @param c 受信データ
+/// @return True:コマンドが揃った（getCommand()で取り出す）   False:コマンドの途中、または不正な行
+/// @note 1byteあたりの処理はcommand_namesの数で決まる一定の範囲に収まる
+bool CommandParser::feed(const uint8_t c){
+    const uint8_t upper = (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+
+    switch (state){
+        case E_State::IDLE :
+            if (isEndOfLine(upper) || isSpace(upper)){
+                return false;
+            }
+            state = E_State::NAME;
+            name_length = 0;
+            candidates = (1 << COMMAND_COUNT) - 1;
+            argument_length = 0;
+            argument = 0;
+            // コマンド名の1文字目として続けて処理する
+            // fall through
+
+        case E_State::NAME :
+            if (isSpace(upper) || isEndOfLine(upper)){
+                if (!matchName()){
+                    fail(isEndOfLine(upper));
+                    return false;
+                }
+                const uint8_t argument_type = command_names[name_index].argument;
+                if (isEndOfLine(upper)){
+                    if (argument_type != ARGUMENT_NONE){
+                        fail(true);
+                        return false;
+                    }
+                    return finish();
+                }
+                state = (argument_type == ARGUMENT_NONE) ? E_State::TRAILING : E_State::SPACE;
+                return false;
+            }
+            // 0x00がコマンド名の終端と一致しないように、英字以外はここで弾く
+            if (upper < 'A' || upper > 'Z' || name_length >= MAX_NAME_LENGTH){
+                fail(false);
+                return false;
+            }
+            for (uint8_t i = 0; i < COMMAND_COUNT; i++){
+                // 候補のコマンド名はname_lengthまで一致しているので、終端を越えて読むことはない
+                if ((candidates & (1 << i)) && command_names[i].name[name_length] != upper){
+                    candidates &= ~(1 << i);
+                }
+            }
+            name_length++;
+            if (candidates == 0){
+                fail(false);
+            }
+            return false;
+
+        case E_State::SPACE :
+            if (isSpace(upper)){
+                return false;
+            }
+            if (isEndOfLine(upper)){
+                fail(true);
+                return false;
+            }
+            state = E_State::ARGUMENT;
+            // 引数の1文字目として続けて処理する
+            // fall through
+
+        case E_State::ARGUMENT :
+            if (isSpace(upper) || isEndOfLine(upper)){
+                if (isEndOfLine(upper)){
+                    return finish();
+                }
+                state = E_State::TRAILING;
+                return false;
+            }
+            if (command_names[name_index].argument == ARGUMENT_MODE){
+                if (argument_length != 0 || (upper != 'T' && upper != 'M' && upper != 'C')){
+                    fail(false);
+                    return false;
+                }
+                argument = upper;
+            } else {
+                if (upper < '0' || upper > '9'){
+                    fail(false);
+                    return false;
+                }
+                argument = argument * 10 + (upper - '0');
+                const uint64_t limit = (command_names[name_index].argument == ARGUMENT_TIME) ? MAX_TIME : UINT16_MAX;
+                if (argument > limit){
+                    fail(false);
+                    return false;
+                }
+            }
+            argument_length++;
+            return false;
+
+        case E_State::TRAILING :
+            if (isSpace(upper)){
+                return false;
+            }
+            if (isEndOfLine(upper)){
+                return finish();
+            }
+            fail(false);
+            return false;
+
+        case E_State::DISCARD :
+        default:
+            if (isEndOfLine(upper)){
+                state = E_State::IDLE;
+            }
+            return false;
+    }
+}
+
+/// @brief 受信中の行を捨てて行頭の状態に戻す
+void CommandParser::reset(void){
+    state = E_State::IDLE;
+    name_length = 0;
+    candidates = 0;
+    name_index = 0;
+    argument_length = 0;
+    argument = 0;
+}
+
+/// @brief 受信したコマンド名と完全に一致するものを探す  (private)
+/// @return True:一致した（name_indexに位置を設定）   False:一致しない
+bool CommandParser::matchName(void){
+    for (uint8_t i = 0; i < COMMAND_COUNT; i++){
+        if ((candidates & (1 << i)) && command_names[i].name[name_length] == '\0'){
+            name_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief コマンドを確定して行頭の状態に戻る  (private)
+/// @return True
+bool CommandParser::finish(void){
+    command.type = command_names[name_index].type;
+    command.value = static_cast<uint16_t>(argument);
+    command.epoch_ms = argument;
+    state = E_State::IDLE;
+    return true;
+}
+
+/// @brief 不正な行としてエラーを数える  (private)
+/// @param end_of_line True:行末で見つかった（次の行から受け付ける）  False:行末まで読み捨てる
+void CommandParser::fail(const bool end_of_line){
+    error_count++;
+    state = end_of_line ? E_State::IDLE : E_State::DISCARD;
+}
@@ -0,0 +1,141 @@
+/**************************************************************************/
+/*!
+ * @file CommandParser.h/cpp
+ * @brief UARTから受信したコマンドを1byteずつ解析する  ヒープを使わない
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    1行1コマンド（CRまたはLFで終端）のASCII。大文字・小文字は区別しない。
+ *      START         1回計測を開始する
+ *      STOP          計測を止めてタイマモードに戻る
+ *      MODE T|M|C    動作モードを切り替える
+ *      TIMER n       タイマ周期を設定する [min]
+ *      GET           現在の値を送る
+ *      TIME n        ホストの時刻を設定する  epochからの時間 [ms]
+ *    feed()は1byteごとに一定の処理しかしない（行末でまとめて解析しない）。
+ *    不正な行は行末まで読み捨て、エラーとして数える。
+ *    Arduinoに依存しないので、ホスト側でもそのまま使える。
+ */
+/**************************************************************************/
+
+#ifndef _COMMANDPARSER_H_
+#define _COMMANDPARSER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class CommandParser {
+
+    public:
+    // consts
+
+    /// @brief コマンドの種類
+    enum class E_Command : uint8_t {
+        NONE = 0,
+        START,
+        STOP,
+        MODE,   // value: 'T', 'M', 'C'
+        TIMER,  // value: タイマ周期 [min]
+        GET,
+        TIME    // epoch_ms: ホストの時刻 [ms]
+    };
+
+    /// @brief 解析したコマンド
+    struct Command{
+        E_Command type;
+        uint16_t value;
+        uint64_t epoch_ms;
+    };
+
+    // methods
+    /*!
+    * @brief constructor
+    */
+    CommandParser(){
+        reset();
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~CommandParser(){
+    };
+
+    bool feed(const uint8_t c);
+    void reset(void);
+
+    /// @brief 最後に解析したコマンド  feed()がtrueを返した時に有効
+    const Command& getCommand(void) const {
+        return command;
+    };
+
+    /// @brief 受信中の行があるか（コマンドの途中）
+    bool isReceiving(void) const {
+        return state != E_State::IDLE;
+    };
+
+    /// @brief 不正な行の数
+    uint32_t getErrorCount(void) const {
+        return error_count;
+    };
+
+    private:
+    // consts
+
+    // コマンド名の最大長
+    static constexpr uint8_t MAX_NAME_LENGTH = 5;
+
+    /// @brief 解析の状態
+    enum class E_State : uint8_t {
+        IDLE = 0,   // 行頭  空行は無視する
+        NAME,       // コマンド名
+        SPACE,      // コマンド名と引数の間
+        ARGUMENT,   // 引数
+        TRAILING,   // 引数の後の空白
+        DISCARD     // 不正な行  行末まで読み捨てる
+    };
+
+    /// @brief コマンド名と引数の種類
+    struct CommandName{
+        const char* name;
+        E_Command type;
+        uint8_t argument;   // 0:なし  1:モード文字  2:数値  3:時刻
+    };
+
+    static constexpr uint8_t ARGUMENT_NONE = 0;
+    static constexpr uint8_t ARGUMENT_MODE = 1;
+    static constexpr uint8_t ARGUMENT_NUMBER = 2;
+    static constexpr uint8_t ARGUMENT_TIME = 3;
+
+    // 時刻の最大値  48bit  IotGatewayのタイムスタンプの長さ
+    static constexpr uint64_t MAX_TIME = 0xFFFFFFFFFFFFULL;
+
+    static constexpr uint8_t COMMAND_COUNT = 6;
+    static constexpr CommandName command_names[COMMAND_COUNT] = {
+        { "START", E_Command::START, ARGUMENT_NONE },
+        { "STOP",  E_Command::STOP,  ARGUMENT_NONE },
+        { "MODE",  E_Command::MODE,  ARGUMENT_MODE },
+        { "TIMER", E_Command::TIMER, ARGUMENT_NUMBER },
+        { "GET",   E_Command::GET,   ARGUMENT_NONE },
+        { "TIME",  E_Command::TIME,  ARGUMENT_TIME }
+    };
+
+    // vars
+    E_State state = E_State::IDLE;
+    uint8_t name_length = 0;
+    uint8_t candidates = 0;     // 受信したコマンド名と前方一致するcommand_namesのビット
+    uint8_t name_index = 0;     // 確定したコマンド名のcommand_namesの位置
+    uint8_t argument_length = 0;
+    uint64_t argument = 0;
+    Command command = { E_Command::NONE, 0, 0 };
+    uint32_t error_count = 0;
+
+    // methods
+    bool matchName(void);
+    bool finish(void);
+    void fail(const bool end_of_line);
+};
+
+#endif //_COMMANDPARSER_H_
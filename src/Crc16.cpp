@@ -0,0 +1,17 @@
+#include "Crc16.h"
+
+/// @brief CRC-16/MODBUSを計算する
+/// @param data データ
+/// @param length データ長
+/// @param crc 初期値  続きを計算する場合は前回の結果を渡す
+/// @return CRC  送信時は下位バイトから送る
+uint16_t Crc16::modbus(const uint8_t* data, const size_t length, const uint16_t crc){
+    uint16_t value = crc;
+    for (size_t i = 0; i < length; i++){
+        value ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++){
+            value = (value & 1) ? (value >> 1) ^ POLYNOMIAL : (value >> 1);
+        }
+    }
+    return value;
+}
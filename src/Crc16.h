@@ -0,0 +1,33 @@
+/**************************************************************************/
+/*!
+ * @file Crc16.h/cpp
+ * @brief CRC-16/MODBUS  (多項式0xA001(反転), 初期値0xFFFF)
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    バイナリ形式のテレメトリで使う。Arduinoに依存しないので、ホスト側でもそのまま使える。
+ */
+/**************************************************************************/
+
+#ifndef _CRC16_H_
+#define _CRC16_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Crc16 {
+
+    public:
+    // consts
+    static constexpr uint16_t INITIAL_VALUE = 0xFFFF;
+
+    // methods
+    static uint16_t modbus(const uint8_t* data, const size_t length, const uint16_t crc = INITIAL_VALUE);
+
+    private:
+    // consts
+    static constexpr uint16_t POLYNOMIAL = 0xA001;
+};
+
+#endif //_CRC16_H_
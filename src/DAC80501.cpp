@@ -19,6 +19,17 @@
 /**************************************************************************/
 DAC80501::DAC80501() {}
 
+/**************************************************************************/
+/*!
+    @brief  Destroys the I2C device held in the object
+*/
+/**************************************************************************/
+DAC80501::~DAC80501() {
+  if (i2c_dev) {
+    i2c_dev->~Adafruit_I2CDevice();
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief  Setups the hardware and checks the DAC was found
@@ -29,12 +40,15 @@ DAC80501::DAC80501() {}
 /**************************************************************************/
 bool DAC80501::begin(uint8_t i2c_address, TwoWire *wire) {
   if (i2c_dev) {
-    delete i2c_dev;
+    i2c_dev->~Adafruit_I2CDevice();
   }
 
-  i2c_dev = new Adafruit_I2CDevice(i2c_address, wire);
+  // construct in place: re-calling begin() does not touch the heap
+  i2c_dev = new (i2c_dev_storage) Adafruit_I2CDevice(i2c_address, wire);
 
+  I2cProfileScope profile(i2c_address, E_I2cComponent::DAC80501, 0);
   if (!i2c_dev->begin()) {
+    profile.setAck(false);
     return false;
   }
 
@@ -51,22 +65,52 @@ bool DAC80501::begin(uint8_t i2c_address, TwoWire *wire) {
 /**************************************************************************/
 bool DAC80501::init(void) {
 
+  if (!reset()) {
+    return false;
+  }
+
+  delay(RESET_TIME_MS); // wait for restarting
+
+  return configure();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Issue a soft reset to DAC80501
+            The device must not be accessed for RESET_TIME_MS afterwards.
+            init() = reset(), wait, configure(); the split lets a caller
+            do other work instead of blocking during the restart.
+
+    @returns True if the command was acknowledged, False otherwise.
+*/
+/**************************************************************************/
+bool DAC80501::reset(void) {
+
   uint8_t packet[3];
 
   packet[0] = DAC80501::CMD::CMD_TRIGGER;
   packet[1] = 0x00;
   packet[2] = SOFT_RES ; //RESET command
   
-  if (!i2c_dev->write(packet, 3)) {
-    return false;
-  }
+  return writePacket(packet, 3);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Configure DAC80501 after reset()
+            VFS=2.5V, Async output update, enable output and internal VREF
+
+    @returns True if no alarm on the device, False otherwise.
+*/
+/**************************************************************************/
+bool DAC80501::configure(void) {
 
-  delay(10); // wait for restarting
+  uint8_t packet[3];
 
   packet[0] = DAC80501::CMD::CMD_SYNC;
   packet[1] = 0x00;
   packet[2] = DAC80501::DAC_SYNC_EN::UPDATE_ASYNC; //the output is update immedietely
-  if (!i2c_dev->write(packet, 3)) {
+  if (!writePacket(packet, 3)) {
     return false;
   }
   
@@ -74,7 +118,7 @@ bool DAC80501::init(void) {
   packet[1] = DAC80501::REF_PWDWN::REFPWDWN_DISABLE; //use internal VREF 2.5V
   packet[2] = DAC80501::DAC_PWDWN::DACPWDN_DISABLE; //activate DAC
 
-  if (!i2c_dev->write(packet, 3)) {
+  if (!writePacket(packet, 3)) {
     return false;
   }
 
@@ -83,20 +127,18 @@ bool DAC80501::init(void) {
   packet[1] = DAC80501::REF_DIV::REFDIV_2;     // VREF divider = 1/2 
   packet[2] = DAC80501::BUFF_GAIN::BUFGAIN_2;  // DAC Buffer gain =2 ,thus VFS=2.5V
 
-  if (!i2c_dev->write(packet, 3)) {
+  if (!writePacket(packet, 3)) {
     return false;
   }
 
-  DAC80501::DAC_VOLT2LSB = 65535 / 2.5;
-
   // check the status
   packet[0] = DAC80501::CMD::CMD_STATUS;
-  if (!i2c_dev->write(packet, 1)) {
+  if (!writePacket(packet, 1)) {
     return false;
   }
 
   //  Read 2byte of spacified resigter.
-  if (!i2c_dev->read(packet,2,true)) {
+  if (!readPacket(packet, 2)) {
     return false;
   }
 
@@ -128,13 +170,16 @@ bool DAC80501::init(void) {
                 the DAC's input voltage and its output voltage.
 
     @param i2c_frequency What we should set the I2C clock to when writing
-    to the DAC, defaults to 400 KHz
+    to the DAC. Defaults to 0, which leaves the bus clock as it is
+    (managed by I2cBusClock)
     @returns True if able to write the value over I2C
 */
 /**************************************************************************/
 bool DAC80501::setVoltage(const uint16_t output, 
                           const uint32_t i2c_frequency) {
-  i2c_dev->setSpeed(i2c_frequency); // Set I2C frequency to desired speed
+  if (i2c_frequency) {
+    i2c_dev->setSpeed(i2c_frequency); // Set I2C frequency to desired speed
+  }
 
   uint8_t packet[3];
 
@@ -143,11 +188,13 @@ bool DAC80501::setVoltage(const uint16_t output,
   packet[1] = output / 256;        // Upper data bits (D15.....D8)
   packet[2] = (output % 256);      // Lower data bits (D7......D0)
 
-  if (!i2c_dev->write(packet, 3)) {
+  if (!writePacket(packet, 3)) {
     return false;
   }
 
-  i2c_dev->setSpeed(100000); // reset to arduino default
+  if (i2c_frequency) {
+    i2c_dev->setSpeed(100000); // reset to arduino default
+  }
   return true;
 }
 
@@ -161,7 +208,7 @@ bool DAC80501::setVoltage(const uint16_t output,
                 absolute voltage [V] to be output. Assuming VFS=2.5V
 
     @param i2c_frequency What we should set the I2C clock to when writing
-    to the DAC, defaults to 400 KHz
+    to the DAC. Defaults to 0, which leaves the bus clock as it is
     @returns True if able to write the value over I2C
 */
 /**************************************************************************/
@@ -174,4 +221,41 @@ bool DAC80501::setVoltage(const float output,
 
   return DAC80501::setVoltage((uint16_t)(output * DAC80501::DAC_VOLT2LSB), i2c_frequency);
 
-}
\ No newline at end of file
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a command packet to the DAC (recorded by I2cProfiler,
+            retried by I2cBusRecovery)
+    @param packet command byte followed by the data bytes
+    @param len length of the packet
+    @returns True if the DAC acknowledged the packet
+*/
+/**************************************************************************/
+bool DAC80501::writePacket(const uint8_t *packet, const size_t len) {
+  I2cProfileScope profile(i2c_dev->address(), E_I2cComponent::DAC80501, len);
+  const bool ack = I2cRecovery.execute(i2c_dev->address(), [this, packet, len]() {
+    return i2c_dev->write(packet, len);
+  });
+  profile.setAck(ack);
+  return ack;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads bytes of the register selected by the last command
+            (recorded by I2cProfiler, retried by I2cBusRecovery)
+    @param packet buffer for the read bytes
+    @param len number of bytes to read
+    @returns True if the read was acknowledged
+*/
+/**************************************************************************/
+bool DAC80501::readPacket(uint8_t *packet, const size_t len) {
+  I2cProfileScope profile(i2c_dev->address(), E_I2cComponent::DAC80501, len);
+  const bool ack = I2cRecovery.execute(i2c_dev->address(), [this, packet, len]() {
+    return i2c_dev->read(packet, len, true);
+  });
+  I2cRecovery.filterRead(i2c_dev->address(), packet, len);
+  profile.setAck(ack);
+  return ack;
+}
@@ -10,6 +10,9 @@
 #include <Adafruit_BusIO_Register.h>
 #include <Adafruit_I2CDevice.h>
 #include <Wire.h>
+#include <new>
+#include "I2cProfiler.h"
+#include "I2cBusRecovery.h"
 
 
 constexpr uint8_t DAC80501_I2CADDR_DEFAULT=0x48; ///< Default i2c address
@@ -86,20 +89,36 @@ public:
 
 public:
   DAC80501();
+  ~DAC80501();
+  DAC80501(const DAC80501 &) = delete;
+  DAC80501 &operator=(const DAC80501 &) = delete;
   bool begin(uint8_t i2c_address = DAC80501_I2CADDR_DEFAULT,
              TwoWire *wire = &Wire);
   
   bool init(void);
+  bool reset(void);
+  bool configure(void);
+
+  // time to wait after reset() before configure() [ms]
+  static constexpr uint32_t RESET_TIME_MS = 10;
 
   bool setVoltage(const uint16_t output,
-                  const uint32_t dac_frequency = 400000);
+                  const uint32_t dac_frequency = 0);
 
   bool setVoltage(const float output,
-                  const uint32_t dac_frequency = 400000);
+                  const uint32_t dac_frequency = 0);
 
 private:
   Adafruit_I2CDevice *i2c_dev = NULL;
-  float DAC_VOLT2LSB = 0.0;
+
+  // in-object storage for i2c_dev (no heap allocation)
+  alignas(Adafruit_I2CDevice) uint8_t i2c_dev_storage[sizeof(Adafruit_I2CDevice)];
+
+  bool writePacket(const uint8_t *packet, const size_t len);
+  bool readPacket(uint8_t *packet, const size_t len);
+
+  // VFS=2.5V (REFDIV_2, BUFGAIN_2) for the conversion of volts to LSB
+  static constexpr float DAC_VOLT2LSB = 65535 / 2.5;
   
 };
 
@@ -8,14 +8,11 @@
     */
 bool EH_LED::setMode(const E_IllumiMode& mode, const uint16_t& period ) {
     LED_mode = mode;
-    blink_flag = true;
     if (0 == period || period>200) {
         blink_period = DEFAULT_BLINK_PERIOD;
-        blink_count = blink_period;
         return false;
     } else {
         blink_period = period;
-        blink_count = blink_period;
     }
     return true;
 };
@@ -33,11 +30,7 @@ void EH_LED::clk_in(void){
             digitalWrite(LED_port_number, HIGH);
         } 
         else if (LED_mode==E_IllumiMode::BLINK) {
-            if (--blink_count == 0){
-                blink_count  = blink_period;
-                blink_flag = !blink_flag;
-            } 
-            if (blink_flag) {
+            if (BlinkPhase::isOn(blink_period)) {
                 digitalWrite(LED_port_number, HIGH);
             } else {
                 digitalWrite(LED_port_number, LOW);
@@ -45,8 +38,6 @@ void EH_LED::clk_in(void){
         }
     } else {    //消灯状態
         digitalWrite(LED_port_number, LOW);
-        blink_count = blink_period;
-        blink_flag = true;
     }
 
     if(acquire_resource){
@@ -9,6 +9,7 @@
  *      2023/6/23   コーディング開始
  *      2023/6/28   V1.0完成
  *      2023/8/22   V1.1 占有処理など見直し
+ *      2026/10/19  点滅の位相をBlinkPhaseで共通化
  *      
  */
 /**************************************************************************/
@@ -17,6 +18,7 @@
 #define _EH_LED_H_
 
 #include <Arduino.h>
+#include "BlinkPhase.h"
 
 /*!
  * @class   EH_LED
@@ -161,14 +163,8 @@ class EH_LED {
         // LEDの点灯モード設定 
         E_IllumiMode LED_mode = DEFAULT_ILLUMI_MODE;
 
-        // 点滅周期設定[CLK count]
-        uint16_t blink_period = 0;
-
-        // 点滅モード時のCLKカウント用
-        uint16_t blink_count =0;
-
-        // BLINKモードでの点灯／消灯の状態を示すフラグ
-        bool blink_flag = false;
+        // 点滅周期設定[CLK count]  位相はBlinkPhaseで全ての点滅表示に共通
+        uint16_t blink_period = DEFAULT_BLINK_PERIOD;
 
         // 内部でのLED状態を示す True:点灯  False:消灯
         bool LED_state = false;
@@ -0,0 +1,95 @@
+#include "I2cBusClock.h"
+
+I2cBusClock I2cClock;
+
+/// @brief バスクロック管理の開始
+/// @param wire 管理するI2Cバス
+/// @note Wire.begin()の後に呼び出す。バスはアクティブなデバイスの共通クロックに設定される
+void I2cBusClock::begin(TwoWire* wire){
+    i2c_wire = wire;
+    updateCommonClock();
+    present_clock = common_clock;
+    i2c_wire->setClock(present_clock);
+    return;
+}
+
+/// @brief 共通クロックの計算対象にするデバイスを設定する
+/// @param address デバイスのI2Cアドレス
+/// @param active True:対象にする    False:対象から外す
+void I2cBusClock::setActive(const uint16_t address, const bool active){
+    for (size_t i = 0; i < device_count; i++){
+        if (profiles[i].address == address){
+            profiles[i].active = active;
+        }
+    }
+    updateCommonClock();
+    return;
+}
+
+/// @brief 指定のデバイスにアクセスする前に呼び出し、バスクロックを合わせる
+/// @param address これからアクセスするデバイスのI2Cアドレス
+/// @return 設定されたバスクロック[Hz]
+/// @note 共通クロックとデバイスの最大クロックの低い方に設定する。変化がなければ何もしない
+uint32_t I2cBusClock::select(const uint16_t address){
+    const uint32_t device_clock = getMaxClock(address);
+    const uint32_t target = (device_clock < common_clock) ? device_clock : common_clock;
+
+    if (target != present_clock && i2c_wire){
+        i2c_wire->setClock(target);
+        present_clock = target;
+        switch_count++;
+        if(DEBUG){Serial.print("I2C clock: "); Serial.println(present_clock);}
+    }
+    return present_clock;
+}
+
+/// @brief ドライバ内部でバスクロックが変更されたことを通知する
+/// @param clock 変更後のバスクロック[Hz]
+/// @note Adafruit_MCP4725::setVoltage()などは書き込み後に100kHzに戻すので、その後に呼び出す
+void I2cBusClock::notifyClock(const uint32_t clock){
+    present_clock = clock;
+    return;
+}
+
+/// @brief 現在のバスクロックを返す
+/// @return バスクロック[Hz]
+uint32_t I2cBusClock::getClock(void){
+    return present_clock;
+}
+
+/// @brief アクティブなデバイスに共通の最高クロックを返す
+/// @return バスクロック[Hz]
+uint32_t I2cBusClock::getCommonClock(void){
+    return common_clock;
+}
+
+/// @brief デバイスの最大クロックを返す
+/// @param address デバイスのI2Cアドレス
+/// @return 最大クロック[Hz]    一覧にないデバイスは STANDARD_MODE
+uint32_t I2cBusClock::getMaxClock(const uint16_t address){
+    for (size_t i = 0; i < device_count; i++){
+        if (profiles[i].address == address){
+            return profiles[i].max_clock;
+        }
+    }
+    return STANDARD_MODE;
+}
+
+/// @brief クロックを切り替えた回数を返す
+/// @return 切り替え回数
+uint32_t I2cBusClock::getSwitchCount(void){
+    return switch_count;
+}
+
+/// @brief アクティブなデバイスの最大クロックの最小値を共通クロックとする (private)
+/// @note アクティブなデバイスがなければ STANDARD_MODE
+void I2cBusClock::updateCommonClock(void){
+    uint32_t clock = 0;
+    for (size_t i = 0; i < device_count; i++){
+        if (profiles[i].active && (clock == 0 || profiles[i].max_clock < clock)){
+            clock = profiles[i].max_clock;
+        }
+    }
+    common_clock = (clock == 0) ? STANDARD_MODE : clock;
+    return;
+}
@@ -0,0 +1,102 @@
+/**************************************************************************/
+/*!
+ * @file I2cBusClock.h/cpp
+ * @brief I2Cバスのクロック管理  デバイスごとの最大クロックを基にバス速度を切り替える
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    通常はアクティブなデバイス（計測用IC, FRAM）に共通の最高速度でバスを動かし、
+ *    遅いデバイス（Grove LCD）をアクセスするときだけ速度を落とす。
+ *    クロックの切り替えは速度が変わるときのみ行う。
+ */
+/**************************************************************************/
+
+#ifndef _I2CBUSCLOCK_H_
+#define _I2CBUSCLOCK_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "measUnitParameters.h"
+
+class I2cBusClock {
+
+    public:
+    // consts
+
+    // I2Cバスのクロック [Hz]
+    static constexpr uint32_t STANDARD_MODE = 100000;
+    static constexpr uint32_t FAST_MODE = 400000;
+    static constexpr uint32_t FAST_MODE_PLUS = 1000000;
+
+    // methods
+    /*!
+    * @brief constructor
+    */
+    I2cBusClock(){
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~I2cBusClock(){
+    };
+
+    void begin(TwoWire* wire = &Wire);
+
+    void setActive(const uint16_t address, const bool active);
+    uint32_t select(const uint16_t address);
+    void notifyClock(const uint32_t clock);
+
+    uint32_t getClock(void);
+    uint32_t getCommonClock(void);
+    uint32_t getMaxClock(const uint16_t address);
+    uint32_t getSwitchCount(void);
+
+    private:
+    // consts
+
+    // debug flag
+    static constexpr bool DEBUG = false;
+
+    // types
+    /// @brief デバイスごとのクロックプロファイル
+    struct DeviceProfile{
+        uint16_t address;   // I2Cアドレス
+        uint32_t max_clock; // デバイスの最大クロック [Hz]  (HSモードは使わない)
+        bool active;        // 共通クロックの計算対象とするか
+    };
+
+    // vars
+    TwoWire* i2c_wire = nullptr;
+
+    //  デバイスの一覧  I2C_ADDRに定義されたもの
+    //      LCDは必要な時だけ速度を落として使うので、共通クロックの計算対象にしない
+    static constexpr size_t device_count = 6;
+    DeviceProfile profiles[device_count] = {
+        {   .address = I2C_ADDR::ADC,           .max_clock = FAST_MODE,       .active = false },  // ADS1115
+        {   .address = I2C_ADDR::CURRENT_ADJ,   .max_clock = FAST_MODE,       .active = false },  // MCP4725
+        {   .address = I2C_ADDR::V_MON,         .max_clock = FAST_MODE_PLUS,  .active = false },  // DAC80501
+        {   .address = I2C_ADDR::PIO,           .max_clock = FAST_MODE,       .active = false },  // MCP23008
+        {   .address = I2C_ADDR::FRAM,          .max_clock = FAST_MODE_PLUS,  .active = false },  // MB85RC256V
+        {   .address = I2C_ADDR::LCD,           .max_clock = STANDARD_MODE,   .active = false }   // Grove LCD
+    };
+
+    // 現在のバスクロック  Arduinoのデフォルトから始まる
+    uint32_t present_clock = STANDARD_MODE;
+
+    // アクティブなデバイスに共通の最高クロック
+    uint32_t common_clock = STANDARD_MODE;
+
+    // クロックを切り替えた回数
+    uint32_t switch_count = 0;
+
+    // methods
+    void updateCommonClock(void);
+};
+
+// バス全体で共有するインスタンス
+extern I2cBusClock I2cClock;
+
+#endif //_I2CBUSCLOCK_H_
@@ -0,0 +1,209 @@
+#include "I2cBusRecovery.h"
+#include "I2cBusClock.h"
+
+I2cBusRecovery I2cRecovery;
+
+// コアの転送のタイムアウトが長いと、execute()がSTALL_LIMIT_USを超えて止まる
+#if defined(I2C_TIMEOUT_TICK) && (I2C_TIMEOUT_TICK > EH_I2C_TIMEOUT_MS)
+#warning "I2C_TIMEOUT_TICK is longer than EH_I2C_TIMEOUT_MS: set it in build_opt.h"
+#endif
+
+/// @brief バス復旧の準備
+/// @param wire 管理するI2Cバス
+/// @param pin_sda SDAのピン番号
+/// @param pin_scl SCLのピン番号
+/// @note Wire.begin()の後に呼び出す。呼び出す前はバス復旧を行わない
+void I2cBusRecovery::begin(TwoWire* wire, const uint32_t pin_sda, const uint32_t pin_scl){
+    i2c_wire = wire;
+    sda_pin = pin_sda;
+    scl_pin = pin_scl;
+    return;
+}
+
+/// @brief デバイスが応答するかをリトライ付きで確認する
+/// @param address デバイスのI2Cアドレス
+/// @return True:応答あり  False:応答なし
+/// @note エラーを返さないドライバ（ADS1115など）の前後で使う
+bool I2cBusRecovery::check(const uint16_t address){
+    return execute(address, [this, address](){ return probe(address); });
+}
+
+/// @brief アドレスのみのトランザクションでデバイスの応答(ACK)を確認する
+/// @param address デバイスのI2Cアドレス
+/// @return True:ACK  False:NACK もしくはバスエラー
+bool I2cBusRecovery::probe(const uint16_t address){
+    if (!i2c_wire){
+        return true;
+    }
+    i2c_wire->beginTransmission(address);
+    return (i2c_wire->endTransmission() == 0);
+}
+
+/// @brief SDAがLOWに張り付いているかを確認する
+/// @return True:張り付いている   False:正常
+/// @note バスがアイドルの時に呼び出すこと
+bool I2cBusRecovery::isBusStuck(void){
+    if (stuck_injected){
+        return true;
+    }
+    if (!i2c_wire){
+        return false;
+    }
+    return (digitalRead(sda_pin) == LOW);
+}
+
+/// @brief SCLをクロックアウトしてバスを復旧する
+/// @return True:SDAが解放された   False:復旧できなかった
+/// @note SDAを握っているスレーブに最大9クロックを与えて転送を終わらせ、STOPを出す。
+///       その後Wireを初期化し直すので、バスクロックはI2cClockで設定し直す
+bool I2cBusRecovery::recoverBus(void){
+    const uint32_t start_us = micros();
+    bool released = true;
+
+    if (i2c_wire){
+        i2c_wire->end();
+        pinMode(sda_pin, INPUT_PULLUP);
+        pinMode(scl_pin, OUTPUT_OPEN_DRAIN);
+        digitalWrite(scl_pin, HIGH);
+
+        for (uint8_t i = 0; i < RECOVERY_CLOCKS && digitalRead(sda_pin) == LOW; i++){
+            digitalWrite(scl_pin, LOW);
+            delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+            digitalWrite(scl_pin, HIGH);
+            delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        }
+        released = (digitalRead(sda_pin) == HIGH);
+
+        // STOP: SCL=HIGHの間にSDAをLOWからHIGHにする
+        pinMode(sda_pin, OUTPUT_OPEN_DRAIN);
+        digitalWrite(scl_pin, LOW);
+        digitalWrite(sda_pin, LOW);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        digitalWrite(scl_pin, HIGH);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        digitalWrite(sda_pin, HIGH);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+
+        i2c_wire->begin();
+        I2cClock.notifyClock(I2cBusClock::STANDARD_MODE);
+    }
+
+    // 故障注入の張り付きは1回の復旧で解除する
+    stuck_injected = false;
+
+    last_recovery_us = micros() - start_us;
+    if (last_recovery_us > max_recovery_us){
+        max_recovery_us = last_recovery_us;
+    }
+    recovery_count++;
+    if(DEBUG){Serial.print("I2C bus recovery: "); Serial.print(released); Serial.print(" "); Serial.println(last_recovery_us);}
+
+    return released;
+}
+
+/// @brief デバイスの健全性を返す
+/// @param address デバイスのI2Cアドレス
+/// @return 健全性
+I2cBusRecovery::E_Health I2cBusRecovery::getHealth(const uint16_t address){
+    return findDevice(address).health;
+}
+
+/// @brief デバイスごとの健全性の記録を返す
+/// @param index 0 -- DEVICE_COUNT-1
+/// @return 健全性の記録
+const I2cBusRecovery::DeviceHealth& I2cBusRecovery::getDeviceHealth(const size_t index){
+    return devices[(index < DEVICE_COUNT) ? index : DEVICE_COUNT - 1];
+}
+
+/// @brief バス復旧の回数を返す
+/// @return 回数
+uint32_t I2cBusRecovery::getRecoveryCount(void){
+    return recovery_count;
+}
+
+/// @brief 最後のバス復旧にかかった時間を返す
+/// @return 時間 [us]
+uint32_t I2cBusRecovery::getLastRecoveryTime(void){
+    return last_recovery_us;
+}
+
+/// @brief バス復旧にかかった時間の最大値を返す
+/// @return 時間 [us]
+uint32_t I2cBusRecovery::getMaxRecoveryTime(void){
+    return max_recovery_us;
+}
+
+/// @brief execute()1回にかかった時間の最大値を返す
+/// @return 時間 [us]
+/// @note 10ms周期の処理が止まる最長時間の目安。STALL_BUDGET_USとの比較に使う
+uint32_t I2cBusRecovery::getMaxStallTime(void){
+    return max_stall_us;
+}
+
+#if EH_I2C_FAULT_INJECTION
+/// @brief 故障を注入する
+/// @param address 故障させるデバイスのI2Cアドレス
+/// @param fault 故障の種類
+/// @param count 故障させる試行回数  MAX_ATTEMPTS以上でリトライでも回復しない
+void I2cBusRecovery::injectFault(const uint16_t address, const E_Fault fault, const uint8_t count){
+    fault_address = address;
+    I2cBusRecovery::fault = fault;
+    fault_count = count;
+    return;
+}
+#endif
+
+/// @brief アドレスに対応する健全性の記録を探す (private)
+/// @param address デバイスのI2Cアドレス
+/// @return 健全性の記録  一覧にないものは最後の要素
+I2cBusRecovery::DeviceHealth& I2cBusRecovery::findDevice(const uint16_t address){
+    size_t index = 0;
+    while (index < DEVICE_COUNT - 1 && devices[index].address != address){
+        index++;
+    }
+    return devices[index];
+}
+
+/// @brief デバイスにアクセスしてよいか (private)
+/// @return True:アクセスする   False:FAILEDで再アクセスの時間に達していない
+bool I2cBusRecovery::shouldAttempt(const DeviceHealth& device){
+    if (device.health != E_Health::FAILED){
+        return true;
+    }
+    return (millis() - device.last_failure_ms >= FAILED_RETRY_INTERVAL_MS);
+}
+
+/// @brief execute()の結果を健全性に反映する (private)
+void I2cBusRecovery::reportResult(DeviceHealth& device, const bool result, const uint32_t elapsed_us){
+    if (elapsed_us > max_stall_us){
+        max_stall_us = elapsed_us;
+    }
+
+    if (result){
+        device.health = E_Health::HEALTHY;
+        device.consecutive_failures = 0;
+        return;
+    }
+
+    device.failures++;
+    device.last_failure_ms = millis();
+    if (device.consecutive_failures < UINT8_MAX){
+        device.consecutive_failures++;
+    }
+    device.health = (device.consecutive_failures >= FAILED_THRESHOLD) ? E_Health::FAILED : E_Health::DEGRADED;
+    if(DEBUG){Serial.print("I2C fail: "); Serial.print(device.address, HEX); Serial.print(" "); Serial.println(device.consecutive_failures);}
+    return;
+}
+
+/// @brief 注入された故障を1回分取り出す (private)
+/// @return 故障の種類  注入がなければNONE
+I2cBusRecovery::E_Fault I2cBusRecovery::takeFault(const uint16_t address){
+    if (!EH_I2C_FAULT_INJECTION || fault_count == 0 || fault_address != address){
+        return E_Fault::NONE;
+    }
+    fault_count--;
+    if (fault == E_Fault::CORRUPT){
+        corrupt_address = address;
+    }
+    return fault;
+}
@@ -0,0 +1,242 @@
+/**************************************************************************/
+/*!
+ * @file I2cBusRecovery.h/cpp
+ * @brief I2Cバスのリトライ・バス復旧とデバイスごとの健全性の管理
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    execute()でドライバ呼び出しを包み、失敗時は回数と時間を制限してリトライする。
+ *    SDAがLOWに張り付いている場合はSCLを最大9回クロックアウトしてSTOPを出し、バスを復旧する。
+ *    続けて失敗したデバイスはFAILEDとし、一定時間アクセスしない（10ms周期の処理を止めないため）。
+ *
+ *    EH_I2C_FAULT_INJECTION=1 でビルドすると故障注入（NACK, タイムアウト, データ化け, バス張り付き）
+ *    が使えるようになる。ホスト側のシミュレーションや評価用。
+ */
+/**************************************************************************/
+
+#ifndef _I2CBUSRECOVERY_H_
+#define _I2CBUSRECOVERY_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "measUnitParameters.h"
+
+#ifndef EH_I2C_FAULT_INJECTION
+#define EH_I2C_FAULT_INJECTION 0
+#endif
+
+// 1回の転送（STARTからSTOPまで）のタイムアウト [ms]
+//  STM32コアのWireはI2C_TIMEOUT_TICK [ms]（デフォルト100ms）まで待つので、
+//  スケッチのbuild_opt.hで -DI2C_TIMEOUT_TICK=4 としてこの値に合わせる
+//  100kHzで32byte（Wireのバッファ長）の転送が約3msなので、それより長くする
+#ifndef EH_I2C_TIMEOUT_MS
+#define EH_I2C_TIMEOUT_MS 4
+#endif
+
+class I2cBusRecovery {
+
+    public:
+    // consts
+
+    /// @brief デバイスの健全性
+    enum class E_Health : uint8_t {
+        HEALTHY = 0,    // 正常
+        DEGRADED,       // 直近に失敗あり（リトライで回復していない）
+        FAILED          // 続けて失敗  一定時間アクセスを止める
+    };
+
+    /// @brief 注入する故障の種類
+    enum class E_Fault : uint8_t {
+        NONE = 0,
+        NACK,       // 応答なし
+        TIMEOUT,    // 応答が遅れたうえで失敗
+        CORRUPT,    // 読み出したデータが化ける
+        STUCK_BUS   // SDAがLOWに張り付く
+    };
+
+    // 1回のexecute()での最大試行回数
+    static constexpr uint8_t MAX_ATTEMPTS = 3;
+
+    // 1回のexecute()でリトライを続けてよい時間 [us]  これを超えたらリトライしない
+    //  確認はリトライの前だけなので、execute()1回の最長はSTALL_LIMIT_US
+    static constexpr uint32_t STALL_BUDGET_US = 3000;
+
+    // 1回の転送の最長 [us]  クロックストレッチが続いてもWireのタイムアウトで打ち切られる
+    static constexpr uint32_t TRANSFER_TIMEOUT_US = EH_I2C_TIMEOUT_MS * 1000UL;
+
+    // バス復旧時のSCLの半周期 [us]  (約100kHz)
+    static constexpr uint32_t RECOVERY_HALF_PERIOD_US = 5;
+
+    // バス復旧時の最大クロック数
+    static constexpr uint8_t RECOVERY_CLOCKS = 9;
+
+    // バス復旧1回の最長 [us]  クロックアウトとSTOP
+    static constexpr uint32_t RECOVERY_MAX_US = (RECOVERY_CLOCKS * 2 + 3) * RECOVERY_HALF_PERIOD_US;
+
+    // execute()1回の最長 [us]  予算の直前に始めた最後の試行が、バス復旧のあとタイムアウトまで続いた場合
+    //  試行1回が転送1回（check()など）の場合  転送がn回の処理はタイムアウトもn回分になる
+    //  ADS1115の変換はexecute()の外（check()で前後の応答を確認する）  リトライしないので、
+    //  1回の変換の最長は変換待ち(8ms) + 転送3回分のタイムアウト
+    //  故障の種類ごとの実測は extras/host/sim_i2c_recovery.cpp
+    static constexpr uint32_t STALL_LIMIT_US = STALL_BUDGET_US + RECOVERY_MAX_US + TRANSFER_TIMEOUT_US;
+
+    // FAILEDとするまでの連続失敗回数
+    static constexpr uint8_t FAILED_THRESHOLD = 3;
+
+    // FAILEDのデバイスに再度アクセスするまでの時間 [ms]
+    static constexpr uint32_t FAILED_RETRY_INTERVAL_MS = 1000;
+
+    //  管理するデバイス数  I2C_ADDRの6個 + 一覧にないもの
+    static constexpr size_t DEVICE_COUNT = 7;
+
+    // types
+    /// @brief デバイスごとの健全性の記録
+    struct DeviceHealth{
+        uint16_t address;
+        E_Health health;
+        uint8_t consecutive_failures;   // 連続失敗回数
+        uint32_t failures;              // 失敗回数の累計（リトライで回復しなかったもの）
+        uint32_t retries;               // リトライ回数の累計
+        uint32_t last_failure_ms;       // 最後に失敗した時刻 [ms]
+    };
+
+    // methods
+    /*!
+    * @brief constructor
+    */
+    I2cBusRecovery(){
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~I2cBusRecovery(){
+    };
+
+    void begin(TwoWire* wire = &Wire, const uint32_t pin_sda = PIN_WIRE_SDA, const uint32_t pin_scl = PIN_WIRE_SCL);
+
+    /// @brief ドライバ呼び出しをリトライ・バス復旧付きで実行する
+    /// @param address デバイスのI2Cアドレス
+    /// @param transaction 実行する処理  成功でtrueを返すこと
+    /// @return True:成功  False:失敗（リトライでも回復せず、もしくはFAILEDで実行せず）
+    template <typename F>
+    bool execute(const uint16_t address, F transaction){
+        DeviceHealth& device = findDevice(address);
+        if (!shouldAttempt(device)){
+            return false;
+        }
+
+        const uint32_t start_us = micros();
+        bool result = false;
+        for (uint8_t attempt = 0; attempt < MAX_ATTEMPTS && !result; attempt++){
+            if (attempt != 0){
+                if (micros() - start_us > STALL_BUDGET_US){
+                    break;
+                }
+                device.retries++;
+                if (isBusStuck()){
+                    recoverBus();
+                }
+            }
+            switch (takeFault(address)){
+                case E_Fault::NACK :
+                    result = false;
+                    break;
+                case E_Fault::TIMEOUT :
+                    delayMicroseconds(INJECTED_TIMEOUT_US);
+                    result = false;
+                    break;
+                case E_Fault::STUCK_BUS :
+                    stuck_injected = true;
+                    result = false;
+                    break;
+                default:
+                    result = transaction();
+                    break;
+            }
+        }
+
+        reportResult(device, result, micros() - start_us);
+        return result;
+    };
+
+    bool check(const uint16_t address);
+    bool probe(const uint16_t address);
+    bool isBusStuck(void);
+    bool recoverBus(void);
+
+    /// @brief 読み出したデータを通す（故障注入時はデータを化けさせる）
+    /// @param address デバイスのI2Cアドレス
+    /// @param data 読み出したデータ
+    /// @param len データ長
+    void filterRead(const uint16_t address, uint8_t* data, const size_t len){
+        if (EH_I2C_FAULT_INJECTION && corrupt_address == address && len != 0){
+            corrupt_address = 0;
+            data[0] = ~data[0];
+        }
+    };
+
+    E_Health getHealth(const uint16_t address);
+    const DeviceHealth& getDeviceHealth(const size_t index);
+    uint32_t getRecoveryCount(void);
+    uint32_t getLastRecoveryTime(void);
+    uint32_t getMaxRecoveryTime(void);
+    uint32_t getMaxStallTime(void);
+
+#if EH_I2C_FAULT_INJECTION
+    void injectFault(const uint16_t address, const E_Fault fault, const uint8_t count = 1);
+#endif
+
+    private:
+    // consts
+
+    // debug flag
+    static constexpr bool DEBUG = false;
+
+    // 故障注入時のタイムアウトの長さ [us]
+    static constexpr uint32_t INJECTED_TIMEOUT_US = 1000;
+
+    // vars
+    TwoWire* i2c_wire = nullptr;
+    uint32_t sda_pin = 0;
+    uint32_t scl_pin = 0;
+
+    //  デバイスごとの健全性  最後のものは一覧にないデバイス
+    DeviceHealth devices[DEVICE_COUNT] = {
+        { I2C_ADDR::ADC,         E_Health::HEALTHY, 0, 0, 0, 0 },
+        { I2C_ADDR::CURRENT_ADJ, E_Health::HEALTHY, 0, 0, 0, 0 },
+        { I2C_ADDR::V_MON,       E_Health::HEALTHY, 0, 0, 0, 0 },
+        { I2C_ADDR::PIO,         E_Health::HEALTHY, 0, 0, 0, 0 },
+        { I2C_ADDR::FRAM,        E_Health::HEALTHY, 0, 0, 0, 0 },
+        { I2C_ADDR::LCD,         E_Health::HEALTHY, 0, 0, 0, 0 },
+        { 0,                     E_Health::HEALTHY, 0, 0, 0, 0 }
+    };
+
+    // バス復旧の記録
+    uint32_t recovery_count = 0;
+    uint32_t last_recovery_us = 0;
+    uint32_t max_recovery_us = 0;
+
+    // execute()1回あたりの最大所要時間 [us]
+    uint32_t max_stall_us = 0;
+
+    // 故障注入
+    uint16_t fault_address = 0;
+    E_Fault fault = E_Fault::NONE;
+    uint8_t fault_count = 0;
+    uint16_t corrupt_address = 0;
+    bool stuck_injected = false;
+
+    // methods
+    DeviceHealth& findDevice(const uint16_t address);
+    bool shouldAttempt(const DeviceHealth& device);
+    void reportResult(DeviceHealth& device, const bool result, const uint32_t elapsed_us);
+    E_Fault takeFault(const uint16_t address);
+};
+
+// バス全体で共有するインスタンス
+extern I2cBusRecovery I2cRecovery;
+
+#endif //_I2CBUSRECOVERY_H_
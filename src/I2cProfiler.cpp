@@ -0,0 +1,88 @@
+#include "I2cProfiler.h"
+
+#if EH_I2C_PROFILE
+
+I2cProfiler I2cProf;
+
+constexpr uint16_t I2cProfiler::device_address[];
+
+/// @brief ドライバ呼び出し1回分を記録する
+/// @param address デバイスのI2Cアドレス
+/// @param component 呼び出し元
+/// @param transactions トランザクション数
+/// @param bytes 転送バイト数
+/// @param ack True:正常   False:NACK（失敗）
+/// @param elapsed_us 所要時間[us]
+void I2cProfiler::record(const uint16_t address, const E_I2cComponent component,
+                         const uint16_t transactions, const uint16_t bytes, const bool ack, const uint32_t elapsed_us){
+    size_t index = 0;
+    while (index < DEVICE_COUNT - 1 && device_address[index] != address){
+        index++;
+    }
+    accumulate(device_stats[index], transactions, bytes, ack, elapsed_us);
+    accumulate(component_stats[static_cast<uint8_t>(component)], transactions, bytes, ack, elapsed_us);
+    return;
+}
+
+/// @brief 集計値をクリアする
+void I2cProfiler::clear(void){
+    for (size_t i = 0; i < DEVICE_COUNT; i++){
+        device_stats[i] = Stat();
+    }
+    for (size_t i = 0; i < COMPONENT_COUNT; i++){
+        component_stats[i] = Stat();
+    }
+    return;
+}
+
+/// @brief 集計対象のデバイスのアドレスを返す
+/// @param index 0 -- DEVICE_COUNT-1
+/// @return I2Cアドレス    0は一覧にないデバイスの集計
+uint16_t I2cProfiler::getDeviceAddress(const size_t index){
+    return device_address[(index < DEVICE_COUNT) ? index : DEVICE_COUNT - 1];
+}
+
+/// @brief デバイスごとの集計値を返す
+/// @param index 0 -- DEVICE_COUNT-1
+/// @return 集計値
+const I2cProfiler::Stat& I2cProfiler::getDeviceStat(const size_t index){
+    return device_stats[(index < DEVICE_COUNT) ? index : DEVICE_COUNT - 1];
+}
+
+/// @brief 呼び出し元ごとの集計値を返す
+/// @param component 呼び出し元
+/// @return 集計値
+const I2cProfiler::Stat& I2cProfiler::getComponentStat(const E_I2cComponent component){
+    return component_stats[static_cast<uint8_t>(component)];
+}
+
+/// @brief 集計値に1回分を加える (private)
+void I2cProfiler::accumulate(Stat& stat, const uint16_t transactions, const uint16_t bytes, const bool ack, const uint32_t elapsed_us){
+    if (stat.calls == 0 || elapsed_us < stat.min_us){
+        stat.min_us = elapsed_us;
+    }
+    if (elapsed_us > stat.max_us){
+        stat.max_us = elapsed_us;
+    }
+    stat.calls++;
+    stat.transactions += transactions;
+    stat.bytes += bytes;
+    stat.total_us += elapsed_us;
+    if (!ack){
+        stat.nacks++;
+    }
+
+    // ヒストグラム  64us未満をbin0とし、2倍ごとにビンを進める
+    size_t bin = 0;
+    uint32_t limit = HISTOGRAM_FIRST_BIN_US;
+    while (bin < HISTOGRAM_BINS - 1 && elapsed_us >= limit){
+        bin++;
+        limit <<= 1;
+    }
+    if (stat.histogram[bin] != UINT16_MAX){
+        stat.histogram[bin]++;
+    }
+    return;
+}
+
+#endif  // EH_I2C_PROFILE
@@ -0,0 +1,157 @@
+/**************************************************************************/
+/*!
+ * @file I2cProfiler.h/cpp
+ * @brief I2Cトランザクションの計測  デバイス（アドレス）ごと、呼び出し元ごとにバス使用時間を集計する
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    EH_I2C_PROFILE=1 でビルドしたときのみ有効。
+ *    無効時はI2cProfileScopeが空のインライン関数になり、集計用のRAMも確保しない。
+ *    計測時間はドライバ呼び出し全体の時間（ADS1115の変換待ちなども含む）
+ */
+/**************************************************************************/
+
+#ifndef _I2CPROFILER_H_
+#define _I2CPROFILER_H_
+
+#include <Arduino.h>
+#include "measUnitParameters.h"
+
+#ifndef EH_I2C_PROFILE
+#define EH_I2C_PROFILE 0
+#endif
+
+/// @brief I2Cバスを使う呼び出し元の一覧
+enum class E_I2cComponent : uint8_t {
+    MEASUREMENT = 0,    // 計測ユニット (ADS1115, MCP4725, MCP23008)
+    DAC80501,           // アナログモニタ出力DA
+    PARAMETER_STORAGE,  // FRAM
+    LCD                 // Grove LCD
+};
+
+#if EH_I2C_PROFILE
+
+class I2cProfiler {
+
+    public:
+    // consts
+
+    // 所要時間のヒストグラムのビン数  64us未満から2倍ごと、最後のビンは4096us以上
+    static constexpr size_t HISTOGRAM_BINS = 8;
+    static constexpr uint32_t HISTOGRAM_FIRST_BIN_US = 64;
+
+    //  集計するデバイス数  I2C_ADDRの6個 + 一覧にないもの
+    static constexpr size_t DEVICE_COUNT = 7;
+    //  呼び出し元の数
+    static constexpr size_t COMPONENT_COUNT = 4;
+
+    // types
+    /// @brief 集計値
+    struct Stat{
+        uint32_t calls = 0;         // ドライバ呼び出し回数
+        uint32_t transactions = 0;  // トランザクション数
+        uint32_t bytes = 0;         // 転送バイト数（アドレスバイトは含まない）
+        uint32_t nacks = 0;         // NACK（失敗）回数
+        uint32_t total_us = 0;      // 所要時間の合計[us]
+        uint32_t min_us = 0;        // 所要時間の最小値[us]
+        uint32_t max_us = 0;        // 所要時間の最大値[us]
+        uint16_t histogram[HISTOGRAM_BINS] = {};  // 所要時間の分布（呼び出し回数）
+    };
+
+    // methods
+    /*!
+    * @brief constructor
+    */
+    I2cProfiler(){
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~I2cProfiler(){
+    };
+
+    void record(const uint16_t address, const E_I2cComponent component,
+                const uint16_t transactions, const uint16_t bytes, const bool ack, const uint32_t elapsed_us);
+    void clear(void);
+
+    uint16_t getDeviceAddress(const size_t index);
+    const Stat& getDeviceStat(const size_t index);
+    const Stat& getComponentStat(const E_I2cComponent component);
+
+    private:
+    // consts
+
+    //  集計対象のアドレス  最後の0は一覧にないデバイス
+    static constexpr uint16_t device_address[DEVICE_COUNT] = {
+        I2C_ADDR::ADC, I2C_ADDR::CURRENT_ADJ, I2C_ADDR::V_MON, I2C_ADDR::PIO,
+        I2C_ADDR::FRAM, I2C_ADDR::LCD, 0
+    };
+
+    // vars
+    Stat device_stats[DEVICE_COUNT];
+    Stat component_stats[COMPONENT_COUNT];
+
+    // methods
+    void accumulate(Stat& stat, const uint16_t transactions, const uint16_t bytes, const bool ack, const uint32_t elapsed_us);
+};
+
+// バス全体で共有するインスタンス
+extern I2cProfiler I2cProf;
+
+/*!
+ * @class   I2cProfileScope
+ * @brief   スコープの開始から終了までを1回のドライバ呼び出しとして記録する
+ */
+class I2cProfileScope {
+    public:
+    I2cProfileScope(const uint16_t address, const E_I2cComponent component,
+                    const uint16_t bytes, const uint16_t transactions = 1)
+        : address(address), component(component), transactions(transactions), bytes(bytes), start_us(micros()){
+    };
+
+    ~I2cProfileScope(){
+        I2cProf.record(address, component, transactions, bytes, ack, micros() - start_us);
+    };
+
+    /// @brief 結果を設定する
+    /// @param result True:ACK  False:NACK（失敗）
+    void setAck(const bool result){
+        ack = result;
+    };
+
+    /// @brief 転送量を実際の値に置き換える（途中で終了した場合など）
+    /// @param count_transactions トランザクション数
+    /// @param count_bytes 転送バイト数
+    void setTransfer(const uint16_t count_transactions, const uint16_t count_bytes){
+        transactions = count_transactions;
+        bytes = count_bytes;
+    };
+
+    private:
+    const uint16_t address;
+    const E_I2cComponent component;
+    uint16_t transactions;
+    uint16_t bytes;
+    const uint32_t start_us;
+    bool ack = true;
+};
+
+#else   // EH_I2C_PROFILE
+
+// 無効時：何もしない
+class I2cProfileScope {
+    public:
+    I2cProfileScope(const uint16_t, const E_I2cComponent, const uint16_t, const uint16_t = 1){
+    };
+    void setAck(const bool){
+    };
+    void setTransfer(const uint16_t, const uint16_t){
+    };
+};
+
+#endif  // EH_I2C_PROFILE
+
+#endif //_I2CPROFILER_H_
@@ -10,34 +10,412 @@
 */
 /**************************************************************************/
 #include "IotGateway.h"
+#include "Cobs.h"
+#include "Crc16.h"
+
+constexpr const char* IotGateway::schema_keys[];
+constexpr uint8_t IotGateway::schema_sizes[];
 
 
 void IotGateway::clk_in(void){
-    if (payload.length() != 0){
+    tick_count++;
+    if (link != E_Link::POINT_TO_POINT){
+        // RS-485では要求への応答だけを送る  値はpublish()の最新の値を応答する
+        if (link == E_Link::MULTIDROP){
+            receiveMultidrop();
+        } else {
+            receiveModbus();
+        }
+        drain();
+        releaseBus();
+        return;
+    }
+    receive();
+    evaluatePublish();
+    if (batch_count != 0 && batch_max_latency != 0 && tick_count - batch_start_tick >= batch_max_latency){
+        sendBatch();
+    }
+    if (writer.length() != 0 || record_length != 0){
         sendPayload();
     }
+    drain();
     return;
 }
 
+/*!
+    @brief  送信リングバッファからUARTの送信バッファの空きの分だけ送る  メインループから呼び出す
+    @note   clk_in()だけでは、1CLKに送れるのはUARTの送信バッファ(SERIAL_TX_BUFFER_SIZE, STM32コアのデフォルトは64byte)まで
+            なので、6.4kB/s（64000baud相当）が上限になる  115200baud(11.5kB/s)で送り続ける場合は、
+            メインループからも呼び出すか、SERIAL_TX_BUFFER_SIZEを128以上にする（1CLKの115byteが入る）
+            clk_in()と同じコンテキストから呼び出すこと（割り込みからは呼び出さない）
+*/
+void IotGateway::pollTx(void){
+  drain();
+  return;
+}
+
+/*!
+    @brief  payloadを { } で囲み、改行を付けて送信リングバッファに入れる
+    @return 送信リングバッファの空きバイト数
+    @note   payloadはクリアされます。送信はclk_in()で行うのでブロックしない
+            入りきらない場合は優先度に従って捨てる（enqueue()を参照）  優先度はsetPayloadPriority()を参照
+*/
+size_t IotGateway::sendPayload(void){
+  if (link != E_Link::POINT_TO_POINT){
+    // RS-485では勝手に送らない
+    clearPayload();
+    record_length = 0;
+    record_fields = 0;
+    takePayloadPriority();
+    return getTxFree();
+  }
+  if (framing == E_Framing::BINARY){
+    // バイナリ形式ではJSONのノードは送らない
+    clearPayload();
+    return sendRecords();
+  }
+
+  const size_t length = writer.length() + 4;  // { } CR LF
+  const E_Priority priority = takePayloadPriority();
+  if (!admit(length, priority, payload_fields)){
+    clearPayload();
+    return getTxFree();
+  }
+  static const uint8_t open_brace = '{';
+  static const uint8_t close_brace[] = {'}', '\r', '\n'};
+  push(&open_brace, 1);
+  push(reinterpret_cast<const uint8_t*>(writer.c_str()), writer.length());
+  push(close_brace, sizeof(close_brace));
+  clearPayload();
+  return getTxFree();
+}
+
+/*!
+    @brief  レコードをCOBSで符号化したフレームにして送信リングバッファに入れる   (private)
+    @return 送信リングバッファの空きバイト数
+    @note   フレーム  [種類][シーケンス番号][ID 値]...[CRC-16/MODBUS 下位 上位]  をCOBSで符号化し、0x00で区切る
+*/
+size_t IotGateway::sendRecords(void){
+  if (record_length == 0){
+    return getTxFree();
+  }
+  size_t length = 0;
+  frame_buffer[length++] = FRAME_TYPE_RECORDS;
+  frame_buffer[length++] = frame_sequence++;
+  memcpy(&frame_buffer[length], record_buffer, record_length);
+  length += record_length;
+  record_length = 0;
+  const uint32_t fields = record_fields;
+  record_fields = 0;
+  return sendFrame(frame_buffer, length, takePayloadPriority(), fields);
+}
+
+/*!
+    @brief  次に送るpayload, レコードの優先度を決め、指定なしに戻す   (private)
+    @return setPayloadPriority()で指定した優先度  指定がなければLEVEL
+    @note   指定なしのLEVELのフレームは値の組が同じものとだけまとめるので、スケッチが一定周期で送る値は
+            最新の1つになり、別のキーの値は捨てない  送信リングバッファが混んだ場合はALARMのために捨てる
+*/
+IotGateway::E_Priority IotGateway::takePayloadPriority(void){
+  const E_Priority priority = payload_tagged ? payload_priority : E_Priority::LEVEL;
+  payload_priority = E_Priority::ALARM;
+  payload_tagged = false;
+  return priority;
+}
+
+/*!
+    @brief  スケッチが加えたキーをpayloadの値の組に加える   (private)
+    @param key JSONのキー  setPayload()ではJSONデータ全体
+    @note   キーのハッシュ（FNV-1a）の和をとるので、加えた順によらない
+*/
+void IotGateway::addPayloadKey(const char* key){
+  uint32_t hash = 2166136261UL;
+  for (; *key != '\0'; key++){
+    hash = (hash ^ static_cast<uint8_t>(*key)) * 16777619UL;
+  }
+  const uint32_t keys = (payload_fields >> FIELD_KEY_SHIFT) + hash;
+  payload_fields = (payload_fields & (FIELD_SKETCH - 1)) | FIELD_SKETCH | (keys << FIELD_KEY_SHIFT);
+}
+
+/*!
+    @brief  バッチの液面を1フレームにして送信リングバッファに入れる   (private)
+    @return 送信リングバッファの空きバイト数
+    @note   フレーム  [種類][シーケンス番号][数][最初の時刻 uint32_t][最初の液面 uint16_t]
+                      [時刻の差分の差分 zigzag varint][液面の差分 zigzag varint]...[CRC-16/MODBUS]
+            一定周期の計測では時刻の差分の差分が0になり、1byteで済む
+            時刻が同期済みの場合は種類をFRAME_TYPE_BATCH_EPOCHとし、時刻はホストの時刻（最初の時刻は48bit）
+*/
+size_t IotGateway::sendBatch(void){
+  if (batch_count == 0){
+    return getTxFree();
+  }
+  const bool epoch = time_sync.isSynced();
+  size_t length = 0;
+  frame_buffer[length++] = epoch ? FRAME_TYPE_BATCH_EPOCH : FRAME_TYPE_BATCH;
+  frame_buffer[length++] = frame_sequence++;
+  frame_buffer[length++] = batch_count;
+  const uint64_t first_time = batchTime(0, epoch);
+  for (uint8_t i = 0; i < (epoch ? TIMESTAMP_SIZE : 4); i++){
+    frame_buffer[length++] = (first_time >> (8 * i)) & 0xFF;
+  }
+  frame_buffer[length++] = batch_levels[0] & 0xFF;
+  frame_buffer[length++] = batch_levels[0] >> 8;
+
+  int32_t previous_interval = 0;
+  for (uint8_t i = 1; i < batch_count; i++){
+    const int32_t interval = static_cast<int32_t>(batchTime(i, epoch) - batchTime(i - 1, epoch));
+    const int32_t time_delta = interval - previous_interval;
+    const int32_t level_delta = static_cast<int32_t>(batch_levels[i]) - batch_levels[i - 1];
+    // zigzag  0,-1,1,-2... を 0,1,2,3... にする
+    length += putVarint(&frame_buffer[length], (static_cast<uint32_t>(time_delta) << 1) ^ static_cast<uint32_t>(time_delta >> 31));
+    length += putVarint(&frame_buffer[length], (static_cast<uint32_t>(level_delta) << 1) ^ static_cast<uint32_t>(level_delta >> 31));
+    previous_interval = interval;
+  }
+  batch_count = 0;
+  return sendFrame(frame_buffer, length, E_Priority::BATCH, FIELDS_UNKNOWN);
+}
+
+/*!
+    @brief  バッチのi番目の液面の取得時刻   (private)
+    @param index バッチの位置
+    @param epoch True:ホストの時刻に変換する   False:millis()のまま
+    @return 時刻 [ms]
+*/
+uint64_t IotGateway::batchTime(const uint8_t index, const bool epoch){
+  uint64_t time = batch_times[index];
+  if (epoch){
+    time_sync.toEpoch(batch_times[index], time);
+  }
+  return time;
+}
+
+/*!
+    @brief  フレームにCRCを付け、COBSで符号化して送信リングバッファに入れる   (private)
+    @param frame フレーム  CRCの2byteを書き足せる長さがあること
+    @param length CRCを除く長さ
+    @param priority 優先度
+    @param fields 値の組
+    @return 送信リングバッファの空きバイト数
+*/
+size_t IotGateway::sendFrame(uint8_t* frame, size_t length, const E_Priority priority, const uint32_t fields){
+  const uint16_t crc = Crc16::modbus(frame, length);
+  frame[length++] = crc & 0xFF;
+  frame[length++] = crc >> 8;
+
+  uint8_t encoded[Cobs::maxEncodedLength(BATCH_FRAME_SIZE) + 1];
+  size_t encoded_length = Cobs::encode(frame, length, encoded);
+  encoded[encoded_length++] = Cobs::DELIMITER;
+  return enqueue(encoded, encoded_length, priority, fields);
+}
+
+/*!
+    @brief  符号なし整数をvarint（7bitずつ、下位から、bit7:続きあり）で書き込む   (private)
+    @param buffer 書き込み先  5byte以上
+    @param value 値
+    @return 書き込んだ長さ
+*/
+size_t IotGateway::putVarint(uint8_t* buffer, uint32_t value){
+  size_t length = 0;
+  while (value >= 0x80){
+    buffer[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  buffer[length++] = value;
+  return length;
+}
+
+/*!
+    @brief  1フレームを送信リングバッファに入れる
+    @param data フレーム
+    @param length データ長
+    @param priority 優先度
+    @param fields 値の組（FIELD_*, スキーマIDのビット）  FIELDS_UNKNOWN:まとめない
+    @note   入りきらない場合は送信待ちのフレームのうち優先度の低いものから捨てて空ける
+            LEVELのフレームは、送信待ちのLEVELのうち値の組が同じものを捨てて最新の1つにする（getTxCoalescedCount()で確認）
+            値の組の一部だけを送るフレーム（publish()の変化した値だけなど）は、別の組のフレームの値を捨てない
+            それでも入りきらない場合は何も入れずに捨てる（getTxDroppedCount()で確認）
+            ALARMは捨てられないので、送信待ちのALARMと送信中のフレームでTX_RING_SIZE（1024byte）,
+            TX_FRAME_QUEUE_SIZE（32フレーム）を超える分だけが捨てられる  UARTの速さを超えて送り続けないこと
+*/
+size_t IotGateway::enqueue(const uint8_t* data, const size_t length, const E_Priority priority, const uint32_t fields){
+  if (admit(length, priority, fields)){
+    push(data, length);
+  }
+  return getTxFree();
+}
+
+/*!
+    @brief  フレームを入れる場所を空けて、送信待ちのフレームに加える   (private)
+    @param length データ長
+    @param priority 優先度
+    @param fields 値の組
+    @return True:入れられる（続けてpush()で書き込む）   False:入りきらないので捨てた
+    @note   入るかどうかを先に確かめ、入らない場合は送信待ちのフレームを何も変えない（まとめない、捨てない）
+*/
+bool IotGateway::admit(const size_t length, const E_Priority priority, const uint32_t fields){
+  const uint8_t level = static_cast<uint8_t>(priority);
+  if (length > TX_RING_SIZE){
+    tx_dropped_counts[level]++;
+    return false;
+  }
+  // まとめる・捨てることで空けられる長さ  送信中のフレームは外せない
+  //  まとめるのは値の組が同じLEVELのフレームだけ  一部の値だけのフレームを捨てるとその値が届かない
+  const bool coalesce = (priority == E_Priority::LEVEL && fields != FIELDS_UNKNOWN);
+  size_t reclaimable = getTxFree();
+  bool has_victim = false;
+  for (size_t i = (tx_front_sent == 0) ? 0 : 1; i < tx_frame_count; i++){
+    const bool same_fields = coalesce && tx_frames[i].priority == E_Priority::LEVEL && tx_frames[i].fields == fields;
+    if (tx_frames[i].priority > priority || same_fields){
+      reclaimable += tx_frames[i].length;
+      has_victim = true;
+    }
+  }
+  if (length > reclaimable || (tx_frame_count >= TX_FRAME_QUEUE_SIZE && !has_victim)){
+    tx_dropped_counts[level]++;
+    return false;
+  }
+  if (coalesce){
+    for (size_t i = tx_frame_count; i-- > 0;){
+      if (tx_frames[i].priority == E_Priority::LEVEL && tx_frames[i].fields == fields && (i != 0 || tx_front_sent == 0)){
+        removeFrame(i);
+        tx_coalesced_count++;
+      }
+    }
+  }
+  while (length > getTxFree() || tx_frame_count >= TX_FRAME_QUEUE_SIZE){
+    if (!evict(priority)){
+      tx_dropped_counts[level]++;
+      return false;
+    }
+  }
+  tx_frames[tx_frame_count].fields = fields;
+  tx_frames[tx_frame_count].length = length;
+  tx_frames[tx_frame_count].priority = priority;
+  tx_frame_count++;
+  return true;
+}
+
+/*!
+    @brief  送信待ちのフレームのうち、指定より優先度の低いものを1つ捨てる   (private)
+    @param lowest この優先度より低いものを捨てる
+    @return True:捨てた   False:捨てられるものがない
+    @note   優先度の最も低いものの中で一番古いものを捨てる  送信中のフレームは捨てない
+*/
+bool IotGateway::evict(const E_Priority lowest){
+  for (uint8_t level = PRIORITY_COUNT - 1; level > static_cast<uint8_t>(lowest); level--){
+    for (size_t i = (tx_front_sent == 0) ? 0 : 1; i < tx_frame_count; i++){
+      if (static_cast<uint8_t>(tx_frames[i].priority) == level){
+        removeFrame(i);
+        tx_dropped_counts[level]++;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*!
+    @brief  送信待ちのフレームを外し、後ろのフレームを詰める   (private)
+    @param index tx_framesの位置  送信中のフレームは指定しないこと
+    @note   送信リングバッファの長さ分のコピーで済む
+*/
+void IotGateway::removeFrame(const size_t index){
+  uint16_t start = tx_tail - tx_front_sent;
+  for (size_t i = 0; i < index; i++){
+    start += tx_frames[i].length;
+  }
+  const uint16_t head = tx_head;
+  for (uint16_t from = start + tx_frames[index].length; from != head; from++, start++){
+    tx_ring[start & (TX_RING_SIZE - 1)] = tx_ring[from & (TX_RING_SIZE - 1)];
+  }
+  tx_head = start;
+  for (size_t i = index + 1; i < tx_frame_count; i++){
+    tx_frames[i - 1] = tx_frames[i];
+  }
+  tx_frame_count--;
+}
+
+/*!
+    @brief  送信リングバッファに書き込む   (private)
+    @param data データ
+    @param length データ長  admit()で空けた長さまで
+*/
+void IotGateway::push(const uint8_t* data, const size_t length){
+  uint16_t head = tx_head;
+  for (size_t i = 0; i < length; i++){
+    tx_ring[head & (TX_RING_SIZE - 1)] = data[i];
+    head++;
+  }
+  tx_head = head;
+}
+
+/*!
+    @brief  送信リングバッファからUARTの送信バッファの空きの分だけ送る   (private)
+    @note   HardwareSerialの送信は割り込みで行われるので、空きの範囲内ならwrite()はブロックしない
+            1回に送れるのはUARTの送信バッファの空きまで  上限はpollTx()を参照
+*/
+void IotGateway::drain(void){
+  if (link != E_Link::POINT_TO_POINT && !de_active && tx_tail != tx_head){
+    digitalWrite(de_pin, HIGH);
+    de_active = true;
+  }
+  int space = HardwareSerial::availableForWrite();
+  while (space > 0 && tx_tail != tx_head){
+    // リングバッファの折り返しまでを一度に書き込む
+    const uint16_t tail = tx_tail;
+    const size_t index = tail & (TX_RING_SIZE - 1);
+    size_t count = static_cast<uint16_t>(tx_head - tail);
+    if (count > TX_RING_SIZE - index){
+      count = TX_RING_SIZE - index;
+    }
+    if (count > static_cast<size_t>(space)){
+      count = space;
+    }
+    HardwareSerial::write(&tx_ring[index], count);
+    tx_tail = tail + count;
+    space -= count;
+
+    // 送り終わったフレームを外す
+    tx_front_sent += count;
+    while (tx_frame_count != 0 && tx_front_sent >= tx_frames[0].length){
+      tx_front_sent -= tx_frames[0].length;
+      for (size_t i = 1; i < tx_frame_count; i++){
+        tx_frames[i - 1] = tx_frames[i];
+      }
+      tx_frame_count--;
+    }
+  }
+  return;
+}
+
 /*!
     @brief  payloadに直接JSONデータを書き込む（オーバーライト）
     @param json 大外の { } なしの形のJSONデータ
-    @return payloadの中身（文字列）
-
+    @note   送信バッファに入りきらない場合、payloadは空になる
 */
 void IotGateway::setPayload(const String& json){
-  payload = json;
+  setPayload(json.c_str());
+}
 
+/*!
+    @brief  payloadに直接JSONデータを書き込む（オーバーライト）
+    @param json 大外の { } なしの形のJSONデータ
+    @note   送信バッファに入りきらない場合、payloadは空になる
+*/
+void IotGateway::setPayload(const char* json){
+  payload_fields = 0;
+  if (writer.set(json)){
+    addPayloadKey(json);
+  }
 }
 
 /*!
-    @brief  payloadに引数のデータをノードして加える  
-    @param void
+    @brief  payloadの中身を { } で囲んで返す
     @return payloadの中身（文字列）
-
+    @note   Stringを作るので確認用。送信はsendPayload()で送信バッファから直接行う
 */
 String IotGateway::getPayload(void){
-  return("{" + payload + "}");
+  return("{" + String(writer.c_str()) + "}");
 }
 
 /*!
@@ -47,14 +425,9 @@ String IotGateway::getPayload(void){
 
 */
 void IotGateway::addPayload(const String& key, const String& value){
-  String quote = "\"";
-  String node = quote + key + quote + ":" + quote + value + quote;
-
-  IotGateway::joinToPayload(node);
-
-  return;
-
+  addPayload(key.c_str(), value.c_str());
 }
+
 /*!
     @brief  payloadに引数のデータをノードして加える 
     @param key JSONのキー
@@ -62,12 +435,7 @@ void IotGateway::addPayload(const String& key, const String& value){
 
 */
 void IotGateway::addPayload(const String& key, const int32_t& value){
-  String quote = "\"";
-  String node = quote + key + quote + ":" +  String(value) ;
-
-  IotGateway::joinToPayload(node);
-
-  return;
+  addPayload(key.c_str(), value);
 }
 
 /*!
@@ -78,25 +446,683 @@ void IotGateway::addPayload(const String& key, const int32_t& value){
 
 */
 void IotGateway::addPayload(const String& key, const float& value, const uint8_t& deciPlac){
-  String quote = "\"";
-  String node = quote + key + quote + ":"  + String(value, deciPlac) ;
+  addPayload(key.c_str(), value, deciPlac);
+}
 
-  IotGateway::joinToPayload(node);
+/*!
+    @brief  スキーマIDの決まった値を加える
+    @param schema 値の種類
+    @param value 値  スキーマの長さに切り詰める
+    @note   JSON形式ではスキーマのキー（"level"など）のノード、バイナリ形式ではレコードとして加える
+            同じフレームに入りきらない場合は捨てる
+*/
+void IotGateway::addRecord(const E_Schema schema, const uint16_t value){
+  putRecord(schema, value);
+}
 
+/*!
+    @brief  スキーマIDの決まった値をpayload（JSON形式）またはレコード（バイナリ形式）に加える   (private)
+    @param schema 値の種類
+    @param value 値  スキーマの長さに切り詰める
+    @note   値の組にスキーマIDのビットを加える
+*/
+void IotGateway::putRecord(const E_Schema schema, const uint16_t value){
+  const uint8_t index = static_cast<uint8_t>(schema) - 1;
+  if (index >= SCHEMA_COUNT){
+    return;
+  }
+  if (framing == E_Framing::JSON){
+    if (writer.add(schema_keys[index], static_cast<int32_t>(value))){
+      payload_fields |= 1UL << index;
+    }
+    return;
+  }
+  if (record_length + 1 + schema_sizes[index] > RECORD_BUFFER_SIZE){
+    return;
+  }
+  record_buffer[record_length++] = static_cast<uint8_t>(schema);
+  for (uint8_t i = 0; i < schema_sizes[index]; i++){
+    record_buffer[record_length++] = (value >> (8 * i)) & 0xFF;
+  }
+  record_fields |= 1UL << index;
   return;
 }
 
 /*!
-    @brief  データセパレータ(,)を入れながらpayloadにノードを足す   (private)
-    @param node JSONの情報単位
+    @brief  値の取得時刻をホストの時刻に変換し、タイムスタンプとしてpayload（JSON形式ではキー"ts"）に加える
+    @param acquired_ms 値の取得時刻 millis()
+    @return True:加えた   False:時刻が同期していない、または入りきらない
+    @note   バイナリ形式では[RECORD_TIMESTAMP][ホストの時刻 48bit]のレコードにする
+*/
+bool IotGateway::addTimestamp(const uint32_t acquired_ms){
+  return putTimestamp(acquired_ms);
+}
+
+/*!
+    @brief  値の取得時刻のタイムスタンプを加える   (private)
+    @param acquired_ms 値の取得時刻 millis()
+    @return True:加えた   False:時刻が同期していない、または入りきらない
+    @note   値の組にFIELD_TIMESTAMPを加える
+*/
+bool IotGateway::putTimestamp(const uint32_t acquired_ms){
+  uint64_t epoch_ms = 0;
+  if (!time_sync.toEpoch(acquired_ms, epoch_ms)){
+    return false;
+  }
+  if (framing == E_Framing::JSON){
+    writer.beginNode("ts");
+    writer.appendUint64(epoch_ms);
+    if (!writer.endNode()){
+      return false;
+    }
+    payload_fields |= FIELD_TIMESTAMP;
+    return true;
+  }
+  if (record_length + 1 + TIMESTAMP_SIZE > RECORD_BUFFER_SIZE){
+    return false;
+  }
+  record_buffer[record_length++] = RECORD_TIMESTAMP;
+  for (uint8_t i = 0; i < TIMESTAMP_SIZE; i++){
+    record_buffer[record_length++] = (epoch_ms >> (8 * i)) & 0xFF;
+  }
+  record_fields |= FIELD_TIMESTAMP;
+  return true;
+}
+
+/*!
+    @brief  値を送信条件付きで送る
+    @param schema 値の種類
+    @param value 値
+    @param acquired_ms 値の取得時刻 millis()  0:なし
+    @note   clk_in()で送信条件を判定し、deadbandを超えて変化したか、heartbeatの間隔が過ぎた場合に送る
+            immediateの種類（モード、エラー）が変化した場合は、全ての種類の最新の値を直ちに送る
+            時刻が同期済みであれば、送る値のうち取得時刻のある最初のもの（E_Schemaの順）の時刻をタイムスタンプとして送る
 */
-void IotGateway::joinToPayload(const String& node){
-  if (payload.length() != 0)
-    // payloadに何か既に入っている場合
-    {payload = payload + "," + node ;} 
-  else
-    // payloadに何もない場合
-    {payload = node;}
-  
+void IotGateway::publish(const E_Schema schema, const uint16_t value, const uint32_t acquired_ms){
+  const uint8_t index = static_cast<uint8_t>(schema) - 1;
+  if (index >= SCHEMA_COUNT){
+    return;
+  }
+  publish_states[index].value = value;
+  publish_states[index].acquired_ms = acquired_ms;
+  publish_states[index].has_value = true;
+}
+
+/*!
+    @brief  publish()の送信条件を設定する
+    @param schema 値の種類
+    @param deadband 前回送った値からこの幅を超えて変化したら送る
+    @param heartbeat 変化がなくてもこの間隔で送る [CLK Cycle]  0:送らない
+    @param immediate True:変化したら直ちに全ての値を送る
+*/
+void IotGateway::setPublishPolicy(const E_Schema schema, const uint16_t deadband, const uint16_t heartbeat, const bool immediate){
+  const uint8_t index = static_cast<uint8_t>(schema) - 1;
+  if (index >= SCHEMA_COUNT){
+    return;
+  }
+  publish_states[index].deadband = deadband;
+  publish_states[index].heartbeat = heartbeat;
+  publish_states[index].immediate = immediate;
+}
+
+/*!
+    @brief  publish()された値の送信条件を判定し、送るものをpayloadに加える   (private)
+*/
+void IotGateway::evaluatePublish(void){
+  bool send[SCHEMA_COUNT] = {};
+  bool flush_all = false;
+  for (size_t i = 0; i < SCHEMA_COUNT; i++){
+    const PublishState& state = publish_states[i];
+    if (!state.has_value){
+      continue;
+    }
+    const uint16_t change = (state.value > state.sent_value) ? state.value - state.sent_value : state.sent_value - state.value;
+    const bool changed = !state.has_sent || change > state.deadband || publish_requested;
+    const bool expired = state.heartbeat != 0 && tick_count - state.sent_tick >= state.heartbeat;
+    send[i] = changed || expired;
+    flush_all = flush_all || (changed && state.immediate && state.has_sent);
+  }
+  if (flush_all){
+    // モード・エラーの変化は捨てずに送る
+    setPayloadPriority(E_Priority::ALARM);
+  }
+
+  uint32_t acquired_ms = 0;
+  for (size_t i = 0; i < SCHEMA_COUNT; i++){
+    PublishState& state = publish_states[i];
+    if (state.has_value && (send[i] || flush_all)){
+      putRecord(static_cast<E_Schema>(i + 1), state.value);
+      state.sent_value = state.value;
+      state.sent_tick = tick_count;
+      state.has_sent = true;
+      acquired_ms = (acquired_ms == 0) ? state.acquired_ms : acquired_ms;
+    }
+  }
+  if (acquired_ms != 0){
+    putTimestamp(acquired_ms);
+  }
+  publish_requested = false;
+  return;
+}
+
+/*!
+    @brief  液面をバッチに加える  取得時刻はmillis()
+    @param level 液面 [0.1%]
+*/
+void IotGateway::addReading(const uint16_t level){
+  addReading(level, millis());
+}
+
+/*!
+    @brief  液面をバッチに加える
+    @param level 液面 [0.1%]
+    @param acquired_ms 液面の取得時刻 millis()  Measurement::getResultTime()
+    @note   バイナリ形式でバッチが有効な場合、batch_size個たまるか、最初の液面からmax_latencyが過ぎたら1フレームで送る
+            RS-485ではpublish(LEVEL)と同じ  それ以外の場合はaddRecord(LEVEL), addTimestamp()と同じ内容を加え、
+            周期的な値（LEVEL）として送る
+*/
+void IotGateway::addReading(const uint16_t level, const uint32_t acquired_ms){
+  if (link != E_Link::POINT_TO_POINT){
+    publish(E_Schema::LEVEL, level, acquired_ms);
+    return;
+  }
+  if (framing != E_Framing::BINARY || batch_size <= 1){
+    putRecord(E_Schema::LEVEL, level);
+    putTimestamp(acquired_ms);
+    return;
+  }
+  if (batch_count == 0){
+    batch_start_tick = tick_count;
+  }
+  batch_levels[batch_count] = level;
+  batch_times[batch_count] = acquired_ms;
+  if (++batch_count >= batch_size){
+    sendBatch();
+  }
+}
+
+/*!
+    @brief  バッチの設定
+    @param batch_size 1フレームにまとめる液面の数  MAX_BATCH_SIZEまで  0, 1:バッチにしない
+    @param max_latency 最初の液面からこの時間が過ぎたら、batch_sizeに満たなくても送る [CLK Cycle]
+                       0:時間では送らない（batch_size個たまった時だけ送る）
+    @note   たまっている液面は送る
+*/
+void IotGateway::setBatching(const uint8_t batch_size, const uint16_t max_latency){
+  sendBatch();
+  this->batch_size = (batch_size < MAX_BATCH_SIZE) ? batch_size : MAX_BATCH_SIZE;
+  batch_max_latency = max_latency;
+}
+
+/*!
+    @brief  受信データを読み、揃ったコマンドを実行する   (private)
+    @note   1CLKに読むのはRX_BYTES_PER_TICKまで  残りは次のCLKで読む
+*/
+void IotGateway::receive(void){
+  for (uint16_t i = 0; i < RX_BYTES_PER_TICK && HardwareSerial::available() > 0; i++){
+    if (!parser.isReceiving()){
+      command_start_ms = millis();
+    }
+    if (!parser.feed(static_cast<uint8_t>(HardwareSerial::read()))){
+      continue;
+    }
+    if (executeCommand(parser.getCommand())){
+      command_count++;
+      const uint32_t latency = millis() - command_start_ms;
+      if (latency > max_command_latency){
+        max_command_latency = latency;
+      }
+    } else {
+      command_reject_count++;
+    }
+  }
+  return;
+}
+
+/*!
+    @brief  コマンドを実行する   (private)
+    @param command 受信したコマンド
+    @return True:実行した   False:実行できない（対象が未設定、範囲外）
+    @note   START, STOP, MODEはステートマシンの状態遷移として行うので、
+            計測の開始・停止はスイッチ操作と同じくhasStatusUpdated()で確認する
+            MODEでのMANUALとCONTの間の遷移は、スイッチ操作と同じくできない（一度MODE Tで止める）
+*/
+bool IotGateway::executeCommand(const CommandParser::Command& command){
+  switch (command.type){
+    case CommandParser::E_Command::START :
+      // 1回計測はタイマモードからのみ（スイッチのクリックと同じ）
+      if (statemachine == nullptr || statemachine->getStatus() != Statemachine::E_Status::TIMER){
+        return false;
+      }
+      statemachine->requestStatus(Statemachine::E_Status::MANUAL);
+      return true;
+
+    case CommandParser::E_Command::STOP :
+      if (statemachine == nullptr){
+        return false;
+      }
+      statemachine->requestStatus(Statemachine::E_Status::TIMER);
+      return true;
+
+    case CommandParser::E_Command::MODE :
+      if (statemachine == nullptr){
+        return false;
+      }
+      {
+        Statemachine::E_Status target;
+        switch (command.value){
+          case 'T' : target = Statemachine::E_Status::TIMER;  break;
+          case 'M' : target = Statemachine::E_Status::MANUAL; break;
+          case 'C' : target = Statemachine::E_Status::CONT;   break;
+          default: return false;
+        }
+        // 1回計測と連続計測は計測中に切り替えられない
+        const Statemachine::E_Status status = statemachine->getStatus();
+        if (target != status && target != Statemachine::E_Status::TIMER && status != Statemachine::E_Status::TIMER){
+          return false;
+        }
+        statemachine->requestStatus(target);
+      }
+      return true;
+
+    case CommandParser::E_Command::TIMER :
+      return (timer != nullptr) && timer->init(command.value);
+
+    case CommandParser::E_Command::GET :
+      publish_requested = true;
+      return true;
+
+    case CommandParser::E_Command::TIME :
+      // 1文字目を読んだ時刻をホストが送信した時刻とみなす
+      time_sync.sync(command.epoch_ms, command_start_ms - RX_STAMP_CORRECTION_MS);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/*!
+    @brief  受信したコマンドで操作する対象を設定する
+    @param statemachine START, STOP, MODEで状態遷移させるステートマシン
+    @param timer TIMERで周期を設定するタイマ
+    @note   nullptrの場合、そのコマンドは実行できないエラーとして数える
+*/
+void IotGateway::setCommandTarget(Statemachine* statemachine, TimeSwitch* timer){
+  this->statemachine = statemachine;
+  this->timer = timer;
+}
+
+/*!
+    @brief  RS-485マルチドロップにする
+    @param address ユニットアドレス  1-247  それ以外はマルチドロップを使わない
+    @param de_pin RS-485トランシーバのDE（送信許可）ピン  HIGHで送信
+    @return True:マルチドロップにした   False:アドレスが範囲外なので使わない
+    @note   begin()の後、送信していない時に呼び出すこと（UARTの送信バッファが空の状態を覚える）
+            マルチドロップでは親局の要求（MultidropFrame）にだけ応答し、payload, レコード, バッチは送らない
+*/
+bool IotGateway::setMultidrop(const uint8_t address, const uint32_t de_pin){
+  if (!enableDriver(address, de_pin)){
+    return false;
+  }
+  link = E_Link::MULTIDROP;
+  return true;
+}
+
+/*!
+    @brief  Modbus RTUスレーブにする
+    @param address スレーブアドレス  1-247  それ以外は1対1に戻す
+    @param de_pin RS-485トランシーバのDE（送信許可）ピン  HIGHで送信
+    @return True:Modbusにした   False:アドレスが範囲外なので使わない
+    @note   begin()の後、送信していない時に呼び出すこと
+            レジスタ0-3（液面, モード, 残り時間, エラー）はpublish()の値、それ以外はsetModbusRegister()で設定する
+            Modbusではpayload, レコード, バッチは送らない
+            受信はclk_in()で読むので、115200baudで他のスレーブの長い応答が続くバスでは
+            SERIAL_RX_BUFFER_SIZEを128以上にする（RX_BYTES_PER_TICKを参照）
+*/
+bool IotGateway::setModbus(const uint8_t address, const uint32_t de_pin){
+  if (!enableDriver(address, de_pin)){
+    return false;
+  }
+  modbus.setAddress(address);
+  link = E_Link::MODBUS;
+  return true;
+}
+
+/*!
+    @brief  Modbusのレジスタの値を設定する  パラメタ・校正値など
+    @param reg レジスタ
+    @param value 値
+    @note   応答に使うのは次のCLKから
+*/
+void IotGateway::setModbusRegister(const ModbusSlave::E_Register reg, const uint16_t value){
+  modbus.setRegister(reg, value);
+}
+
+/*!
+    @brief  Modbusの2ワードのレジスタにfloatを設定する  校正値
+    @param reg レジスタ（先頭）
+    @param value 値
+*/
+void IotGateway::setModbusFloat(const ModbusSlave::E_Register reg, const float value){
+  modbus.setFloat(reg, value);
+}
+
+/*!
+    @brief  RS-485トランシーバのDEピンを設定する   (private)
+    @param address ユニットアドレス  1-247  それ以外は1対1に戻す
+    @param de_pin DEピン
+    @return True:設定した   False:アドレスが範囲外
+*/
+bool IotGateway::enableDriver(const uint8_t address, const uint32_t de_pin){
+  if (!MultidropFrame::isUnitAddress(address)){
+    if (link != E_Link::POINT_TO_POINT){
+      digitalWrite(this->de_pin, LOW);
+      de_active = false;
+    }
+    link = E_Link::POINT_TO_POINT;
+    unit_address = 0;
+    modbus.setAddress(0);
+    return false;
+  }
+  this->de_pin = de_pin;
+  pinMode(de_pin, OUTPUT);
+  digitalWrite(de_pin, LOW);
+  de_active = false;
+  tx_idle_space = HardwareSerial::availableForWrite();
+  rx_length = 0;
+  rx_overflow = false;
+  parser.reset();
+  unit_address = address;
+  return true;
+}
+
+/*!
+    @brief  受信データを区切りまでためて、自分宛ての要求を処理する   (private)
+    @note   1CLKに読むのはRX_BYTES_PER_TICKまで
+            他の子局の応答（RESPONSE_FLAG付き）や他のアドレス宛ての要求は読み捨てる
+*/
+void IotGateway::receiveMultidrop(void){
+  for (uint16_t i = 0; i < RX_BYTES_PER_TICK && HardwareSerial::available() > 0; i++){
+    const uint8_t c = static_cast<uint8_t>(HardwareSerial::read());
+    if (c != Cobs::DELIMITER){
+      if (rx_length == 0){
+        // フレームの先頭を読んだ時刻  TIMEコマンドの受信時刻とする
+        command_start_ms = millis();
+      }
+      if (rx_length < sizeof(rx_frame)){
+        rx_frame[rx_length++] = c;
+      } else {
+        rx_overflow = true;
+      }
+      continue;
+    }
+    if (rx_length != 0 && !rx_overflow){
+      uint8_t address = 0;
+      uint8_t function = 0;
+      const uint8_t* data = nullptr;
+      size_t length = 0;
+      if (!MultidropFrame::decode(rx_frame, rx_length, address, function, data, length)){
+        rx_error_count++;
+      } else if ((function & MultidropFrame::RESPONSE_FLAG) == 0
+                 && (address == unit_address || address == MultidropFrame::BROADCAST_ADDRESS)){
+        handleRequest(function, data, length, address == unit_address);
+      }
+    } else if (rx_overflow){
+      rx_error_count++;
+    }
+    rx_length = 0;
+    rx_overflow = false;
+  }
+  return;
+}
+
+/*!
+    @brief  Modbusの要求を受信し、スナップショットから応答する   (private)
+    @note   CLKの最初にpublish()の値をレジスタに反映してスナップショットを取るので、
+            同じCLKで処理する要求は全て同じ値を返す
+            読み出し要求は1byteごとに揃ったかを見るので、共有バスで他のスレーブとのやり取りに
+            続けて届いても、1CLKの途切れを待たずに応答する
+            応答（最大37byte）はUARTの送信バッファに収まるので、文字の間は空かない
+*/
+void IotGateway::receiveModbus(void){
+  for (size_t i = 0; i < SCHEMA_COUNT; i++){
+    if (publish_states[i].has_value){
+      // E_SchemaとModbusSlave::E_Registerの先頭4つは同じ並び
+      modbus.setRegister(static_cast<ModbusSlave::E_Register>(i), publish_states[i].value);
+    }
+  }
+  modbus.latch();
+
+  // 読み出し要求は揃ったbyteで応答する  同じCLKに続いて届いたフレームと繋げない
+  uint8_t response[ModbusSlave::MAX_RESPONSE_LENGTH];
+  bool idle = true;
+  for (uint16_t i = 0; i < RX_BYTES_PER_TICK && HardwareSerial::available() > 0; i++){
+    modbus.feed(static_cast<uint8_t>(HardwareSerial::read()));
+    idle = false;
+    const size_t length = modbus.service(false, response);
+    if (length != 0){
+      enqueue(response, length, E_Priority::ALARM);
+    }
+  }
+  if (idle){
+    const size_t length = modbus.service(true, response);
+    if (length != 0){
+      enqueue(response, length, E_Priority::ALARM);
+    }
+  }
+  return;
+}
+
+/*!
+    @brief  要求を処理して応答を送信リングバッファに入れる   (private)
+    @param function ファンクション
+    @param data 要求データ
+    @param length データ長
+    @param respond True:応答する   False:ブロードキャストなので応答しない
+*/
+void IotGateway::handleRequest(const uint8_t function, const uint8_t* data, const size_t length, const bool respond){
+  uint8_t response[MultidropFrame::MAX_DATA_LENGTH];
+  size_t response_length = 0;
+
+  switch (function){
+    case MultidropFrame::FUNCTION_POLL : {
+      // [シーケンス番号][ID 値]...[RECORD_TIMESTAMP 液面の取得時刻]  publish()された値のみ  時刻は同期済みの場合のみ
+      response[response_length++] = frame_sequence++;
+      for (size_t i = 0; i < SCHEMA_COUNT; i++){
+        const PublishState& state = publish_states[i];
+        if (!state.has_value || response_length + 1 + schema_sizes[i] > sizeof(response)){
+          continue;
+        }
+        response[response_length++] = static_cast<uint8_t>(i + 1);
+        for (uint8_t j = 0; j < schema_sizes[i]; j++){
+          response[response_length++] = (state.value >> (8 * j)) & 0xFF;
+        }
+      }
+      uint64_t epoch_ms = 0;
+      const PublishState& level = publish_states[static_cast<uint8_t>(E_Schema::LEVEL) - 1];
+      if (level.has_value && level.acquired_ms != 0 && time_sync.toEpoch(level.acquired_ms, epoch_ms)
+          && response_length + 1 + TIMESTAMP_SIZE <= sizeof(response)){
+        response[response_length++] = RECORD_TIMESTAMP;
+        for (uint8_t j = 0; j < TIMESTAMP_SIZE; j++){
+          response[response_length++] = (epoch_ms >> (8 * j)) & 0xFF;
+        }
+      }
+      poll_count++;
+      break;
+    }
+
+    case MultidropFrame::FUNCTION_COMMAND : {
+      // 1行のコマンドとして解析する
+      bool executed = false;
+      parser.reset();
+      for (size_t i = 0; i < length; i++){
+        parser.feed(data[i]);
+      }
+      if (parser.feed('\n')){
+        executed = executeCommand(parser.getCommand());
+      }
+      if (executed){
+        command_count++;
+      } else {
+        command_reject_count++;
+      }
+      response[response_length++] = executed ? MultidropFrame::RESULT_OK : MultidropFrame::RESULT_ERROR;
+      break;
+    }
+
+    default:
+      // 知らないファンクションには応答しない  親局はタイムアウトで判断する
+      return;
+  }
+
+  if (respond){
+    uint8_t encoded[MultidropFrame::MAX_ENCODED_LENGTH];
+    const size_t encoded_length = MultidropFrame::encode(unit_address, function | MultidropFrame::RESPONSE_FLAG,
+                                                         response, response_length, encoded);
+    // 応答は要求された時にしか送らないので捨てない
+    enqueue(encoded, encoded_length, E_Priority::ALARM);
+  }
+  return;
+}
+
+/*!
+    @brief  送信が終わったらDEをLOWにしてバスを空ける   (private)
+    @note   送信リングバッファとUARTの送信バッファが空になった時点で、シフトレジスタに残るのは最後の1byteだけなので、
+            flush()で待つのは1byte分（9600baudで約1ms）
+*/
+void IotGateway::releaseBus(void){
+  if (!de_active || tx_tail != tx_head || HardwareSerial::availableForWrite() < tx_idle_space){
+    return;
+  }
+  HardwareSerial::flush();
+  digitalWrite(de_pin, LOW);
+  de_active = false;
+  return;
+}
+
+/*!
+    @brief  送信形式を設定する
+    @param mode 送信形式
+    @note   送信前のpayloadとレコードは捨てる
+*/
+void IotGateway::setFraming(const E_Framing mode){
+  framing = mode;
+  clearPayload();
+  record_length = 0;
+  record_fields = 0;
+  batch_count = 0;
+}
+
+/*!
+    @brief  送信形式を返す
+    @return 送信形式
+*/
+IotGateway::E_Framing IotGateway::getFraming(void){
+  return framing;
+}
+
+/*!
+    @brief  payloadに引数のデータをノードして加える  送信バッファに直接書き込む
+    @param key JSONのキー
+    @param value 値（文字列）  エスケープして書き込む
+    @note   入りきらない場合、ノードは捨てられる（getOverflowCount()で確認）
+*/
+void IotGateway::addPayload(const char* key, const char* value){
+  if (writer.add(key, value)){
+    addPayloadKey(key);
+  }
+}
+
+/*!
+    @brief  payloadに引数のデータをノードして加える  送信バッファに直接書き込む
+    @param key JSONのキー
+    @param value 数値（整数）
+    @note   入りきらない場合、ノードは捨てられる（getOverflowCount()で確認）
+*/
+void IotGateway::addPayload(const char* key, const int32_t& value){
+  if (writer.add(key, value)){
+    addPayloadKey(key);
+  }
+}
+
+/*!
+    @brief  payloadに引数のデータをノードして加える  送信バッファに直接書き込む
+    @param key JSONのキー
+    @param value 数値（小数）
+    @param deciPlac 出力する小数点以下桁数
+    @note   入りきらない場合、ノードは捨てられる（getOverflowCount()で確認）
+*/
+void IotGateway::addPayload(const char* key, const float& value, const uint8_t& deciPlac){
+  if (writer.add(key, value, deciPlac)){
+    addPayloadKey(key);
+  }
+}
+
+#if EH_I2C_PROFILE
+/*!
+    @brief  I2Cバスの集計値をpayloadに加える
+    @note   キーはデバイスごとに "i2c_<アドレス16進>"、呼び出し元ごとに "i2c_c<番号>"
+            値は "呼び出し回数,トランザクション数,バイト数,NACK数,合計us,最小us,平均us,最大us,ヒストグラム..."
+            呼び出しのないものは出力しない
+*/
+void IotGateway::addI2cProfile(void){
+  if (writer.length() == 0 && !payload_tagged){
+    // プロファイルだけのpayloadは混雑時に真っ先に捨てる
+    setPayloadPriority(E_Priority::DEBUG);
+  }
+  static const char hex[] = "0123456789abcdef";
+  char key[8] = "i2c_";
+  for (size_t i = 0; i < I2cProfiler::DEVICE_COUNT; i++){
+    const I2cProfiler::Stat& stat = I2cProf.getDeviceStat(i);
+    if (stat.calls != 0){
+      const uint16_t address = I2cProf.getDeviceAddress(i);
+      uint8_t n = 4;
+      if (address >= 0x10){
+        key[n++] = hex[(address >> 4) & 0x0F];
+      }
+      key[n++] = hex[address & 0x0F];
+      key[n] = '\0';
+      addI2cStat(key, stat);
+    }
+  }
+  key[4] = 'c';
+  for (size_t i = 0; i < I2cProfiler::COMPONENT_COUNT; i++){
+    const I2cProfiler::Stat& stat = I2cProf.getComponentStat(static_cast<E_I2cComponent>(i));
+    if (stat.calls != 0){
+      key[5] = '0' + i;
+      key[6] = '\0';
+      addI2cStat(key, stat);
+    }
+  }
+  return;
+}
+
+/*!
+    @brief  I2Cバスの集計値をカンマ区切りの文字列としてpayloadに加える   (private)
+    @param key JSONのキー
+    @param stat 集計値
+*/
+void IotGateway::addI2cStat(const char* key, const I2cProfiler::Stat& stat){
+  // 平均は呼び出し1回あたり
+  const uint32_t values[] = {
+    stat.calls, stat.transactions, stat.bytes, stat.nacks,
+    stat.total_us, stat.min_us, (stat.calls != 0) ? stat.total_us / stat.calls : 0, stat.max_us
+  };
+  writer.beginNode(key);
+  writer.appendChar('"');
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+    if (i != 0){
+      writer.appendChar(',');
+    }
+    writer.appendUint(values[i]);
+  }
+  for (size_t i = 0; i < I2cProfiler::HISTOGRAM_BINS; i++){
+    writer.appendChar(',');
+    writer.appendUint(stat.histogram[i]);
+  }
+  writer.appendChar('"');
+  writer.endNode();
   return;
 }
+#endif
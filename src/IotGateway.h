@@ -2,10 +2,88 @@
 #define _IOTGATEWAY_H_
 
 #include "HardwareSerial.h"
+#include "I2cProfiler.h"
+#include "JsonWriter.h"
+#include "CommandParser.h"
+#include "MultidropFrame.h"
+#include "ModbusSlave.h"
+#include "TimeSync.h"
+#include "statemachine.h"
+#include "timeswitch.h"
 
 class IotGateway : public HardwareSerial{
 
   public:
+    /*!
+    @brief  送信形式
+    */
+    enum class E_Framing : uint8_t {
+      JSON = 0,   // 1行1フレームのJSON
+      BINARY      // COBSで符号化したバイナリ  0x00で区切る
+    };
+
+    /*!
+    @brief  バイナリ形式のレコードの種類（スキーマID）
+    @note   値の長さは種類ごとに固定  リトルエンディアン
+    */
+    enum class E_Schema : uint8_t {
+      LEVEL = 0x01,   // uint16_t 液面 [0.1%]
+      MODE = 0x02,    // uint8_t  測定モード
+      REMAIN = 0x03,  // uint16_t タイマ残り時間 [min]
+      ERROR_FLAGS = 0x04  // uint8_t  エラーフラグ  bit0:センサエラー  bit1:デバイスエラー
+    };
+
+    /*!
+    @brief  送信フレームの優先度  送信リングバッファがあふれそうな時に、値の大きいものから捨てる
+    */
+    enum class E_Priority : uint8_t {
+      ALARM = 0,  // モード・エラーの変化、setPayloadPriority(ALARM)を指定したpayload  捨てない・まとめない
+                  //  ただし送信待ちのALARMだけで送信リングバッファが埋まった場合は、新しいものを捨てる
+      LEVEL,      // publish(), addReading()の周期的な値、優先度を指定しないスケッチのpayload
+                  //  送信待ちの同じ値の組（フィールド）のものは最新の1フレームにまとめる
+      BATCH,      // バッチ  まとめずに順に送る
+      DEBUG       // I2Cプロファイルなど  真っ先に捨てる
+    };
+
+    // 優先度の数
+    static constexpr size_t PRIORITY_COUNT = 4;
+
+    // 送信フレームの値の組（フィールド）  LEVELのフレームは値の組が同じものだけをまとめる
+    //  bit0-3:スキーマID 1-4の値  bit4:タイムスタンプ  bit5:スケッチが加えたキー  bit6-31:そのキーのハッシュの和
+    static constexpr uint32_t FIELD_TIMESTAMP = 0x10;
+    static constexpr uint32_t FIELD_SKETCH = 0x20;
+    static constexpr uint8_t FIELD_KEY_SHIFT = 6;
+    //  値の組が分からない  まとめない
+    static constexpr uint32_t FIELDS_UNKNOWN = 0;
+
+    /*!
+    @brief  UARTの使い方
+    */
+    enum class E_Link : uint8_t {
+      POINT_TO_POINT = 0, // 1対1  テレメトリを送り、コマンドを受ける
+      MULTIDROP,          // RS-485マルチドロップ  MultidropFrameの要求にだけ応答する
+      MODBUS              // RS-485 Modbus RTUスレーブ  レジスタの読み出しにだけ応答する
+    };
+
+    // スキーマIDの数
+    static constexpr size_t SCHEMA_COUNT = 4;
+
+    // バイナリ形式のフレームの種類
+    static constexpr uint8_t FRAME_TYPE_RECORDS = 0x01;
+    static constexpr uint8_t FRAME_TYPE_BATCH = 0x02;
+    static constexpr uint8_t FRAME_TYPE_BATCH_EPOCH = 0x03;   // 最初の時刻がホストの時刻（48bit）のバッチ
+
+    // バイナリ形式のタイムスタンプのレコード  ID, 値はホストの時刻 [ms] 48bit
+    //  E_Schemaとは別  publish()の値ではなく、値の取得時刻
+    static constexpr uint8_t RECORD_TIMESTAMP = 0x10;
+    static constexpr uint8_t TIMESTAMP_SIZE = 6;
+
+    // バッチにまとめる液面の最大数
+    static constexpr uint8_t MAX_BATCH_SIZE = 32;
+
+    // バッチの最初の液面から送るまでの時間の初期値 [CLK Cycle]  1秒
+    static constexpr uint16_t DEFAULT_BATCH_MAX_LATENCY = 100;
+
     /*!
     @brief  コンストラクタ 
     */
@@ -14,13 +92,119 @@ class IotGateway : public HardwareSerial{
     };
 
     void clk_in(void);
+    void pollTx(void);
 
     void setPayload(const String& json);
+    void setPayload(const char* json);
     String getPayload(void);
 
     void addPayload(const String& key, const String& value);
     void addPayload(const String& key, const int32_t& value);
     void addPayload(const String& key, const float& value, const uint8_t& deciPlac);
+    void addPayload(const char* key, const char* value);
+    void addPayload(const char* key, const int32_t& value);
+    void addPayload(const char* key, const float& value, const uint8_t& deciPlac);
+    void addRecord(const E_Schema schema, const uint16_t value);
+    bool addTimestamp(const uint32_t acquired_ms);
+
+    void publish(const E_Schema schema, const uint16_t value, const uint32_t acquired_ms = 0);
+    void setPublishPolicy(const E_Schema schema, const uint16_t deadband, const uint16_t heartbeat, const bool immediate);
+
+    void addReading(const uint16_t level);
+    void addReading(const uint16_t level, const uint32_t acquired_ms);
+    void setBatching(const uint8_t batch_size, const uint16_t max_latency);
+
+    void setFraming(const E_Framing mode);
+    E_Framing getFraming(void);
+
+    void setCommandTarget(Statemachine* statemachine, TimeSwitch* timer);
+
+    bool setMultidrop(const uint8_t address, const uint32_t de_pin);
+    bool setModbus(const uint8_t address, const uint32_t de_pin);
+    void setModbusRegister(const ModbusSlave::E_Register reg, const uint16_t value);
+    void setModbusFloat(const ModbusSlave::E_Register reg, const float value);
+
+    /*!
+    @brief  UARTの使い方
+    @return 1対1, マルチドロップ, Modbus
+    */
+    E_Link getLink(void){
+      return link;
+    };
+
+    /*!
+    @brief  RS-485のユニットアドレス（マルチドロップ・Modbus）
+    @return アドレス  0:1対1
+    */
+    uint8_t getUnitAddress(void){
+      return unit_address;
+    };
+
+    /*!
+    @brief  時刻の同期  ドリフトなどの確認用
+    */
+    const TimeSync& getTimeSync(void){
+      return time_sync;
+    };
+
+    /*!
+    @brief  Modbusスレーブ  応答数などの確認用
+    */
+    const ModbusSlave& getModbus(void){
+      return modbus;
+    };
+
+    /*!
+    @brief  応答したPOLLの数
+    @return 要求数の累計
+    */
+    uint32_t getPollCount(void){
+      return poll_count;
+    };
+
+    /*!
+    @brief  CRCエラーなどで捨てた受信フレームの数（マルチドロップ）
+    @return フレーム数の累計
+    */
+    uint32_t getRxErrorCount(void){
+      return rx_error_count;
+    };
+
+    /*!
+    @brief  実行したコマンドの数
+    @return コマンド数の累計
+    */
+    uint32_t getCommandCount(void){
+      return command_count;
+    };
+
+    /*!
+    @brief  不正な行、または実行できなかったコマンドの数
+    @return コマンド数の累計
+    */
+    uint32_t getCommandErrorCount(void){
+      return parser.getErrorCount() + command_reject_count;
+    };
+
+    /*!
+    @brief  コマンドの1文字目を読んでから実行するまでの時間の最大値
+    @return 時間 [ms]
+    */
+    uint32_t getMaxCommandLatency(void){
+      return max_command_latency;
+    };
+
+    /*!
+    @brief  入りきらずに捨てたノードの数
+    @return ノード数の累計
+    */
+    uint32_t getOverflowCount(void){
+      return writer.getOverflowCount();
+    };
+
+#if EH_I2C_PROFILE
+    void addI2cProfile(void);
+#endif
     
     
     /*!
@@ -29,23 +213,235 @@ class IotGateway : public HardwareSerial{
     @return void
     */
     void clearPayload(void){
-      payload="";
+      writer.clear();
+      payload_fields = 0;
     };
     
+    size_t sendPayload(void);
+    size_t enqueue(const uint8_t* data, const size_t length, const E_Priority priority = E_Priority::ALARM,
+                   const uint32_t fields = FIELDS_UNKNOWN);
+
     /*!
-    @brief  payloadをUARTに出力
-    @param void
-    @return void
-    @note   payloadはクリアされます
+    @brief  次に送るpayload, レコードの優先度を設定する
+    @param priority 優先度
+    @note   送ると指定なしに戻る  指定しない場合はLEVEL（送信待ちの同じキーの組のものは最新の1つにまとめる）
+            スケッチのアラーム・エラーはALARMを指定すること（まとめず、低い優先度のために捨てない）
+    */
+    void setPayloadPriority(const E_Priority priority){
+      payload_priority = priority;
+      payload_tagged = true;
+    };
+
+    /*!
+    @brief  送信リングバッファの空き
+    @return 空きバイト数
     */
-    void sendPayload(void){
-      HardwareSerial::println(getPayload());
-      clearPayload();
+    size_t getTxFree(void){
+      return TX_RING_SIZE - static_cast<uint16_t>(tx_head - tx_tail);
+    };
+
+    /*!
+    @brief  送信待ちのフレームの数
+    @return フレーム数  送信中のものを含む
+    */
+    size_t getTxQueueDepth(void){
+      return tx_frame_count;
+    };
+
+    /*!
+    @brief  送信リングバッファに入りきらずに捨てたフレームの数
+    @return フレーム数の累計
+    */
+    uint32_t getTxDroppedCount(void){
+      uint32_t total = 0;
+      for (size_t i = 0; i < PRIORITY_COUNT; i++){
+        total += tx_dropped_counts[i];
+      }
+      return total;
+    };
+
+    /*!
+    @brief  送信リングバッファに入りきらずに捨てたフレームの数
+    @param priority 優先度
+    @return フレーム数の累計  ALARMは送信待ちのALARMだけで埋まった場合のみ
+    */
+    uint32_t getTxDroppedCount(const E_Priority priority){
+      return tx_dropped_counts[static_cast<uint8_t>(priority)];
+    };
+
+    /*!
+    @brief  新しいLEVELのフレームにまとめて捨てた、送信待ちの同じ値の組のフレームの数
+    @return フレーム数の累計
+    */
+    uint32_t getTxCoalescedCount(void){
+      return tx_coalesced_count;
     };
 
   private:
-    String payload;
-    void joinToPayload(const String& node);
+    // 送信リングバッファの長さ  2のべき乗
+    //  9600baudでは1byteに約1msかかるので、10ms周期の処理の中ではUARTの送信完了を待たない
+    static constexpr size_t TX_RING_SIZE = 1024;
+    static_assert((TX_RING_SIZE & (TX_RING_SIZE - 1)) == 0, "TX_RING_SIZE must be a power of 2");
+
+    // 送信リングバッファ  headは書き込み位置、tailは読み出し位置（どちらもマスク前の値）
+    //  clk_in(), pollTx()と同じコンテキスト（メインループ）からだけ触る  割り込みからは触らない
+    uint8_t tx_ring[TX_RING_SIZE];
+    uint16_t tx_head = 0;
+    uint16_t tx_tail = 0;
+
+    // 送信待ちのフレームの最大数
+    static constexpr size_t TX_FRAME_QUEUE_SIZE = 32;
+
+    /*!
+    @brief  送信リングバッファ内のフレーム  送信順に並ぶ
+    */
+    struct TxFrame{
+      uint32_t fields;        // 値の組  LEVELのフレームをまとめる場合に比べる
+      uint16_t length;
+      E_Priority priority;
+    };
+
+    // 送信待ちのフレーム  [0]が送信中（先頭からtx_front_sentまで送った）
+    //  送信リングバッファ内のフレームは詰めて並んでいるので、位置は長さの和で求める
+    TxFrame tx_frames[TX_FRAME_QUEUE_SIZE];
+    size_t tx_frame_count = 0;
+    uint16_t tx_front_sent = 0;
+    uint32_t tx_dropped_counts[PRIORITY_COUNT] = {};
+    uint32_t tx_coalesced_count = 0;
+
+    // 次に送るpayload, レコードの優先度  setPayloadPriority()で指定した場合
+    E_Priority payload_priority = E_Priority::ALARM;
+    bool payload_tagged = false;
+
+    // payload（JSON形式）, レコード（バイナリ形式）に加えた値の組
+    uint32_t payload_fields = 0;
+    uint32_t record_fields = 0;
+
+    // 送信バッファの長さ  大外の { } なしのJSONデータ + 終端
+    static constexpr size_t TX_BUFFER_SIZE = 512;
+
+    // 送信バッファ  payloadは直接ここに書き込む
+    char tx_buffer[TX_BUFFER_SIZE];
+    JsonWriter writer{tx_buffer, TX_BUFFER_SIZE};
+
+    // バイナリ形式  フレームに入れるレコードの最大長
+    static constexpr size_t RECORD_BUFFER_SIZE = 32;
+
+    // スキーマIDごとのJSONのキーと値の長さ  E_Schemaの順
+    static constexpr const char* schema_keys[SCHEMA_COUNT] = {"level", "mode", "remain", "error"};
+    static constexpr uint8_t schema_sizes[SCHEMA_COUNT] = {2, 1, 2, 1};
+
+    E_Framing framing = E_Framing::JSON;
+
+    /*!
+    @brief  publish()した値の送信条件と状態
+    */
+    struct PublishState{
+      uint16_t deadband;      // 前回送った値からこの幅を超えて変化したら送る
+      uint16_t heartbeat;     // 変化がなくてもこの間隔で送る [CLK Cycle]  0:送らない
+      bool immediate;         // 変化したら直ちに全ての値を送る（モード、エラー）
+      bool has_value;         // publish()された値がある
+      bool has_sent;          // 一度でも送った
+      uint16_t value;         // 最新の値
+      uint16_t sent_value;    // 前回送った値
+      uint32_t sent_tick;     // 前回送ったCLKカウント
+      uint32_t acquired_ms;   // 最新の値の取得時刻 millis()  0:なし
+    };
+
+    // スキーマIDごとの送信条件  E_Schemaの順
+    //  液面は0.5%、残り時間は変化ごと  いずれも60秒ごとに送る
+    PublishState publish_states[SCHEMA_COUNT] = {
+      { 5, 6000, false, false, false, 0, 0, 0, 0 },  // LEVEL
+      { 0, 6000, true,  false, false, 0, 0, 0, 0 },  // MODE
+      { 0, 6000, false, false, false, 0, 0, 0, 0 },  // REMAIN
+      { 0, 6000, true,  false, false, 0, 0, 0, 0 }   // ERROR_FLAGS
+    };
+
+    // CLKカウント
+    uint32_t tick_count = 0;
+
+    // GETコマンドで全ての値を送る
+    bool publish_requested = false;
+
+    // 1CLKに読む受信データの最大数  UARTの受信バッファ(SERIAL_RX_BUFFER_SIZE)の分
+    //  1CLKで受信バッファを空にできるので、CLKの間に届くのが受信バッファ以下ならあふれない
+    //  （9600baudで約10byte、115200baudで約115byteなので、115200baudでは64byte以下のコマンドを続けて送る場合まで）
+    static constexpr uint16_t RX_BYTES_PER_TICK = SERIAL_RX_BUFFER_SIZE;
+
+    // 受信コマンド
+    CommandParser parser;
+    Statemachine* statemachine = nullptr;
+    TimeSwitch* timer = nullptr;
+    uint32_t command_start_ms = 0;      // 受信中のコマンドの1文字目を読んだ時刻
+    uint32_t max_command_latency = 0;   // [ms]
+    uint32_t command_count = 0;
+    uint32_t command_reject_count = 0;
+
+    // 時刻の同期  TIMEコマンドの時刻と受信したmillis()の組から求める
+    //  受信データは10ms周期で読むので、1文字目を読んだ時刻は受信から平均して半周期遅れる
+    static constexpr uint32_t RX_STAMP_CORRECTION_MS = 5;
+    TimeSync time_sync;
+
+    // RS-485  要求を受けた時だけ送信し、送信中だけDEをHIGHにする
+    E_Link link = E_Link::POINT_TO_POINT;
+    uint8_t unit_address = 0;       // 0:1対1
+    uint32_t de_pin = 0;
+    bool de_active = false;
+    int tx_idle_space = 0;          // UARTの送信バッファが空の時のavailableForWrite()
+    uint8_t rx_frame[MultidropFrame::MAX_ENCODED_LENGTH];
+    size_t rx_length = 0;
+    bool rx_overflow = false;       // 区切りが来ないままrx_frameが一杯になった
+    uint32_t poll_count = 0;
+    uint32_t rx_error_count = 0;
+
+    // Modbus RTUスレーブ
+    ModbusSlave modbus;
+
+    // バッチ  液面と取得時刻 [ms] をまとめて1フレームで送る
+    //  フレームに入れる1つあたりの最大長  時刻・液面の差分のvarint
+    static constexpr size_t BATCH_ENTRY_MAX_LENGTH = 5 + 3;
+    //  フレームの最大長  種類, シーケンス番号, 数, 最初の時刻（ホストの時刻では6byte）, 最初の液面, 差分..., CRC
+    static constexpr size_t BATCH_FRAME_SIZE = 3 + TIMESTAMP_SIZE + 2 + (MAX_BATCH_SIZE - 1) * BATCH_ENTRY_MAX_LENGTH + 2;
+
+    uint8_t batch_size = 1;         // 1:バッチにしない
+    uint16_t batch_max_latency = DEFAULT_BATCH_MAX_LATENCY; // 最初の液面からこの時間で送る [CLK Cycle]  0:数だけで送る
+    uint8_t batch_count = 0;
+    uint32_t batch_start_tick = 0;
+    uint16_t batch_levels[MAX_BATCH_SIZE];
+    uint32_t batch_times[MAX_BATCH_SIZE];   // 取得時刻 millis()
+    uint8_t frame_buffer[BATCH_FRAME_SIZE];
+
+    // バイナリ形式のレコード  (ID, 値)の並び
+    uint8_t record_buffer[RECORD_BUFFER_SIZE];
+    size_t record_length = 0;
+    uint8_t frame_sequence = 0;
+
+    void drain(void);
+    bool admit(const size_t length, const E_Priority priority, const uint32_t fields);
+    void push(const uint8_t* data, const size_t length);
+    bool evict(const E_Priority lowest);
+    void removeFrame(const size_t index);
+    void receive(void);
+    bool executeCommand(const CommandParser::Command& command);
+    bool enableDriver(const uint8_t address, const uint32_t de_pin);
+    void receiveMultidrop(void);
+    void receiveModbus(void);
+    void handleRequest(const uint8_t function, const uint8_t* data, const size_t length, const bool respond);
+    void releaseBus(void);
+    void evaluatePublish(void);
+    void putRecord(const E_Schema schema, const uint16_t value);
+    bool putTimestamp(const uint32_t acquired_ms);
+    E_Priority takePayloadPriority(void);
+    void addPayloadKey(const char* key);
+    size_t sendRecords(void);
+    size_t sendBatch(void);
+    size_t sendFrame(uint8_t* frame, size_t length, const E_Priority priority, const uint32_t fields);
+    static size_t putVarint(uint8_t* buffer, uint32_t value);
+    uint64_t batchTime(const uint8_t index, const bool epoch);
+
+#if EH_I2C_PROFILE
+    void addI2cStat(const char* key, const I2cProfiler::Stat& stat);
+#endif
 };
 
 #endif // _IOTGATEWAY_H_
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "JsonWriter.h"
+
+/// @brief 内容をクリアする
+void JsonWriter::clear(void){
+    used = 0;
+    node_start = 0;
+    node_failed = false;
+    if (capacity != 0){
+        buffer[0] = '\0';
+    }
+    return;
+}
+
+/// @brief 内容を直接書き込む（オーバーライト）
+/// @param json 大外の { } なしの形のJSONデータ
+/// @return True:成功   False:入りきらない（内容は空になる）
+bool JsonWriter::set(const char* json){
+    clear();
+    appendRaw(json);
+    if (node_failed){
+        overflow_count++;
+        clear();
+        return false;
+    }
+    buffer[used] = '\0';
+    node_start = used;
+    return true;
+}
+
+/// @brief ノードを加える
+/// @param key JSONのキー
+/// @param value 値（文字列）  エスケープして書き込む
+/// @return True:成功   False:入りきらない（ノードは捨てる）
+bool JsonWriter::add(const char* key, const char* value){
+    beginNode(key);
+    appendString(value);
+    return endNode();
+}
+
+/// @brief ノードを加える
+/// @param key JSONのキー
+/// @param value 数値（整数）
+/// @return True:成功   False:入りきらない（ノードは捨てる）
+bool JsonWriter::add(const char* key, const int32_t value){
+    beginNode(key);
+    appendInt(value);
+    return endNode();
+}
+
+/// @brief ノードを加える
+/// @param key JSONのキー
+/// @param value 数値（小数）  NaN, infはnullとする
+/// @param decimal_places 出力する小数点以下桁数
+/// @return True:成功   False:入りきらない（ノードは捨てる）
+bool JsonWriter::add(const char* key, const float value, const uint8_t decimal_places){
+    beginNode(key);
+    appendFloat(value, decimal_places);
+    return endNode();
+}
+
+/// @brief ノードの書き込みを開始する  区切りとキーを書き込む
+/// @param key JSONのキー  エスケープして書き込む
+/// @return True:成功   False:入りきらない
+bool JsonWriter::beginNode(const char* key){
+    node_start = used;
+    node_failed = false;
+    if (used != 0){
+        put(',');
+    }
+    appendString(key);
+    return put(':');
+}
+
+/// @brief 文字列をそのまま書き込む
+/// @param text 文字列
+/// @return True:成功   False:入りきらない
+bool JsonWriter::appendRaw(const char* text){
+    while (*text != '\0'){
+        put(*text++);
+    }
+    return !node_failed;
+}
+
+/// @brief 1文字をそのまま書き込む
+/// @param c 文字
+/// @return True:成功   False:入りきらない
+bool JsonWriter::appendChar(const char c){
+    return put(c);
+}
+
+/// @brief 文字列を "" で囲み、エスケープして書き込む
+/// @param text 文字列
+/// @return True:成功   False:入りきらない
+bool JsonWriter::appendString(const char* text){
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    for (; *text != '\0'; text++){
+        const uint8_t c = static_cast<uint8_t>(*text);
+        switch (c){
+            case '"' :  put('\\'); put('"');  break;
+            case '\\' : put('\\'); put('\\'); break;
+            case '\n' : put('\\'); put('n');  break;
+            case '\r' : put('\\'); put('r');  break;
+            case '\t' : put('\\'); put('t');  break;
+            default:
+                if (c < 0x20){
+                    put('\\'); put('u'); put('0'); put('0');
+                    put(hex[c >> 4]); put(hex[c & 0x0F]);
+                } else {
+                    put(c);
+                }
+                break;
+        }
+    }
+    return put('"');
+}
+
+/// @brief 整数を書き込む
+/// @param value 数値
+/// @return True:成功   False:入りきらない
+bool JsonWriter::appendInt(const int32_t value){
+    if (value < 0){
+        put('-');
+        // INT32_MINでも正しく変換できるように符号なしで扱う
+        return appendUint(0U - static_cast<uint32_t>(value));
+    }
+    return appendUint(static_cast<uint32_t>(value));
+}
+
+/// @brief 符号なし整数を書き込む
+/// @param value 数値
+/// @return True:成功   False:入りきらない
+bool JsonWriter::appendUint(uint32_t value){
+    char digits[10];
+    uint8_t count = 0;
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count != 0){
+        put(digits[--count]);
+    }
+    return !node_failed;
+}
+
+/// @brief 64bitの符号なし整数を書き込む
+/// @param value 数値  epochからの時間 [ms] など
+/// @return True:成功   False:入りきらない
+/// @note 32bitに収まる値はappendUint()で書き込む（64bitの除算は遅い）
+bool JsonWriter::appendUint64(uint64_t value){
+    if (value <= UINT32_MAX){
+        return appendUint(static_cast<uint32_t>(value));
+    }
+    char digits[20];
+    uint8_t count = 0;
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count != 0){
+        put(digits[--count]);
+    }
+    return !node_failed;
+}
+
+/// @brief 小数を書き込む
+/// @param value 数値  NaN, inf, 整数部がuint32_tに入らないものはnullとする
+/// @param decimal_places 小数点以下桁数  MAX_DECIMAL_PLACESまで
+/// @return True:成功   False:入りきらない
+bool JsonWriter::appendFloat(float value, const uint8_t decimal_places){
+    if (isnan(value) || isinf(value) || value >= 4294967040.0f || value <= -4294967040.0f){
+        return appendRaw("null");
+    }
+    const uint8_t places = (decimal_places < MAX_DECIMAL_PLACES) ? decimal_places : MAX_DECIMAL_PLACES;
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < places; i++){
+        scale *= 10;
+    }
+
+    if (value < 0){
+        value = -value;
+        put('-');
+    }
+    uint32_t integer = static_cast<uint32_t>(value);
+    uint32_t fraction = static_cast<uint32_t>((value - integer) * scale + 0.5f);
+    if (fraction >= scale){
+        integer++;
+        fraction -= scale;
+    }
+    appendUint(integer);
+    if (places != 0){
+        put('.');
+        for (uint32_t digit = scale / 10; digit != 0; digit /= 10){
+            put('0' + (fraction / digit) % 10);
+        }
+    }
+    return !node_failed;
+}
+
+/// @brief ノードの書き込みを確定する
+/// @return True:成功   False:入りきらなかったのでノードを捨てた
+bool JsonWriter::endNode(void){
+    if (node_failed){
+        used = node_start;
+        overflow_count++;
+    }
+    buffer[used] = '\0';
+    node_start = used;
+    const bool result = !node_failed;
+    node_failed = false;
+    return result;
+}
+
+/// @brief 1文字書き込む  (private)
+/// @param c 文字
+/// @return True:成功   False:入りきらない
+/// @note 終端の'\0'の分を残す。書き込み中のノードが入りきらなかった場合は以降何もしない
+bool JsonWriter::put(const char c){
+    if (node_failed || used + 1 >= capacity){
+        node_failed = true;
+        return false;
+    }
+    buffer[used++] = c;
+    return true;
+}
@@ -0,0 +1,92 @@
+/**************************************************************************/
+/*!
+ * @file JsonWriter.h/cpp
+ * @brief 固定長バッファへのJSON書き出し  ヒープを使わない
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    大外の { } なしの形（"key":value,"key":value...）でバッファに直接書き込む。
+ *    ノードが入りきらない場合はそのノードを書き込まずに捨て、overflowとして数える。
+ */
+/**************************************************************************/
+
+#ifndef _JSONWRITER_H_
+#define _JSONWRITER_H_
+
+#include <Arduino.h>
+
+class JsonWriter {
+
+    public:
+    // methods
+    /*!
+    * @brief constructor
+    * @param buffer 書き込み先  終端の'\0'の分も含めてcapacityの長さがあること
+    * @param capacity バッファの長さ
+    */
+    JsonWriter(char* buffer, const size_t capacity)
+        : buffer(buffer), capacity(capacity){
+        clear();
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~JsonWriter(){
+    };
+
+    void clear(void);
+    bool set(const char* json);
+
+    bool add(const char* key, const char* value);
+    bool add(const char* key, const int32_t value);
+    bool add(const char* key, const float value, const uint8_t decimal_places);
+
+    // ノードを部分ごとに書き込む  beginNode()の後に値を書き、endNode()で確定する
+    bool beginNode(const char* key);
+    bool appendRaw(const char* text);
+    bool appendChar(const char c);
+    bool appendString(const char* text);
+    bool appendInt(const int32_t value);
+    bool appendUint(uint32_t value);
+    bool appendUint64(uint64_t value);
+    bool appendFloat(float value, const uint8_t decimal_places);
+    bool endNode(void);
+
+    /// @brief 書き込んだ内容  '\0'で終端されている
+    const char* c_str(void) const {
+        return buffer;
+    };
+
+    /// @brief 書き込んだ長さ（終端を含まない）
+    size_t length(void) const {
+        return used;
+    };
+
+    /// @brief 入りきらずに捨てたノードの数
+    uint32_t getOverflowCount(void) const {
+        return overflow_count;
+    };
+
+    private:
+    // consts
+
+    // 小数の最大桁数
+    static constexpr uint8_t MAX_DECIMAL_PLACES = 6;
+
+    // vars
+    char* const buffer;
+    const size_t capacity;
+
+    size_t used = 0;            // 確定した長さ
+    size_t node_start = 0;      // 書き込み中のノードの開始位置（区切りのカンマを含む）
+    bool node_failed = false;   // 書き込み中のノードが入りきらなかった
+    uint32_t overflow_count = 0;
+
+    // methods
+    bool put(const char c);
+};
+
+#endif //_JSONWRITER_H_
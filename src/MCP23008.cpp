@@ -0,0 +1,136 @@
+/**************************************************************************/
+/*!
+    @file     MCP23008.cpp
+
+        I2C Driver for MCP23008/Microchip  (register access of Adafruit_MCP23008)
+
+        @section  HISTORY
+
+*/
+/**************************************************************************/
+
+#include "MCP23008.h"
+
+/**************************************************************************/
+/*!
+    @brief  Instantiates a new MCP23008 class
+*/
+/**************************************************************************/
+MCP23008::MCP23008() {}
+
+/**************************************************************************/
+/*!
+    @brief  Destroys the I2C device held in the object
+*/
+/**************************************************************************/
+MCP23008::~MCP23008() {
+  if (i2c_dev) {
+    i2c_dev->~Adafruit_I2CDevice();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Setups the hardware and restores the power-on register values
+            (all pins input, no pull-up)
+    @param i2c_address The I2C address of the device, defaults to 0x20
+    @param wire The I2C TwoWire object to use, defaults to &Wire
+    @returns True if the device was found and the registers were written.
+*/
+/**************************************************************************/
+bool MCP23008::begin(uint8_t i2c_address, TwoWire *wire) {
+  if (i2c_dev) {
+    i2c_dev->~Adafruit_I2CDevice();
+  }
+
+  // construct in place: re-calling begin() does not touch the heap
+  i2c_dev = new (i2c_dev_storage) Adafruit_I2CDevice(i2c_address, wire);
+
+  if (!i2c_dev->begin()) {
+    return false;
+  }
+
+  // IODIR = 0xFF (all input), the others 0  (sequential write from IODIR)
+  const uint8_t defaults[] = {MCP23008::REG::REG_IODIR, 0xFF, 0, 0, 0, 0,
+                              0, 0, 0, 0, 0};
+  return i2c_dev->write(defaults, sizeof(defaults));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the direction of a pin
+    @param p pin number 0..7
+    @param d INPUT or OUTPUT
+*/
+/**************************************************************************/
+void MCP23008::pinMode(uint8_t p, uint8_t d) {
+  updateBit(MCP23008::REG::REG_IODIR, p, d == INPUT);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables the internal 100k pull-up of a pin
+    @param p pin number 0..7
+    @param d HIGH: enable, LOW: disable
+*/
+/**************************************************************************/
+void MCP23008::pullUp(uint8_t p, uint8_t d) {
+  updateBit(MCP23008::REG::REG_GPPU, p, d == HIGH);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the output latch of a pin
+    @param p pin number 0..7
+    @param d HIGH or LOW
+*/
+/**************************************************************************/
+void MCP23008::digitalWrite(uint8_t p, uint8_t d) {
+  updateBit(MCP23008::REG::REG_OLAT, p, d == HIGH);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the level of a pin
+    @param p pin number 0..7
+    @returns 1: HIGH, 0: LOW
+*/
+/**************************************************************************/
+uint8_t MCP23008::digitalRead(uint8_t p) {
+  return (read8(MCP23008::REG::REG_GPIO) >> (p & 7)) & 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads a register (0 if the device does not answer)
+*/
+/**************************************************************************/
+uint8_t MCP23008::read8(uint8_t reg) {
+  uint8_t value = 0;
+  i2c_dev->write_then_read(&reg, 1, &value, 1);
+  return value;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a register
+*/
+/**************************************************************************/
+void MCP23008::write8(uint8_t reg, uint8_t value) {
+  const uint8_t packet[2] = {reg, value};
+  i2c_dev->write(packet, 2);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read-modify-write of one bit of a register
+*/
+/**************************************************************************/
+void MCP23008::updateBit(uint8_t reg, uint8_t p, bool set) {
+  if (p > 7) {
+    return;
+  }
+  uint8_t value = read8(reg);
+  value = set ? (value | (1 << p)) : (value & ~(1 << p));
+  write8(reg, value);
+}
@@ -0,0 +1,65 @@
+/**************************************************************************/
+/*!
+    @file     MCP23008.h
+*/
+/**************************************************************************/
+
+#ifndef _MCP23008_H_
+#define _MCP23008_H_
+
+#include <Arduino.h>
+#include <Adafruit_I2CDevice.h>
+#include <Wire.h>
+#include <new>
+
+constexpr uint8_t MCP23008_I2CADDR = 0x20; ///< Default i2c address (A2..A0 = GND)
+
+/**************************************************************************/
+/*!
+    @brief  Class for communicating with an MCP23008 I/O expander
+            Same register access as Adafruit_MCP23008, but the I2C device
+            is held in the object so begin() does not touch the heap
+*/
+/**************************************************************************/
+class MCP23008 {
+public:
+  // register table:
+  enum REG {
+    REG_IODIR,    //0 I/O direction  1:input
+    REG_IPOL,     //1 input polarity
+    REG_GPINTEN,  //2 interrupt-on-change enable
+    REG_DEFVAL,   //3 default compare value
+    REG_INTCON,   //4 interrupt control
+    REG_IOCON,    //5 configuration
+    REG_GPPU,     //6 pull-up  1:enable (100k)
+    REG_INTF,     //7 interrupt flag
+    REG_INTCAP,   //8 interrupt capture
+    REG_GPIO,     //9 port
+    REG_OLAT      //10 output latch
+  };
+
+public:
+  MCP23008();
+  ~MCP23008();
+  MCP23008(const MCP23008 &) = delete;
+  MCP23008 &operator=(const MCP23008 &) = delete;
+
+  bool begin(uint8_t i2c_address = MCP23008_I2CADDR, TwoWire *wire = &Wire);
+
+  void pinMode(uint8_t p, uint8_t d);
+  void pullUp(uint8_t p, uint8_t d);
+  void digitalWrite(uint8_t p, uint8_t d);
+  uint8_t digitalRead(uint8_t p);
+
+private:
+  Adafruit_I2CDevice *i2c_dev = NULL;
+
+  // in-object storage for i2c_dev (no heap allocation)
+  alignas(Adafruit_I2CDevice) uint8_t i2c_dev_storage[sizeof(Adafruit_I2CDevice)];
+
+  uint8_t read8(uint8_t reg);
+  void write8(uint8_t reg, uint8_t value);
+  void updateBit(uint8_t reg, uint8_t p, bool set);
+};
+
+#endif
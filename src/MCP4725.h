@@ -0,0 +1,48 @@
+/**************************************************************************/
+/*!
+    @file     MCP4725.h
+*/
+/**************************************************************************/
+
+#ifndef _MCP4725_H_
+#define _MCP4725_H_
+
+#include <Adafruit_I2CDevice.h>
+#include <Wire.h>
+#include <new>
+
+constexpr uint8_t MCP4725_I2CADDR = 0x60; ///< Default i2c address (A0 pin = GND)
+
+/**************************************************************************/
+/*!
+    @brief  Class for communicating with an MCP4725 DAC
+            Same protocol as Adafruit_MCP4725, but the I2C device is held
+            in the object so begin() does not touch the heap
+*/
+/**************************************************************************/
+class MCP4725 {
+public:
+  // command byte table:
+  enum CMD {
+    CMD_WRITEDAC = 0x40,       // Writes data to the DAC
+    CMD_WRITEDACEEPROM = 0x60  // Writes data to the DAC and the EEPROM
+  };
+
+public:
+  MCP4725();
+  ~MCP4725();
+  MCP4725(const MCP4725 &) = delete;
+  MCP4725 &operator=(const MCP4725 &) = delete;
+
+  bool begin(uint8_t i2c_address = MCP4725_I2CADDR, TwoWire *wire = &Wire);
+  bool setVoltage(const uint16_t output, const bool writeEEPROM,
+                  const uint32_t i2c_frequency = 0);
+
+private:
+  Adafruit_I2CDevice *i2c_dev = NULL;
+
+  // in-object storage for i2c_dev (no heap allocation)
+  alignas(Adafruit_I2CDevice) uint8_t i2c_dev_storage[sizeof(Adafruit_I2CDevice)];
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "ModbusSlave.h"
+#include "Crc16.h"
+#include <string.h>
+
+/// @brief スレーブアドレスを設定する
+/// @param address 1-247  0:応答しない
+void ModbusSlave::setAddress(const uint8_t address){
+    this->address = address;
+    frame_length = 0;
+    frame_overflow = false;
+}
+
+/// @brief レジスタの値を設定する  応答に使うのは次のlatch()の後
+/// @param reg レジスタ
+/// @param value 値
+void ModbusSlave::setRegister(const E_Register reg, const uint16_t value){
+    const uint16_t index = static_cast<uint16_t>(reg);
+    if (index < REGISTER_COUNT){
+        registers[index] = value;
+    }
+}
+
+/// @brief 2ワードのレジスタにfloatを設定する  上位ワードが先
+/// @param reg レジスタ（先頭）
+/// @param value 値
+void ModbusSlave::setFloat(const E_Register reg, const float value){
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t index = static_cast<uint16_t>(reg);
+    if (index + 1 < REGISTER_COUNT){
+        registers[index] = bits >> 16;
+        registers[index + 1] = bits & 0xFFFF;
+    }
+}
+
+/// @brief 最新の値をスナップショットにコピーする
+/// @note CLKごとに、受信したフレームを処理する前に1回呼び出す
+void ModbusSlave::latch(void){
+    memcpy(snapshot, registers, sizeof(snapshot));
+}
+
+/// @brief 受信した1byteを渡す
+/// @param c 受信データ
+/// @note 最大長を超えたフレームは、次の区切り（受信の途切れ）まで捨てる
+///       末尾の8byteがCRCの合う読み出し要求になったら、その前で区切って前の部分を捨てる
+///       （共有バスで、他のスレーブの応答などに3.5文字時間未満で続いた要求）
+void ModbusSlave::feed(const uint8_t c){
+    if (frame_length < MAX_FRAME_LENGTH){
+        frame[frame_length++] = c;
+    } else {
+        frame_overflow = true;
+        return;
+    }
+    if (frame_length > READ_REQUEST_LENGTH && isReadRequestAt(frame_length - READ_REQUEST_LENGTH)){
+        memmove(frame, &frame[frame_length - READ_REQUEST_LENGTH], READ_REQUEST_LENGTH);
+        frame_length = READ_REQUEST_LENGTH;
+        resync_count++;
+    }
+}
+
+/// @brief フレームが揃っていれば処理して応答を作る
+/// @param idle True:このCLKでは受信がなかった（フレームの区切り）
+/// @param response 応答の書き込み先  MAX_RESPONSE_LENGTH以上
+/// @return 応答の長さ  0:応答しない
+/// @note CLKごとに、そのCLKの受信データをfeed()した後に呼び出す
+///       feed()の1byteごとにidle=falseで呼び出すと、読み出し要求が揃ったbyteで応答できる
+size_t ModbusSlave::service(const bool idle, uint8_t* response){
+    if (frame_length == 0 || (!idle && !isCompleteReadRequest())){
+        return 0;
+    }
+    size_t length = 0;
+    if (frame_overflow || frame_length < 4){
+        frame_error_count++;
+    } else {
+        length = handleFrame(response);
+    }
+    frame_length = 0;
+    frame_overflow = false;
+    return length;
+}
+
+/// @brief 受信中のフレームが完全な読み出し要求か   (private)
+/// @return True:8byteでCRCが合う読み出し要求
+bool ModbusSlave::isCompleteReadRequest(void) const {
+    return frame_length == READ_REQUEST_LENGTH && !frame_overflow && isReadRequestAt(0);
+}
+
+/// @brief 受信中のフレームのoffsetからの8byteが読み出し要求か   (private)
+/// @param offset 先頭の位置  offset + 8 <= frame_length
+/// @return True:ファンクションが読み出しで、CRCが合う
+bool ModbusSlave::isReadRequestAt(const size_t offset) const {
+    const uint8_t* request = &frame[offset];
+    if (request[1] != FUNCTION_READ_HOLDING_REGISTERS && request[1] != FUNCTION_READ_INPUT_REGISTERS){
+        return false;
+    }
+    const uint16_t crc = request[6] | (request[7] << 8);
+    return Crc16::modbus(request, 6) == crc;
+}
+
+/// @brief 1フレームを処理する   (private)
+/// @param response 応答の書き込み先
+/// @return 応答の長さ  0:応答しない（CRCエラー、他のスレーブ宛て、ブロードキャスト）
+size_t ModbusSlave::handleFrame(uint8_t* response){
+    const uint16_t crc = frame[frame_length - 2] | (frame[frame_length - 1] << 8);
+    if (Crc16::modbus(frame, frame_length - 2) != crc){
+        frame_error_count++;
+        return 0;
+    }
+    // ブロードキャスト（0）は読み出しに使えないので応答しない
+    if (address == 0 || frame[0] != address){
+        return 0;
+    }
+
+    const uint8_t function = frame[1];
+    if (function != FUNCTION_READ_HOLDING_REGISTERS && function != FUNCTION_READ_INPUT_REGISTERS){
+        return exceptionResponse(function, EXCEPTION_ILLEGAL_FUNCTION, response);
+    }
+    if (frame_length != READ_REQUEST_LENGTH){
+        return exceptionResponse(function, EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    const uint16_t start = (frame[2] << 8) | frame[3];
+    const uint16_t quantity = (frame[4] << 8) | frame[5];
+    if (quantity == 0 || quantity > MAX_READ_QUANTITY){
+        return exceptionResponse(function, EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    if (start >= REGISTER_COUNT || quantity > REGISTER_COUNT - start){
+        return exceptionResponse(function, EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    size_t length = 0;
+    response[length++] = address;
+    response[length++] = function;
+    response[length++] = quantity * 2;
+    for (uint16_t i = 0; i < quantity; i++){
+        response[length++] = snapshot[start + i] >> 8;
+        response[length++] = snapshot[start + i] & 0xFF;
+    }
+    request_count++;
+    return appendCrc(response, length);
+}
+
+/// @brief 例外応答を作る   (private)
+/// @param function 要求のファンクションコード
+/// @param code 例外コード
+/// @param response 応答の書き込み先
+/// @return 応答の長さ
+size_t ModbusSlave::exceptionResponse(const uint8_t function, const uint8_t code, uint8_t* response){
+    response[0] = address;
+    response[1] = function | EXCEPTION_FLAG;
+    response[2] = code;
+    request_count++;
+    exception_count++;
+    return appendCrc(response, 3);
+}
+
+/// @brief CRCを付ける  下位byteが先   (private)
+/// @param response 応答
+/// @param length CRCを除く長さ
+/// @return CRCを含む長さ
+size_t ModbusSlave::appendCrc(uint8_t* response, const size_t length){
+    const uint16_t crc = Crc16::modbus(response, length);
+    response[length] = crc & 0xFF;
+    response[length + 1] = crc >> 8;
+    return length + 2;
+}
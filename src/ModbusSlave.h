@@ -0,0 +1,157 @@
+/**************************************************************************/
+/*!
+ * @file ModbusSlave.h/cpp
+ * @brief Modbus RTUスレーブ  レジスタの読み出し（0x03, 0x04）のみ
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    読み出しはlatch()でCLKごとに1回コピーしたスナップショットから応答するので、
+ *    応答の内容・時間は計測の状態によらない（計測中に値が半分だけ更新された状態を返さない）。
+ *    フレームの終わりは1CLK受信が途切れたこと（3.5文字時間以上）で判断する。
+ *    ただし読み出し要求は8byteと決まっているので、8byteでCRCが合えばそのCLKで応答する。
+ *    共有バスでは他のスレーブとのやり取りに続けて要求が届き、1CLKの途切れがないことがあるので、
+ *    末尾の8byteが読み出し要求になったらその前で区切る。
+ *    受信・応答ともに固定長のバッファで、ヒープを使わない。
+ *    Arduinoに依存しないので、ホスト側でもそのまま使える。
+ *
+ *    レジスタマップ  0x03（Holding）, 0x04（Input）とも同じ  書き込みには対応しない
+ *      0   液面 [0.1%]
+ *      1   測定モード  0:TIMER 1:MANUAL 2:CONT
+ *      2   タイマ残り時間 [min]
+ *      3   エラーフラグ  bit0:センサエラー  bit1:デバイスエラー
+ *      4   センサ長 [inch]
+ *      5   タイマ周期 [min]
+ *      6   スケーリング 100% [0.1%]
+ *      7   スケーリング 0% [0.1%]
+ *      8   電流源設定値 [0.1mA]
+ *      9   アナログモニタDAオフセット [LSB]
+ *      10  ADCオフセット補正 電圧計測（int16_t）
+ *      11  ADCオフセット補正 電流計測（int16_t）
+ *      12-13   ADCエラー補正系数 電圧計測（float  上位ワードが先）
+ *      14-15   ADCエラー補正系数 電流計測（float  上位ワードが先）
+ */
+/**************************************************************************/
+
+#ifndef _MODBUSSLAVE_H_
+#define _MODBUSSLAVE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class ModbusSlave {
+
+    public:
+    // consts
+
+    /// @brief レジスタのアドレス
+    enum class E_Register : uint16_t {
+        LEVEL = 0,
+        MODE,
+        REMAIN,
+        ERROR_FLAGS,
+        SENSOR_LENGTH,
+        TIMER_PERIOD,
+        SCALE_100,
+        SCALE_0,
+        CURRENT_SET,
+        VMON_DA_OFFSET,
+        ADC_OFFSET_01,
+        ADC_OFFSET_23,
+        ADC_GAIN_ERROR_01,  // 2ワード
+        ADC_GAIN_ERROR_23 = ADC_GAIN_ERROR_01 + 2  // 2ワード
+    };
+
+    // レジスタの数
+    static constexpr uint16_t REGISTER_COUNT = static_cast<uint16_t>(E_Register::ADC_GAIN_ERROR_23) + 2;
+
+    // ファンクションコード
+    static constexpr uint8_t FUNCTION_READ_HOLDING_REGISTERS = 0x03;
+    static constexpr uint8_t FUNCTION_READ_INPUT_REGISTERS = 0x04;
+    static constexpr uint8_t EXCEPTION_FLAG = 0x80;
+
+    // 例外コード
+    static constexpr uint8_t EXCEPTION_ILLEGAL_FUNCTION = 0x01;
+    static constexpr uint8_t EXCEPTION_ILLEGAL_DATA_ADDRESS = 0x02;
+    static constexpr uint8_t EXCEPTION_ILLEGAL_DATA_VALUE = 0x03;
+
+    // 応答の最大長  アドレス, ファンクション, バイト数, レジスタ, CRC
+    static constexpr size_t MAX_RESPONSE_LENGTH = 3 + 2 * REGISTER_COUNT + 2;
+
+    // methods
+    /*!
+    * @brief constructor
+    */
+    ModbusSlave(){
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~ModbusSlave(){
+    };
+
+    void setAddress(const uint8_t address);
+    void setRegister(const E_Register reg, const uint16_t value);
+    void setFloat(const E_Register reg, const float value);
+    void latch(void);
+
+    void feed(const uint8_t c);
+    size_t service(const bool idle, uint8_t* response);
+
+    /// @brief 応答した要求の数（例外応答を含む）
+    uint32_t getRequestCount(void) const {
+        return request_count;
+    };
+
+    /// @brief 例外応答の数
+    uint32_t getExceptionCount(void) const {
+        return exception_count;
+    };
+
+    /// @brief CRCエラー・長さ不足で捨てたフレームの数
+    uint32_t getFrameErrorCount(void) const {
+        return frame_error_count;
+    };
+
+    /// @brief 前のフレームに続けて届いた読み出し要求で区切った数
+    uint32_t getResyncCount(void) const {
+        return resync_count;
+    };
+
+    private:
+    // consts
+
+    // RTUフレームの最大長
+    static constexpr size_t MAX_FRAME_LENGTH = 256;
+
+    // 読み出し要求の長さ  アドレス, ファンクション, 開始アドレス, 数, CRC
+    static constexpr size_t READ_REQUEST_LENGTH = 8;
+
+    // 1回に読み出せるレジスタの最大数（仕様）
+    static constexpr uint16_t MAX_READ_QUANTITY = 125;
+
+    // vars
+    uint8_t address = 0;    // 0:応答しない
+    uint16_t registers[REGISTER_COUNT] = {};    // 最新の値
+    uint16_t snapshot[REGISTER_COUNT] = {};     // 応答に使う値  latch()でコピーする
+
+    uint8_t frame[MAX_FRAME_LENGTH];
+    size_t frame_length = 0;
+    bool frame_overflow = false;
+
+    uint32_t request_count = 0;
+    uint32_t exception_count = 0;
+    uint32_t frame_error_count = 0;
+    uint32_t resync_count = 0;
+
+    // methods
+    bool isCompleteReadRequest(void) const;
+    bool isReadRequestAt(const size_t offset) const;
+    size_t handleFrame(uint8_t* response);
+    size_t exceptionResponse(const uint8_t function, const uint8_t code, uint8_t* response);
+    static size_t appendCrc(uint8_t* response, const size_t length);
+};
+
+#endif //_MODBUSSLAVE_H_
@@ -0,0 +1,58 @@
+#include "MultidropFrame.h"
+#include "Cobs.h"
+#include "Crc16.h"
+
+/// @brief フレームを符号化する
+/// @param address アドレス
+/// @param function ファンクション
+/// @param data データ
+/// @param length データ長  MAX_DATA_LENGTHまで
+/// @param destination 書き込み先  MAX_ENCODED_LENGTH以上の長さがあること
+/// @return 符号化後の長さ（区切りを含む）  0:データが長すぎる
+size_t MultidropFrame::encode(const uint8_t address, const uint8_t function,
+                              const uint8_t* data, const size_t length, uint8_t* destination){
+    if (length > MAX_DATA_LENGTH){
+        return 0;
+    }
+    uint8_t frame[MAX_FRAME_LENGTH];
+    size_t frame_length = 0;
+    frame[frame_length++] = address;
+    frame[frame_length++] = function;
+    for (size_t i = 0; i < length; i++){
+        frame[frame_length++] = data[i];
+    }
+    const uint16_t crc = Crc16::modbus(frame, frame_length);
+    frame[frame_length++] = crc & 0xFF;
+    frame[frame_length++] = crc >> 8;
+
+    size_t encoded_length = Cobs::encode(frame, frame_length, destination);
+    destination[encoded_length++] = Cobs::DELIMITER;
+    return encoded_length;
+}
+
+/// @brief フレームを復号する
+/// @param frame COBSで符号化されたフレーム（区切りは含まない）  その場で復号する
+/// @param length フレームの長さ
+/// @param address アドレス
+/// @param function ファンクション
+/// @param data データの先頭（frameの中を指す）
+/// @param data_length データ長
+/// @return True:成功   False:COBS, CRCのいずれかが不正
+bool MultidropFrame::decode(uint8_t* frame, const size_t length, uint8_t& address, uint8_t& function,
+                            const uint8_t*& data, size_t& data_length){
+    // 復号後は短くなるので上書きできる
+    const size_t decoded_length = Cobs::decode(frame, length, frame);
+    if (decoded_length < 4){
+        return false;
+    }
+    const size_t body_length = decoded_length - 2;
+    const uint16_t crc = frame[body_length] | (frame[body_length + 1] << 8);
+    if (Crc16::modbus(frame, body_length) != crc){
+        return false;
+    }
+    address = frame[0];
+    function = frame[1];
+    data = &frame[2];
+    data_length = body_length - 2;
+    return true;
+}
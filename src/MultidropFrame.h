@@ -0,0 +1,64 @@
+/**************************************************************************/
+/*!
+ * @file MultidropFrame.h/cpp
+ * @brief RS-485マルチドロップの要求・応答フレーム
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    フレーム  [アドレス][ファンクション][データ...][CRC-16/MODBUS 下位 上位]  をCOBSで符号化し、0x00で区切る。
+ *    親局（ホスト）が要求を送り、アドレスの一致した子局（計測ユニット）だけが応答する。
+ *    応答のアドレスは子局自身のアドレス、ファンクションは要求のファンクション | RESPONSE_FLAG。
+ *    ブロードキャスト（アドレス0）には応答しない。
+ *      POLL     要求データなし      応答データ  [シーケンス番号][ID 値]...（バイナリ形式のレコードと同じ）
+ *      COMMAND  要求データ  コマンド1行（改行なし）   応答データ  [結果 0:実行した 1:実行できない]
+ *    Arduinoに依存しないので、ホスト側でもそのまま使える。
+ */
+/**************************************************************************/
+
+#ifndef _MULTIDROPFRAME_H_
+#define _MULTIDROPFRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class MultidropFrame {
+
+    public:
+    // consts
+
+    // アドレス  0:ブロードキャスト  1-247:子局
+    static constexpr uint8_t BROADCAST_ADDRESS = 0;
+    static constexpr uint8_t MAX_ADDRESS = 247;
+
+    // ファンクション
+    static constexpr uint8_t FUNCTION_POLL = 0x01;
+    static constexpr uint8_t FUNCTION_COMMAND = 0x02;
+    static constexpr uint8_t RESPONSE_FLAG = 0x80;
+
+    // COMMANDの応答
+    static constexpr uint8_t RESULT_OK = 0;
+    static constexpr uint8_t RESULT_ERROR = 1;
+
+    // データの最大長
+    static constexpr size_t MAX_DATA_LENGTH = 32;
+
+    // 符号化前のフレームの最大長  アドレス, ファンクション, データ, CRC
+    static constexpr size_t MAX_FRAME_LENGTH = 2 + MAX_DATA_LENGTH + 2;
+
+    // 符号化後の最大長  区切りを含む
+    static constexpr size_t MAX_ENCODED_LENGTH = MAX_FRAME_LENGTH + MAX_FRAME_LENGTH / 254 + 1 + 1;
+
+    // methods
+    static size_t encode(const uint8_t address, const uint8_t function,
+                         const uint8_t* data, const size_t length, uint8_t* destination);
+    static bool decode(uint8_t* frame, const size_t length, uint8_t& address, uint8_t& function,
+                       const uint8_t*& data, size_t& data_length);
+
+    /// @brief 子局のアドレスとして使えるか
+    static constexpr bool isUnitAddress(const uint8_t address){
+        return address != BROADCAST_ADDRESS && address <= MAX_ADDRESS;
+    };
+};
+
+#endif //_MULTIDROPFRAME_H_
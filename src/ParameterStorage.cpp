@@ -4,14 +4,18 @@
 /// @param parameter_name パラメータ名(enum)
 /// @param parameter 製造番号
 /// @return True:成功   False:失敗
+/// @note 最大長（SER_NUM_MAX_LENGTH）を1回のトランザクションで読み、終端を探す  parameterはその長さがあること
 bool ParameterStorage::read(const E_ParameterCategories parameter_name, char* parameter){
     if (DEBUG){Serial.print("Method-read: ");}
     if (parameter_name == E_ParameterCategories::SERIAL_NUMBER){
         const uint16_t idx = static_cast<uint16_t>(parameter_name);            
+        if (!readBlock(idx, (uint8_t *) parameter, SER_NUM_MAX_LENGTH)){
+            if (DEBUG){Serial.println("FRAM not responding!");}
+            return false;
+        }
         size_t i = 0;
-        for (i=0; i < SER_NUM_MAX_LENGTH; i++){
-            parameter[i] = Adafruit_FRAM_I2C::read8(idx + i);
-            if (parameter[i] == '\0') break;
+        while (i < SER_NUM_MAX_LENGTH && parameter[i] != '\0'){
+            i++;
         }
         if (i == SER_NUM_MAX_LENGTH | i == 0){
             if (DEBUG){Serial.println("found no EOL!");}
@@ -48,15 +52,55 @@ bool ParameterStorage::store(const E_ParameterCategories parameter_name, const c
             return false;
         }
 
-        for (uint16_t i = 0; i < len ; i++){
-            if (DEBUG) {Serial.print(parameter[i]);}
-            Adafruit_FRAM_I2C::write8(idx + i, parameter[i]);
-        }
+        if (DEBUG) {Serial.print(parameter);}
+        const bool ack = storeBlock(idx, (const uint8_t *) parameter, len);
         
-        if (DEBUG) {Serial.println("finish sotre.");}
+        if (DEBUG) {Serial.println(ack ? "finish sotre." : "FRAM write error.");}
         
-        return true;
+        return ack;
     }
     return false;
 };
 
+
+/// @brief FRAMの連続したアドレスから読み出す  (private)
+/// @param address 先頭のアドレス
+/// @param data 読み出したデータ
+/// @param len 長さ
+/// @return True:成功   False:失敗（FRAMが応答しない場合は読み出さない）
+/// @note 1回のトランザクションでメモリアドレスを送り、続けてlenバイトを読む（FRAMのアドレス自動インクリメント）
+bool ParameterStorage::readBlock(const uint16_t address, uint8_t* data, const size_t len){
+    I2cClock.select(I2C_ADDR::FRAM);
+    if (!I2cRecovery.check(I2C_ADDR::FRAM)){
+        return false;
+    }
+    //  トランザクションごとにメモリアドレス2byte + データ
+    const uint16_t transactions = countTransactions(len);
+    I2cProfileScope profile(I2C_ADDR::FRAM, E_I2cComponent::PARAMETER_STORAGE, 2 * transactions + len, transactions);
+    const bool ack = I2cRecovery.execute(I2C_ADDR::FRAM, [this, address, data, len](){
+        return Adafruit_FRAM_I2C::read(address, data, len);
+    });
+    profile.setAck(ack);
+    if (ack){
+        I2cRecovery.filterRead(I2C_ADDR::FRAM, data, len);
+    }
+    return ack;
+}
+
+/// @brief FRAMの連続したアドレスに書き込む  (private)
+/// @param address 先頭のアドレス
+/// @param data 書き込むデータ
+/// @param len 長さ
+/// @return True:成功   False:失敗（FRAMが応答しない）
+/// @note FRAMは書き込み待ちがないので、lenバイトを1回のトランザクションで書き込む
+bool ParameterStorage::storeBlock(const uint16_t address, const uint8_t* data, const size_t len){
+    I2cClock.select(I2C_ADDR::FRAM);
+    const uint16_t transactions = countTransactions(len);
+    I2cProfileScope profile(I2C_ADDR::FRAM, E_I2cComponent::PARAMETER_STORAGE, 2 * transactions + len, transactions);
+    const bool ack = I2cRecovery.execute(I2C_ADDR::FRAM, [this, address, data, len](){
+        // ライブラリの引数はconstではないが、書き込むデータは変更しない
+        return Adafruit_FRAM_I2C::write(address, const_cast<uint8_t *>(data), len);
+    });
+    profile.setAck(ack);
+    return ack;
+}
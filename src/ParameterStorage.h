@@ -16,6 +16,9 @@
 
 #include <Arduino.h>
 #include <Adafruit_FRAM_I2C.h>
+#include "I2cBusClock.h"
+#include "I2cProfiler.h"
+#include "I2cBusRecovery.h"
 
 class ParameterStorage : public Adafruit_FRAM_I2C {
 
@@ -30,6 +33,7 @@ class ParameterStorage : public Adafruit_FRAM_I2C {
 
         SENSOR_LENGTH = 0x40,   // uint8_t センサ長[inch]
         TIMER_PERIOD = 0x48,    // uint8_t タイマ周期設定[min]
+        UNIT_ADDRESS = 0x4C,    // 構造体 UnitAddress RS-485マルチドロップのユニットアドレス  1-247以外:使わない
         SERIAL_NUMBER =0x50,    // char[15]   製造番号
         SCALING = 0x60,         // 構造体 ScalingParameter スケーリング
         CAL_DATA = 0x70         // 構造体 CalData キャリブレーション値
@@ -49,6 +53,20 @@ class ParameterStorage : public Adafruit_FRAM_I2C {
         uint16_t hi_side_scale;
         uint16_t low_side_scale;
     };
+    //  inverted（addressのビット反転）が一致しない場合は書き込まれていない
+    //  （未書き込みのFRAM、以前のファームウェアが0x4Cに残した値）ものとして使わない
+    struct UnitAddress{
+        uint8_t address;
+        uint8_t inverted;
+
+        /// @brief 書き込む値を作る
+        static UnitAddress make(const uint8_t address){
+            return UnitAddress{ address, static_cast<uint8_t>(~address) };
+        };
+        bool isValid(void) const{
+            return inverted == static_cast<uint8_t>(~address);
+        };
+    };
 
     // methods 
     /*!
@@ -67,17 +85,13 @@ class ParameterStorage : public Adafruit_FRAM_I2C {
     /// @brief parameterをFRAMから読み出す(任意の型 char[]以外)
     /// @param parameter_name パラメータ名(enum)
     /// @param parameter 読み出したパラメタを保存する変数
-    /// @return True:成功   False:失敗
+    /// @return True:成功   False:失敗（FRAMが応答しない場合は読み出さない）
+    /// @note FRAMのアドレス自動インクリメントで、パラメタ全体を1回のトランザクションで読む
     template <typename T>
     bool read(const E_ParameterCategories parameter_name, T& parameter){
         if (DEBUG){Serial.print("Method-read_template: ");}
         if (parameter_name != E_ParameterCategories::SERIAL_NUMBER){
-            const uint16_t idx = static_cast<uint16_t>(parameter_name);
-            uint8_t* ptr = (uint8_t *) &parameter;
-            for (int i=0; i < sizeof(parameter); i++){
-                *(ptr + i) = Adafruit_FRAM_I2C::read8(idx + i);
-            }
-            return true;
+            return readBlock(static_cast<uint16_t>(parameter_name), (uint8_t *) &parameter, sizeof(parameter));
         };
         return false;
     };
@@ -85,17 +99,13 @@ class ParameterStorage : public Adafruit_FRAM_I2C {
     /// @brief parameterをFRAMに書き込む(任意の型 char[]以外)
     /// @param parameter_name パラメータ名(enum)
     /// @param parameter パラメタ
-    /// @return True:成功   False:失敗
+    /// @return True:成功   False:失敗（FRAMが応答しない）
+    /// @note FRAMのアドレス自動インクリメントで、パラメタ全体を1回のトランザクションで書き込む
     template <typename T>
     bool store(const E_ParameterCategories parameter_name, const T& parameter){
         if (DEBUG){Serial.print("Method-store_template: ");}
         if (parameter_name != E_ParameterCategories::SERIAL_NUMBER){
-            const uint16_t idx = static_cast<uint16_t>(parameter_name);
-            const uint8_t* ptr = (const uint8_t *) &parameter;
-            for (int i=0; i < sizeof(parameter); i++){
-                Adafruit_FRAM_I2C::write8(idx + i, *(ptr + i));
-            }
-            return true;
+            return storeBlock(static_cast<uint16_t>(parameter_name), (const uint8_t *) &parameter, sizeof(parameter));
         };
         return false;
     };
@@ -106,6 +116,10 @@ class ParameterStorage : public Adafruit_FRAM_I2C {
     private:
     // consts
 
+    // 1回のトランザクションで転送するデータの最大長
+    //  Wireのバッファ（32byte）からメモリアドレスの2byteを除いたもの  これを超えるとライブラリが分割する
+    static constexpr size_t MAX_TRANSFER_LENGTH = 30;
+
     // debug flag
     static constexpr bool DEBUG = false;
 
@@ -114,6 +128,13 @@ class ParameterStorage : public Adafruit_FRAM_I2C {
     // vars
     
     // methods 
+    bool readBlock(const uint16_t address, uint8_t* data, const size_t len);
+    bool storeBlock(const uint16_t address, const uint8_t* data, const size_t len);
+
+    /// @brief トランザクション数  MAX_TRANSFER_LENGTHごとに分割される
+    static uint16_t countTransactions(const size_t len){
+        return (len + MAX_TRANSFER_LENGTH - 1) / MAX_TRANSFER_LENGTH;
+    };
 };
 
 #endif //_PARAMETERSTORAGE_H_
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "TimeSync.h"
+
+/// @brief ホストの時刻を受け取る
+/// @param epoch_ms ホストの時刻 [ms]
+/// @param local_ms その時刻を受信したmillis()
+/// @note 予測との差がSTEP_THRESHOLD_MSを超えた場合は、ホストの時刻が飛んだものとしてオフセットだけを合わせる
+///       ドリフトの基準も同じだけずらすので、それまでの長い間隔で求めたドリフトはそのまま使い続ける
+void TimeSync::sync(const uint64_t epoch_ms, const uint32_t local_ms){
+    sync_count++;
+    uint64_t predicted = epoch_ms;
+    toEpoch(local_ms, predicted);
+    const int64_t error = static_cast<int64_t>(epoch_ms - predicted);
+    last_error = (error > INT32_MAX) ? INT32_MAX : (error < INT32_MIN) ? INT32_MIN : static_cast<int32_t>(error);
+
+    if (!synced){
+        base_epoch = epoch_ms;
+        base_local = local_ms;
+    } else if (error > STEP_THRESHOLD_MS || error < -STEP_THRESHOLD_MS){
+        base_epoch += error;
+    } else {
+        const uint32_t local_interval = local_ms - base_local;
+        if (local_interval >= MIN_DRIFT_INTERVAL_MS){
+            const int64_t epoch_interval = static_cast<int64_t>(epoch_ms - base_epoch);
+            int64_t drift = (epoch_interval - static_cast<int64_t>(local_interval)) * 1000000000LL / local_interval;
+            drift = (drift > MAX_DRIFT_PPB) ? MAX_DRIFT_PPB : (drift < -MAX_DRIFT_PPB) ? -MAX_DRIFT_PPB : drift;
+            drift_ppb = static_cast<int32_t>(drift);
+        }
+        if (local_interval >= MAX_BASELINE_MS){
+            base_epoch = epoch_ms;
+            base_local = local_ms;
+        }
+    }
+    anchor_epoch = epoch_ms;
+    anchor_local = local_ms;
+    synced = true;
+    return;
+}
+
+/// @brief millis()の値をホストの時刻に変換する
+/// @param local_ms millis()の値  最新の同期の前後24日以内
+/// @param epoch_ms ホストの時刻 [ms]
+/// @return True:変換した   False:同期していない（epoch_msは変更しない）
+bool TimeSync::toEpoch(const uint32_t local_ms, uint64_t& epoch_ms) const {
+    if (!synced){
+        return false;
+    }
+    // 最新の同期より前に取得した値もあるので、符号付きで扱う
+    const int32_t elapsed = static_cast<int32_t>(local_ms - anchor_local);
+    epoch_ms = anchor_epoch + static_cast<int64_t>(elapsed) + correction(elapsed);
+    return true;
+}
+
+/// @brief 同期していない状態に戻す  推定したドリフトも捨てる
+void TimeSync::reset(void){
+    synced = false;
+    drift_ppb = 0;
+    last_error = 0;
+}
+
+/// @brief 経過時間に対するドリフトの補正  (private)
+/// @param elapsed 最新の同期からの経過時間 [ms]
+/// @return 補正量 [ms]  四捨五入
+int64_t TimeSync::correction(const int32_t elapsed) const {
+    const int64_t scaled = static_cast<int64_t>(elapsed) * drift_ppb;
+    return (scaled >= 0) ? (scaled + 500000000LL) / 1000000000LL : -((-scaled + 500000000LL) / 1000000000LL);
+}
@@ -0,0 +1,97 @@
+/**************************************************************************/
+/*!
+ * @file TimeSync.h/cpp
+ * @brief ホストの時刻（epoch）と計測ユニットのmillis()の対応を保持する
+ * @author
+ * @date 20261019
+ * $Version:    0.0$
+ * @par
+ *    ホストが送る時刻（TIMEコマンド）と、それを受信したmillis()の組からオフセットとドリフトを求め、
+ *    millis()の値をホストの時刻に変換する。
+ *    オフセットは同期ごとに最新の組に合わせ、ドリフトは最初の同期（基準）からの長い間隔で求めるので、
+ *    受信時刻の量子化（10ms周期で読む）の影響は間隔が長くなるほど小さくなる。
+ *    予測との差がSTEP_THRESHOLD_MSを超えた場合はホストの時刻が飛んだものとして、オフセットと基準を同じだけずらす。
+ *    millis()の差はint32_tで扱うので、同期の間隔は24日未満であること。
+ *    Arduinoに依存しないので、ホスト側でもそのまま使える。
+ */
+/**************************************************************************/
+
+#ifndef _TIMESYNC_H_
+#define _TIMESYNC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class TimeSync {
+
+    public:
+    // consts
+
+    // ドリフトの上限 [ppb]  水晶発振子の誤差より十分大きい値
+    static constexpr int32_t MAX_DRIFT_PPB = 500000;
+
+    // 予測との差がこれを超えたら基準を取り直す [ms]
+    static constexpr int32_t STEP_THRESHOLD_MS = 1000;
+
+    // ドリフトを求める基準からの最短の間隔 [ms]  短いと受信時刻の量子化の影響が大きい
+    static constexpr uint32_t MIN_DRIFT_INTERVAL_MS = 60000;
+
+    // 基準を最新の同期に移す間隔 [ms]  millis()の差がuint32_tであふれないように
+    static constexpr uint32_t MAX_BASELINE_MS = 86400000;
+
+    // methods
+    /*!
+    * @brief constructor
+    */
+    TimeSync(){
+    };
+
+    /*!
+    * @brief deconstructor
+    *
+    */
+    ~TimeSync(){
+    };
+
+    void sync(const uint64_t epoch_ms, const uint32_t local_ms);
+    bool toEpoch(const uint32_t local_ms, uint64_t& epoch_ms) const;
+    void reset(void);
+
+    /// @brief 同期済みか
+    bool isSynced(void) const {
+        return synced;
+    };
+
+    /// @brief 推定したドリフト  正:millis()が遅れている
+    /// @return [ppb]
+    int32_t getDrift(void) const {
+        return drift_ppb;
+    };
+
+    /// @brief 最後の同期で、それまでの推定とホストの時刻の差
+    /// @return [ms]  正:推定が遅れていた
+    int32_t getLastError(void) const {
+        return last_error;
+    };
+
+    /// @brief 同期した回数
+    uint32_t getSyncCount(void) const {
+        return sync_count;
+    };
+
+    private:
+    // vars
+    bool synced = false;
+    uint64_t anchor_epoch = 0;  // 最新の同期  ホストの時刻 [ms]
+    uint32_t anchor_local = 0;  //             millis()
+    uint64_t base_epoch = 0;    // ドリフトの基準
+    uint32_t base_local = 0;
+    int32_t drift_ppb = 0;
+    int32_t last_error = 0;
+    uint32_t sync_count = 0;
+
+    // methods
+    int64_t correction(const int32_t elapsed) const;
+};
+
+#endif //_TIMESYNC_H_
@@ -1,45 +1,118 @@
 #include "eh_LCD.h"
-
+#include "I2cBusClock.h"
+#include "I2cProfiler.h"
+#include "I2cBusRecovery.h"
+#include <Wire.h>
+
+constexpr uint8_t EhLcd::bar_graph[EhLcd::cg_count][EhLcd::cg_y_dots];
+constexpr EhLcd::E_DisplayItemName EhLcd::refresh_priority[];
+constexpr EhLcd::ItemLayout EhLcd::item_layouts[];
+constexpr const char* EhLcd::item_initial_texts[];
+constexpr EhLcd::FrameText EhLcd::frame[];
+constexpr EhLcd::ItemLayout EhLcd::timer_period_layout;
 
 /*! 
 @brief  LCDイニシャライズ
 @return True:常に正常終了
 @note   clk_in()の動作を始める前に呼び出す必要あり
+        ブロックせずに初期化する場合はinitStep()をE_InitStepの順に呼び出す
 */
 bool EhLcd::init(void){
+    initStep(E_InitStep::BEGIN);
+    delay(BEGIN_TIME_MS);  // delayを入れないとうまく通信できない時がある
+    return initStep(E_InitStep::CGRAM);
+};
 
-    rgb_lcd::begin(16,2);
-    delay(10);  // delayを入れないとうまく通信できない時がある
+/// @brief 初期化の1ステップを実行する
+/// @param step 実行するステップ  E_InitStepの順に呼び出すこと
+/// @return True:常に正常終了
+/// @note BEGINの後、CGRAMまでBEGIN_TIME_MS以上空けること（CLKの間隔で待てる）
+///       rgb_lcd::begin()はライブラリの中で電源投入後の待ち（合計約57ms）をdelayMicroseconds()で行う
+bool EhLcd::initStep(const E_InitStep step){
+    switch (step){
+        case E_InitStep::BEGIN :
+            I2cClock.select(I2C_ADDR::LCD);
+            rgb_lcd::begin(LCD_COLUMNS, LCD_ROWS);
+            break;
+
+        case E_InitStep::CGRAM :
+        {
+            I2cClock.select(I2C_ADDR::LCD);
+
+            // begin()で画面はクリアされている
+            resetScreen(' ');
+
+            // 表示要素の初期テキスト（タイマ動作中表示の":"）  次のCLKで描画される
+            for (size_t i = 0; i < item_count; i++){
+                copyText(display_items[i].text, item_initial_texts[i]);
+                markDirty(display_items[i]);
+            }
 
-    // CGRAM読み込み    beginのすぐ後に実行する
-    // CGaddress = 0 は表示関数でNULLと判断されるので使わない
-    for (uint8_t i=0; i<cg_count; i++){
-        rgb_lcd::createChar(i+1, bar_graph[i]);
-    }
+            // CGRAM読み込み    beginの後、最初に実行する
+            // CGaddress = 0 は表示関数でNULLと判断されるので使わない
+            //  1文字あたりコマンド1回 + データ8回、それぞれ制御byte + 1byte
+            I2cProfileScope profile(I2C_ADDR::LCD, E_I2cComponent::LCD, 2 * 9 * cg_count, 9 * cg_count);
+            for (uint8_t i=0; i<cg_count; i++){
+                uint8_t glyph[cg_y_dots];   // createChar()はconstでない配列を取るのでコピーして渡す
+                memcpy(glyph, bar_graph[i], cg_y_dots);
+                rgb_lcd::createChar(i+1, glyph);
+            }
 
-    if (DEBUG){
-        Serial.print("- eh_LCD.ino");
-        Serial.println(sizeof(display_items));
-        Serial.println(sizeof(frame));
-    }
+            //  RAM使用量の確認  以前の構成との比較は extras/host/test_lcd_ram.cpp
+            if (DEBUG){
+                Serial.print("- eh_LCD.ino RAM:");
+                Serial.print(getItemRamSize());
+                Serial.print(" (");
+                Serial.print(getItemStateSize());
+                Serial.print("/item) flash:");
+                Serial.println(sizeof(item_layouts) + sizeof(frame) + sizeof(timer_period_layout) + sizeof(bar_graph));
+            }
+            break;
+        }
 
+        default:
+            break;
+    }
     return true;
-};
+}
 
 /// @brief 起動時のメッセージ（型式等）を表示します。
 /// @param message char配列のポインタ   16文字までのメッセージを指定
 void EhLcd::showSplash(const char *message){
+    clearDisplay();
+    delay(CLEAR_TIME_MS);
+    writeSplash(message);
+    delay(2000);
+
+    clearDisplay();
+    delay(300);
+    return;
+}
+
+/// @brief LCDをクリアする
+/// @note 次にLCDにアクセスするまでCLEAR_TIME_MS以上空けること
+void EhLcd::clearDisplay(void){
+    I2cClock.select(I2C_ADDR::LCD);
     rgb_lcd::clear();
-    delay(10);
+    resetScreen(' ');
+    return;
+}
 
+/// @brief 起動時のメッセージ（型式等）を書き込む   ブロックしない
+/// @param message char配列のポインタ   16文字までのメッセージを指定
+/// @note clearDisplay()からCLEAR_TIME_MS以上空けて呼び出す
+void EhLcd::writeSplash(const char *message){
+    I2cClock.select(I2C_ADDR::LCD);
+    I2cProfileScope profile(I2C_ADDR::LCD, E_I2cComponent::LCD, 0);
+    size_t count = 2;
     rgb_lcd::setCursor(2, 0);
-    rgb_lcd::print("-- EH-900 --");
+    count += rgb_lcd::print("-- EH-900 --");
     rgb_lcd::setCursor(0, 1);
-    rgb_lcd::print(message);
-    delay(2000);
+    count += rgb_lcd::print(message);
+    profile.setTransfer(count, 2 * count);
 
-    rgb_lcd::clear();
-    delay(300);
+    // フレームバッファを介さずに書いたので、LCDの内容は不明とする
+    resetScreen('\0');
     return;
 }
 
@@ -47,14 +120,21 @@ void EhLcd::showSplash(const char *message){
 /// @brief 起動時のハードウエアチェックのエラー表示
 /// @param error_code この数値をそのまま表示します
 void EhLcd::showHardwareError(const uint8_t error_code){
+    I2cClock.select(I2C_ADDR::LCD);
     rgb_lcd::clear();
     delay(10);
 
+    I2cProfileScope profile(I2C_ADDR::LCD, E_I2cComponent::LCD, 0);
+    size_t count = 2;
     rgb_lcd::setCursor(0, 0);
-    rgb_lcd::print("HARDWARE ERROR!");
+    count += rgb_lcd::print("HARDWARE ERROR!");
     rgb_lcd::setCursor(3, 1);
-    rgb_lcd::print("#");
-    rgb_lcd::print(error_code);
+    count += rgb_lcd::print("#");
+    count += rgb_lcd::print(error_code);
+    profile.setTransfer(count, 2 * count);
+
+    // フレームバッファを介さずに書いたので、LCDの内容は不明とする
+    resetScreen('\0');
 
     return;
 }
@@ -68,29 +148,63 @@ void EhLcd::clk_in(void){
     busy_now = true;
  
     //  CLKに同期した処理を記載
- 
-    uint8_t now_thread = thread_count;
 
-    // 処理時間測定用   フレーム同期信号
+    // 処理時間測定用   点滅の位相
     if(DEBUG){
-        if(now_thread==0){
-            digitalWrite(PA3,HIGH);
+        digitalWrite(PA3, blink_phase ? HIGH : LOW);
+    }
+
+    if (enable_CLK){
+        // blinkの処理  位相が変わった時だけ点滅モードの表示要素を更新する
+        const bool phase = BlinkPhase::isOn(DEFAULT_BLINK_PERIOD);
+        if (phase != blink_phase){
+            blink_phase = phase;
+            updateBlink();
+        }
+
+        // I2Cバスを使えない時は更新を保留する（refreshを残す）  保留したCLKを数える
+        if (vacateI2Cbus){
+            bool dirty = false;
+            for (size_t i = 0; i < item_count; i++){
+                dirty = dirty || display_items[i].refresh;
+            }
+            if (dirty){
+                dropped_frame_count++;
+                if (++dropped_frames > max_dropped_frames){
+                    max_dropped_frames = dropped_frames;
+                }
+            }
         } else {
-            digitalWrite(PA3,LOW);
+            dropped_frames = 0;
         }
-    }
 
-    // display_itemに記載のある表示内容を表示
-    if (now_thread < item_count && enable_CLK ){
-        writeItem(display_items[now_thread]);  //スレッド１つ当たり１つの項目を表示させる
-    
-        // blinkの処理
-        if (display_items[now_thread].mode == BLINK_MODE){
-            if ( --display_items[now_thread].count == 0){
-                display_items[now_thread].count = DEFAULT_BLINK_PERIOD;
-                display_items[now_thread].state = !display_items[now_thread].state;
-                display_items[now_thread].refresh = true;
-                // 表示更新
+        // 更新のある表示要素を優先順に描画・転送  転送量がTICK_BYTE_BUDGETを超えたら次のCLKに回す
+        uint16_t budget = vacateI2Cbus ? 0 : TICK_BYTE_BUDGET;
+        for (size_t i = 0; i < item_count && budget != 0; i++){
+            const uint8_t index = static_cast<uint8_t>(refresh_priority[i]);
+            const ItemLayout& layout = item_layouts[index];
+            if (!display_items[index].refresh){
+                continue;
+            }
+            writeItem(index);
+            const uint8_t x_begin = layout.x_location;
+            const uint8_t x_end = (x_begin + layout.width < LCD_COLUMNS) ? x_begin + layout.width : LCD_COLUMNS;
+            const uint16_t sent = flushRegion(layout.y_location, x_begin, x_end, budget);
+            budget = (sent < budget) ? budget - sent : 0;
+
+            // 全て書き込めた時点で表示完了  書き込めなかった場合は次のCLKで再度転送する
+            if (memcmp(&screen[layout.y_location][x_begin], &lcd_shadow[layout.y_location][x_begin], x_end - x_begin) == 0){
+                recordLatency(index);
+            } else {
+                display_items[index].refresh = true;
+            }
+        }
+
+        // 予算が残っていれば、書き込みに失敗した部分などを転送  変化がなければバスは使わない
+        if (budget != 0){
+            for (uint8_t y = 0; y < LCD_ROWS && budget != 0; y++){
+                const uint16_t sent = flushRegion(y, 0, LCD_COLUMNS, budget);
+                budget = (sent < budget) ? budget - sent : 0;
             }
         }
     }
@@ -111,40 +225,189 @@ void EhLcd::clk_in(void){
         }
     }
 
-    // スレッドカウンタ 0~9 10スレッド
-    if (++thread_count == 10){
-        thread_count = 0;
-    }
-
     // 同期信号処理のクロージング処理
     busy_now = false;
 
     return;
 };
 
-/// @brief 同期動作で呼び出す関数:  指定項目の内容をLCDに書く
-/// @param itemの(ItemProperty型) 表示項目の指定
-void EhLcd::writeItem(ItemProperty& item){
+/// @brief 同期動作で呼び出す関数:  指定項目の内容をフレームバッファに描画する
+/// @param index 表示項目の指定  E_DisplayItemNameの値
+/// @note LCDへの転送はflushScreen()で行う
+void EhLcd::writeItem(const uint8_t index){
+    ItemState& item = display_items[index];
+
+    //表示更新の指示がある場合表示を更新
+    if (item.refresh){  
+        //  点滅モードでは共通の位相で表示・非表示を切り替える
+        const bool visible = item.state && (item.mode != BLINK_MODE || blink_phase);
+        writeText(item_layouts[index], item.text, visible);
+        item.refresh = false;
+    }
 
-    //表示更新の指示がある場合表示を更新、I2Cバスを使えない時は更新しない
-    if (item.refresh && !vacateI2Cbus){  
-        rgb_lcd::setCursor(item.x_location,item.y_location);
-        
-        String buffer = "";
+    return;
+}
 
-        //  表示・非表示の処理  非表示の場合、表示されていた内容をスペースで消去
-        if(item.state){
-            buffer = item.text;
-        } else {
-            for (uint8_t i=0 ; i < item.text.length() ; i++){
-                buffer = buffer + " ";
+/// @brief テキストをフレームバッファに描画する
+/// @param layout 表示位置と幅
+/// @param text 表示内容  幅より短い場合は残りを空白にする
+/// @param visible True:表示  False:非表示（空白で消去）
+void EhLcd::writeText(const ItemLayout& layout, const char* text, const bool visible){
+    bool terminated = false;
+    for (uint8_t i = 0; i < layout.width && layout.x_location + i < LCD_COLUMNS; i++){
+        terminated = terminated || (text[i] == '\0');
+        screen[layout.y_location][layout.x_location + i] = (visible && !terminated) ? text[i] : ' ';
+    }
+    return;
+}
+
+/// @brief 表示要素に更新があることを記録する
+/// @param item 表示要素
+/// @note 最初に更新された時刻を保持し、表示までの遅れを計測する
+void EhLcd::markDirty(ItemState& item){
+    if (!item.refresh){
+        item.refresh = true;
+        item.dirty_ms = static_cast<uint16_t>(millis());
+    }
+    return;
+}
+
+/// @brief 更新待ちの表示要素の更新時刻を現在にする
+/// @note 表示処理が無効の間や集計のクリア前の時刻で遅れを計測しないようにする
+void EhLcd::restampDirty(void){
+    const uint16_t now_ms = static_cast<uint16_t>(millis());
+    for (size_t i = 0; i < item_count; i++){
+        if (display_items[i].refresh){
+            display_items[i].dirty_ms = now_ms;
+        }
+    }
+    return;
+}
+
+/// @brief 表示要素の更新からLCDへの書き込み完了までの遅れを記録する
+/// @param index 表示項目の指定  E_DisplayItemNameの値
+void EhLcd::recordLatency(const uint8_t index){
+    const uint16_t latency = static_cast<uint16_t>(millis()) - display_items[index].dirty_ms;
+    LatencyStat& stat = latency_stats[index];
+    stat.count++;
+    stat.total_ms += latency;
+    if (latency > stat.max_ms){
+        stat.max_ms = latency;
+    }
+
+    size_t bin = 0;
+    for (uint32_t limit = LATENCY_FIRST_BIN_MS; latency >= limit && bin < LATENCY_BINS - 1; limit <<= 1){
+        bin++;
+    }
+    if (stat.histogram[bin] != UINT16_MAX){
+        stat.histogram[bin]++;
+    }
+    return;
+}
+
+/// @brief 点滅モードの表示要素を再描画の対象にする
+/// @note 点滅の位相が変わった時だけ呼び出す
+void EhLcd::updateBlink(void){
+    for (size_t i = 0; i < item_count; i++){
+        if (display_items[i].mode == BLINK_MODE){
+            markDirty(display_items[i]);
+        }
+    }
+    return;
+}
+
+/// @brief フレームバッファとLCDの内容を比較し、異なる文字の連続（ラン）だけを転送する
+/// @note I2Cバスを使えない時は何もしない（次の機会に転送される）
+void EhLcd::flushScreen(void){
+    if (vacateI2Cbus){
+        return;
+    }
+
+    for (uint8_t y = 0; y < LCD_ROWS; y++){
+        flushRegion(y, 0, LCD_COLUMNS, UINT16_MAX);
+    }
+    return;
+}
+
+/// @brief 1行の指定範囲で、フレームバッファとLCDの内容が異なる部分を転送する
+/// @param y 行
+/// @param x_begin 範囲の開始位置
+/// @param x_end 範囲の終了位置（この位置は含まない）
+/// @param budget 転送バイト数の目安  超えたら次のランは転送しない
+/// @return 転送したバイト数
+/// @note 近接したランはつないで1回のトランザクションで転送する
+uint16_t EhLcd::flushRegion(const uint8_t y, const uint8_t x_begin, const uint8_t x_end, const uint16_t budget){
+    uint16_t sent = 0;
+    uint8_t x = x_begin;
+    while (x < x_end && sent < budget){
+        if (screen[y][x] == lcd_shadow[y][x]){
+            x++;
+            continue;
+        }
+        const uint8_t start = x;
+        uint8_t end = x;    // 最後に異なる文字の次の位置
+        while (x < x_end && x - end <= RUN_MERGE_GAP){
+            if (screen[y][x] != lcd_shadow[y][x]){
+                end = x + 1;
             }
+            x++;
         }
-        rgb_lcd::print(buffer);
-        // new imprementation !!!
-        item.refresh = false;
+        sent += writeRun(start, y, end - start);
+        x = end;
+    }
+    return sent;
+}
+
+/// @brief フレームバッファの指定範囲をLCDに1回のトランザクションで書き込む
+/// @param x 書き込み開始位置X
+/// @param y 書き込み開始位置Y
+/// @param length 文字数
+/// @return 転送したバイト数（アドレスbyteは含まない）
+/// @note 転送内容  [0x80, DDRAMアドレス設定](カーソル移動時のみ), 0x40, 文字...
+///       rgb_lcdでは1コマンド・1文字ごとに1トランザクションになるので、Wireを直接使う
+///       コントローラの実行時間（コマンド・データとも約43us）は100kHzでの1byteの転送時間（90us）より短いので、
+///       byteの間に待ち時間は不要
+///       失敗した場合は書き込み済みの内容を更新しないので、次のflushScreen()で再送される
+uint8_t EhLcd::writeRun(const uint8_t x, const uint8_t y, const uint8_t length){
+    I2cClock.select(I2C_ADDR::LCD);   // LCDは100kHzでしか動かない
+    const bool set_cursor = (x != cursor_x || y != cursor_y);
+    const uint8_t count = length + (set_cursor ? 3 : 1);
+    I2cProfileScope profile(I2C_ADDR::LCD, E_I2cComponent::LCD, count);
+
+    const bool result = I2cRecovery.execute(I2C_ADDR::LCD, [&]{
+        Wire.beginTransmission(I2C_ADDR::LCD);
+        if (set_cursor){
+            Wire.write(CONTROL_COMMAND_CONTINUE);
+            Wire.write(COMMAND_SET_DDRAM | (y * DDRAM_ROW_OFFSET + x));
+        }
+        Wire.write(CONTROL_DATA_LAST);
+        Wire.write((const uint8_t*)&screen[y][x], length);
+        return Wire.endTransmission() == 0;
+    });
+    profile.setAck(result);
+    transaction_count++;
+    transferred_bytes += count;
+
+    if (!result){
+        cursor_x = CURSOR_UNKNOWN;
+        cursor_y = CURSOR_UNKNOWN;
+        return count;
     }
+    memcpy(&lcd_shadow[y][x], &screen[y][x], length);
+
+    // 行の最後まで書いた場合、次の位置は次の行の先頭ではないので不明とする
+    cursor_x = (x + length < LCD_COLUMNS) ? x + length : CURSOR_UNKNOWN;
+    cursor_y = y;
+    return count;
+}
 
+/// @brief フレームバッファをクリアし、LCDの内容を設定する
+/// @param shadow_fill LCDの内容  ' ':クリア済み  '\0':不明（次の転送で全て書き直す）
+void EhLcd::resetScreen(const char shadow_fill){
+    memset(screen, ' ', sizeof(screen));
+    memset(lcd_shadow, shadow_fill, sizeof(lcd_shadow));
+    cursor_x = CURSOR_UNKNOWN;
+    cursor_y = CURSOR_UNKNOWN;
     return;
 }
 
@@ -155,7 +418,11 @@ void EhLcd::writeItem(ItemProperty& item){
 
 /// @brief 表示処理を有効／無効にする
 /// @param active true:有効 false:無効
+/// @note 有効にした時、更新待ちの表示要素の遅れはその時点から計測する（無効の間は表示できないため）
 void EhLcd::activateDisplay(const bool active){
+    if (active && !enable_CLK){
+        restampDirty();
+    }
     enable_CLK = active;
 };
 
@@ -173,7 +440,7 @@ void EhLcd::setVacateI2Cbus(const bool flag){
 void EhLcd::setBlink(const E_DisplayItemName item, const bool mode){
     display_items[static_cast<uint8_t>(item)].mode = mode;
     display_items[static_cast<uint8_t>(item)].state = true;
-    display_items[static_cast<uint8_t>(item)].refresh = true;
+    markDirty(display_items[static_cast<uint8_t>(item)]);
 };
 
 /// @brief 表示・非表示の設定
@@ -187,7 +454,14 @@ void EhLcd::setVisible(const E_DisplayItemName item, const bool visible){
 /// @param item：表示項目の指定 EDisplayItemNameの要素名で指定
 /// @param text 表示テキスト(String)
 void EhLcd::setText(const E_DisplayItemName item, const String& text){
-    display_items[static_cast<uint8_t>(item)].text = text;
+    setText(item, text.c_str());
+};
+
+/// @brief 表示テキストの直接書き込み（非推奨）
+/// @param item：表示項目の指定 EDisplayItemNameの要素名で指定
+/// @param text 表示テキスト  TEXT_LENGTH文字を超える部分は切り捨て
+void EhLcd::setText(const E_DisplayItemName item, const char* text){
+    copyText(display_items[static_cast<uint8_t>(item)].text, text);
 };
 
 
@@ -202,10 +476,13 @@ bool EhLcd::setLevel(const uint16_t value){
         return false;
     }
 
-    String msg = ("  "+String((float(value)/10.0),1));
-    msg = msg.substring(msg.length()-5);
-    display_items[static_cast<uint8_t>(E_DisplayItemName::LEVEL)].text=msg;
-    display_items[static_cast<uint8_t>(E_DisplayItemName::LEVEL)].refresh = true;
+    // 右詰め5文字 "100.0", "  5.3"
+    char* text = display_items[static_cast<uint8_t>(E_DisplayItemName::LEVEL)].text;
+    formatDecimal(text, 3, value / 10);
+    text[3] = '.';
+    text[4] = '0' + (value % 10);
+    text[5] = '\0';
+    markDirty(display_items[static_cast<uint8_t>(E_DisplayItemName::LEVEL)]);
 
     return true;
 };
@@ -232,8 +509,8 @@ bool EhLcd::setBargraph(const uint16_t value){
         temp[index]=(unsigned char)(fine);
     };
     
-    display_items[static_cast<uint8_t>(E_DisplayItemName::BARGRAPH)].text=temp;
-    display_items[static_cast<uint8_t>(E_DisplayItemName::BARGRAPH)].refresh = true;
+    copyText(display_items[static_cast<uint8_t>(E_DisplayItemName::BARGRAPH)].text, temp);
+    markDirty(display_items[static_cast<uint8_t>(E_DisplayItemName::BARGRAPH)]);
 
     return true;
 };
@@ -241,43 +518,40 @@ bool EhLcd::setBargraph(const uint16_t value){
 /// @brief LCD表示内容を設定する：タイマ周期の設定
 /// @param value タイマ周期（分）
 void EhLcd::setTimerperiod(const uint8_t value){
-    String msg = ("  "+String(value));
-    timer_period = msg.substring(msg.length()-2);
-    frame[0].text = timer_period;
-    frame[0].refresh = true;
+    formatDecimal(timer_period, 2, value);
+    writeText(timer_period_layout, timer_period, true);
 };
 
 /// @brief LCD表示内容を設定する：センサ長の設定
 /// @param value センサ長(インチ)
 void EhLcd::setSensorlength(const uint8_t value){
-    String msg = ("  "+String(value));
-    msg = msg.substring(msg.length()-3);
-    sensor_length = msg +"inch";
-    display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].text = sensor_length;
-    display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].refresh = true;
+    // 右詰め3文字 + "inch"
+    formatDecimal(sensor_length, 3, value);
+    copyText(&sensor_length[3], "inch");
+    copyText(display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].text, sensor_length);
+    markDirty(display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)]);
 };
 
 /// @brief LCD表示内容を設定する：タイマ残り時間
 /// @param value タイマ残り時間[min]
 void EhLcd::setTimerRemain(const uint8_t value){
-    String msg = ("  "+String(value));
-    msg = msg.substring(msg.length()-2);
-    display_items[static_cast<uint8_t>(E_DisplayItemName::TIME_REMAIN)].text=msg;
-    display_items[static_cast<uint8_t>(E_DisplayItemName::TIME_REMAIN)].refresh = true;
+    formatDecimal(display_items[static_cast<uint8_t>(E_DisplayItemName::TIME_REMAIN)].text, 2, value);
+    markDirty(display_items[static_cast<uint8_t>(E_DisplayItemName::TIME_REMAIN)]);
 };
 
 /// @brief LCD表示内容を設定する：計測モード
 /// @param meas_mode 測定モード
 void EhLcd::setMeasMode(const E_Modes meas_mode){
-    display_items[static_cast<uint8_t>(E_DisplayItemName::MODE)].text = ModeInd[static_cast<uint8_t>(meas_mode)];
-    display_items[static_cast<uint8_t>(E_DisplayItemName::MODE)].refresh = true;
+    display_items[static_cast<uint8_t>(E_DisplayItemName::MODE)].text[0] = ModeInd[static_cast<uint8_t>(meas_mode)];
+    display_items[static_cast<uint8_t>(E_DisplayItemName::MODE)].text[1] = '\0';
+    markDirty(display_items[static_cast<uint8_t>(E_DisplayItemName::MODE)]);
 }
 
 /// @brief センサエラーの表示
 /// @param error
 // True:エラー表示  False:センサ長表示 
 void EhLcd::setError(const bool error){
-    String msg = "";
+    const char* msg = "";
     if (error){
         msg = "-ERROR-";
         display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].mode = BLINK_MODE;
@@ -285,9 +559,9 @@ void EhLcd::setError(const bool error){
         msg = sensor_length;
         display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].mode = HOLD_MODE;
     }
-    display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].state = true; // BLINK_MODEからHOLD_MODEに戻したら、必ずstateをtrueにすること
-    display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].text = msg;
-    display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].refresh = true;
+    display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].state = true; // 非表示に設定されていても、エラー・センサ長は必ず表示する
+    copyText(display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)].text, msg);
+    markDirty(display_items[static_cast<uint8_t>(E_DisplayItemName::SENSOR)]);
 }
 
 
@@ -295,10 +569,111 @@ void EhLcd::setError(const bool error){
 /// @note 初期化時のみ使用。通常書き換えない表示部分を書き込みます
 void EhLcd::writeFrame(void){
     for (uint8_t i=0 ; i<frame_item_count ; i++){
-        writeItem(frame[i]);
+        const ItemLayout layout = { frame[i].x_location, frame[i].y_location, static_cast<uint8_t>(strlen(frame[i].text)) };
+        writeText(layout, frame[i].text, true);
     }
+    writeText(timer_period_layout, timer_period, true);
+    flushScreen();
 };
 
+/// @brief 表示テキストをコピーする（TEXT_LENGTH文字まで）
+/// @param destination コピー先  TEXT_LENGTH+1以上の長さがあること
+/// @param source コピー元
+void EhLcd::copyText(char* destination, const char* source){
+    uint8_t i = 0;
+    for (i = 0; i < TEXT_LENGTH && source[i] != '\0'; i++){
+        destination[i] = source[i];
+    }
+    destination[i] = '\0';
+    return;
+}
+
+/// @brief 整数を右詰め・空白埋めの文字列にする
+/// @param buffer 書き込み先  width+1以上の長さがあること
+/// @param width 桁数  収まらない場合は下位の桁のみ
+/// @param value 数値
+void EhLcd::formatDecimal(char* buffer, const uint8_t width, uint16_t value){
+    buffer[width] = '\0';
+    for (int8_t i = width - 1; i >= 0; i--){
+        if (value == 0 && i != width - 1){
+            buffer[i] = ' ';
+        } else {
+            buffer[i] = '0' + (value % 10);
+            value /= 10;
+        }
+    }
+    return;
+}
+
+/// @brief LCDへの転送バイト数の累計を返す
+/// @return 転送バイト数（制御byteを含み、I2Cのアドレスbyteは含まない）
+/// @note 一定時間の差分を取れば、表示モードごとのバス使用量を比較できる
+uint32_t EhLcd::getTransferredBytes(void){
+    return transferred_bytes;
+}
+
+/// @brief LCDへのトランザクション数の累計を返す
+/// @return トランザクション数（init()でのCGRAM書き込みは含まない）
+uint32_t EhLcd::getTransactionCount(void){
+    return transaction_count;
+}
+
+/// @brief 表示要素の更新からLCDへの転送までの最大の遅れを返す
+/// @return 全ての表示要素での最大の遅れ [ms]
+uint16_t EhLcd::getMaxRefreshLatency(void){
+    uint16_t max_ms = 0;
+    for (size_t i = 0; i < item_count; i++){
+        if (latency_stats[i].max_ms > max_ms){
+            max_ms = latency_stats[i].max_ms;
+        }
+    }
+    return max_ms;
+}
+
+/// @brief 表示要素ごとの表示の遅れの集計を返す
+/// @param item 表示項目の指定 EDisplayItemNameの要素名で指定
+/// @return 集計値  setterの呼び出しからLCDへの書き込み完了まで
+const EhLcd::LatencyStat& EhLcd::getLatencyStat(const E_DisplayItemName item){
+    return latency_stats[static_cast<uint8_t>(item)];
+}
+
+/// @brief I2Cバスを解放していたために表示を更新できなかったCLKの数を返す
+/// @return CLKの数の累計
+uint32_t EhLcd::getDroppedFrameCount(void){
+    return dropped_frame_count;
+}
+
+/// @brief I2Cバスを解放していたために連続して表示を更新できなかったCLKの数の最大値を返す
+/// @return CLKの数
+uint16_t EhLcd::getMaxDroppedFrames(void){
+    return max_dropped_frames;
+}
+
+/// @brief 表示要素の状態（display_items）が使うRAMのサイズを返す
+/// @return byte数  表示要素の数 x getItemStateSize()
+/// @note 以前の構成との比較は extras/host/test_lcd_ram.cpp
+size_t EhLcd::getItemRamSize(void){
+    return sizeof(display_items);
+}
+
+/// @brief 表示要素1つあたりの状態（ItemState）のサイズを返す
+/// @return byte数
+size_t EhLcd::getItemStateSize(void){
+    return sizeof(ItemState);
+}
+
+/// @brief 表示の遅れの集計をクリアする
+/// @note 更新待ちの表示要素の遅れはクリアした時点から計測する
+void EhLcd::clearLatencyStat(void){
+    for (size_t i = 0; i < item_count; i++){
+        latency_stats[i] = LatencyStat();
+    }
+    restampDirty();
+    dropped_frame_count = 0;
+    max_dropped_frames = 0;
+    return;
+}
+
 /*!
 * @brief リソースを占有する
 * @param  bool
@@ -18,6 +18,7 @@
 
 #include <Arduino.h>
 #include <rgb_lcd.h>
+#include "BlinkPhase.h"
 
 
 /*!
@@ -40,6 +41,19 @@ class EhLcd : public rgb_lcd {
         static constexpr bool BLINK_MODE = true;
         static constexpr bool HOLD_MODE = false;
 
+        // LCDクリア後、次にアクセスできるまでの時間 [ms]
+        static constexpr uint32_t CLEAR_TIME_MS = 10;
+
+        // rgb_lcd::begin()の後、CGRAMに書き込めるまでの時間 [ms]
+        static constexpr uint32_t BEGIN_TIME_MS = 10;
+
+        /// @brief 初期化のステップ  この順に実行する
+        enum class E_InitStep : uint8_t {
+            BEGIN = 0,      // コントローラの初期化（rgb_lcd::begin()）
+            CGRAM,          // バーグラフの文字の登録と表示要素の初期化（BEGINからBEGIN_TIME_MS以上後）
+            DONE
+        };
+
         // 表示項目ごとのプロパティに名前でアクセスするための列挙型
         // 
         enum class E_DisplayItemName {
@@ -52,6 +66,18 @@ class EhLcd : public rgb_lcd {
         };
 
         enum class E_Modes{MANUAL = 0, TIMER, CONTINUOUS};
+
+        // 表示の遅れのヒストグラムのビン数  10ms未満から2倍ごと、最後のビンは640ms以上
+        static constexpr size_t LATENCY_BINS = 8;
+        static constexpr uint16_t LATENCY_FIRST_BIN_MS = 10;
+
+        /// @brief 表示要素ごとの、setterの呼び出しからLCDへの書き込み完了までの遅れの集計
+        struct LatencyStat{
+            uint32_t count = 0;         // 表示した回数
+            uint32_t total_ms = 0;      // 遅れの合計 [ms]
+            uint16_t max_ms = 0;        // 遅れの最大値 [ms]
+            uint16_t histogram[LATENCY_BINS] = {};  // 遅れの分布（回数）
+        };
         const char ModeInd[3]={'M','T','C'};
     
     // ファンダメンタルな関数
@@ -71,7 +97,10 @@ class EhLcd : public rgb_lcd {
     // 機能としてのclass関数の定義 
     
         bool init(void);
+        bool initStep(const E_InitStep step);
         void showSplash(const char *message);
+        void clearDisplay(void);
+        void writeSplash(const char *message);
         void showHardwareError(const uint8_t error_code);
         void activateDisplay(const bool active);
 
@@ -80,6 +109,7 @@ class EhLcd : public rgb_lcd {
         void setBlink(const E_DisplayItemName item, const bool mode);
         void setVisible(const E_DisplayItemName item, const bool visible);
         void setText(const E_DisplayItemName item, const String& Value);
+        void setText(const E_DisplayItemName item, const char* text);
 
         // 表示内容を数値で指定するセッター
 
@@ -95,6 +125,15 @@ class EhLcd : public rgb_lcd {
         void setError(const bool error);
         void writeFrame(void);
         void setVacateI2Cbus(const bool flag);
+        uint32_t getTransferredBytes(void);
+        uint32_t getTransactionCount(void);
+        uint16_t getMaxRefreshLatency(void);
+        const LatencyStat& getLatencyStat(const E_DisplayItemName item);
+        uint32_t getDroppedFrameCount(void);
+        uint16_t getMaxDroppedFrames(void);
+        size_t getItemRamSize(void);
+        size_t getItemStateSize(void);
+        void clearLatencyStat(void);
 
 
     private:
@@ -106,74 +145,75 @@ class EhLcd : public rgb_lcd {
         /*
         *   その他定数 
         */
-        static constexpr uint8_t DEFAULT_BLINK_PERIOD = 5; //[CLK Cycle]
+        // 点滅時の表示（非表示）の時間  位相はBlinkPhaseで全ての表示要素に共通
+        static constexpr uint16_t DEFAULT_BLINK_PERIOD = 50; //[CLK Cycle]
+
+        // 1CLKあたりにLCDへ転送するバイト数の目安  100kHzで約2.2ms
+        //  超えた時点で残りの表示要素は次のCLKに回す（1回の転送は途中で止めない）
+        static constexpr uint16_t TICK_BYTE_BUDGET = 24;
 
-        //  バーグラフのためのCGデータ 
+        // LCDの表示サイズ
+        static constexpr uint8_t LCD_COLUMNS = 16;
+        static constexpr uint8_t LCD_ROWS = 2;
+
+        // カーソル位置が不明なことを示す値
+        static constexpr uint8_t CURSOR_UNKNOWN = 0xFF;
+
+        // LCDコントローラの制御byte  Co(bit7):後に制御byteが続く  RS(bit6):データ
+        static constexpr uint8_t CONTROL_COMMAND_CONTINUE = 0x80;
+        static constexpr uint8_t CONTROL_DATA_LAST = 0x40;
+
+        // DDRAMアドレス設定コマンド  2行目は0x40から
+        static constexpr uint8_t COMMAND_SET_DDRAM = 0x80;
+        static constexpr uint8_t DDRAM_ROW_OFFSET = 0x40;
+
+        // 変化していない文字がこの数以下なら、ランをつないで1回で転送する
+        //  ランを分けると制御byte, コマンド, 制御byte, アドレスbyteの4byteが増えるため
+        static constexpr uint8_t RUN_MERGE_GAP = 4;
+
+        // 表示要素のテキストの最大文字数
+        static constexpr uint8_t TEXT_LENGTH = 8;
+
+        //  バーグラフのためのCGデータ  フラッシュに置く
         static constexpr uint8_t cg_count = 5;
         static constexpr uint8_t cg_y_dots = 8;
-        uint8_t bar_graph[cg_count][cg_y_dots] = {
-        {       // 0x01: |
-            0b10000,
-            0b10000,
-            0b10000,
-            0b10000,
-            0b10000,
-            0b10000,
-            0b10000,
-            0b10000 
-        }, {    // 0x02: ||
-            0b11000,
-            0b11000,
-            0b11000,
-            0b11000,
-            0b11000,
-            0b11000,
-            0b11000,
-            0b11000
-        }, {    // 0x03: |||
-            0b11100,
-            0b11100,
-            0b11100,
-            0b11100,
-            0b11100,
-            0b11100,
-            0b11100,
-            0b11100
-        }, {    // 0x04: ||||
-            0b11110,
-            0b11110,
-            0b11110,
-            0b11110,
-            0b11110,
-            0b11110,
-            0b11110,
-            0b11110
-        }, {    // 0x05: |||||
-            0b11111,
-            0b11111,
-            0b11111,
-            0b11111,
-            0b11111,
-            0b11111,
-            0b11111,
-            0b11111
-        },
-    };
+        static constexpr uint8_t bar_graph[cg_count][cg_y_dots] = {
+            { 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000 },  // 0x01: |
+            { 0b11000, 0b11000, 0b11000, 0b11000, 0b11000, 0b11000, 0b11000, 0b11000 },  // 0x02: ||
+            { 0b11100, 0b11100, 0b11100, 0b11100, 0b11100, 0b11100, 0b11100, 0b11100 },  // 0x03: |||
+            { 0b11110, 0b11110, 0b11110, 0b11110, 0b11110, 0b11110, 0b11110, 0b11110 },  // 0x04: ||||
+            { 0b11111, 0b11111, 0b11111, 0b11111, 0b11111, 0b11111, 0b11111, 0b11111 }   // 0x05: |||||
+        };
 
 
     // 構造体  
-        // 表示要素のプロパティ
         
-        /// @brief 表示要素のプロパティ
-        /// @note 20byte/element
-        struct ItemProperty{   
-            bool mode = false;  // True: Blink False: Normal
-            bool state = true;  // True: 表示   False: 非表示 
-            uint8_t count = 1; // Blink時のカウンタ 
-            uint8_t x_location = 0;  // 表示位置X
-            uint8_t y_location = 0;  // 表示位置y
-            String text = "";   // 表示内容
-            bool refresh = true;   // 当該項目の表示内容をリフレッシュするかどうか
+        /// @brief 表示要素の位置と幅  変化しないのでフラッシュに置く
+        struct ItemLayout{
+            uint8_t x_location;  // 表示位置X
+            uint8_t y_location;  // 表示位置y
+            uint8_t width;       // 表示幅  テキストが短い場合は残りを空白にする
+        };
+
+        /// @brief 変更されない表示の記述  フラッシュに置く
+        struct FrameText{
+            uint8_t x_location;  // 表示位置X
+            uint8_t y_location;  // 表示位置y
+            const char* text;    // 表示内容
+        };
+
+        /// @brief 表示要素の変化する状態
+        /// @note 12byte/element
+        struct ItemState{
+            uint16_t dirty_ms;          // refreshが設定された時刻（millis()の下位16bit）  表示までの遅れの計測用
+            uint8_t mode : 1;           // True: Blink False: Normal
+            uint8_t state : 1;          // True: 表示   False: 非表示
+            uint8_t refresh : 1;        // 当該項目の表示内容をリフレッシュするかどうか
+            char text[TEXT_LENGTH + 1]; // 表示内容
+
+            constexpr ItemState()
+                : dirty_ms(0), mode(HOLD_MODE), state(true), refresh(true), text{}{
+            };
         };
 
     // 変数
@@ -205,20 +245,41 @@ class EhLcd : public rgb_lcd {
          */
         uint16_t keep_busy = DEFAULT_KEEP_BUSY;
 
-        // 時分割のスレット番号をカウントする
-        uint16_t thread_count = 0;
+        // 点滅の位相  True:表示  False:非表示
+        bool blink_phase = true;
+
+        // I2Cバスを解放していたために転送できなかったCLKの数
+        uint32_t dropped_frame_count = 0;
+        // 連続して転送できなかったCLKの数と、その最大値
+        uint16_t dropped_frames = 0;
+        uint16_t max_dropped_frames = 0;
+
+    // 表示内容のフレームバッファ
+    //  表示要素はscreenに描画し、LCDに書き込み済みの内容(lcd_shadow)と異なる文字だけを転送する
+        char screen[LCD_ROWS][LCD_COLUMNS] = {};
+        char lcd_shadow[LCD_ROWS][LCD_COLUMNS] = {};
+
+        // LCDのカーソル位置（次に書き込まれる位置）
+        uint8_t cursor_x = CURSOR_UNKNOWN;
+        uint8_t cursor_y = CURSOR_UNKNOWN;
+
+        // LCDへの転送バイト数の累計（制御byteを含み、アドレスbyteは含まない）
+        uint32_t transferred_bytes = 0;
+
+        // LCDへのトランザクション数の累計
+        uint32_t transaction_count = 0;
 
     // 内部で保持する表示内容   外部からsetされるのでその表示順が来るまで維持しておくため
     // 
         /*!
         * @brief 内部で保持する表示内容: センサ長 
         */
-        String sensor_length = "";
+        char sensor_length[TEXT_LENGTH + 1] = "";
         
         /*!
         * @brief 内部で保持する表示内容: タイマ周期 
         */
-        String timer_period = "";
+        char timer_period[TEXT_LENGTH + 1] = "";
 
 
     // 
@@ -226,91 +287,70 @@ class EhLcd : public rgb_lcd {
         //  変化する表示内容 
         static const size_t item_count = 6;  // display_itemsの要素数
 
-        // 全ての表示要素のプロパティ
-        ItemProperty display_items[item_count]={
-            // 0:MODE表示 
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 0, .y_location = 0,
-                .text = ""    
-            },
-            // 1: タイマ動作中表示
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 1, .y_location = 0,
-                .text = ":"
-            },
-            // 2: タイマ経過時間表示
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 2, .y_location = 0,
-                .text = ""
-            },
-            // 3: 液面表示（数値）
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 10, .y_location = 1,
-                .text = ""
-            },
-            // 4: センサ長／エラー表示
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 0, .y_location = 1,
-                .text = ""
-            },
-            // 5: 液面表示（バーグラフ）
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 10, .y_location = 0,
-                .text = ""
-            }
+        // 表示要素を処理する優先順  液面とエラーを先に、タイマ表示を最後に
+        static constexpr E_DisplayItemName refresh_priority[item_count] = {
+            E_DisplayItemName::LEVEL,
+            E_DisplayItemName::SENSOR,
+            E_DisplayItemName::BARGRAPH,
+            E_DisplayItemName::MODE,
+            E_DisplayItemName::TIME_REMAIN,
+            E_DisplayItemName::TIMER_IND
         };
 
+        // 表示要素の位置と幅  E_DisplayItemNameの順
+        static constexpr ItemLayout item_layouts[item_count] = {
+            { 0, 0, 1 },    // 0: MODE表示
+            { 1, 0, 1 },    // 1: タイマ動作中表示
+            { 2, 0, 2 },    // 2: タイマ経過時間表示
+            { 10, 1, 5 },   // 3: 液面表示（数値）
+            { 0, 1, 7 },    // 4: センサ長／エラー表示
+            { 10, 0, 4 }    // 5: 液面表示（バーグラフ）
+        };
+
+        // 表示要素の初期テキスト  E_DisplayItemNameの順  init()でdisplay_itemsに設定する
+        static constexpr const char* item_initial_texts[item_count] = {
+            "",     // 0: MODE表示
+            ":",    // 1: タイマ動作中表示
+            "",     // 2: タイマ経過時間表示
+            "",     // 3: 液面表示（数値）
+            "",     // 4: センサ長／エラー表示
+            ""      // 5: 液面表示（バーグラフ）
+        };
+
+        // 全ての表示要素の状態
+        ItemState display_items[item_count];
+
+        // 表示要素ごとの表示の遅れ  E_DisplayItemNameの順
+        LatencyStat latency_stats[item_count];
+
 
     // 変更されない表示の記述
-        static const size_t frame_item_count = 4;
-        ItemProperty frame[frame_item_count]={
-            // 0: タイマ周期表示
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 5, .y_location = 0,
-                .text = ""
-            },
-            // 1: タイマの経過時間／周期の区切り（スラッシュ）
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 4, .y_location = 0,
-                .text = "/"
-            },
-            // 2: レベル    バー表示のフレーム
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 8, .y_location = 0,
-                .text = "E:    :F"
-            },
-            // 3: レベル    数値表示    ％
-            {   .mode = false,
-                .state = true,
-                .count = DEFAULT_BLINK_PERIOD,
-                .x_location = 15, .y_location = 1,
-                .text = "%"
-            }     
-            
+        static constexpr size_t frame_item_count = 3;
+        static constexpr FrameText frame[frame_item_count] = {
+            { 4, 0, "/" },          // タイマの経過時間／周期の区切り（スラッシュ）
+            { 8, 0, "E:    :F" },   // レベル    バー表示のフレーム
+            { 15, 1, "%" }          // レベル    数値表示    ％
         };
 
+        // タイマ周期表示の位置と幅  内容はtimer_period
+        static constexpr ItemLayout timer_period_layout = { 5, 0, 2 };
+
 
     // private関数
 
-    void writeItem(ItemProperty& item);
+    void writeItem(const uint8_t index);
+    void writeText(const ItemLayout& layout, const char* text, const bool visible);
+    void markDirty(ItemState& item);
+    void restampDirty(void);
+    void recordLatency(const uint8_t index);
+    void updateBlink(void);
+    void flushScreen(void);
+    uint16_t flushRegion(const uint8_t y, const uint8_t x_begin, const uint8_t x_end, const uint16_t budget);
+    uint8_t writeRun(const uint8_t x, const uint8_t y, const uint8_t length);
+    void resetScreen(const char shadow_fill);
+
+    static void copyText(char* destination, const char* source);
+    static void formatDecimal(char* buffer, const uint8_t width, uint16_t value);
 
     // arrayのサイズを計算
     template < typename TYPE, size_t SIZE >
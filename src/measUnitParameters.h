@@ -9,6 +9,7 @@
     constexpr uint16_t V_MON          = 0x49;   // DAC80501 電圧出力用DAコンバータ
     constexpr uint16_t PIO            = 0x20;   // MCP23008 GPIO IC  電流on/off  電流源エラー読み込み
     constexpr uint16_t LCD            = 0x3E;   // Grove 16x2 LCD ドライバにアドレス指定は不要
+    constexpr uint16_t FRAM           = 0x50;   // MB85RC256V   パラメタ保存用FRAM
     };
 
 // ADの読み値から電圧値を計算するための系数 [/ micro Volts/LSB]
@@ -58,6 +59,10 @@
     //  Vmon用  DAC80501 1Vあたりのカウント(2.5VFS時）  COUNT/V
     constexpr uint16_t VMON_COUNT_PER_VOLT = 26214;
 
+    //  Vmon用  液面[0.1%]あたりのDAカウント  Q16固定小数点 (VMON_COUNT_PER_VOLT/1000 * 65536 を丸め)
+    //      液面1000(100.0%)で 1.72E9 となり uint32_t に収まる
+    constexpr uint32_t VMON_COUNT_PER_LEVEL_Q16 = ((uint32_t)VMON_COUNT_PER_VOLT * 65536UL + 500UL) / 1000UL;
+
     // 計測用定数
     //  連続計測時の計測周期
     constexpr uint16_t CONT_MEAS_INTERVAL = 100; // [x10ms]
@@ -4,19 +4,146 @@
 
 #include "measurement.h"
 #include "measUnitParameters.h"
+#include "I2cBusClock.h"
+#include "I2cProfiler.h"
+#include "I2cBusRecovery.h"
 
 // Methodの実体
 
 /// @brief 内部パラメタの設定、デバイスドライバインスタンスの作成・初期化
 /// @return 正常起動:0  異常発生時はエラーコード
+/// @note ドライバのインスタンスはオブジェクト内の領域に一度だけ構築し、begin()もその時だけ呼ぶ
+///       再度の呼び出しではデバイスの応答を確認して設定だけをやり直すので、ヒープを使わない
 //      bit0 : current_adj_dac 
 //      bit1 : v_mon_dac
 //      bit2 : pio
 //      bit3 : meas_adc エラーを検出できないので常に0
+//      ブロックせずに初期化する場合はinitStep()をE_InitStepの順に呼び出す
 uint16_t Measurement::init(void){
-    // どのハードウエアでエラーが出たかを検出する
-    uint16_t error_code = 0;
+    for (uint8_t step = 0; step < static_cast<uint8_t>(E_InitStep::DONE); step++){
+        initStep(static_cast<E_InitStep>(step));
+        // DAC80501のリセット後は再起動を待つ
+        if (static_cast<E_InitStep>(step) == E_InitStep::V_MON_RESET){
+            delay(DAC80501::RESET_TIME_MS);
+        }
+    }
+    return init_error;
+}  
+
+/// @brief 初期化の1ステップを実行する
+/// @param step 実行するステップ  E_InitStepの順に呼び出すこと
+/// @return これまでのステップでのエラーコード（init()と同じ）
+/// @note V_MON_RESETの後、V_MON_CONFIGUREまでDAC80501::RESET_TIME_MS以上空けること
+uint16_t Measurement::initStep(const E_InitStep step){
+    switch (step){
+        case E_InitStep::PARAMETERS :
+            init_error = 0;
+            initParameters();
+            break;
+
+        case E_InitStep::CURRENT_ADJ :
+        {
+            // 電流源設定用DAC  初期化
+            const bool placed = placeDevice(current_adj_dac, current_adj_dac_storage);
+            I2cClock.select(I2C_ADDR::CURRENT_ADJ);
+            bool detected = false;
+            {
+                I2cProfileScope profile(I2C_ADDR::CURRENT_ADJ, E_I2cComponent::MEASUREMENT, 0);
+                detected = placed ? current_adj_dac->begin(I2C_ADDR::CURRENT_ADJ, &Wire) : detectDevice(I2C_ADDR::CURRENT_ADJ);
+                profile.setAck(detected);
+            }
+            if (detected && setCurrent(p_parameter->current_set_default)) { 
+                // 電流値設定済み
+            } else {
+                if(DEBUG){Serial.println("error on Current Source DAC.  ");}
+                init_error = init_error | 1 ;
+            }
+            break;
+        }
+
+        case E_InitStep::V_MON_RESET :
+            // アナログモニタ用DAC  検出とリセット
+            placeDevice(v_mon_dac, v_mon_dac_storage);
+            I2cClock.select(I2C_ADDR::V_MON);
+            if (!(v_mon_dac->begin(I2C_ADDR::V_MON, &Wire) && v_mon_dac->reset())) { 
+                if(DEBUG){Serial.println("error on Analog Monitor DAC.  ");}
+                init_error = init_error | 2 ;
+            }
+            break;
+
+        case E_InitStep::V_MON_CONFIGURE :
+            // アナログモニタ用DAC  設定  リセットに失敗していたら何もしない
+            if ((init_error & 2) == 0){
+                I2cClock.select(I2C_ADDR::V_MON);
+                if (v_mon_dac->configure() && setVmon(0)) { 
+                    // アナログモニタ出力   リセット済み
+                } else {
+                    if(DEBUG){Serial.println("error on Analog Monitor DAC.  ");}
+                    init_error = init_error | 2 ;
+                }
+            }
+            break;
 
+        case E_InitStep::PIO :
+        {
+            // PIO  初期化  再初期化ではbegin()によるレジスタの初期化は行わず、使うピンだけ設定し直す
+            const bool placed = placeDevice(pio, pio_storage);
+            I2cClock.select(I2C_ADDR::PIO);
+            bool detected = false;
+            {
+                I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 0);
+                detected = placed ? pio->begin(I2C_ADDR::PIO, &Wire) : detectDevice(I2C_ADDR::PIO);
+                profile.setAck(detected);
+            }
+            if (detected) { 
+                //  set IO port     レジスタのread-modify-writeが4回
+                I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 16, 8);
+                pio->pinMode(PIO_PORT::CURRENT_ERRFLAG, INPUT);
+                pio->pullUp(PIO_PORT::CURRENT_ERRFLAG, HIGH);  // turn on a 100K pullup internally
+
+                pio->pinMode(PIO_PORT::CURRENT_ENABLE, OUTPUT);
+                pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_OFF);
+            } else {
+                if(DEBUG){Serial.println("error on PIO.  ");}
+                init_error = init_error | 4 ;
+            }
+            break;
+        }
+
+        case E_InitStep::ADC :
+            //  計測用ADコンバータ設定    PGA=x2   2.048V FS
+            placeDevice(meas_adc, meas_adc_storage, (uint8_t)I2C_ADDR::ADC);
+            I2cClock.select(I2C_ADDR::ADC);
+            meas_adc->begin();
+            meas_adc->setGain(adsGain_t::GAIN_TWO);
+            adc_gain_coeff = ADC_READOUT_VOLTAGE_COEFF::GAIN_TWO;
+
+            // 確認として、インスタンスのアドレスとサイズを印字
+            if(DEBUG){
+                Serial.print("DA-current:"); Serial.print((uintptr_t)current_adj_dac,HEX); Serial.print("/");Serial.println(sizeof(*current_adj_dac));
+                Serial.print("DA-Vmon:"); Serial.print((uintptr_t)v_mon_dac,HEX); Serial.print("/");Serial.println(sizeof(*v_mon_dac));
+                Serial.print("PIO:"); Serial.print((uintptr_t)pio,HEX); Serial.print("/");Serial.println(sizeof(*pio));
+                Serial.print("ADC:"); Serial.print((uintptr_t)meas_adc,HEX); Serial.print("/");Serial.println(sizeof(*meas_adc));
+            }
+            break;
+
+        default:
+            break;
+    }
+    return init_error;
+}
+
+/// @brief デバイスが応答するかを確認する（アドレスのみのトランザクション）
+/// @param address デバイスのI2Cアドレス
+/// @return True:ACK  False:NACK
+/// @note 構築済みのドライバの再初期化で、begin()の代わりに使う
+bool Measurement::detectDevice(const uint16_t address){
+    Wire.beginTransmission(address);
+    return (Wire.endTransmission() == 0);
+}
+
+/// @brief 計測パラメタから内部パラメタを計算し、計測用ICをバスクロックの管理対象にする
+void Measurement::initParameters(void){
     // センサ長から内部パラメタを計算
     sensor_resistance = SENSOR_UNIT_IMP * (float)p_parameter->sensor_length;
     sensor_heat_propagation_time = p_parameter->sensor_length * (uint16_t)(1/HEAT_PROPERGATION_VEROCITY * 1000.0 * 1.2); // [ms]
@@ -39,68 +166,19 @@ uint16_t Measurement::init(void){
     }
     // デバイスの校正値を設定
     // デバイスの校正値はFramから読み込まれてp_parameterに入っているのでそこを直接読む
-    
-    // deviceドライバのインスタンス作成、初期化
-
-    // 電流源設定用DAC  初期化
-    if(current_adj_dac){delete current_adj_dac;}
-    current_adj_dac = new Adafruit_MCP4725;
-    if (current_adj_dac->begin(I2C_ADDR::CURRENT_ADJ, &Wire)) { 
-        // 電流値設定
-        setCurrent(p_parameter->current_set_default);
-    } else {
-        if(DEBUG){Serial.println("error on Current Source DAC.  ");}
-        error_code = error_code | 1 ;
-    }
-
-    // アナログモニタ用DAC  初期化
-    if(v_mon_dac){delete v_mon_dac;}
-    v_mon_dac = new DAC80501;
-    if (v_mon_dac->begin(I2C_ADDR::V_MON, &Wire)) { 
-         if (v_mon_dac->init()) { 
-            // アナログモニタ出力   リセット 
-            setVmon(0);
-        } else {
-            if(DEBUG){Serial.println("error on Analog Monitor DAC.  ");}
-            error_code = error_code | 2 ;
-        }
-    } else {
-        if(DEBUG){Serial.println("error on Analog Monitor DAC.  ");}
-        error_code = error_code | 2 ;
-    }
-
-    // PIO  初期化
-    if(pio){delete pio;}
-    pio = new Adafruit_MCP23008;
-    if (pio->begin(I2C_ADDR::PIO, &Wire)) { 
-        //  set IO port 
-        pio->pinMode(PIO_PORT::CURRENT_ERRFLAG, INPUT);
-        pio->pullUp(PIO_PORT::CURRENT_ERRFLAG, HIGH);  // turn on a 100K pullup internally
-
-        pio->pinMode(PIO_PORT::CURRENT_ENABLE, OUTPUT);
-        pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_OFF);
-    } else {
-        if(DEBUG){Serial.println("error on PIO.  ");}
-        error_code = error_code | 4 ;
-    }
 
-    //  計測用ADコンバータ設定    PGA=x2   2.048V FS
-    if(meas_adc){delete meas_adc;}
-    meas_adc = new Adafruit_ADS1115(I2C_ADDR::ADC);
-    meas_adc->begin();
-    meas_adc->setGain(adsGain_t::GAIN_TWO);
-    adc_gain_coeff = ADC_READOUT_VOLTAGE_COEFF::GAIN_TWO;
+    // Vmon出力の伝達関数の切片を計算  0%=0.1V の出力にオフセット補正を加えたもの
+    //  丸めのための0.5LSB(0x8000)も含めておく
+    vmon_da_intercept_q16 = ((uint32_t)(uint16_t)((VMON_COUNT_PER_VOLT / 10) - p_parameter->vmon_da_offset) << 16) + 0x8000UL;
 
-    // 確認として、インスタンスのアドレスとサイズを印字
-    if(DEBUG){
-        Serial.print("DA-current:"); Serial.print((uint32_t)current_adj_dac,HEX); Serial.print("/");Serial.println(sizeof(*current_adj_dac));
-        Serial.print("DA-Vmon:"); Serial.print((uint32_t)v_mon_dac,HEX); Serial.print("/");Serial.println(sizeof(*v_mon_dac));
-        Serial.print("PIO:"); Serial.print((uint32_t)pio,HEX); Serial.print("/");Serial.println(sizeof(*pio));
-        Serial.print("ADC:"); Serial.print((uint32_t)meas_adc,HEX); Serial.print("/");Serial.println(sizeof(*meas_adc));
-    }
 
-    return error_code;
-}  
+    // 計測用ICをバスクロックの管理対象にする  バスはこれらに共通の最高速度で動かす
+    I2cClock.setActive(I2C_ADDR::CURRENT_ADJ, true);
+    I2cClock.setActive(I2C_ADDR::V_MON, true);
+    I2cClock.setActive(I2C_ADDR::PIO, true);
+    I2cClock.setActive(I2C_ADDR::ADC, true);
+    return;
+}
 
 /// @brief CLKに同期した処理を行います 
 /// @note 連続計測の計測周期の管理を行っています  
@@ -261,20 +339,36 @@ void Measurement::executeMeasurement(void){
     if(DEBUG){Serial.print("execMeas::start "); Serial.print(micros());Serial.print(" ");}
 
     // uint16_t result = 0;
+    bool adc_failed = false;
     if (getCurrentSourceStatus()){
         sensor_error = false;
-        measured_level = read_level();
-        result_ready = true;
+        uint16_t level = 0;
+        // 取得時刻はADCを読む前に記録する  I2Cのリトライで読み出しが遅れても取得時刻は動かない
+        const uint32_t acquired_ms = millis();
+        if (read_level(level)){
+            measured_level = level;
+            measured_ms = acquired_ms;
+            result_ready = true;
+            if (first_result_ms == 0){
+                first_result_ms = millis();
+            }
+        } else {
+            // ADCが応答しない  読み値が0なのか通信エラーなのか区別できないので計測を中断する
+            //  センサの異常ではないので、センサエラー（LCDの-ERROR-表示）にはしない
+            if(DEBUG){Serial.print("-ADC I2C error- ");}
+            device_error = true;
+            adc_failed = true;
+        }
     } else {
         sensor_error = true;
     }
 
-    // Sensorエラー処理（異常終了）
-    if (sensor_error){
+    // Sensorエラー・計測用ICの通信エラー処理（異常終了）
+    if (sensor_error || adc_failed){
         if(DEBUG){Serial.print("-sensorError  - ");}
         //センサエラー（測定中にエラー発生）なら計測を終了して帰る
         if(DEBUG){Serial.println("Measurement Treminate by error.");}
-        terminateMeasurement();
+        terminateMeasurement(true);
         return;
     }
 
@@ -294,7 +388,7 @@ void Measurement::executeMeasurement(void){
     //      外部で出力するようにしなくてもいいか？？？
     setVmon(measured_level);
 
-    if(DEBUG){Serial.println("execMeas::End ");}
+    if(DEBUG){Serial.print("execMeas::End "); Serial.println(micros());}
 }
 
 /// @brief I2Cバスの明け渡し要求
@@ -321,6 +415,15 @@ bool Measurement::haveFailedMesasurement(void){
     return temp;
 }
 
+/// @brief 計測用ICの通信エラーの状態を読み出す
+/// @return True:エラー False:正常
+/// @note 計測中にADCが応答しなかった場合にセットされます。一度読み出すとfalseにリセットされます
+bool Measurement::isDeviceError(void){
+    bool temp = device_error;
+    device_error = false;
+    return temp;
+}
+
 /// @brief センサエラーの状態を読み出す
 /// @return True:エラー False:正常
 /// @note LCD表示への信号
@@ -344,16 +447,40 @@ uint16_t Measurement::getResult(void){
     return measured_level;
 }
 
+/// @brief 測定結果の取得時刻を返す
+/// @return millis()の値 [ms]  getResult()の値をADCから読み始めた時刻
+/// @note IotGatewayはこの時刻をホストの時刻に変換してタイムスタンプとして送る
+uint32_t Measurement::getResultTime(void){
+    return measured_ms;
+}
+
+/// @brief 最初に計測結果が得られた時刻を返す
+/// @return millis()の値 [ms]  0:まだ得られていない
+/// @note 起動から最初の計測までの時間の評価用
+uint32_t Measurement::getFirstResultTime(void){
+    return first_result_ms;
+}
+
 /*!
  * @brief 電流源をonにする
  */
 bool Measurement::currentOn(void){
     if(DEBUG){Serial.print("currentCtrl:ON --  ");} 
-    pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_ON);
+    I2cClock.select(I2C_ADDR::PIO);
+    {
+        I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 4, 2);
+        pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_ON);
+    }
     delay(10); // エラー判定が可能になるまで10ms待つ
     
-    if (pio->digitalRead(PIO_PORT::CURRENT_ERRFLAG) == LOW){
+    uint8_t err_flag = HIGH;
+    {
+        I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 2);
+        err_flag = pio->digitalRead(PIO_PORT::CURRENT_ERRFLAG);
+    }
+    if (err_flag == LOW){
         // f_sensor_error = true;
+        I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 4, 2);
         pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_OFF);
         if(DEBUG){Serial.print(" FAIL.  ");}
     } else {
@@ -383,7 +510,11 @@ bool Measurement::currentOn(void){
 void Measurement::currentOff(void){
     // if(DEBUG){Serial.println("CurrentSoruce OFF");}
     if(DEBUG){Serial.print("currentCtrl:OFF  -- ");}
-    pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_OFF);      
+    I2cClock.select(I2C_ADDR::PIO);
+    {
+        I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 4, 2);
+        pio->digitalWrite(PIO_PORT::CURRENT_ENABLE, CURRENT_OFF);      
+    }
     if(DEBUG){Serial.println(" Fin. --");}
     return ;
 }
@@ -391,17 +522,28 @@ void Measurement::currentOff(void){
 /*!
  * @brief 電流源を設定する
  * @param current 設定電流値[0.1mA]
+ * @return True:設定完了  False:設定範囲外もしくはDAが応答しない
  */
-void Measurement::setCurrent(const uint16_t& current){
+bool Measurement::setCurrent(const uint16_t& current){
     if(DEBUG){Serial.print("CurrentSoruce set ");Serial.println(current);}
     if ( 670 < current && current < 830){
         uint16_t value = (( current - 666 ) * DAC_COUNT_PER_VOLT) / CURRENT_SORCE_VI_COEFF;
         if(DEBUG){Serial.print(" value:"); Serial.print(value);}
         // current -> vref converting function
-        current_adj_dac->setVoltage(value, false);
-        if(DEBUG){Serial.println(" - DAC changed. " );}
+        //  バスクロックはI2cBusClockに任せる（ドライバでは変更しない）
+        bool result = false;
+        {
+            I2cProfileScope profile(I2C_ADDR::CURRENT_ADJ, E_I2cComponent::MEASUREMENT, 3);
+            result = I2cRecovery.execute(I2C_ADDR::CURRENT_ADJ, [this, value](){
+                I2cClock.select(I2C_ADDR::CURRENT_ADJ);   // バスの回復後のリトライでも設定し直す
+                return current_adj_dac->setVoltage(value, false);
+            });
+            profile.setAck(result);
+        }
+        if(DEBUG){Serial.println(result ? " - DAC changed. " : " - DAC error. ");}
+        return result;
       }
-    return;
+    return false;
 }
 
 /*!
@@ -410,6 +552,8 @@ void Measurement::setCurrent(const uint16_t& current){
  */
 bool Measurement::getCurrentSourceStatus(void){
     if(DEBUG){Serial.print("C-C ");}
+    I2cClock.select(I2C_ADDR::PIO);
+    I2cProfileScope profile(I2C_ADDR::PIO, E_I2cComponent::MEASUREMENT, 4, 2);
 
     return (   (pio->digitalRead(PIO_PORT::CURRENT_ENABLE ) == CURRENT_ON)  \
             && (pio->digitalRead(PIO_PORT::CURRENT_ERRFLAG) == HIGH)        \
@@ -425,29 +569,25 @@ bool Measurement::getCurrentSourceStatus(void){
 }
 
 /// @brief 電圧モニタ出力を設定する 
-/// @param vout 出力電圧[0.1V] 
-void Measurement::setVmon(const uint16_t& vout){
+/// @param vout 液面[0.1%]  100.0%以上は100.0%として出力
+/// @return True:設定完了  False:DAが応答しない
+/// @note 100.0% = 1.1V, 0%=0.1V 
+///       傾き・切片は固定小数点で事前に計算してあるので、除算なしでCLK周期でも呼び出せる
+bool Measurement::setVmon(const uint16_t& vout){
     if(DEBUG){Serial.print("Vout: set ");Serial.println(vout);}
-    uint16_t da_value=0;
 
-    //  100.0%以下の値ならそのまま設定、100.0%以上なら100.0%として設定
-    if (vout <= 1000) {
-        // da_value = ( VMON_COUNT_PER_VOLT * (value + 100) ) / 1000;
-        da_value = (( VMON_COUNT_PER_VOLT * vout ) / 1000) + (uint16_t)((VMON_COUNT_PER_VOLT / 10) - p_parameter->vmon_da_offset );
+    const uint32_t level = (vout < 1000) ? vout : 1000;
+    const uint16_t da_value = (uint16_t)((level * VMON_COUNT_PER_LEVEL_Q16 + vmon_da_intercept_q16) >> 16);
 
-    //     100.0% = 1.1V, 0%=0.1V 
-    } else {
-        da_value = (( VMON_COUNT_PER_VOLT * 1000 ) / 1000) + (uint16_t)((VMON_COUNT_PER_VOLT / 10) - p_parameter->vmon_da_offset );
-    }
-    v_mon_dac->setVoltage(da_value);
-
-    return;
+    I2cClock.select(I2C_ADDR::V_MON);
+    return v_mon_dac->setVoltage(da_value);
 }
 
 /// @brief  電圧モニタ出力にエラーを提示する（0V) 
 /// @param  void
 void Measurement::setVmonFailed(void){
     if(DEBUG){Serial.println("Vout: Error indicate.");}
+    I2cClock.select(I2C_ADDR::V_MON);
     v_mon_dac->setVoltage((uint16_t) 0);
     return;
 }
@@ -458,13 +598,14 @@ void Measurement::setVmonFailed(void){
 
 //
 // @brief 測定を終了する
+// @param failed True:計測用ICの通信エラーなどで異常終了する（センサエラーの場合は指定しなくても異常終了）
 //
-void Measurement::terminateMeasurement(void){
+void Measurement::terminateMeasurement(const bool failed){
     should_measure = false;
     currentOff();
     // present_mode = E_Modes::TIMER;
     busy_now = false;
-    if (sensor_error){      // センサーエラーでターミネートされたら異常終了
+    if (sensor_error || failed){      // センサーエラー・通信エラーでターミネートされたら異常終了
 
         single_last_meas = false;   //１回計測用のフラグをクリア
         single_meas_counter = 0;
@@ -477,40 +618,59 @@ void Measurement::terminateMeasurement(void){
 }
 
 // @brief 電圧を読み取る
-// @return 電圧値[/uV]
+// @param voltage 電圧値[/uV]
+// @return True:正常  False:ADCが応答しない
 // @note 回路定数から逆算して実際のセンサ両端の電圧を返します 
-uint32_t Measurement::read_voltage(void){
+bool Measurement::read_voltage(uint32_t& voltage){
     if(DEBUG){Serial.print("RVol ");}
-    uint32_t result = (uint32_t)((float)read_raw_voltage(0) * ATTENUATOR_COEFF);
-    if(DEBUG){Serial.print(":"); Serial.print(result); Serial.println(" uV: Fin. --");}
+    int32_t raw = 0;
+    const bool result = read_raw_voltage(0, raw);
+    voltage = (uint32_t)((float)raw * ATTENUATOR_COEFF);
+    if(DEBUG){Serial.print(":"); Serial.print(voltage); Serial.println(" uV: Fin. --");}
     return result;
 }
 
 // @brief 電流を読み取る
-// @return 電流値[/uA]
+// @param current 電流値[/uA]
+// @return True:正常  False:ADCが応答しない
 // @note 電流検出回路の定数と計測電圧を基にセンサに流れている電流を計算し返します
-uint32_t Measurement::read_current(void){
+bool Measurement::read_current(uint32_t& current){
     if(DEBUG){Serial.print("RCur ");}
-    uint32_t result = (uint32_t)((float)read_raw_voltage(1) / CURRENT_MEASURE_COEFF); // convert voltage to current.
-    if(DEBUG){Serial.print(":"); Serial.print(result);Serial.println(" uA: Fin. --");}
+    int32_t raw = 0;
+    const bool result = read_raw_voltage(1, raw);
+    current = (uint32_t)((float)raw / CURRENT_MEASURE_COEFF); // convert voltage to current.
+    if(DEBUG){Serial.print(":"); Serial.print(current);Serial.println(" uA: Fin. --");}
     return result;
 }
 
 // @brief ADCの指定チャネルを動作させ電圧値を読み取ります
 // @param チャネル指定 uint8_t 0:ch 0-1 / 1:ch 2-3
-// @return  指定したチャネルの電圧値[micro Volt]
-int32_t Measurement::read_raw_voltage(const uint8_t channel){
+// @param voltage 指定したチャネルの電圧値[micro Volt]
+// @return True:正常  False:ADCが応答しない（読み値は無効）
+// @note ADS1115のドライバは通信エラーを返さないので、読み取りの前後でADCの応答を確認する
+bool Measurement::read_raw_voltage(const uint8_t channel, int32_t& voltage){
     occupy_the_bus = true;
 
     if(DEBUG){Serial.print("rawV ch:");Serial.print(channel);Serial.print(":");}
+    I2cClock.select(I2C_ADDR::ADC);
+    if (!I2cRecovery.check(I2C_ADDR::ADC)){
+        occupy_the_bus = false;
+        voltage = 0;
+        return false;
+    }
+
     uint32_t readout = 0;
     for (uint16_t i = 0; i < ADC_AVERAGE_DEFAULT; i++){
         int16_t temp = 0;
+        //  コンフィグ書き込み3byte + ポインタ1byte + 読み出し2byte  変換待ち(8ms)を含む
+        I2cProfileScope profile(I2C_ADDR::ADC, E_I2cComponent::MEASUREMENT, 6, 3);
         if (channel == 0){
-            temp = (meas_adc->readADC_Differential_0_1() - p_parameter->adc_OFS_comp_diff_0_1);
+            temp = meas_adc->readADC_Differential_0_1();
         } else {
-            temp = (meas_adc->readADC_Differential_2_3() - p_parameter->adc_OFS_comp_diff_2_3);
+            temp = meas_adc->readADC_Differential_2_3();
         }
+        I2cRecovery.filterRead(I2C_ADDR::ADC, (uint8_t*)&temp, sizeof(temp));
+        temp = temp - ((channel == 0) ? p_parameter->adc_OFS_comp_diff_0_1 : p_parameter->adc_OFS_comp_diff_2_3);
         if(DEBUG){Serial.print(", "); Serial.print(temp); } 
         readout += temp;
     }
@@ -522,25 +682,33 @@ int32_t Measurement::read_raw_voltage(const uint8_t channel){
     }
     float_t result = (float)(readout / ADC_AVERAGE_DEFAULT) * adc_gain_coeff * gain_comp; // reading in microVolt
 
+    // 読み取り中にADCが応答しなくなっていないか
+    const bool responded = I2cRecovery.check(I2C_ADDR::ADC);
+
     occupy_the_bus = false;
-    return round(result);
+    voltage = round(result);
+    return responded;
 };
 
 
 /// @brief 液面計測を実行
-/// @param void 
-/// @return uint16_t 液面 [0.1%] 
-uint16_t Measurement::read_level(void){
-    // uint32_t voltage = read_voltage();
-    // uint32_t current = read_current();
+/// @param level 液面 [0.1%] 
+/// @return True:正常  False:ADCが応答しない（levelは変更しない）
+bool Measurement::read_level(uint16_t& level){
+    uint32_t voltage = 0;
+    uint32_t current = 0;
+    if (!read_voltage(voltage) || !read_current(current)){
+        return false;
+    }
     // レベルの計算・補正
-    float_t ratio = ((float)read_voltage()/(float)read_current()) / sensor_resistance ;
+    float_t ratio = ((float)voltage/(float)current) / sensor_resistance ;
     if(DEBUG){Serial.print(" Resistance = "); Serial.println( ratio * sensor_resistance);}
     if(DEBUG){Serial.print(" Ratio = "); Serial.println( ratio, 4 );}
     // センサの抵抗値誤差のマージンを2%とって確実にゼロ表示ができるようにする
     int16_t result = round((1.0 - ratio*1.02) * 1000);
     level_scaling(result, p_parameter->scale_100, p_parameter->scale_0);
-    return (uint16_t)result;
+    level = (uint16_t)result;
+    return true;
 }
 
 // @brief 液面測定値をスケーリングする
@@ -15,11 +15,12 @@
 #define _MEASUREMENT_H_
 
 #include <Arduino.h>
+#include <new>
 
 // デバイスのドライバ
 #include <Adafruit_ADS1015.h>   // ADC 16bit diff - 2ch
-#include <Adafruit_MCP23008.h>  // PIO 8bit
-#include <Adafruit_MCP4725.h>   // DAC  12bit 
+#include "MCP23008.h"           // PIO 8bit
+#include "MCP4725.h"            // DAC  12bit
 #include "DAC80501.h"           // DAC 16bit for Analog Mon Out
 
 class Measurement {
@@ -49,7 +50,7 @@ class Measurement {
     struct MesasUintParameters{
         //  センサ長 [inch]
         uint8_t sensor_length;
-        //  タイマ設定  [s]
+        //  タイマ設定  [min]  TimeSwitch::init()に渡す
         uint16_t timer_period;
         //  スケーリング
         //      100%表示をセンサ長の何%に設定するか [0.1%]
@@ -72,6 +73,19 @@ class Measurement {
     };
 
 
+    /*!
+    * @brief 初期化のステップ  この順に実行する
+    */
+    enum class E_InitStep : uint8_t{
+        PARAMETERS = 0,     // 内部パラメタの計算
+        CURRENT_ADJ,        // 電流源設定用DAC
+        V_MON_RESET,        // アナログモニタ用DAC  リセット
+        V_MON_CONFIGURE,    // アナログモニタ用DAC  設定（リセットからDAC80501::RESET_TIME_MS以上後）
+        PIO,                // PIO
+        ADC,                // 計測用ADC
+        DONE
+    };
+
     // instances
 
     // vars
@@ -85,15 +99,24 @@ class Measurement {
         p_parameter = ptr;
     };
 
+    // デバイスのインスタンスをこのオブジェクトの中に置くので、コピーできない
+    Measurement(const Measurement&) = delete;
+    Measurement& operator=(const Measurement&) = delete;
+
     /*!
     * @brief deconstructor
     *  
     */
     ~Measurement(){
+        if (current_adj_dac){current_adj_dac->~MCP4725();}
+        if (v_mon_dac){v_mon_dac->~DAC80501();}
+        if (pio){pio->~MCP23008();}
+        if (meas_adc){meas_adc->~Adafruit_ADS1115();}
     };
 
 
     uint16_t init(void);
+    uint16_t initStep(const E_InitStep step);
     void clk_in(void);
 
  
@@ -108,8 +131,11 @@ class Measurement {
     bool shouldMeasure(void);
     void executeMeasurement(void);
     bool isSensorError(void); 
+    bool isDeviceError(void); 
     bool isResultReady(void); 
     uint16_t getResult(void); 
+    uint32_t getResultTime(void);
+    uint32_t getFirstResultTime(void);
 
     //  statemachineへのフィードバック 
     bool haveFinishedMeasurement(void); //正常測定完了信号      statemachine用    モーメンタリ
@@ -119,7 +145,7 @@ class Measurement {
     bool shouldVacateI2Cbus(void);
 
     //  モニタ出力制御
-    void setVmon(const uint16_t& vout);
+    bool setVmon(const uint16_t& vout);
     void setVmonFailed(void);
 
     private:
@@ -129,13 +155,19 @@ class Measurement {
     constexpr static bool DEBUG = true;
 
     // instances
-    // デバイスのインスタンスへのポインタ 
+    // デバイスのインスタンスを置く領域  ヒープは使わず、このオブジェクトの中に構築する
+    alignas(MCP4725)            uint8_t current_adj_dac_storage[sizeof(MCP4725)];
+    alignas(DAC80501)           uint8_t v_mon_dac_storage[sizeof(DAC80501)];
+    alignas(MCP23008)           uint8_t pio_storage[sizeof(MCP23008)];
+    alignas(Adafruit_ADS1115)   uint8_t meas_adc_storage[sizeof(Adafruit_ADS1115)];
+
+    // デバイスのインスタンスへのポインタ  構築前はnullptr
     //  電流設定用DAコンバータ
-    Adafruit_MCP4725*   current_adj_dac = nullptr;
+    MCP4725*            current_adj_dac = nullptr;
     // //  アナログモニタ出力用DAコンバータ
     DAC80501*           v_mon_dac = nullptr;
     // //  電流源制御用    GPIO
-    Adafruit_MCP23008*  pio = nullptr;
+    MCP23008*           pio = nullptr;
     // //  電圧・電流読み取り用ADコンバータ
     Adafruit_ADS1115*   meas_adc = nullptr;
 
@@ -147,10 +179,15 @@ class Measurement {
     uint16_t sensor_heat_propagation_time;
     //  液面計測結果
     uint16_t measured_level = 0;
+    //  液面計測結果の取得時刻（ADCを読み始めたmillis()） [ms]
+    uint32_t measured_ms = 0;
 
     //  センサエラーフラグ
     bool sensor_error = false;
 
+    //  計測用ICの通信エラーフラグ
+    bool device_error = false;
+
     // リソースが命令実行中
     bool busy_now = false;
 
@@ -181,6 +218,16 @@ class Measurement {
     // 計測用ADCゲイン係数 mirco volt/LSB
     float adc_gain_coeff = 0.0;
 
+    // Vmon出力DAの切片（0.1V出力時のカウント、オフセット補正込み） Q16固定小数点
+    //  init()でvmon_da_offsetから計算しておく
+    uint32_t vmon_da_intercept_q16 = 0;
+
+    // 初期化時のエラーコード  init()の戻り値
+    uint16_t init_error = 0;
+
+    // 最初に計測結果が得られた時刻 [ms]  0:まだ得られていない
+    uint32_t first_result_ms = 0;
+
     //  現在の動作モードを保持
     E_Modes present_mode = E_Modes::TIMER;
 
@@ -189,17 +236,37 @@ class Measurement {
     //  電流源制御
     bool currentOn(void);
     void currentOff(void);
-    void setCurrent(const uint16_t& current = 750);
+    bool setCurrent(const uint16_t& current = 750);
     bool getCurrentSourceStatus(void);
 
+    // 初期化
+    void initParameters(void);
+    bool detectDevice(const uint16_t address);
+
     // 計測制御
-    void terminateMeasurement(void);
+    void terminateMeasurement(const bool failed = false);
+
+    /// @brief デバイスのインスタンスを領域内に構築する（構築済みならそのまま使う）
+    /// @param instance インスタンスへのポインタ
+    /// @param storage インスタンスを置く領域
+    /// @param args コンストラクタの引数
+    /// @return True:今回構築した（begin()を呼ぶ）  False:構築済み
+    /// @note begin()は構築した時の1回だけ呼ぶ。再初期化ではdetectDevice()で応答を確認し、設定だけをやり直す
+    ///       どのドライバもI2Cデバイスをオブジェクトの中に持つので、begin()を含めてヒープは使わない
+    template <typename T, typename... Args>
+    bool placeDevice(T*& instance, uint8_t* storage, Args... args){
+        if (instance){
+            return false;
+        }
+        instance = new (storage) T(args...);
+        return true;
+    };
 
     //  電圧・電流値の読み取り
-    int32_t  read_raw_voltage(const uint8_t channel);
-    uint32_t read_voltage(void);
-    uint32_t read_current(void);
-    uint16_t read_level(void);
+    bool read_raw_voltage(const uint8_t channel, int32_t& voltage);
+    bool read_voltage(uint32_t& voltage);
+    bool read_current(uint32_t& current);
+    bool read_level(uint16_t& level);
     void level_scaling(int16_t& level, const uint16_t& hiside_scle = 1000, const uint16_t& lowside_scale = 0);
 
 };
@@ -94,6 +94,34 @@ bool Statemachine::setTransitSignal(const E_Transit signal){
     return (updated);
 }
 
+/*!
+    * @brief 指定した状態へ直接遷移させます（リモートコマンド用）
+    * @param  target 遷移先の状態
+    * @return true: statusが更新された false: 更新なし（すでにその状態、MANUALとCONTの間）
+    * @note タイマモードへは計測停止、タイマモードからは計測開始のコマンドをセットする
+    *       MANUALとCONTの間は遷移しない  スイッチ操作でも遷移できず、計測部は1回計測と連続計測を
+    *       途中で切り替えられないので、一度TIMERへ遷移させる
+    */
+bool Statemachine::requestStatus(const E_Status target){
+    if(DEBUG){Serial.print("(Request:"); Serial.print(ModeInd[static_cast<uint8_t>(target)]); Serial.print(")");}
+    previous_machine_status = machine_status;
+
+    if (target == machine_status){
+        command = E_MeasCommand::IDLE;
+    } else if (target == E_Status::TIMER){
+        command = E_MeasCommand::STOP;
+        machine_status = target;
+    } else if (machine_status == E_Status::TIMER){
+        command = E_MeasCommand::START;
+        machine_status = target;
+    } else {
+        command = E_MeasCommand::IDLE;
+    }
+
+    updated = (previous_machine_status != machine_status);
+    return (updated);
+}
+
 /*!
 * @brief 状態遷移が行われたかどうかを返します
 * @return true: statusが更新された false: 更新なし
@@ -70,6 +70,7 @@ class Statemachine {
         };
 
         bool setTransitSignal(const E_Transit signal);
+        bool requestStatus(const E_Status target);
         bool hasStatusUpdated(void);
         E_MeasCommand getMeasCommand(void);
         E_Status getStatus(void);